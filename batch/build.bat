@@ -2,7 +2,7 @@
 
 REM take away d from -MTd in release
 set CommonCompilerFlags=-MTd -nologo -fp:fast -Gm- -GR- -EHa- -Od -Oi -WX -W4 -wd4201 -wd4100 -wd4189 -wd4505 -DENGINE_INTERNAL=1 -DENGINE_SLOW=1 -FC -Z7
-set CommonLinkerFlags= -incremental:no -opt:ref user32.lib gdi32.lib winmm.lib
+set CommonLinkerFlags= -incremental:no -opt:ref user32.lib gdi32.lib winmm.lib synchronization.lib
 
 IF NOT EXIST build mkdir build
 pushd build
@@ -19,4 +19,10 @@ cl  %CommonCompilerFlags% ..\code\engine.cpp  -Fmengine.map -LD /link -increment
 del lock.tmp
 cl  %CommonCompilerFlags% ..\code\win32_engine.cpp  -Fmwin32_engine.map /link %CommonLinkerFlags%
 
+REM Console benchmarks
+cl  %CommonCompilerFlags% ..\code\engine_bench.cpp  -Fmengine_bench.map /link -incremental:no -opt:ref
+
+REM Asset packer
+cl  %CommonCompilerFlags% ..\code\engine_asset_packer.cpp  -Fmengine_asset_packer.map /link -incremental:no -opt:ref
+
 popd
\ No newline at end of file
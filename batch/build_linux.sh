@@ -0,0 +1,24 @@
+#!/bin/bash
+
+# Run from the repository root, builds into ./build like build.bat
+# take away -DENGINE_SLOW=1 in release
+CommonCompilerFlags="-g -O2 -ffast-math -fno-exceptions -fno-rtti -msse4.1 -Wall -DENGINE_INTERNAL=1 -DENGINE_SLOW=1"
+
+mkdir -p build
+pushd build > /dev/null
+
+# Game code, the host loads it with dlopen and reloads it when it changes
+echo WAITING FOR SO > lock.tmp
+g++ $CommonCompilerFlags -shared -fPIC ../code/engine.cpp -o engine.so
+rm -f lock.tmp
+
+# Headless host
+g++ $CommonCompilerFlags ../code/linux_engine.cpp -o linux_engine -ldl -lpthread
+
+# Console benchmarks
+g++ $CommonCompilerFlags ../code/engine_bench.cpp -o engine_bench
+
+# Asset packer
+g++ $CommonCompilerFlags ../code/engine_asset_packer.cpp -o engine_asset_packer
+
+popd > /dev/null
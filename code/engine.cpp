@@ -3,36 +3,65 @@
  */
 
 #include "engine.h"
+#include <tmmintrin.h>
+#include "engine_tile_chunk.cpp"
+#include "engine_world_file.cpp"
 #include "engine_tile.cpp"
+#include "engine_tile_type.cpp"
+#include "engine_tile_journal.cpp"
+#include "engine_region.cpp"
+#include "engine_light.cpp"
+#include "engine_fov.cpp"
+#include "engine_path.cpp"
+#include "engine_ray.cpp"
+#include "engine_tile_render.cpp"
+#include "engine_asset.cpp"
 #include "engine_random.h"
 
+// Mixes the footstep over silence. A footstep that is not resident yet is skipped over rather than played late.
 internal void
-GameOutputSound(game_sound_output_buffer* soundBuffer, game_state* gameState, int toneHz) {
-	int16 toneVolume = 3000;
-	int wavePeriod = soundBuffer->mSamplesPerSecond / toneHz;
+GameOutputSound(game_sound_output_buffer* soundBuffer, game_state* gameState, game_memory* memory) {
+	loaded_sound footstep = {};
+	if (soundBuffer->mSamplesPerSecond == ASSET_SOUND_SAMPLES_PER_SECOND) {
+		footstep = GetCachedSound(memory, &gameState->mAssetCache, gameState->mFootstepID);
+	}
 
 	int16* sampleOut = soundBuffer->mSamples;
 	for (int sampleIndex = 0; sampleIndex < soundBuffer->mSampleCount; ++sampleIndex) {
-		int16 sampleValue = 0;
-		*sampleOut++ = sampleValue;
-		*sampleOut++ = sampleValue;
+		int16 left = 0;
+		int16 right = 0;
+		uint32 footstepIndex = gameState->mFootstepSampleIndex + (uint32)sampleIndex;
+		if (footstepIndex < footstep.mSampleCount) {
+			left = footstep.mSamples[2*footstepIndex + 0];
+			right = footstep.mSamples[2*footstepIndex + 1];
+		}
+		*sampleOut++ = left;
+		*sampleOut++ = right;
+	}
+
+	if (gameState->mFootstepID) {
+		gameState->mFootstepSampleIndex += (uint32)soundBuffer->mSampleCount;
+		if (gameState->mFootstepSampleIndex >= gameState->mAssets.mAssets[gameState->mFootstepID].mSound.mSampleCount) {
+			gameState->mFootstepID = 0;
+		}
 	}
 }
 
 internal void
-DrawBitmap(game_offscreen_buffer* buffer, loaded_bitmap* bitmap, real32 realX, real32 realY, int32 alignX = 0, int32 alignY = 0)) {
+DrawBitmap(game_offscreen_buffer* buffer, loaded_bitmap* bitmap, real32 realX, real32 realY, int32 alignX = 0, int32 alignY = 0) {
+	TIMED_FUNCTION();
 	realX -= (real32)alignX;
 	realY -= (real32)alignY;
 
-	int32 min = RoundReal32ToInt32(realX);
+	int32 minX = RoundReal32ToInt32(realX);
 	int32 minY = RoundReal32ToInt32(realY);
 	int32 maxX = RoundReal32ToInt32(realX + (real32)bitmap->mWidth);
 	int32 maxY = RoundReal32ToInt32(realY + (real32)bitmap->mHeight);
 
 	int32 sourceOffsetX = 0;
-	if (min < 0) {
+	if (minX < 0) {
 		sourceOffsetX = -minX;
-		min = 0;
+		minX = 0;
 	}
 
 	int32 sourceOffsetY = 0;
@@ -59,7 +88,7 @@ DrawBitmap(game_offscreen_buffer* buffer, loaded_bitmap* bitmap, real32 realX, r
 		uint32* dest = (uint32*)destRow;
 		uint32* source = sourceRow;
 
-		for (int X = min; X < maxX; ++X) {
+		for (int X = minX; X < maxX; ++X) {
 			real32 A = (real32)((*source >> 24) & 0xFF) / 255.0f;
 			real32 SR = (real32)((*source >> 16) & 0xFF);
 			real32 SG = (real32)((*source >> 8) & 0xFF);
@@ -69,9 +98,10 @@ DrawBitmap(game_offscreen_buffer* buffer, loaded_bitmap* bitmap, real32 realX, r
 			real32 DG = (real32)((*dest >> 8) & 0xFF);
 			real32 DB = (real32)((*dest >> 0) & 0xFF);
 
-			real32 R = (1.0f - A)*DR + A * SR;
-			real32 G = (1.0f - A)*DG + A * SG;
-			real32 B = (1.0f - A)*DB + A * SB;
+			// Bitmap colors are premultiplied by their alpha
+			real32 R = (1.0f - A)*DR + SR;
+			real32 G = (1.0f - A)*DG + SG;
+			real32 B = (1.0f - A)*DB + SB;
 
 			*dest = (((uint32)(R + 0.5f) << 16) |
 					((uint32)(G + 0.5f) << 8) |
@@ -160,59 +190,295 @@ struct bitmap_header {
 	uint32 mColorsUsed;
 	uint32 mColorsImportant;
 
+	// Only there for bit field files, in the header or right after it
 	uint32 mRedMask;
 	uint32 mGreenMask;
 	uint32 mBlueMask;
+	uint32 mAlphaMask;
 };
 #pragma pack(pop)
 
-// TODO: Create a robust BMP loader
-internal loaded_bitmap
-DEBUGLoadBMP(thread_context* thread, debug_platform_read_entire_file* readEntireFile, char* fileName) {
-	loaded_bitmap result;
-	//MemoryZeroClear(result, sizeof(loaded_bitmap));
+#define BITMAP_FILE_TYPE 0x4D42  // BM
+#define BITMAP_FILE_HEADER_SIZE 14
+#define BITMAP_INFO_HEADER_SIZE 40
+#define BITMAP_V3_INFO_HEADER_SIZE 56  // The first header with an alpha mask
 
-	// Byte order in memory is AA BB GG RR, bottom up.
-	// In little endian -> 0xRRGGBBAA
+#define BITMAP_COMPRESSION_RGB 0
+#define BITMAP_COMPRESSION_BITFIELDS 3
+#define BITMAP_COMPRESSION_ALPHA_BITFIELDS 6
 
-	debug_read_file_result readResult = readEntireFile(thread, fileName);
-	if (readResult.mContentsSize != 0) {
-		bitmap_header* header = (bitmap_header*)readResult.mContents;
-		uint32* pixels = (uint32*)((uint8*)readResult.mContents + header->mBitmapOffset);
-		result.mPixels = pixels;
-		result.mWidth = header->mWidth;
-		result.mHeight = header->mHeight;
+// Channels in 0xAARRGGBB order from the low byte up: blue, green, red, alpha
+#define BITMAP_CHANNEL_COUNT 4
+
+// How a 32 bit BMP's pixels become 0xAARRGGBB
+struct bitmap_layout {
+	uint32 mMasks[BITMAP_CHANNEL_COUNT];  // An alpha mask of 0 means opaque
+	uint32 mShifts[BITMAP_CHANNEL_COUNT];
+	uint32 mBitCounts[BITMAP_CHANNEL_COUNT];
+
+	// Set when every channel is a whole byte, a byte shuffle then does the swizzle four pixels at a time
+	bool32 mIsByteAligned;
+	__m128i mShuffle;
+	__m128i mOpaque;
+};
+
+// Scales the color channels of 0xAARRGGBB by its alpha, rounding to the nearest
+inline uint32
+PremultiplyAlpha(uint32 color) {
+	uint32 alpha = (color >> 24) & 0xFF;
+	uint32 red = (((color >> 16) & 0xFF)*alpha + 127) / 255;
+	uint32 green = (((color >> 8) & 0xFF)*alpha + 127) / 255;
+	uint32 blue = ((color & 0xFF)*alpha + 127) / 255;
+	uint32 result = ((alpha << 24) | (red << 16) | (green << 8) | blue);
+	return result;
+}
+
+// False when the mask is empty or has gaps
+internal bool32
+SetBitmapChannel(bitmap_layout* layout, uint32 channelIndex, uint32 mask) {
+	bit_scan scan = FindLeastSignificantSetBit(mask);
+	uint32 shifted = scan.mFound ? (mask >> scan.mIndex) : 0;
+	bool32 result = (scan.mFound && ((shifted & (shifted + 1)) == 0));
+	if (result) {
+		layout->mMasks[channelIndex] = mask;
+		layout->mShifts[channelIndex] = scan.mIndex;
+		layout->mBitCounts[channelIndex] = 0;
+		while (shifted) {
+			++layout->mBitCounts[channelIndex];
+			shifted >>= 1;
+		}
+	}
+	return result;
+}
+
+// The layout has to start out zeroed
+internal bool32
+InitializeBitmapLayout(bitmap_layout* layout, uint32 redMask, uint32 greenMask, uint32 blueMask, uint32 alphaMask) {
+	bool32 result = (SetBitmapChannel(layout, 0, blueMask) &&
+					 SetBitmapChannel(layout, 1, greenMask) &&
+					 SetBitmapChannel(layout, 2, redMask) &&
+					 (!alphaMask || SetBitmapChannel(layout, 3, alphaMask)) &&
+					 ((redMask & greenMask) == 0) && ((redMask & blueMask) == 0) && ((greenMask & blueMask) == 0) &&
+					 ((alphaMask & (redMask | greenMask | blueMask)) == 0));
+
+	if (result) {
+		layout->mIsByteAligned = true;
+		uint8 sourceBytes[BITMAP_CHANNEL_COUNT];
+		for (uint32 channelIndex = 0; channelIndex < BITMAP_CHANNEL_COUNT; ++channelIndex) {
+			// 0x80 makes the shuffle write a zero, which mOpaque then fills in for a missing alpha
+			sourceBytes[channelIndex] = 0x80;
+			if (layout->mMasks[channelIndex]) {
+				layout->mIsByteAligned &= ((layout->mBitCounts[channelIndex] == 8) && ((layout->mShifts[channelIndex] % 8) == 0));
+				sourceBytes[channelIndex] = (uint8)(layout->mShifts[channelIndex] / 8);
+			}
+		}
+
+		uint8 shuffle[16];
+		for (uint32 byteIndex = 0; byteIndex < 16; ++byteIndex) {
+			uint8 sourceByte = sourceBytes[byteIndex % BITMAP_CHANNEL_COUNT];
+			shuffle[byteIndex] = (sourceByte == 0x80) ? sourceByte : (uint8)((byteIndex & ~3u) + sourceByte);
+		}
+		layout->mShuffle = _mm_loadu_si128((__m128i*)shuffle);
+		layout->mOpaque = _mm_set1_epi32(alphaMask ? 0 : (int32)0xFF000000);
+	}
+
+	return result;
+}
+
+// Channels narrower than a byte are scaled up to the full range, wider ones keep their top 8 bits
+inline uint32
+ConvertBitmapPixel(bitmap_layout* layout, uint32 pixel) {
+	uint32 result = layout->mMasks[3] ? 0 : 0xFF000000;
+	for (uint32 channelIndex = 0; channelIndex < BITMAP_CHANNEL_COUNT; ++channelIndex) {
+		uint32 bitCount = layout->mBitCounts[channelIndex];
+		if (bitCount) {
+			uint32 value = (pixel & layout->mMasks[channelIndex]) >> layout->mShifts[channelIndex];
+			if (bitCount >= 8) {
+				value >>= (bitCount - 8);
+			}
+			else {
+				uint32 maxValue = (1u << bitCount) - 1;
+				value = (value*255 + maxValue / 2) / maxValue;
+			}
+			result |= (value << (8*channelIndex));
+		}
+	}
+	if (layout->mMasks[3]) {
+		result = PremultiplyAlpha(result);
+	}
+	return result;
+}
+
+/*
+ * Four pixels of the shuffled 0xAARRGGBB, premultiplied the way PremultiplyAlpha does it.
+ * (x + (x >> 8)) >> 8 with x = c*a + 128 is c*a/255 rounded, exact for every 8 bit c and a.
+ */
+inline __m128i
+PremultiplyAlpha4(__m128i pixels) {
+	__m128i zero = _mm_setzero_si128();
+	__m128i alphaShuffle = _mm_setr_epi8(3, 3, 3, 3, 7, 7, 7, 7, 11, 11, 11, 11, 15, 15, 15, 15);
+	__m128i alphaLane = _mm_set1_epi32((int32)0xFF000000);
+	__m128i half = _mm_set1_epi16(128);
+
+	// The alpha channel is multiplied by 255 so it comes out unchanged
+	__m128i alphas = _mm_or_si128(_mm_shuffle_epi8(pixels, alphaShuffle), alphaLane);
+
+	__m128i low = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(pixels, zero), _mm_unpacklo_epi8(alphas, zero)), half);
+	__m128i high = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(pixels, zero), _mm_unpackhi_epi8(alphas, zero)), half);
+	low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+	high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+
+	__m128i result = _mm_packus_epi16(low, high);
+	return result;
+}
 
-		// Remeber that BMP files can go in either direction and the height will be negative
-		// for top down. There is also compression
-		uint32 redMask = header->mRedMask;
-		uint32 greenMask = header->mGreenMask;
-		uint32 blueMask = header->mBlueMask;
-		uint32 alphaMask = ~(redMask | greenMask | blueMask);
+// Converts 32 bit pixels where they are. Pixels in the file need not be 4 byte aligned.
+internal void
+ConvertBitmapPixels(bitmap_layout* layout, uint32* pixels, memory_index pixelCount) {
+	memory_index pixelIndex = 0;
+	if (layout->mIsByteAligned) {
+		bool32 hasAlpha = (layout->mMasks[3] != 0);
+		for (; (pixelIndex + 4) <= pixelCount; pixelIndex += 4) {
+			__m128i* at = (__m128i*)(pixels + pixelIndex);
+			__m128i color = _mm_or_si128(_mm_shuffle_epi8(_mm_loadu_si128(at), layout->mShuffle), layout->mOpaque);
+			if (hasAlpha) {
+				color = PremultiplyAlpha4(color);
+			}
+			_mm_storeu_si128(at, color);
+		}
+	}
+	for (; pixelIndex < pixelCount; ++pixelIndex) {
+		pixels[pixelIndex] = ConvertBitmapPixel(layout, pixels[pixelIndex]);
+	}
+}
+
+internal void
+SwapBitmapRows(uint32* rowA, uint32* rowB, int32 width) {
+	int32 x = 0;
+	for (; (x + 4) <= width; x += 4) {
+		__m128i a = _mm_loadu_si128((__m128i*)(rowA + x));
+		__m128i b = _mm_loadu_si128((__m128i*)(rowB + x));
+		_mm_storeu_si128((__m128i*)(rowA + x), b);
+		_mm_storeu_si128((__m128i*)(rowB + x), a);
+	}
+	for (; x < width; ++x) {
+		uint32 a = rowA[x];
+		rowA[x] = rowB[x];
+		rowB[x] = a;
+	}
+}
+
+// Blue green red bytes to opaque 0xAARRGGBB, sixteen bytes are read for every four pixels while six are left
+internal void
+ConvertBitmapRow24(uint8* source, uint32* dest, int32 width) {
+	__m128i shuffle = _mm_setr_epi8(0, 1, 2, -128, 3, 4, 5, -128, 6, 7, 8, -128, 9, 10, 11, -128);
+	__m128i opaque = _mm_set1_epi32((int32)0xFF000000);
+	int32 x = 0;
+	for (; (x + 6) <= width; x += 4) {
+		__m128i bgr = _mm_loadu_si128((__m128i*)(source + 3*x));
+		_mm_storeu_si128((__m128i*)(dest + x), _mm_or_si128(_mm_shuffle_epi8(bgr, shuffle), opaque));
+	}
+	for (; x < width; ++x) {
+		uint8* at = source + 3*x;
+		dest[x] = (0xFF000000 | ((uint32)at[2] << 16) | ((uint32)at[1] << 8) | (uint32)at[0]);
+	}
+}
 
-		bit_scan_result redScan = FindLeastSignificantSetBit(redMask);
-		bit_scan_result greenScan = FindLeastSignificantSetBit(greenMask);
-		bit_scan_result blueScan = FindLeastSignificantSetBit(blueMask);
-		bit_scan_result alphaScan = FindLeastSignificantSetBit(alphaMask);
+/*
+ * Loads 24 and 32 bit BMPs, uncompressed or with bit fields, stored either way up. The result is
+ * premultiplied 0xAARRGGBB, bottom up. 32 bit files are converted inside the file contents, 24 bit
+ * files need room on the arena for their converted pixels. Anything else, or a file whose sizes do
+ * not add up, loads as an empty bitmap.
+ */
+internal loaded_bitmap
+DEBUGLoadBMP(thread_context* thread, debug_platform_read_entire_file* readEntireFile, const char* fileName, memory_areana* arena) {
+	loaded_bitmap result = {};
 
-		int32 redShift = 16 - (int32)redScan.mIndex;
-		int32 greenShift = 8 - (int32)greenScan.mIndex;
-		int32 blueShift = 0 - (int32)blueScan.mIndex;
-		int32 alphaShift = 24 - (int32)alphaScan.mIndex;
+	debug_read_file_result readResult = readEntireFile(thread, fileName);
+	uint8* contents = (uint8*)readResult.mContents;
+	uint64 contentsSize = readResult.mContentsSize;
+	bitmap_header* header = (bitmap_header*)contents;
+	if (!contents || (contentsSize < (BITMAP_FILE_HEADER_SIZE + BITMAP_INFO_HEADER_SIZE)) ||
+		(header->mFileType != BITMAP_FILE_TYPE) || (header->mSize < BITMAP_INFO_HEADER_SIZE) ||
+		((BITMAP_FILE_HEADER_SIZE + (uint64)header->mSize) > contentsSize) || (header->mPlanes != 1) ||
+		(header->mWidth <= 0) || (header->mHeight == 0) || (header->mHeight == Int32Min)) {
+		return result;
+	}
 
-		uint32 *sourceDest = pixels;
-		for (int32 Y = 0; Y < header->mHeight; ++Y) {
-			for (int32 X = 0; X < header->mWidth; ++X) {
-				uint32 z = *sourceDest;
+	int32 width = header->mWidth;
+	bool32 isTopDown = (header->mHeight < 0);
+	int32 height = isTopDown ? -header->mHeight : header->mHeight;
+	uint32 bitsPerPixel = header->mBitsPerPixel;
+	uint32 compression = header->mCompression;
+
+	// Rows are padded to 4 bytes, converted pixels are kept to what fits a file read
+	uint64 stride = (((uint64)width*bitsPerPixel + 31) / 32)*4;
+	uint64 pixelSize = (uint64)width*(uint64)height*sizeof(uint32);
+	bool32 isValid = ((header->mBitmapOffset >= (BITMAP_FILE_HEADER_SIZE + BITMAP_INFO_HEADER_SIZE)) &&
+					  (header->mBitmapOffset <= contentsSize) &&
+					  (stride*(uint64)height <= (contentsSize - header->mBitmapOffset)) &&
+					  (pixelSize <= UInt32Max));
+
+	bitmap_layout layout = {};
+	if (isValid && (bitsPerPixel == 32)) {
+		uint64 masksEnd = (uint8*)&header->mAlphaMask - contents;
+		if (compression == BITMAP_COMPRESSION_RGB) {
+			isValid = InitializeBitmapLayout(&layout, 0x00FF0000, 0x0000FF00, 0x000000FF, 0);
+		}
+		else if (((compression == BITMAP_COMPRESSION_BITFIELDS) || (compression == BITMAP_COMPRESSION_ALPHA_BITFIELDS)) &&
+				 (masksEnd + sizeof(uint32)) <= contentsSize) {
+			// Plain info headers only have an alpha mask when the compression says so
+			bool32 hasAlphaMask = ((compression == BITMAP_COMPRESSION_ALPHA_BITFIELDS) ||
+								   (header->mSize >= BITMAP_V3_INFO_HEADER_SIZE));
+			isValid = InitializeBitmapLayout(&layout, header->mRedMask, header->mGreenMask, header->mBlueMask,
+											 hasAlphaMask ? header->mAlphaMask : 0);
+		}
+		else {
+			isValid = false;
+		}
 
-				*sourceDest++ = (RotateLeft(z & redMask, redShift) |
-								RotateLeft(z & greenMask, greenShift) |
-								RotateLeft(z & blueMask, blueShift) |
-								RotateLeft(z & alphaMask, alphaShift));
+		if (isValid) {
+			uint32* pixels = (uint32*)(contents + header->mBitmapOffset);
+			if (isTopDown) {
+				// Each pair of rows is converted and swapped while it is still in the cache
+				for (int32 y = 0; y < (height + 1) / 2; ++y) {
+					uint32* top = pixels + (memory_index)y*width;
+					uint32* bottom = pixels + (memory_index)(height - 1 - y)*width;
+					ConvertBitmapPixels(&layout, top, width);
+					if (bottom != top) {
+						ConvertBitmapPixels(&layout, bottom, width);
+						SwapBitmapRows(top, bottom, width);
+					}
+				}
 			}
+			else {
+				ConvertBitmapPixels(&layout, pixels, (memory_index)width*height);
+			}
+			result.mPixels = pixels;
 		}
 	}
+	else if (isValid && (bitsPerPixel == 24) && (compression == BITMAP_COMPRESSION_RGB) &&
+			 arena && ((arena->mUsed + pixelSize) <= arena->mSize)) {
+		uint32* pixels = PushArray(arena, (memory_index)width*height, uint32);
+		for (int32 y = 0; y < height; ++y) {
+			int32 sourceY = isTopDown ? (height - 1 - y) : y;
+			ConvertBitmapRow24(contents + header->mBitmapOffset + (memory_index)sourceY*stride,
+				pixels + (memory_index)y*width, width);
+		}
+		result.mPixels = pixels;
+	}
+
+	if (result.mPixels) {
+		result.mWidth = width;
+		result.mHeight = height;
+	}
+
+	return result;
+}
 
+inline bool32
+WasPressed(game_button_state* button) {
+	bool32 result = (button->EndedDown && (button->mHalfTransitionCount > 0));
 	return result;
 }
 
@@ -220,7 +486,7 @@ inline entity*
 GetEntity(game_state* gameState, uint32 index) {
 	entity* entity = 0;
 
-	if ((Index > 0) && (index < ArrayCount(gameState->mEntities))) {
+	if ((index > 0) && (index < ArrayCount(gameState->mEntities))) {
 		entity = &gameState->mEntities[index];
 	}
 
@@ -233,7 +499,7 @@ AddEntity(game_state* gameState) {
 
 	Assert(gameState->mEntityCount < ArrayCount(gameState->mEntities));
 	entity* ent = &gameState->mEntities[entityIndex];
-	*ent = NULL;
+	*ent = {};
 
 	return entityIndex;
 }
@@ -246,7 +512,7 @@ InitializePlayer(game_state* gameState, uint32 entityIndex) {
 	ent->mTilePos.mAbsTileX = 1;
 	ent->mTilePos.mAbsTileY = 3;
 	ent->mTilePos.mOffset.x = 0;
-	ent->mTilePos.mOffset.t = 0;
+	ent->mTilePos.mOffset.y = 0;
 	ent->mHeight = 1.0f;
 	ent->mWidth = 1.0f;
 
@@ -255,40 +521,339 @@ InitializePlayer(game_state* gameState, uint32 entityIndex) {
 	}
 }
 
-internal bool32
-TestWall(real32 wallX, real32 relX, real32 relY, real32 playerDeltaX, real32 playerDeltaY,
-	real32* tMin, real32 minY, real32 maxY) {
-	bool32 hit = false;
+internal void
+MovePlayer(game_state* gameState, entity* entity, real32 deltaTime, Vector2 ddP) {
+	// TODO: Move the player
+}
+
+// Anything that changes how paths cross a chunk rebuilds the field the next time its goal is set
+internal TILE_CHUNK_CHANGED(FollowerFieldChunkChanged) {
+	tile_flow_field* field = (tile_flow_field*)subscriberData;
+	if ((change->mType == TILE_CHANGE_EVICT) || DoesTileChangeMovePaths(change)) {
+		field->mIsBuilt = false;
+	}
+}
+
+internal uint32
+AddFollower(game_state* gameState, tile_map_location location) {
+	uint32 entityIndex = AddEntity(gameState);
+	entity* ent = GetEntity(gameState, entityIndex);
+
+	ent->mExists = true;
+	ent->mTilePos = CenteredTilePoint(location.mAbsTileX, location.mAbsTileY, location.mAbsTileZ);
+	ent->mHeight = 0.5f;
+	ent->mWidth = 0.5f;
+	ent->mIsFollower = true;
 
-	// TODO: Test if the player hit the wall
-	return hit;
+	return entityIndex;
+}
+
+// The footstep tagged nearest the floor and the light on the tile
+inline asset_id
+GetFootstepAsset(asset_pack* pack, tile_map* tileMap, tile_map_location p) {
+	asset_vector match = {};
+	asset_vector weight = {};
+	match.mE[ASSET_TAG_FLOOR] = (real32)p.mAbsTileZ;
+	weight.mE[ASSET_TAG_FLOOR] = 1.0f;
+	match.mE[ASSET_TAG_LIGHT_LEVEL] = (real32)GetTileLightLevel(tileMap, p.mAbsTileX, p.mAbsTileY, p.mAbsTileZ);
+	weight.mE[ASSET_TAG_LIGHT_LEVEL] = 1.0f;
+	asset_id result = GetBestMatchAsset(pack, ASSET_TYPE_FOOTSTEP, &match, &weight);
+	return result;
 }
 
+// Followers stand still until they first see the leader, then take one tile step at a time along the flow field toward it
 internal void
-MovePlayer(game_state* gameState, entity* entity, real32 deltaTime, Vector2 ddP) {
-	// TODO: Move the player
+MoveFollowers(game_state* gameState, tile_map* tileMap, entity* leader, real32 deltaTime) {
+	TIMED_FUNCTION();
+	tile_flow_field* field = &gameState->mWorld->mFollowerField;
+	real32 secondsPerStep = 0.25f;
+
+	bool32 isFieldUpdated = false;
+	for (uint32 entityIndex = 0; entityIndex < gameState->mEntityCount; ++entityIndex) {
+		entity* follower = gameState->mEntities + entityIndex;
+		if (follower->mExists && follower->mIsFollower && !follower->mHasSeenLeader) {
+			follower->mHasSeenLeader = HasTileLineOfSight(tileMap, follower->mTilePos, leader->mTilePos);
+		}
+		if (follower->mExists && follower->mIsFollower && follower->mHasSeenLeader) {
+			// The field only follows the leader while someone walks it
+			if (!isFieldUpdated) {
+				UpdateTileFlowGoal(tileMap, field, leader->mTilePos);
+				isFieldUpdated = true;
+			}
+
+			follower->mStepTimer += deltaTime;
+			while (follower->mStepTimer >= secondsPerStep) {
+				follower->mStepTimer -= secondsPerStep;
+
+				tile_map_location* pos = &follower->mTilePos;
+				uint32 direction = GetTileFlowDirection(tileMap, field, *pos);
+				if (direction == TILE_FLOW_NONE) {
+					// Left outside the field, the hierarchical search finds the next step
+					tile_map_location route[2];
+					tile_path path = FindTilePath(tileMap, &gameState->mWorld->mPathCache, *pos, leader->mTilePos,
+						route, ArrayCount(route));
+					if (path.mFound && (path.mTileCount == ArrayCount(route))) {
+						*pos = route[1];
+					}
+				}
+				else {
+					Vector2 step = GetTileFlowVector(direction);
+					pos->mAbsTileX += (tile_delta)step.x;
+					pos->mAbsTileY += (tile_delta)step.y;
+					if (direction == TILE_FLOW_UP) {
+						++pos->mAbsTileZ;
+					}
+					else if (direction == TILE_FLOW_DOWN) {
+						--pos->mAbsTileZ;
+					}
+				}
+
+				// Footsteps stream through the cache, a step starts the sound over
+				if (gameState->mAssetCache.mSlots) {
+					gameState->mFootstepID = GetFootstepAsset(&gameState->mAssets, tileMap, *pos);
+					gameState->mFootstepSampleIndex = 0;
+				}
+			}
+		}
+	}
+}
+
+// Only reads the tile map, so any number of workers can prepare entities while the others wait
+internal
+PARALLEL_FOR_CALLBACK(PrepareEntityDraws) {
+	TIMED_FUNCTION();
+	entity_draw_pass* pass = (entity_draw_pass*)pData;
+	tile_map* tileMap = pass->mTileMap;
+	real32 metersToPixels = pass->mMetersToPixels;
+	for (uint32 entityIndex = pBegin; entityIndex < pEnd; ++entityIndex) {
+		entity* entity = pass->mGameState->mEntities + entityIndex;
+		entity_draw* draw = pass->mDraws + entityIndex;
+		tile_map_location* pos = &entity->mTilePos;
+
+		draw->mIsDrawn = (entity->mExists &&
+						  (!pass->mIsFogged || IsTileVisible(tileMap, pos->mAbsTileX, pos->mAbsTileY, pos->mAbsTileZ)));
+		if (draw->mIsDrawn) {
+			tile_map_difference diff = Subtract(tileMap, pos, &pass->mGameState->cameraP);
+			draw->mBrightness = GetTileLightBrightness(GetTileLightLevel(tileMap, pos->mAbsTileX, pos->mAbsTileY,
+				pos->mAbsTileZ), pass->mAmbientLight);
+
+			Vector2 groundPoint(pass->mScreenCenter.x + metersToPixels*diff.mVector.x,
+								pass->mScreenCenter.y - metersToPixels*diff.mVector.y);
+			Vector2 entityWidthHeight(entity->mWidth, entity->mHeight);
+			draw->mMin = groundPoint - 0.5f*metersToPixels*entityWidthHeight;
+			draw->mMax = draw->mMin + metersToPixels*entityWidthHeight;
+		}
+	}
+}
+
+// Walls all around and floor inside, then the openings
+inline uint32
+GetGeneratedRoomTile(room_generation* generation, generated_room* room, uint32 relTileX, uint32 relTileY) {
+	uint32 width = generation->mTilesPerWidth;
+	uint32 height = generation->mTilesPerHeight;
+
+	uint32 result = 1;
+	if ((relTileX == 0) || (relTileY == 0) || (relTileX == (width - 1)) || (relTileY == (height - 1))) {
+		result = 2;
+	}
+	if ((room->mDoorFlags & GENERATED_ROOM_DOOR_LEFT) && (relTileX == 0) && (relTileY == height / 2)) {
+		result = 1;
+	}
+	if ((room->mDoorFlags & GENERATED_ROOM_DOOR_RIGHT) && (relTileX == (width - 1)) && (relTileY == height / 2)) {
+		result = 1;
+	}
+	if ((room->mDoorFlags & GENERATED_ROOM_DOOR_BOTTOM) && (relTileX == width / 2) && (relTileY == 0)) {
+		result = 1;
+	}
+	if ((room->mDoorFlags & GENERATED_ROOM_DOOR_TOP) && (relTileX == width / 2) && (relTileY == (height - 1))) {
+		result = 1;
+	}
+	if (room->mZDoorValue && (relTileX == 10) && (relTileY == 6)) {
+		result = room->mZDoorValue;
+	}
+	return result;
+}
+
+// Each chunk only reads the rooms and writes its own tiles, tiles no room covers are left as they are
+internal
+PARALLEL_FOR_CALLBACK(BuildGeneratedChunks) {
+	TIMED_FUNCTION();
+	room_generation* generation = (room_generation*)pData;
+	uint32 chunkDim = generation->mTileMap->mChunkDim;
+	for (uint32 chunkIndex = pBegin; chunkIndex < pEnd; ++chunkIndex) {
+		generated_chunk* chunk = generation->mChunks + chunkIndex;
+		for (uint32 tileIndex = 0; tileIndex < chunkDim*chunkDim; ++tileIndex) {
+			chunk->mTiles[tileIndex] = TILE_PATTERN_KEEP;
+		}
+
+		tile_coord chunkMinTileX = chunk->mChunkX*chunkDim;
+		tile_coord chunkMinTileY = chunk->mChunkY*chunkDim;
+		for (uint32 roomIndex = 0; roomIndex < generation->mRoomCount; ++roomIndex) {
+			generated_room* room = generation->mRooms + roomIndex;
+			if (room->mAbsTileZ == chunk->mAbsTileZ) {
+				tile_coord minTileX = Maximum(room->mMinTileX, chunkMinTileX);
+				tile_coord minTileY = Maximum(room->mMinTileY, chunkMinTileY);
+				tile_coord onePastMaxTileX = Minimum(room->mMinTileX + generation->mTilesPerWidth, chunkMinTileX + chunkDim);
+				tile_coord onePastMaxTileY = Minimum(room->mMinTileY + generation->mTilesPerHeight, chunkMinTileY + chunkDim);
+				for (tile_coord tileY = minTileY; tileY < onePastMaxTileY; ++tileY) {
+					uint32* row = chunk->mTiles + (uint32)(tileY - chunkMinTileY)*chunkDim;
+					for (tile_coord tileX = minTileX; tileX < onePastMaxTileX; ++tileX) {
+						row[tileX - chunkMinTileX] = GetGeneratedRoomTile(generation, room,
+							(uint32)(tileX - room->mMinTileX), (uint32)(tileY - room->mMinTileY));
+					}
+				}
+			}
+		}
+	}
+}
+
+// Builds the chunks the rooms touch in parallel out of scratch memory, then writes them to the tile map in order
+internal void
+GenerateRoomChunks(game_memory* memory, room_generation* generation, memory_areana* scratch) {
+	TIMED_FUNCTION();
+	tile_map* tileMap = generation->mTileMap;
+	uint32 chunkDim = tileMap->mChunkDim;
+	uint32 maxChunksPerRoom = ((generation->mTilesPerWidth + chunkDim - 1) / chunkDim + 1)*
+							  ((generation->mTilesPerHeight + chunkDim - 1) / chunkDim + 1);
+
+	memory_index scratchUsed = scratch->mUsed;
+	generation->mChunks = PushArray(scratch, generation->mRoomCount*maxChunksPerRoom, generated_chunk);
+	generation->mChunkCount = 0;
+	for (uint32 roomIndex = 0; roomIndex < generation->mRoomCount; ++roomIndex) {
+		generated_room* room = generation->mRooms + roomIndex;
+		tile_coord maxChunkX = (room->mMinTileX + generation->mTilesPerWidth - 1) >> tileMap->mChunkShift;
+		tile_coord maxChunkY = (room->mMinTileY + generation->mTilesPerHeight - 1) >> tileMap->mChunkShift;
+		for (tile_coord chunkY = room->mMinTileY >> tileMap->mChunkShift; chunkY <= maxChunkY; ++chunkY) {
+			for (tile_coord chunkX = room->mMinTileX >> tileMap->mChunkShift; chunkX <= maxChunkX; ++chunkX) {
+				bool32 isListed = false;
+				for (uint32 chunkIndex = 0; chunkIndex < generation->mChunkCount; ++chunkIndex) {
+					generated_chunk* chunk = generation->mChunks + chunkIndex;
+					if ((chunk->mChunkX == chunkX) && (chunk->mChunkY == chunkY) && (chunk->mAbsTileZ == room->mAbsTileZ)) {
+						isListed = true;
+						break;
+					}
+				}
+
+				if (!isListed) {
+					generated_chunk* chunk = generation->mChunks + generation->mChunkCount++;
+					chunk->mChunkX = chunkX;
+					chunk->mChunkY = chunkY;
+					chunk->mAbsTileZ = room->mAbsTileZ;
+					chunk->mTiles = PushArray(scratch, chunkDim*chunkDim, uint32);
+				}
+			}
+		}
+	}
+
+	ParallelFor(memory, 0, generation->mChunkCount, 1, BuildGeneratedChunks, generation);
+
+	for (uint32 chunkIndex = 0; chunkIndex < generation->mChunkCount; ++chunkIndex) {
+		generated_chunk* chunk = generation->mChunks + chunkIndex;
+		StampTilePattern(tileMap, chunk->mChunkX*chunkDim, chunk->mChunkY*chunkDim, chunk->mAbsTileZ,
+			chunkDim, chunkDim, chunk->mTiles);
+	}
+
+	scratch->mUsed = scratchUsed;
+}
+
+// The backdrop whose floor tag is nearest the floor
+inline asset_id
+GetBackdropAsset(asset_pack* pack, uint32 absTileZ) {
+	asset_vector match = {};
+	asset_vector weight = {};
+	match.mE[ASSET_TAG_FLOOR] = (real32)absTileZ;
+	weight.mE[ASSET_TAG_FLOOR] = 1.0f;
+	asset_id result = GetBestMatchAsset(pack, ASSET_TYPE_BACKDROP, &match, &weight);
+	return result;
+}
+
+// Pack assets stream into the asset cache. Without a pack the backdrop comes from its baked file,
+// which developer builds bake from the BMP the first time. Either way loading never converts a pixel.
+internal void
+LoadGameAssets(thread_context* thread, game_memory* memory, game_state* gameState) {
+	memory_areana* arena = &gameState->mTransientArena;
+	Assert(arena->mUsed == gameState->mAssetArenaMark);
+
+	if (OpenAssetPack(thread, memory, "test/assets.epk", &gameState->mAssets)) {
+		gameState->mBackdropID = GetBackdropAsset(&gameState->mAssets, gameState->cameraP.mAbsTileZ);
+	}
+	if (!gameState->mBackdropID &&
+		!MapBakedBitmap(thread, memory, "test/test_background.ebm", &gameState->mBackdrop)) {
+#if ENGINE_INTERNAL
+		if (memory->DEBUGPlatformReadEntireFile) {
+			loaded_bitmap backdrop =
+				DEBUGLoadBMP(thread, memory->DEBUGPlatformReadEntireFile, "test/test_background.bmp", arena);
+			if (DEBUGBakeBitmap(thread, memory, arena, &backdrop, "test/test_background.ebm")) {
+				MapBakedBitmap(thread, memory, "test/test_background.ebm", &gameState->mBackdrop);
+			}
+			arena->mUsed = gameState->mAssetArenaMark;
+		}
+#endif
+	}
+
+	// Pack payloads stream into a fixed part of the transient storage, the budget is what to tune per platform
+	if (gameState->mAssets.mHeader) {
+		if (InitializeAssetCache(thread, memory, &gameState->mAssetCache, &gameState->mAssets, "test/assets.epk",
+			arena, Megabytes(64))) {
+			// Start the backdrop streaming so it is in before the first frames go by
+			RequestAsset(memory, &gameState->mAssetCache, gameState->mBackdropID);
+		}
+		else {
+			// Drawn straight from the pack, its pages start coming in now
+			PrefetchAsset(memory, &gameState->mAssets, gameState->mBackdropID);
+			gameState->mBackdrop.mBitmap = GetBitmap(&gameState->mAssets, gameState->mBackdropID);
+			gameState->mBackdropID = 0;
+		}
+	}
+}
+
+// Reads still in flight land in the cache memory, so they finish before the pack closes and the memory is handed back
+internal void
+UnloadGameAssets(thread_context* thread, game_memory* memory, game_state* gameState) {
+	asset_cache* cache = &gameState->mAssetCache;
+	if (cache->mSlots) {
+		for (uint32 slotIndex = 1; slotIndex < cache->mPack->mAssetCount; ++slotIndex) {
+			asset_slot* slot = cache->mSlots + slotIndex;
+			if (slot->mState == ASSET_STATE_QUEUED) {
+				memory->PlatformWaitForReads(&slot->mFence);
+			}
+		}
+		memory->PlatformCloseFile(thread, &cache->mFile);
+	}
+	*cache = {};
+
+	// The baked backdrop's view is unmapped here, one drawn from the pack has none and goes with the pack
+	UnmapBakedBitmap(thread, memory, &gameState->mBackdrop);
+	CloseAssetPack(thread, memory, &gameState->mAssets);
+	gameState->mBackdropID = 0;
+	gameState->mFootstepID = 0;
+	gameState->mTransientArena.mUsed = gameState->mAssetArenaMark;
 }
 
 extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender) {
+	// The platform can hand in a new table, or none, with every call
+	gDebugTable = pMemory->mDebugTable;
+	TIMED_FUNCTION();
+
 	Assert((&pInput->mControllers[0].mTerminator - &pInput->mControllers[0].mButtons[0]) == (ArrayCount(pInput->mControllers[0].mButtons)));
 	Assert(sizeof(game_state) <= pMemory->mPermanentStorageSize);
 
-	real32 playerHeight = 1.4f;
-	real32 playerWidth = 0.75f*playerHeight;
+	int32 tileSideInPixels = 60;
+	real32 ambientLight = 0.2f;
 
 	// Initialize the game state
 	game_state* gameState = (game_state*)pMemory->mPermanentStorage;
 	if (!pMemory->IsInitialized) {
+		TIMED_BLOCK("GameInitialize");
 		AddEntity(gameState);
 
-		/*gameState->mBackdrop =
-			DEBUGLoadBMP(thread, pMemory->DEBUGPlatformReadEntireFile, "test/test_background.bmp");*/
-
 		gameState->cameraP.mAbsTileX = 17 / 2;
 		gameState->cameraP.mAbsTileY = 9 / 2;
 
 		InitializeArena(&gameState->mWorldArena, pMemory->mPermanentStorageSize - sizeof(game_state),
 			(uint8*)pMemory->mPermanentStorage + sizeof(game_state));
+		// Scratch space while the world is made, handed back before the render cache takes it
+		InitializeArena(&gameState->mTransientArena, pMemory->mTransientStorageSize, (uint8*)pMemory->mTransientStorage);
 
 		gameState->mWorld = PushStruct(&gameState->mWorldArena, world);
 		world* world = gameState->mWorld;
@@ -304,13 +869,47 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender) {
 		tileMap->mTileChunkCountX = 128;
 		tileMap->mTileChunkCountY = 128;
 		tileMap->mTileChunkCountZ = 2;
-		tileMap->mTileChunks = PushArray(&gameState->mWorldArena,
-			tileMap->mTileChunkCountX*
-			tileMap->mTileChunkCountY*
-			tileMap->mTileChunkCountZ,
-			tile_chunk);
+
+		// Morton order only pays for itself when pdep/pext encode it, builds without BMI2 stay row major
+		InitializeTileChunkLayout(tileMap, ENGINE_BMI2);
+		tileMap->mTileChunks = PushArray(&gameState->mWorldArena, GetTileChunkCount(tileMap), tile_chunk);
 
 		tileMap->mTileSideInMeters = 1.4f;
+		InitializeTileChunkStorage(tileMap, &gameState->mWorldArena);
+		InitializeTileTypes(tileMap);
+
+		// Designers can add tile types or change the built in ones without rebuilding the game
+		if (pMemory->PlatformOpenFile) {
+			platform_file_handle tileTypeFile = pMemory->PlatformOpenFile(thread, "tile_types.txt");
+			if (tileTypeFile.mIsValid && tileTypeFile.mSize && (tileTypeFile.mSize <= Megabytes(1))) {
+				char* tileTypeText = PushArray(&gameState->mTransientArena, tileTypeFile.mSize, char);
+				platform_read_fence tileTypeFence = {};
+				pMemory->PlatformReadDataFromFile(&tileTypeFile, 0, tileTypeFile.mSize, tileTypeText, &tileTypeFence);
+				if (pMemory->PlatformWaitForReads(&tileTypeFence)) {
+					LoadTileTypes(tileMap, tileTypeText, (uint32)tileTypeFile.mSize);
+				}
+			}
+			pMemory->PlatformCloseFile(thread, &tileTypeFile);
+		}
+
+		InitializeTileChunkCompression(tileMap, &gameState->mWorldArena, Megabytes(1));
+		InitializeTilePathCache(tileMap, &world->mPathCache, &gameState->mWorldArena, 4096, Megabytes(1), 16384);
+		InitializeTileRegionMap(tileMap, &world->mRegions, &gameState->mWorldArena, 65536, Megabytes(1));
+		InitializeTileLightMap(tileMap, &world->mLights, &gameState->mWorldArena, 256, 1 << 16, Megabytes(2));
+		InitializeTileFovMap(tileMap, &world->mFov, &gameState->mWorldArena, Megabytes(1));
+		InitializeTileFlowField(tileMap, &world->mFollowerField, &gameState->mWorldArena, 1);
+		world->mFollowerFieldSubscriberIndex =
+			SubscribeToTileChanges(tileMap, FollowerFieldChunkChanged, &world->mFollowerField);
+
+		// Back the tile map with a world file so only the chunks around the camera take up the world arena
+		bool32 worldWasLoaded = false;
+		if (pMemory->PlatformMapFile) {
+			platform_mapped_file worldFile = pMemory->PlatformMapFile(thread, "world.ew", GetWorldFileSize(tileMap));
+			if (worldFile.mMemory) {
+				uint32 residentChunkBudget = 256;
+				worldWasLoaded = InitializeTileChunkStream(tileMap, &world->mChunkStream, worldFile, residentChunkBudget);
+			}
+		}
 
 		uint32 randomNumberIndex = 0;
 		uint32 tilesPerWidth = 17;
@@ -325,7 +924,14 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender) {
 		bool32 doorBottom = false;
 		bool32 doorUp = false;
 		bool32 doorDown = false;
-		for (uint32 screenIndex = 0; screenIndex < 100; ++screenIndex) {
+		uint32 screenCount = worldWasLoaded ? 0 : 100;
+
+		room_generation generation = {};
+		generation.mTileMap = tileMap;
+		generation.mTilesPerWidth = tilesPerWidth;
+		generation.mTilesPerHeight = tilesPerHeight;
+		generation.mRooms = PushArray(&gameState->mTransientArena, screenCount, generated_room);
+		for (uint32 screenIndex = 0; screenIndex < screenCount; ++screenIndex) {
 			Assert(randomNumberIndex < ArrayCount(randomNumberTable));
 
 			uint32 randomChoice;
@@ -353,42 +959,15 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender) {
 				doorTop = true;
 			}
 
-			for (uint32 tileY = 0; tileY < tilesPerHeight; ++tileY) {
-				for (uint32 tileX = 0; tileX < tilesPerWidth; ++tileX) {
-					uint32 absTileX = screenX * tilesPerWidth + tileX;
-					uint32 absTileY = screenY * tilesPerHeight + tileY;
-
-					uint32 tileValue = 1;
-					if ((tileX == 0) && (!doorLeft || (tileY != (tilesPerHeight / 2)))) {
-						tileValue = 2;
-					}
-
-					if ((tileX == (tilesPerWidth - 1)) && (!doorRight || (tileY != (tilesPerHeight / 2)))) {
-						tileValue = 2;
-					}
-
-					if ((tileY == 0) && (!doorBottom || (tileX != (tilesPerWidth / 2)))) {
-						tileValue = 2;
-					}
-
-					if ((tileY == (tilesPerHeight - 1)) && (!doorTop || (tileX != (tilesPerWidth / 2)))) {
-						tileValue = 2;
-					}
-
-					if ((tileX == 10) && (tileY == 6)) {
-						if (doorUp) {
-							tileValue = 3;
-						}
-
-						if (doorDown) {
-							tileValue = 4;
-						}
-					}
-
-					SetTileValue(&gameState->mWorldArena, world->mTileMap, absTileX, absTileY, absTileZ,
-						tileValue);
-				}
-			}
+			generated_room* room = generation.mRooms + generation.mRoomCount++;
+			room->mMinTileX = screenX*tilesPerWidth;
+			room->mMinTileY = screenY*tilesPerHeight;
+			room->mAbsTileZ = absTileZ;
+			room->mDoorFlags = ((doorLeft ? GENERATED_ROOM_DOOR_LEFT : 0) |
+								(doorRight ? GENERATED_ROOM_DOOR_RIGHT : 0) |
+								(doorBottom ? GENERATED_ROOM_DOOR_BOTTOM : 0) |
+								(doorTop ? GENERATED_ROOM_DOOR_TOP : 0));
+			room->mZDoorValue = (doorUp || doorDown) ? (doorDown ? 4 : 3) : 0;
 
 			doorLeft = doorRight;
 			doorBottom = doorTop;
@@ -421,19 +1000,49 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender) {
 			}
 		}
 
+		GenerateRoomChunks(pMemory, &generation, &gameState->mTransientArena);
+
+		// The lights spread through the finished rooms
+		for (uint32 roomIndex = 0; roomIndex < generation.mRoomCount; ++roomIndex) {
+			generated_room* room = generation.mRooms + roomIndex;
+			AddTileLight(tileMap, CenteredTilePoint(room->mMinTileX + tilesPerWidth / 2,
+				room->mMinTileY + tilesPerHeight / 2, room->mAbsTileZ), 10);
+		}
+		gameState->mTransientArena.mUsed = 0;
+
+		FlushTileChunkStream(thread, pMemory, tileMap);
+
+		// Generation is not undoable, only what changes the world from here on is recorded
+		InitializeTileJournal(tileMap, &world->mJournal, &gameState->mWorldArena, 1 << 16, 1024);
+
+		// The camera carries a torch so the rooms it looks at are never fully dark
+		gameState->mCameraLightIndex = AddTileLight(tileMap, gameState->cameraP, TILE_LIGHT_MAX_LEVEL);
+		gameState->mIsCameraLightOn = true;
+
+		// Enough prerendered chunks for the screen on both floors, with room to spare for going back and forth
+		InitializeTileRenderCache(tileMap, &gameState->mTileRenderCache, &gameState->mTransientArena,
+			tileSideInPixels, 16, ambientLight);
+
+		// The asset cache takes the rest of the transient storage it needs, reloads start over from here
+		gameState->mAssetArenaMark = gameState->mTransientArena.mUsed;
+		LoadGameAssets(thread, pMemory, gameState);
+
 		pMemory->IsInitialized = true;
 	}
 
 	world* world = gameState->mWorld;
 	tile_map* tileMap = world->mTileMap;
+	BeginTileMapFrame(tileMap);
+	BeginAssetCacheFrame(&gameState->mAssetCache);
 
-	int32 tileSideInPixels = 60;
-	real32 metersToPixels = (real32)tileSideInPixels / (real32)tileMap->mTileSideInMeters;
+	// The game code may have been reloaded since the last frame, which moves the tile change callbacks
+	RefreshTileSubscription(tileMap, world->mRegions.mSubscriberIndex, TileRegionChunkChanged);
+	RefreshTileSubscription(tileMap, world->mLights.mSubscriberIndex, TileLightChunkChanged);
+	RefreshTileSubscription(tileMap, world->mFollowerFieldSubscriberIndex, FollowerFieldChunkChanged);
 
-	real32 lowerLeftX = -(real32)tileSideInPixels / 2;
-	real32 lowerLeftY = (real32)pScreenBuffer->mHeight;
+	real32 metersToPixels = (real32)tileSideInPixels / (real32)tileMap->mTileSideInMeters;
 
-	for (int controllerIndex = 0; controllerIndex < ArrayCount(pInput->mControllers); ++controllerIndex) {
+	for (uint32 controllerIndex = 0; controllerIndex < ArrayCount(pInput->mControllers); ++controllerIndex) {
 		game_controller_input* controller = GetController(pInput, controllerIndex);
 		entity* controllingEntity = GetEntity(gameState,
 			gameState->mPlayerIndexForController[controllerIndex]);
@@ -447,19 +1056,74 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender) {
 				// Use digital movement
 
 				if (controller->mMoveUp.EndedDown) {
-					dPlayerY = 1.0f;
+					accel.y = 1.0f;
 				}
 				if (controller->mMoveDown.EndedDown) {
-					dPlayerY = -1.0f;
+					accel.y = -1.0f;
 				}
 				if (controller->mMoveLeft.EndedDown) {
-					dPlayerX = -1.0f;
+					accel.x = -1.0f;
 				}
 				if (controller->mMoveRight.EndedDown) {
-					dPlayerX = 1.0f;
+					accel.x = 1.0f;
+				}
+
+				MovePlayer(gameState, controllingEntity, pInput->deltaTime, accel);
+			}
+
+			// Room edits work on the whole room the camera shows
+			tile_coord roomMinTileX = gameState->cameraP.mAbsTileX - 17 / 2;
+			tile_coord roomMinTileY = gameState->cameraP.mAbsTileY - 9 / 2;
+			uint32 roomTileZ = gameState->cameraP.mAbsTileZ;
+			if (WasPressed(&controller->mActionUp)) {
+				// Stamps the room onto the other floor
+				CopyTileRect(tileMap, roomMinTileX, roomMinTileY, roomTileZ,
+					roomMinTileX, roomMinTileY, (roomTileZ + 1) % tileMap->mTileChunkCountZ, 17, 9);
+			}
+			if (WasPressed(&controller->mActionDown)) {
+				// Knocks the walls down, opening the room up to its neighbors
+				FillTileRect(tileMap, roomMinTileX, roomMinTileY, roomTileZ, 17, 9, 1);
+			}
+
+			// Each room edit undoes and redoes as one step
+			if (WasPressed(&controller->mActionLeft)) {
+				UndoTileEdits(tileMap);
+			}
+			if (WasPressed(&controller->mActionRight)) {
+				RedoTileEdits(tileMap);
+			}
+
+			// Puts the camera torch out or lights it again
+			if (WasPressed(&controller->mRightShoulder)) {
+				if (gameState->mIsCameraLightOn) {
+					RemoveTileLight(tileMap, gameState->mCameraLightIndex);
+				}
+				else {
+					gameState->mCameraLightIndex = AddTileLight(tileMap, gameState->cameraP, TILE_LIGHT_MAX_LEVEL);
 				}
+				gameState->mIsCameraLightOn = !gameState->mIsCameraLightOn;
+			}
 
-				MovePlayer(gameState, controllingEntity, pInput->dtForFrame, accel);
+			// Left shoulder brings in a follower at the middle of the room
+			if (WasPressed(&controller->mLeftShoulder) &&
+				((gameState->mEntityCount + 1) < ArrayCount(gameState->mEntities))) {
+				AddFollower(gameState, gameState->cameraP);
+			}
+
+			// Start reloads the assets, so a rebuilt pack shows up without restarting
+			if (WasPressed(&controller->mStart)) {
+				UnloadGameAssets(thread, pMemory, gameState);
+				LoadGameAssets(thread, pMemory, gameState);
+			}
+
+			// Back drops the player out, start brings a new one in
+			if (WasPressed(&controller->mBack)) {
+				RemoveTileFovViewer(tileMap, controllingEntity->mFovViewerIndex);
+				controllingEntity->mExists = false;
+				if (gameState->mCameraEntityIndex == gameState->mPlayerIndexForController[controllerIndex]) {
+					gameState->mCameraEntityIndex = 0;
+				}
+				gameState->mPlayerIndexForController[controllerIndex] = 0;
 			}
 		}
 		else {
@@ -467,15 +1131,18 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender) {
 				uint32 entityIndex = AddEntity(gameState);
 				InitializePlayer(gameState, entityIndex);
 				gameState->mPlayerIndexForController[controllerIndex] = entityIndex;
+
+				entity* player = GetEntity(gameState, entityIndex);
+				player->mFovViewerIndex = AddTileFovViewer(tileMap, player->mTilePos, 10);
 			}
 		}
 	}
 
-	entity* cameraFollowingEntity = GetEntity(gameState, gameState->mCameraFollowingEntityIndex);
+	entity* cameraFollowingEntity = GetEntity(gameState, gameState->mCameraEntityIndex);
 	if (cameraFollowingEntity) {
-		gameState->cameraP.AbsTileZ = cameraFollowingEntity->mPos.AbsTileZ;
+		gameState->cameraP.mAbsTileZ = cameraFollowingEntity->mTilePos.mAbsTileZ;
 
-		tile_map_difference diff = Subtract(tileMap, &cameraFollowingEntity->mPos, &gameState->cameraP);
+		tile_map_difference diff = Subtract(tileMap, &cameraFollowingEntity->mTilePos, &gameState->cameraP);
 		if (diff.mVector.x > (9.0f*tileMap->mTileSideInMeters)) {
 			gameState->cameraP.mAbsTileX += 17;
 		}
@@ -490,63 +1157,79 @@ extern "C" GAME_UPDATE_AND_RENDER(GameUpdateAndRender) {
 		}
 	}
 
+	UpdateResidentTileChunks(tileMap, gameState->cameraP, 2);
+	entity* leader = GetEntity(gameState, gameState->mCameraEntityIndex);
+	if (leader && leader->mExists) {
+		MoveFollowers(gameState, tileMap, leader, pInput->deltaTime);
+	}
+	if (gameState->mIsCameraLightOn) {
+		MoveTileLight(tileMap, gameState->mCameraLightIndex, gameState->cameraP);
+	}
+	UpdateTileLights(tileMap);
+
+	// Each player sees from its own tile, the screen shows what any of them can see
+	for (uint32 controllerIndex = 0; controllerIndex < ArrayCount(pInput->mControllers); ++controllerIndex) {
+		entity* player = GetEntity(gameState, gameState->mPlayerIndexForController[controllerIndex]);
+		if (player) {
+			MoveTileFovViewer(tileMap, player->mFovViewerIndex, player->mTilePos);
+		}
+	}
+	UpdateTileFov(tileMap);
+	bool32 isFogged = (world->mFov.mActiveViewerCount > 0);
+
 	// Render
-	DrawBitmap(pScreenBuffer, &gameState->mBackdrop, 0, 0);
+	// Streamed backdrops follow the camera's floor, and are left out until they are resident
+	loaded_bitmap backdrop = gameState->mBackdrop.mBitmap;
+	if (gameState->mBackdropID) {
+		gameState->mBackdropID = GetBackdropAsset(&gameState->mAssets, gameState->cameraP.mAbsTileZ);
+		backdrop = GetCachedBitmap(pMemory, &gameState->mAssetCache, gameState->mBackdropID);
+	}
+	DrawBitmap(pScreenBuffer, &backdrop, 0, 0);
 
 	real32 screenCenterX = 0.5f*(real32)pScreenBuffer->mWidth;
 	real32 screenCenterY = 0.5f*(real32)pScreenBuffer->mHeight;
+	DrawTileLayer(pMemory, pScreenBuffer, tileMap, &gameState->mTileRenderCache, gameState->cameraP, metersToPixels);
+
+	// The camera's own tile is marked on top of the cached layer so moving the camera never redraws a chunk
+	tile_type* cameraTileType = GetTileType(tileMap, GetTileValue(tileMap, gameState->cameraP));
+	if ((cameraTileType->mFlags & TILE_TYPE_DRAWN) &&
+		(!isFogged || IsTileVisible(tileMap, gameState->cameraP.mAbsTileX, gameState->cameraP.mAbsTileY, gameState->cameraP.mAbsTileZ))) {
+		Vector2 tileSide(0.5f*(real32)tileSideInPixels, 0.5f*(real32)tileSideInPixels);
+		Vector2 cen(screenCenterX - metersToPixels*gameState->cameraP.mOffset.x,
+				  screenCenterY + metersToPixels*gameState->cameraP.mOffset.y);
+		DrawRectangle(pScreenBuffer, cen - 0.9f*tileSide, cen + 0.9f*tileSide, 0.0f, 0.0f, 0.0f);
+	}
 
-	for (int32 relRow = -10; relRow < 10; ++relRow) {
-		for (int32 relColumn = -20; relColumn < 20; ++relColumn) {
-			uint32 column = relColumn + gameState->cameraP.mAbsTileX;
-			uint32 row = relRow + gameState->cameraP.mAbsTileY;
-			uint32 tileID = GetTileValue(tileMap, column, row, gameState->cameraP.mAbsTileZ);
-			if (tileID > 1) {
-				real32 gray = 0.5f;
-				if (tileID == 2) {
-					gray = 1.0f;
-				}
-				if (tileID > 2) {
-					gray = 0.25f;
-				}
-				if ((column == gameState->cameraP.mAbsTileX) &&
-					(row == gameState->cameraP.mAbsTileY)) {
-					gray = 0.0f;
-				}
-
-				Vector2 tileSide(0.5f*TileSideInPixels, 0.5f*TileSideInPixels);
-				Vector2 cen(screenCenterX - MetersToPixels * gameState->cameraP.mOffset.x + ((real32)RelColumn)*TileSideInPixels,
-						  screenCenterY + MetersToPixels * gameState->cameraP.mOffset.y - ((real32)RelRow)*TileSideInPixels);
-				Vector2 Min = cen - 0.9f*tileSide;
-				Vector2 Max = cen + 0.9f*tileSide;
-				DrawRectangle(pScreenBuffer, Min, Max, gray, gray, gray);
+	entity_draw entityDraws[ArrayCount(gameState->mEntities)];
+	entity_draw_pass entityPass = {};
+	entityPass.mGameState = gameState;
+	entityPass.mTileMap = tileMap;
+	entityPass.mDraws = entityDraws;
+	entityPass.mIsFogged = isFogged;
+	entityPass.mAmbientLight = ambientLight;
+	entityPass.mMetersToPixels = metersToPixels;
+	entityPass.mScreenCenter = Vector2(screenCenterX, screenCenterY);
+	ParallelFor(pMemory, 0, gameState->mEntityCount, 16, PrepareEntityDraws, &entityPass);
+
+	// Drawn in entity order so overlapping entities always stack the same way
+	{
+		TIMED_BLOCK("DrawEntities");
+		for (uint32 entityIndex = 0; entityIndex < gameState->mEntityCount; ++entityIndex) {
+			entity_draw* draw = entityDraws + entityIndex;
+			if (draw->mIsDrawn) {
+				DrawRectangle(pScreenBuffer, draw->mMin, draw->mMax, draw->mBrightness, draw->mBrightness, 0.0f);
 			}
 		}
 	}
 
-	entity* entity = gameState->Entities;
-	for (uint32 entityIndex = 0; entityIndex < gameState->mEntityCount; ++entityIndex, ++entity) {
-		if (entity->Exists) {
-			tile_map_difference diff = Subtract(tileMap, &entity->mPos, &gameState->cameraP);
-
-			real32 PlayerR = 1.0f;
-			real32 PlayerG = 1.0f;
-			real32 PlayerB = 0.0f;
-			real32 PlayerGroundPointX = screenCenterX + MetersToPixels * diff.mVector.x;
-			real32 PlayerGroundPointY = screenCenterY - MetersToPixels * diff.mVector.y;
-			Vector2 PlayerLeftTop(PlayerGroundPointX - 0.5f*MetersToPixels*entity->mWidth,
-								PlayerGroundPointY - 0.5f*MetersToPixels*entity->mHeight);
-			Vector2 entityWidthHeight(entity->mWidth, entity->mHeight);
-			DrawRectangle(pScreenBuffer,
-				PlayerLeftTop,
-				PlayerLeftTop + MetersToPixels * entityWidthHeight,
-				PlayerR, PlayerG, PlayerB);
-		}
-	}
+	// Chunks nobody has asked for in the last 120 frames are compressed
+	CompactColdTileChunks(tileMap, 120, 64);
 }
 
-#define TONEHZ 400
 extern "C" GAME_GET_SOUND_SAMPLES(GameGetSoundSamples) {
+	gDebugTable = pMemory->mDebugTable;
+	TIMED_FUNCTION();
+
 	game_state* gameState = (game_state*)pMemory->mPermanentStorage;
-	GameOutputSound(pSoundBuffer, gameState, TONEHZ);
+	GameOutputSound(pSoundBuffer, gameState, pMemory);
 }
\ No newline at end of file
@@ -6,6 +6,8 @@
 
 #include "engine_platform.h"
 
+#include <string.h>
+
 
 #define Minimum(A, B) ((A < B) ? (A) : (B))
 #define Maximum(A, B) ((A > B) ? (A) : (B))
@@ -19,7 +21,7 @@ struct memory_areana {
 	memory_index mUsed;
 };
 
-internal void
+inline void
 InitializeArena(memory_areana* arena, memory_index size, uint8* base) {
 	arena->mSize = size;
 	arena->mBase = base;
@@ -44,13 +46,11 @@ MemoryClear_(void* memory, memory_index size, int32 value) {
 	// TODO: memset(memory, value, size);
 }
 
-#include "engine_intrinsics.h"
-#include "engine_math.h"
-#include "engine_tile.h"
-
-struct world {
-	tile_map* mTileMap;
-};
+#define MemoryCopy(dest, source, size) MemoryCopy_((void*)(dest), (void*)(source), size)
+inline void
+MemoryCopy_(void* dest, void* source, memory_index size) {
+	memcpy(dest, source, size);
+}
 
 struct loaded_bitmap
 {
@@ -59,12 +59,48 @@ struct loaded_bitmap
 	uint32* mPixels;
 };
 
+#include "engine_intrinsics.h"
+#include "engine_debug.h"
+#include "engine_math.h"
+#include "engine_tile.h"
+#include "engine_tile_journal.h"
+#include "engine_world_file.h"
+#include "engine_region.h"
+#include "engine_light.h"
+#include "engine_fov.h"
+#include "engine_path.h"
+#include "engine_ray.h"
+#include "engine_tile_render.h"
+#include "engine_asset.h"
+
+struct world {
+	tile_map* mTileMap;
+	tile_chunk_stream mChunkStream;
+	tile_path_cache mPathCache;
+	tile_region_map mRegions;
+	tile_light_map mLights;
+	tile_fov_map mFov;
+	tile_journal mJournal;
+
+	// Points every tile around the camera entity toward it, followers walk it
+	tile_flow_field mFollowerField;
+	uint32 mFollowerFieldSubscriberIndex;
+};
+
 struct entity {
 	bool32 mExists;
 	tile_map_location mTilePos;
 	Vector2 mPos;
 	uint32 mDir;
 	real32 mWidth, mHeight;
+
+	// Players only
+	uint32 mFovViewerIndex;
+
+	// Followers only
+	bool32 mIsFollower;
+	bool32 mHasSeenLeader;
+	real32 mStepTimer;
 };
 
 struct game_state {
@@ -73,12 +109,73 @@ struct game_state {
 
 	uint32 mCameraEntityIndex;
 	tile_map_location cameraP;
+	uint32 mCameraLightIndex;
+	bool32 mIsCameraLightOn;
 
-	uint32 mPlayerIndexForController[ArrayCount(((game_input *)0)->Controllers)];
+	uint32 mPlayerIndexForController[ArrayCount(((game_input *)0)->mControllers)];
 	uint32 mEntityCount;
 	entity mEntities[256];
 
-	loaded_bitmap mBackdrop;
+	asset_pack mAssets;
+	asset_id mBackdropID;     // 0 when the pack has no backdrop or could not be opened
+	mapped_bitmap mBackdrop;  // The baked backdrop, used without a pack
+	asset_id mFootstepID;     // The footstep playing, 0 when quiet
+	uint32 mFootstepSampleIndex;
+
+	memory_areana mTransientArena;
+	tile_render_cache mTileRenderCache;
+	asset_cache mAssetCache;
+	memory_index mAssetArenaMark;  // Where the asset cache starts in the transient arena
+};
+
+// Where and how an entity is drawn, worked out for all entities in parallel and then drawn in order
+struct entity_draw {
+	bool32 mIsDrawn;
+	Vector2 mMin;
+	Vector2 mMax;
+	real32 mBrightness;
+};
+
+struct entity_draw_pass {
+	game_state* mGameState;
+	tile_map* mTileMap;
+	entity_draw* mDraws;
+	bool32 mIsFogged;
+	real32 mAmbientLight;
+	real32 mMetersToPixels;
+	Vector2 mScreenCenter;
+};
+
+#define GENERATED_ROOM_DOOR_LEFT 0x1
+#define GENERATED_ROOM_DOOR_RIGHT 0x2
+#define GENERATED_ROOM_DOOR_BOTTOM 0x4
+#define GENERATED_ROOM_DOOR_TOP 0x8
+
+// A room laid out by the random walk, its tiles are written later together with the other rooms in its chunks
+struct generated_room {
+	tile_coord mMinTileX;
+	tile_coord mMinTileY;
+	uint32 mAbsTileZ;
+	uint32 mDoorFlags;
+	uint32 mZDoorValue;  // 0 when the room has no door to another floor
+};
+
+// Each chunk's tiles are built in parallel into mTiles, then stamped into the tile map one chunk at a time
+struct generated_chunk {
+	tile_coord mChunkX;
+	tile_coord mChunkY;
+	uint32 mAbsTileZ;
+	uint32* mTiles;
+};
+
+struct room_generation {
+	tile_map* mTileMap;
+	uint32 mTilesPerWidth;
+	uint32 mTilesPerHeight;
+	generated_room* mRooms;
+	uint32 mRoomCount;
+	generated_chunk* mChunks;
+	uint32 mChunkCount;
 };
 
 #define ENGINE_H
@@ -0,0 +1,521 @@
+/*
+ * Author: Jheremy Strom
+ */
+
+// The header is checked against the view, a truncated or stale file is never drawn from
+internal bool32
+MapBakedBitmap(thread_context* thread, game_memory* memory, const char* fileName, mapped_bitmap* bitmap) {
+	bool32 result = false;
+	*bitmap = {};
+
+	if (memory->PlatformMapFileView) {
+		// The pixels page in while the rest of the game starts up
+		platform_file_view view = memory->PlatformMapFileView(thread, fileName, 0, 0, PLATFORM_VIEW_ACCESS_WILL_NEED);
+		if (view.mMemory && (view.mSize >= sizeof(baked_bitmap_header))) {
+			baked_bitmap_header* header = (baked_bitmap_header*)view.mMemory;
+			if ((header->mMagicValue == BAKED_BITMAP_MAGIC_VALUE) && (header->mVersion == BAKED_BITMAP_VERSION) &&
+				(header->mWidth > 0) && (header->mHeight > 0) &&
+				(header->mPixelOffset >= sizeof(baked_bitmap_header)) &&
+				((header->mPixelOffset % BAKED_BITMAP_PIXEL_ALIGNMENT) == 0) &&
+				(header->mPixelOffset <= view.mSize)) {
+				uint64 pixelSize = (uint64)header->mWidth*(uint64)header->mHeight*sizeof(uint32);
+				result = (pixelSize <= (view.mSize - header->mPixelOffset));
+			}
+
+			if (result) {
+				bitmap->mBitmap.mWidth = header->mWidth;
+				bitmap->mBitmap.mHeight = header->mHeight;
+				bitmap->mBitmap.mPixels = (uint32*)((uint8*)view.mMemory + header->mPixelOffset);
+				bitmap->mView = view;
+			}
+		}
+
+		if (!result) {
+			memory->PlatformUnmapFileView(thread, &view);
+		}
+	}
+
+	return result;
+}
+
+internal void
+UnmapBakedBitmap(thread_context* thread, game_memory* memory, mapped_bitmap* bitmap) {
+	if (bitmap->mView.mMemory) {
+		memory->PlatformUnmapFileView(thread, &bitmap->mView);
+	}
+	*bitmap = {};
+}
+
+// Everything in the tables is checked once here, so lookups and the payloads they return can be trusted
+internal bool32
+ValidateAssetPack(asset_pack_header* header, uint64 fileSize) {
+	bool32 result = ((header->mMagicValue == ASSET_PACK_MAGIC_VALUE) && (header->mVersion == ASSET_PACK_VERSION) &&
+					 (header->mAssetCount > 0) &&
+					 (header->mTypesOffset <= fileSize) &&
+					 (((uint64)header->mTypeCount*sizeof(asset_pack_type)) <= (fileSize - header->mTypesOffset)) &&
+					 (header->mTagsOffset <= fileSize) &&
+					 (((uint64)header->mTagCount*sizeof(asset_pack_tag)) <= (fileSize - header->mTagsOffset)) &&
+					 (header->mAssetsOffset <= fileSize) &&
+					 (((uint64)header->mAssetCount*sizeof(asset_pack_asset)) <= (fileSize - header->mAssetsOffset)) &&
+					 ((header->mTypesOffset % sizeof(uint32)) == 0) &&
+					 ((header->mTagsOffset % sizeof(uint32)) == 0) &&
+					 ((header->mAssetsOffset % sizeof(uint64)) == 0));
+
+	if (result) {
+		uint8* base = (uint8*)header;
+		asset_pack_type* types = (asset_pack_type*)(base + header->mTypesOffset);
+		for (uint32 typeIndex = 0; result && (typeIndex < header->mTypeCount); ++typeIndex) {
+			asset_pack_type* type = types + typeIndex;
+			result = ((type->mFirstAssetIndex <= type->mOnePastLastAssetIndex) &&
+					  (type->mOnePastLastAssetIndex <= header->mAssetCount));
+		}
+
+		asset_pack_asset* assets = (asset_pack_asset*)(base + header->mAssetsOffset);
+		for (uint32 assetIndex = 1; result && (assetIndex < header->mAssetCount); ++assetIndex) {
+			asset_pack_asset* asset = assets + assetIndex;
+			uint64 expectedSize = 0;
+			if (asset->mKind == ASSET_KIND_BITMAP) {
+				if ((asset->mBitmap.mWidth > 0) && (asset->mBitmap.mHeight > 0)) {
+					expectedSize = (uint64)asset->mBitmap.mWidth*(uint64)asset->mBitmap.mHeight*sizeof(uint32);
+				}
+			}
+			else if (asset->mKind == ASSET_KIND_SOUND) {
+				expectedSize = (uint64)asset->mSound.mSampleCount*ASSET_SOUND_CHANNEL_COUNT*sizeof(int16);
+			}
+
+			result = ((asset->mKind != ASSET_KIND_NONE) && expectedSize && (asset->mDataSize == expectedSize) &&
+					  ((asset->mDataOffset % ASSET_PACK_DATA_ALIGNMENT) == 0) &&
+					  (asset->mDataOffset <= fileSize) && (asset->mDataSize <= (fileSize - asset->mDataOffset)) &&
+					  (asset->mFirstTagIndex <= asset->mOnePastLastTagIndex) &&
+					  (asset->mOnePastLastTagIndex <= header->mTagCount));
+		}
+	}
+
+	return result;
+}
+
+// The pack is only mapped, payload pages come in the first time an asset is used or prefetched
+internal bool32
+OpenAssetPack(thread_context* thread, game_memory* memory, const char* fileName, asset_pack* pack) {
+	bool32 result = false;
+	*pack = {};
+
+	if (memory->PlatformMapFileView) {
+		platform_file_view view = memory->PlatformMapFileView(thread, fileName, 0, 0, PLATFORM_VIEW_ACCESS_NORMAL);
+		if (view.mMemory && (view.mSize >= sizeof(asset_pack_header))) {
+			result = ValidateAssetPack((asset_pack_header*)view.mMemory, view.mSize);
+		}
+
+		if (result) {
+			pack->mView = view;
+			pack->mHeader = (asset_pack_header*)view.mMemory;
+			pack->mTags = (asset_pack_tag*)((uint8*)view.mMemory + pack->mHeader->mTagsOffset);
+			pack->mAssets = (asset_pack_asset*)((uint8*)view.mMemory + pack->mHeader->mAssetsOffset);
+			pack->mAssetCount = pack->mHeader->mAssetCount;
+
+			asset_pack_type* types = (asset_pack_type*)((uint8*)view.mMemory + pack->mHeader->mTypesOffset);
+			for (uint32 typeIndex = 0; typeIndex < pack->mHeader->mTypeCount; ++typeIndex) {
+				asset_pack_type* type = types + typeIndex;
+				if (type->mTypeID < ASSET_TYPE_COUNT) {
+					pack->mFirstAssetOfType[type->mTypeID] = type->mFirstAssetIndex;
+					pack->mOnePastLastAssetOfType[type->mTypeID] = type->mOnePastLastAssetIndex;
+				}
+			}
+		}
+		else {
+			memory->PlatformUnmapFileView(thread, &view);
+		}
+	}
+
+	return result;
+}
+
+internal void
+CloseAssetPack(thread_context* thread, game_memory* memory, asset_pack* pack) {
+	if (pack->mView.mMemory) {
+		memory->PlatformUnmapFileView(thread, &pack->mView);
+	}
+	*pack = {};
+}
+
+inline asset_id
+GetFirstAsset(asset_pack* pack, uint32 typeID) {
+	Assert(typeID < ASSET_TYPE_COUNT);
+	asset_id result = 0;
+	if (pack->mFirstAssetOfType[typeID] != pack->mOnePastLastAssetOfType[typeID]) {
+		result = pack->mFirstAssetOfType[typeID];
+	}
+	return result;
+}
+
+// The asset of the type whose tags are nearest the match, each tag's distance scaled by its weight.
+// Tags an asset does not have count as matching.
+internal asset_id
+GetBestMatchAsset(asset_pack* pack, uint32 typeID, asset_vector* match, asset_vector* weight) {
+	Assert(typeID < ASSET_TYPE_COUNT);
+	asset_id result = 0;
+	real32 bestDiff = Real32Maximum;
+	for (uint32 assetIndex = pack->mFirstAssetOfType[typeID]; assetIndex < pack->mOnePastLastAssetOfType[typeID]; ++assetIndex) {
+		asset_pack_asset* asset = pack->mAssets + assetIndex;
+
+		real32 totalDiff = 0.0f;
+		for (uint32 tagIndex = asset->mFirstTagIndex; tagIndex < asset->mOnePastLastTagIndex; ++tagIndex) {
+			asset_pack_tag* tag = pack->mTags + tagIndex;
+			if (tag->mTagID < ASSET_TAG_COUNT) {
+				real32 diff = match->mE[tag->mTagID] - tag->mValue;
+				totalDiff += weight->mE[tag->mTagID]*((diff < 0.0f) ? -diff : diff);
+			}
+		}
+
+		if (totalDiff < bestDiff) {
+			bestDiff = totalDiff;
+			result = assetIndex;
+		}
+	}
+	return result;
+}
+
+// An empty bitmap when the id is not a bitmap, the pixels are read only
+inline loaded_bitmap
+GetBitmap(asset_pack* pack, asset_id id) {
+	loaded_bitmap result = {};
+	if (id && (id < pack->mAssetCount) && (pack->mAssets[id].mKind == ASSET_KIND_BITMAP)) {
+		asset_pack_asset* asset = pack->mAssets + id;
+		result.mWidth = asset->mBitmap.mWidth;
+		result.mHeight = asset->mBitmap.mHeight;
+		result.mPixels = (uint32*)((uint8*)pack->mView.mMemory + asset->mDataOffset);
+	}
+	return result;
+}
+
+inline loaded_sound
+GetSound(asset_pack* pack, asset_id id) {
+	loaded_sound result = {};
+	if (id && (id < pack->mAssetCount) && (pack->mAssets[id].mKind == ASSET_KIND_SOUND)) {
+		asset_pack_asset* asset = pack->mAssets + id;
+		result.mSampleCount = asset->mSound.mSampleCount;
+		result.mSamples = (int16*)((uint8*)pack->mView.mMemory + asset->mDataOffset);
+	}
+	return result;
+}
+
+// Starts the asset's pages coming in ahead of its first use
+internal void
+PrefetchAsset(game_memory* memory, asset_pack* pack, asset_id id) {
+	if (id && (id < pack->mAssetCount) && memory->PlatformPrefetchFileView) {
+		asset_pack_asset* asset = pack->mAssets + id;
+		memory->PlatformPrefetchFileView(&pack->mView, asset->mDataOffset, asset->mDataSize);
+	}
+}
+
+inline void
+UnlinkAssetSlot(asset_slot* slot) {
+	slot->mPrevUsed->mNextUsed = slot->mNextUsed;
+	slot->mNextUsed->mPrevUsed = slot->mPrevUsed;
+}
+
+inline void
+LinkAssetSlotAtFront(asset_cache* cache, asset_slot* slot) {
+	asset_slot* sentinel = &cache->mUsedSentinel;
+	slot->mNextUsed = sentinel->mNextUsed;
+	slot->mPrevUsed = sentinel;
+	slot->mNextUsed->mPrevUsed = slot;
+	sentinel->mNextUsed = slot;
+}
+
+// Takes budget bytes of the arena as one free block. The pack has to stay open as long as the cache is used.
+internal bool32
+InitializeAssetCache(thread_context* thread, game_memory* memory, asset_cache* cache, asset_pack* pack,
+					 const char* fileName, memory_areana* arena, memory_index budget) {
+	Assert(budget >= 2*ASSET_CACHE_ALIGNMENT);
+	*cache = {};
+	cache->mPack = pack;
+	cache->mUsedSentinel.mNextUsed = &cache->mUsedSentinel;
+	cache->mUsedSentinel.mPrevUsed = &cache->mUsedSentinel;
+
+	if (memory->PlatformOpenFile && pack->mAssetCount) {
+		cache->mFile = memory->PlatformOpenFile(thread, fileName);
+	}
+
+	bool32 result = cache->mFile.mIsValid;
+	if (result) {
+		// The arena is only as aligned as whatever was pushed before, the slots go after the aligned block
+		uint8* base = PushArray(arena, budget + ASSET_CACHE_ALIGNMENT, uint8);
+		base = (uint8*)(((memory_index)base + ASSET_CACHE_ALIGNMENT - 1) & ~(memory_index)(ASSET_CACHE_ALIGNMENT - 1));
+		cache->mBudget = budget & ~(memory_index)(ASSET_CACHE_ALIGNMENT - 1);
+
+		arena->mUsed = (base + cache->mBudget) - arena->mBase;
+		cache->mSlots = PushArray(arena, pack->mAssetCount, asset_slot);
+		for (uint32 slotIndex = 0; slotIndex < pack->mAssetCount; ++slotIndex) {
+			cache->mSlots[slotIndex] = {};
+		}
+
+		cache->mFirstBlock = (asset_memory_block*)base;
+		cache->mFirstBlock->mPrev = 0;
+		cache->mFirstBlock->mNext = 0;
+		cache->mFirstBlock->mSize = cache->mBudget - ASSET_CACHE_ALIGNMENT;
+		cache->mFirstBlock->mSlotIndex = ASSET_CACHE_FREE_BLOCK;
+	}
+
+	return result;
+}
+
+inline void*
+GetAssetBlockPayload(asset_memory_block* block) {
+	void* result = (uint8*)block + ASSET_CACHE_ALIGNMENT;
+	return result;
+}
+
+// First fit, sizes are multiples of ASSET_CACHE_ALIGNMENT
+internal asset_memory_block*
+FindFreeAssetBlock(asset_cache* cache, uint64 size) {
+	asset_memory_block* result = 0;
+	for (asset_memory_block* block = cache->mFirstBlock; block; block = block->mNext) {
+		if ((block->mSlotIndex == ASSET_CACHE_FREE_BLOCK) && (block->mSize >= size)) {
+			result = block;
+			break;
+		}
+	}
+	return result;
+}
+
+// Whatever the payload does not need is split off when it can hold a header and some payload of its own
+internal void
+UseAssetBlock(asset_memory_block* block, uint64 size, uint32 slotIndex) {
+	Assert((block->mSlotIndex == ASSET_CACHE_FREE_BLOCK) && (block->mSize >= size));
+	uint64 leftover = block->mSize - size;
+	if (leftover >= 2*ASSET_CACHE_ALIGNMENT) {
+		asset_memory_block* split = (asset_memory_block*)((uint8*)GetAssetBlockPayload(block) + size);
+		split->mPrev = block;
+		split->mNext = block->mNext;
+		split->mSize = leftover - ASSET_CACHE_ALIGNMENT;
+		split->mSlotIndex = ASSET_CACHE_FREE_BLOCK;
+		if (split->mNext) {
+			split->mNext->mPrev = split;
+		}
+		block->mNext = split;
+		block->mSize = size;
+	}
+	block->mSlotIndex = slotIndex;
+}
+
+// Returns the free block the memory ended up in after merging with its free neighbours
+internal asset_memory_block*
+FreeAssetBlock(asset_memory_block* block) {
+	block->mSlotIndex = ASSET_CACHE_FREE_BLOCK;
+
+	asset_memory_block* next = block->mNext;
+	if (next && (next->mSlotIndex == ASSET_CACHE_FREE_BLOCK)) {
+		block->mSize += ASSET_CACHE_ALIGNMENT + next->mSize;
+		block->mNext = next->mNext;
+		if (block->mNext) {
+			block->mNext->mPrev = block;
+		}
+	}
+
+	asset_memory_block* prev = block->mPrev;
+	if (prev && (prev->mSlotIndex == ASSET_CACHE_FREE_BLOCK)) {
+		prev->mSize += ASSET_CACHE_ALIGNMENT + block->mSize;
+		prev->mNext = block->mNext;
+		if (prev->mNext) {
+			prev->mNext->mPrev = prev;
+		}
+		block = prev;
+	}
+
+	return block;
+}
+
+internal asset_memory_block*
+EvictAsset(asset_cache* cache, asset_slot* slot) {
+	Assert(slot->mState == ASSET_STATE_RESIDENT);
+	UnlinkAssetSlot(slot);
+	cache->mUsedSize -= ASSET_CACHE_ALIGNMENT + slot->mBlock->mSize;
+	--cache->mResidentCount;
+	++cache->mEvictionCount;
+
+	asset_memory_block* result = FreeAssetBlock(slot->mBlock);
+	slot->mBlock = 0;
+	slot->mState = ASSET_STATE_UNLOADED;
+	return result;
+}
+
+// Makes room by evicting from the least recently used end and starts the read. When everything that
+// could make room was used this frame the asset stays unloaded and the next request tries again.
+internal void
+LoadAsset(game_memory* memory, asset_cache* cache, asset_id id) {
+	asset_slot* slot = cache->mSlots + id;
+	asset_pack_asset* asset = cache->mPack->mAssets + id;
+	uint64 size = (asset->mDataSize + ASSET_CACHE_ALIGNMENT - 1) & ~(uint64)(ASSET_CACHE_ALIGNMENT - 1);
+
+	if ((size + ASSET_CACHE_ALIGNMENT) > cache->mBudget) {
+		slot->mState = ASSET_STATE_FAILED;
+		++cache->mFailedCount;
+		return;
+	}
+
+	asset_memory_block* block = FindFreeAssetBlock(cache, size);
+	asset_slot* victim = cache->mUsedSentinel.mPrevUsed;
+	while (!block && (victim != &cache->mUsedSentinel)) {
+		asset_slot* nextVictim = victim->mPrevUsed;
+		if (victim->mLastUsedFrame != cache->mFrameIndex) {
+			// Only the evicted memory changed, every other free block was already too small
+			asset_memory_block* freed = EvictAsset(cache, victim);
+			if (freed->mSize >= size) {
+				block = freed;
+			}
+		}
+		victim = nextVictim;
+	}
+
+	if (block) {
+		UseAssetBlock(block, size, id);
+		cache->mUsedSize += ASSET_CACHE_ALIGNMENT + block->mSize;
+		++cache->mQueuedCount;
+
+		slot->mBlock = block;
+		slot->mState = ASSET_STATE_QUEUED;
+		slot->mFence = {};
+		memory->PlatformReadDataFromFile(&cache->mFile, asset->mDataOffset, asset->mDataSize,
+			GetAssetBlockPayload(block), &slot->mFence);
+	}
+}
+
+// Makes a queued asset resident once its read lands
+internal void
+UpdateQueuedAsset(asset_cache* cache, asset_slot* slot) {
+	Assert(slot->mState == ASSET_STATE_QUEUED);
+	if (IsReadFenceDone(&slot->mFence)) {
+		--cache->mQueuedCount;
+		if (slot->mFence.mFailedCount == 0) {
+			slot->mState = ASSET_STATE_RESIDENT;
+			++slot->mGeneration;
+			LinkAssetSlotAtFront(cache, slot);
+			++cache->mResidentCount;
+			++cache->mLoadCount;
+		}
+		else {
+			cache->mUsedSize -= ASSET_CACHE_ALIGNMENT + slot->mBlock->mSize;
+			FreeAssetBlock(slot->mBlock);
+			slot->mBlock = 0;
+			slot->mState = ASSET_STATE_FAILED;
+			++cache->mFailedCount;
+		}
+	}
+}
+
+// Assets used from here on are safe from eviction until the next call
+internal void
+BeginAssetCacheFrame(asset_cache* cache) {
+	++cache->mFrameIndex;
+	if (cache->mQueuedCount) {
+		for (uint32 slotIndex = 1; slotIndex < cache->mPack->mAssetCount; ++slotIndex) {
+			asset_slot* slot = cache->mSlots + slotIndex;
+			if (slot->mState == ASSET_STATE_QUEUED) {
+				UpdateQueuedAsset(cache, slot);
+			}
+		}
+	}
+}
+
+// Starts loading the asset if it is not resident. The ref is current once it is, until it gets evicted.
+internal asset_ref
+RequestAsset(game_memory* memory, asset_cache* cache, asset_id id) {
+	asset_ref result = {};
+	if (cache->mSlots && id && (id < cache->mPack->mAssetCount)) {
+		asset_slot* slot = cache->mSlots + id;
+		slot->mLastUsedFrame = cache->mFrameIndex;
+		++cache->mRequestCount;
+
+		if (slot->mState == ASSET_STATE_QUEUED) {
+			UpdateQueuedAsset(cache, slot);
+		}
+
+		if (slot->mState == ASSET_STATE_RESIDENT) {
+			UnlinkAssetSlot(slot);
+			LinkAssetSlotAtFront(cache, slot);
+			result.mID = id;
+			result.mGeneration = slot->mGeneration;
+			++cache->mHitCount;
+		}
+		else if (slot->mState == ASSET_STATE_UNLOADED) {
+			LoadAsset(memory, cache, id);
+		}
+	}
+	return result;
+}
+
+// Null once the asset the ref was taken from has been evicted, even if it was loaded again since
+inline void*
+GetAssetMemory(asset_cache* cache, asset_ref ref) {
+	void* result = 0;
+	if (cache->mSlots && ref.mID && (ref.mID < cache->mPack->mAssetCount)) {
+		asset_slot* slot = cache->mSlots + ref.mID;
+		if ((slot->mState == ASSET_STATE_RESIDENT) && (slot->mGeneration == ref.mGeneration)) {
+			result = GetAssetBlockPayload(slot->mBlock);
+		}
+	}
+	return result;
+}
+
+// Empty until the bitmap is resident
+internal loaded_bitmap
+GetCachedBitmap(game_memory* memory, asset_cache* cache, asset_id id) {
+	loaded_bitmap result = {};
+	asset_pack* pack = cache->mPack;
+	if (pack && id && (id < pack->mAssetCount) && (pack->mAssets[id].mKind == ASSET_KIND_BITMAP)) {
+		result.mPixels = (uint32*)GetAssetMemory(cache, RequestAsset(memory, cache, id));
+		if (result.mPixels) {
+			result.mWidth = pack->mAssets[id].mBitmap.mWidth;
+			result.mHeight = pack->mAssets[id].mBitmap.mHeight;
+		}
+	}
+	return result;
+}
+
+// Empty until the sound is resident
+internal loaded_sound
+GetCachedSound(game_memory* memory, asset_cache* cache, asset_id id) {
+	loaded_sound result = {};
+	asset_pack* pack = cache->mPack;
+	if (pack && id && (id < pack->mAssetCount) && (pack->mAssets[id].mKind == ASSET_KIND_SOUND)) {
+		result.mSamples = (int16*)GetAssetMemory(cache, RequestAsset(memory, cache, id));
+		if (result.mSamples) {
+			result.mSampleCount = pack->mAssets[id].mSound.mSampleCount;
+		}
+	}
+	return result;
+}
+
+#if ENGINE_INTERNAL
+// Writes a converted bitmap out the way MapBakedBitmap reads it, the file is put together in scratch
+internal bool32
+DEBUGBakeBitmap(thread_context* thread, game_memory* memory, memory_areana* scratch, loaded_bitmap* bitmap, const char* fileName) {
+	bool32 result = false;
+
+	uint64 pixelSize = (uint64)bitmap->mWidth*(uint64)bitmap->mHeight*sizeof(uint32);
+	uint64 fileSize = BAKED_BITMAP_PIXEL_ALIGNMENT + pixelSize;
+	if (memory->DEBUGPlatformWriteEntireFile && bitmap->mPixels && (bitmap->mWidth > 0) && (bitmap->mHeight > 0) &&
+		(fileSize <= UInt32Max) && ((scratch->mUsed + fileSize) <= scratch->mSize)) {
+		memory_index scratchUsed = scratch->mUsed;
+		uint8* contents = PushArray(scratch, fileSize, uint8);
+
+		for (uint32 byteIndex = 0; byteIndex < BAKED_BITMAP_PIXEL_ALIGNMENT; ++byteIndex) {
+			contents[byteIndex] = 0;
+		}
+
+		baked_bitmap_header* header = (baked_bitmap_header*)contents;
+		header->mMagicValue = BAKED_BITMAP_MAGIC_VALUE;
+		header->mVersion = BAKED_BITMAP_VERSION;
+		header->mWidth = bitmap->mWidth;
+		header->mHeight = bitmap->mHeight;
+		header->mPixelOffset = BAKED_BITMAP_PIXEL_ALIGNMENT;
+		MemoryCopy(contents + BAKED_BITMAP_PIXEL_ALIGNMENT, bitmap->mPixels, pixelSize);
+
+		result = memory->DEBUGPlatformWriteEntireFile(thread, fileName, (uint32)fileSize, contents);
+		scratch->mUsed = scratchUsed;
+	}
+
+	return result;
+}
+#endif
\ No newline at end of file
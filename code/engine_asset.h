@@ -0,0 +1,211 @@
+#if !defined(ENGINE_ASSET_H)
+
+/*
+ * Author: Jheremy Strom
+ */
+
+#define BAKED_BITMAP_MAGIC_VALUE (((uint32)'E' << 0) | ((uint32)'B' << 8) | ((uint32)'M' << 16) | ((uint32)'P' << 24))
+#define BAKED_BITMAP_VERSION 2  // Version 1 held straight alpha
+#define BAKED_BITMAP_PIXEL_ALIGNMENT 64
+
+/*
+ * Baked bitmap layout:
+ *   baked_bitmap_header
+ *   padding up to mPixelOffset, a multiple of BAKED_BITMAP_PIXEL_ALIGNMENT
+ *   uint32 pixels[mWidth*mHeight]  0xAARRGGBB premultiplied, bottom row first, exactly as loaded_bitmap holds them
+ *
+ * The pixels are already converted, so the game draws straight from the mapped file and loading
+ * costs the same however big the bitmap is.
+ */
+struct baked_bitmap_header {
+	uint32 mMagicValue;
+	uint32 mVersion;
+
+	int32 mWidth;
+	int32 mHeight;
+	uint32 mPixelOffset;
+};
+
+// A bitmap whose pixels are the pages of a mapped file, they are read only
+struct mapped_bitmap {
+	loaded_bitmap mBitmap;
+	platform_file_view mView;
+};
+
+#define ASSET_PACK_MAGIC_VALUE (((uint32)'E' << 0) | ((uint32)'P' << 8) | ((uint32)'A' << 16) | ((uint32)'K' << 24))
+#define ASSET_PACK_VERSION 1
+#define ASSET_PACK_DATA_ALIGNMENT 64
+
+// What an asset is for, every type owns one run of the asset table
+#define ASSET_TYPE_NONE 0
+#define ASSET_TYPE_BACKDROP 1
+#define ASSET_TYPE_ENTITY 2
+#define ASSET_TYPE_MUSIC 3
+#define ASSET_TYPE_FOOTSTEP 4
+#define ASSET_TYPE_COUNT 5
+
+// Properties lookups match against, an asset leaves out the tags it does not care about
+#define ASSET_TAG_FACING_DIRECTION 0  // Radians
+#define ASSET_TAG_FLOOR 1             // Absolute tile z
+#define ASSET_TAG_LIGHT_LEVEL 2       // 0 to TILE_LIGHT_MAX_LEVEL
+#define ASSET_TAG_COUNT 3
+
+#define ASSET_KIND_NONE 0
+#define ASSET_KIND_BITMAP 1
+#define ASSET_KIND_SOUND 2
+
+#define ASSET_SOUND_CHANNEL_COUNT 2
+#define ASSET_SOUND_SAMPLES_PER_SECOND 48000
+
+/*
+ * Asset pack layout:
+ *   asset_pack_header
+ *   asset_pack_type types[mTypeCount]     the run of the asset table each type owns
+ *   asset_pack_tag tags[mTagCount]        one run per asset
+ *   asset_pack_asset assets[mAssetCount]  asset 0 is the null asset, lookups that find nothing return it
+ *   payloads, each starting on a multiple of ASSET_PACK_DATA_ALIGNMENT
+ *
+ * Payloads are stored the way the engine uses them, so the game maps the pack and points into it.
+ * Bitmaps are loaded_bitmap pixels and sounds are interleaved 16 bit stereo at the output rate.
+ * engine_asset_packer.cpp builds packs from BMP and WAV files.
+ */
+struct asset_pack_header {
+	uint32 mMagicValue;
+	uint32 mVersion;
+
+	uint32 mTypeCount;
+	uint32 mTagCount;
+	uint32 mAssetCount;
+	uint32 mReserved;
+
+	uint64 mTypesOffset;
+	uint64 mTagsOffset;
+	uint64 mAssetsOffset;
+};
+
+struct asset_pack_type {
+	uint32 mTypeID;
+	uint32 mFirstAssetIndex;
+	uint32 mOnePastLastAssetIndex;
+};
+
+struct asset_pack_tag {
+	uint32 mTagID;
+	real32 mValue;
+};
+
+struct asset_pack_bitmap {
+	int32 mWidth;
+	int32 mHeight;
+};
+
+struct asset_pack_sound {
+	uint32 mSampleCount;  // Per channel
+	uint32 mReserved;
+};
+
+struct asset_pack_asset {
+	uint64 mDataOffset;
+	uint64 mDataSize;
+
+	uint32 mFirstTagIndex;
+	uint32 mOnePastLastTagIndex;
+
+	uint32 mKind;
+	union {
+		asset_pack_bitmap mBitmap;
+		asset_pack_sound mSound;
+	};
+};
+
+// Indexes the pack's asset table, 0 is no asset
+typedef uint32 asset_id;
+
+struct asset_vector {
+	real32 mE[ASSET_TAG_COUNT];
+};
+
+struct loaded_sound {
+	uint32 mSampleCount;  // Per channel
+	int16* mSamples;      // Interleaved left right
+};
+
+// A mapped pack, every table points into the view
+struct asset_pack {
+	platform_file_view mView;
+	asset_pack_header* mHeader;
+	asset_pack_tag* mTags;
+	asset_pack_asset* mAssets;
+	uint32 mAssetCount;
+
+	// Types this build does not know about are skipped, types the pack lacks are empty
+	uint32 mFirstAssetOfType[ASSET_TYPE_COUNT];
+	uint32 mOnePastLastAssetOfType[ASSET_TYPE_COUNT];
+};
+
+/*
+ * The asset cache streams pack payloads into a fixed block of memory. A request for an asset that is not
+ * resident starts an async read and returns nothing until the read lands. When the block is full the least
+ * recently used assets are evicted, except those used this frame, so what a frame was handed stays put
+ * until the next BeginAssetCacheFrame.
+ */
+#define ASSET_STATE_UNLOADED 0
+#define ASSET_STATE_QUEUED 1    // Read in flight, its memory can not be touched
+#define ASSET_STATE_RESIDENT 2
+#define ASSET_STATE_FAILED 3    // The read failed or the asset is bigger than the budget, it is not asked for again
+
+// Payloads and block headers start on multiples of this
+#define ASSET_CACHE_ALIGNMENT 64
+#define ASSET_CACHE_FREE_BLOCK UInt32Max
+
+// Blocks tile the cache memory in address order, each starts ASSET_CACHE_ALIGNMENT bytes before its payload
+struct asset_memory_block {
+	asset_memory_block* mPrev;
+	asset_memory_block* mNext;
+	uint64 mSize;        // Payload bytes
+	uint32 mSlotIndex;   // ASSET_CACHE_FREE_BLOCK when nothing lives in it
+};
+
+struct asset_slot {
+	uint32 mState;
+	uint32 mGeneration;      // Changes every time the asset is given new memory, 0 before the first time
+	uint32 mLastUsedFrame;
+	asset_memory_block* mBlock;
+	platform_read_fence mFence;
+
+	// Resident slots, most recently used first
+	asset_slot* mNextUsed;
+	asset_slot* mPrevUsed;
+};
+
+// What a caller can hold on to past the current frame, its memory is only good while the ref is current
+struct asset_ref {
+	asset_id mID;
+	uint32 mGeneration;
+};
+
+struct asset_cache {
+	asset_pack* mPack;
+	platform_file_handle mFile;
+	uint32 mFrameIndex;
+
+	asset_slot* mSlots;  // One per pack asset
+	asset_memory_block* mFirstBlock;
+	asset_slot mUsedSentinel;
+
+	// Block headers count against the budget, queued assets already hold their memory
+	uint64 mBudget;
+	uint64 mUsedSize;
+	uint32 mResidentCount;
+	uint32 mQueuedCount;
+
+	// Totals since the cache was made, the hit rate is mHitCount / mRequestCount
+	uint32 mRequestCount;
+	uint32 mHitCount;
+	uint32 mLoadCount;
+	uint32 mEvictionCount;
+	uint32 mFailedCount;
+};
+
+#define ENGINE_ASSET_H
+#endif
\ No newline at end of file
@@ -0,0 +1,434 @@
+/*
+ * Author: Jheremy Strom
+ */
+
+/*
+ * Offline asset packer. Built from the same unity build as the game, so the BMP loader, the pixel
+ * format and the pack layout are exactly the ones the game maps at runtime.
+ *
+ *     engine_asset_packer <manifest> <pack>
+ *
+ * One asset per manifest line, everything after a # is a comment:
+ *     <type> <file> [<tag> <value>]...
+ * .bmp files become bitmaps and .wav files (16 bit PCM, 48000 Hz, mono or stereo) become sounds.
+ */
+
+#if defined(_MSC_VER)
+#define _CRT_SECURE_NO_WARNINGS
+#else
+#include <x86intrin.h>
+#endif
+
+#include "engine.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PACKER_MAX_ASSET_COUNT 4096
+#define PACKER_MAX_TAG_COUNT 16384
+#define PACKER_MAX_LINE_LENGTH 1024
+#define PACKER_SCRATCH_SIZE Megabytes(256)  // Holds the converted pixels of a 24 bit bitmap
+
+// Manifest names, indexed by ASSET_TYPE_ and ASSET_TAG_
+global_variable const char* gAssetTypeNames[ASSET_TYPE_COUNT] = {
+	"none", "backdrop", "entity", "music", "footstep"
+};
+global_variable const char* gAssetTagNames[ASSET_TAG_COUNT] = {
+	"facing_direction", "floor", "light_level"
+};
+
+struct packer_asset {
+	uint32 mTypeID;
+	uint32 mKind;
+	char mFileName[PACKER_MAX_LINE_LENGTH];
+	uint32 mLineNumber;
+
+	uint32 mFirstTagIndex;
+	uint32 mOnePastLastTagIndex;
+};
+
+struct packer_state {
+	char* mManifestName;
+
+	packer_asset mAssets[PACKER_MAX_ASSET_COUNT];
+	uint32 mAssetCount;
+
+	asset_pack_tag mTags[PACKER_MAX_TAG_COUNT];
+	uint32 mTagCount;
+};
+
+#pragma pack(push, 1)
+struct wave_chunk_header {
+	uint32 mID;
+	uint32 mSize;
+};
+
+struct wave_format {
+	uint16 mFormatTag;
+	uint16 mChannelCount;
+	uint32 mSamplesPerSecond;
+	uint32 mBytesPerSecond;
+	uint16 mBlockAlign;
+	uint16 mBitsPerSample;
+};
+#pragma pack(pop)
+
+#define RIFF_CODE(a, b, c, d) (((uint32)(a) << 0) | ((uint32)(b) << 8) | ((uint32)(c) << 16) | ((uint32)(d) << 24))
+#define WAVE_FORMAT_PCM 1
+
+// The BMP loader converts in place inside the file contents, they are freed once the asset is written
+global_variable void* gLastFileContents;
+
+DEBUG_PLATFORM_READ_ENTIRE_FILE(PackerReadEntireFile) {
+	debug_read_file_result result = {};
+	gLastFileContents = 0;
+
+	FILE* file = fopen(pFilename, "rb");
+	if (file) {
+		fseek(file, 0, SEEK_END);
+		long fileSize = ftell(file);
+		fseek(file, 0, SEEK_SET);
+		if ((fileSize > 0) && ((uint64)fileSize <= UInt32Max)) {
+			result.mContents = malloc((size_t)fileSize);
+			if (result.mContents && (fread(result.mContents, 1, (size_t)fileSize, file) == (size_t)fileSize)) {
+				result.mContentsSize = (uint32)fileSize;
+				gLastFileContents = result.mContents;
+			}
+			else {
+				free(result.mContents);
+				result.mContents = 0;
+			}
+		}
+		fclose(file);
+	}
+
+	return result;
+}
+
+internal void
+PackerFreeLastFile(void) {
+	free(gLastFileContents);
+	gLastFileContents = 0;
+}
+
+internal bool32
+HasExtension(char* fileName, const char* extension) {
+	size_t nameLength = strlen(fileName);
+	size_t extensionLength = strlen(extension);
+	bool32 result = false;
+	if (nameLength >= extensionLength) {
+		result = true;
+		char* at = fileName + nameLength - extensionLength;
+		for (size_t charIndex = 0; charIndex < extensionLength; ++charIndex) {
+			char c = at[charIndex];
+			if ((c >= 'A') && (c <= 'Z')) {
+				c = c - 'A' + 'a';
+			}
+			if (c != extension[charIndex]) {
+				result = false;
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+// Returns the index of name in names, or count when it is not there
+internal uint32
+FindName(const char** names, uint32 count, char* name) {
+	uint32 result = 0;
+	while ((result < count) && (strcmp(names[result], name) != 0)) {
+		++result;
+	}
+	return result;
+}
+
+internal bool32
+PackerReadManifest(packer_state* state, char* manifestName) {
+	FILE* manifest = fopen(manifestName, "rb");
+	if (!manifest) {
+		fprintf(stderr, "Could not open the manifest %s\n", manifestName);
+		return false;
+	}
+
+	bool32 result = true;
+	state->mManifestName = manifestName;
+	char line[PACKER_MAX_LINE_LENGTH];
+	uint32 lineNumber = 0;
+	while (result && fgets(line, sizeof(line), manifest)) {
+		++lineNumber;
+		char* comment = strchr(line, '#');
+		if (comment) {
+			*comment = 0;
+		}
+
+		char* typeName = strtok(line, " \t\r\n");
+		if (!typeName) {
+			continue;
+		}
+
+		char* fileName = strtok(0, " \t\r\n");
+		uint32 typeID = FindName(gAssetTypeNames, ASSET_TYPE_COUNT, typeName);
+		if ((typeID == ASSET_TYPE_NONE) || (typeID == ASSET_TYPE_COUNT) || !fileName) {
+			fprintf(stderr, "%s(%u): expected <type> <file>\n", manifestName, lineNumber);
+			result = false;
+			break;
+		}
+
+		if (state->mAssetCount == PACKER_MAX_ASSET_COUNT) {
+			fprintf(stderr, "%s(%u): more than %d assets\n", manifestName, lineNumber, PACKER_MAX_ASSET_COUNT);
+			result = false;
+			break;
+		}
+
+		packer_asset* asset = state->mAssets + state->mAssetCount++;
+		asset->mTypeID = typeID;
+		asset->mKind = HasExtension(fileName, ".bmp") ? ASSET_KIND_BITMAP :
+					   HasExtension(fileName, ".wav") ? ASSET_KIND_SOUND : ASSET_KIND_NONE;
+		strcpy(asset->mFileName, fileName);
+		asset->mLineNumber = lineNumber;
+		asset->mFirstTagIndex = state->mTagCount;
+		if (asset->mKind == ASSET_KIND_NONE) {
+			fprintf(stderr, "%s(%u): %s is neither a .bmp nor a .wav\n", manifestName, lineNumber, fileName);
+			result = false;
+		}
+
+		for (char* tagName = strtok(0, " \t\r\n"); result && tagName; tagName = strtok(0, " \t\r\n")) {
+			char* valueText = strtok(0, " \t\r\n");
+			char* valueEnd = 0;
+			real32 value = valueText ? (real32)strtod(valueText, &valueEnd) : 0.0f;
+			uint32 tagID = FindName(gAssetTagNames, ASSET_TAG_COUNT, tagName);
+			if ((tagID == ASSET_TAG_COUNT) || !valueText || (valueEnd == valueText) || *valueEnd) {
+				fprintf(stderr, "%s(%u): expected <tag> <value>, not %s\n", manifestName, lineNumber, tagName);
+				result = false;
+			}
+			else if (state->mTagCount == PACKER_MAX_TAG_COUNT) {
+				fprintf(stderr, "%s(%u): more than %d tags\n", manifestName, lineNumber, PACKER_MAX_TAG_COUNT);
+				result = false;
+			}
+			else {
+				asset_pack_tag* tag = state->mTags + state->mTagCount++;
+				tag->mTagID = tagID;
+				tag->mValue = value;
+			}
+		}
+		asset->mOnePastLastTagIndex = state->mTagCount;
+	}
+
+	fclose(manifest);
+	return result;
+}
+
+// Converts to interleaved stereo, mono is copied to both channels. The samples are malloced.
+internal bool32
+PackerLoadWAV(void* contents, uint32 contentsSize, uint32* sampleCount, int16** samples) {
+	uint8* at = (uint8*)contents;
+	uint8* end = at + contentsSize;
+	if ((contentsSize < 12) || (((uint32*)at)[0] != RIFF_CODE('R', 'I', 'F', 'F')) ||
+		(((uint32*)at)[2] != RIFF_CODE('W', 'A', 'V', 'E'))) {
+		return false;
+	}
+	at += 12;
+
+	wave_format* format = 0;
+	int16* data = 0;
+	uint32 dataSize = 0;
+	while ((end - at) >= (int64)sizeof(wave_chunk_header)) {
+		wave_chunk_header* chunk = (wave_chunk_header*)at;
+		at += sizeof(wave_chunk_header);
+		if (chunk->mSize > (uint64)(end - at)) {
+			return false;
+		}
+
+		if ((chunk->mID == RIFF_CODE('f', 'm', 't', ' ')) && (chunk->mSize >= sizeof(wave_format))) {
+			format = (wave_format*)at;
+		}
+		else if (chunk->mID == RIFF_CODE('d', 'a', 't', 'a')) {
+			data = (int16*)at;
+			dataSize = chunk->mSize;
+		}
+		// Chunks are padded to an even size
+		at += (chunk->mSize + 1) & ~1u;
+	}
+
+	bool32 result = (format && data && (format->mFormatTag == WAVE_FORMAT_PCM) && (format->mBitsPerSample == 16) &&
+					 (format->mSamplesPerSecond == ASSET_SOUND_SAMPLES_PER_SECOND) &&
+					 ((format->mChannelCount == 1) || (format->mChannelCount == 2)));
+	if (result) {
+		uint32 channelCount = format->mChannelCount;
+		*sampleCount = dataSize / (channelCount*sizeof(int16));
+		*samples = (int16*)malloc((size_t)*sampleCount*ASSET_SOUND_CHANNEL_COUNT*sizeof(int16) + 1);
+		result = (*samples != 0) && (*sampleCount > 0);
+		for (uint32 sampleIndex = 0; result && (sampleIndex < *sampleCount); ++sampleIndex) {
+			int16 left = data[sampleIndex*channelCount];
+			int16 right = data[sampleIndex*channelCount + channelCount - 1];
+			(*samples)[2*sampleIndex + 0] = left;
+			(*samples)[2*sampleIndex + 1] = right;
+		}
+	}
+
+	return result;
+}
+
+internal bool32
+PackerWritePadding(FILE* file, uint64 alignment) {
+	uint8 zeros[ASSET_PACK_DATA_ALIGNMENT] = {};
+	uint64 offset = (uint64)ftell(file);
+	uint64 padding = (alignment - (offset % alignment)) % alignment;
+	bool32 result = (fwrite(zeros, 1, (size_t)padding, file) == padding);
+	return result;
+}
+
+/*
+ * Assets are written grouped by type, in manifest order within a type. The payloads go out first and
+ * the tables are written over the space left for them at the front once every offset is known.
+ * The pack is written beside the target and renamed over it, so a game mapping the old pack never
+ * sees it half written.
+ */
+internal bool32
+PackerWritePack(packer_state* state, char* packName) {
+	asset_pack_header header = {};
+	header.mMagicValue = ASSET_PACK_MAGIC_VALUE;
+	header.mVersion = ASSET_PACK_VERSION;
+	header.mAssetCount = state->mAssetCount + 1;
+	header.mTagCount = state->mTagCount;
+
+	asset_pack_type types[ASSET_TYPE_COUNT] = {};
+	asset_pack_asset* assets = (asset_pack_asset*)calloc(header.mAssetCount, sizeof(asset_pack_asset));
+	asset_pack_tag* tags = (asset_pack_tag*)calloc(header.mTagCount + 1, sizeof(asset_pack_tag));
+	packer_asset** sources = (packer_asset**)calloc(header.mAssetCount, sizeof(packer_asset*));
+	if (!assets || !tags || !sources) {
+		fprintf(stderr, "Out of memory\n");
+		return false;
+	}
+
+	uint32 assetCount = 1;
+	uint32 tagCount = 0;
+	for (uint32 typeID = ASSET_TYPE_NONE + 1; typeID < ASSET_TYPE_COUNT; ++typeID) {
+		asset_pack_type* type = types + header.mTypeCount;
+		type->mTypeID = typeID;
+		type->mFirstAssetIndex = assetCount;
+		for (uint32 sourceIndex = 0; sourceIndex < state->mAssetCount; ++sourceIndex) {
+			packer_asset* source = state->mAssets + sourceIndex;
+			if (source->mTypeID == typeID) {
+				asset_pack_asset* asset = assets + assetCount;
+				sources[assetCount++] = source;
+				asset->mKind = source->mKind;
+				asset->mFirstTagIndex = tagCount;
+				for (uint32 tagIndex = source->mFirstTagIndex; tagIndex < source->mOnePastLastTagIndex; ++tagIndex) {
+					tags[tagCount++] = state->mTags[tagIndex];
+				}
+				asset->mOnePastLastTagIndex = tagCount;
+			}
+		}
+		type->mOnePastLastAssetIndex = assetCount;
+		if (type->mFirstAssetIndex != type->mOnePastLastAssetIndex) {
+			++header.mTypeCount;
+		}
+	}
+
+	header.mTypesOffset = sizeof(asset_pack_header);
+	header.mTagsOffset = header.mTypesOffset + header.mTypeCount*sizeof(asset_pack_type);
+	header.mAssetsOffset = (header.mTagsOffset + header.mTagCount*sizeof(asset_pack_tag) + 7) & ~7ull;
+	uint64 tablesEnd = header.mAssetsOffset + header.mAssetCount*sizeof(asset_pack_asset);
+
+	char tempName[PACKER_MAX_LINE_LENGTH];
+	snprintf(tempName, sizeof(tempName), "%s.tmp", packName);
+	FILE* file = fopen(tempName, "wb");
+	if (!file) {
+		fprintf(stderr, "Could not create %s\n", tempName);
+		return false;
+	}
+
+	thread_context thread = {};
+	memory_areana scratch = {};
+	uint8* scratchMemory = (uint8*)malloc(PACKER_SCRATCH_SIZE);
+	if (scratchMemory) {
+		InitializeArena(&scratch, PACKER_SCRATCH_SIZE, scratchMemory);
+	}
+
+	bool32 result = (fseek(file, (long)tablesEnd, SEEK_SET) == 0);
+	for (uint32 assetIndex = 1; result && (assetIndex < header.mAssetCount); ++assetIndex) {
+		asset_pack_asset* asset = assets + assetIndex;
+		packer_asset* source = sources[assetIndex];
+
+		void* data = 0;
+		uint64 dataSize = 0;
+		int16* samples = 0;
+		if (asset->mKind == ASSET_KIND_BITMAP) {
+			scratch.mUsed = 0;
+			loaded_bitmap bitmap = DEBUGLoadBMP(&thread, PackerReadEntireFile, source->mFileName, &scratch);
+			if (bitmap.mPixels && (bitmap.mWidth > 0) && (bitmap.mHeight > 0)) {
+				asset->mBitmap.mWidth = bitmap.mWidth;
+				asset->mBitmap.mHeight = bitmap.mHeight;
+				data = bitmap.mPixels;
+				dataSize = (uint64)bitmap.mWidth*(uint64)bitmap.mHeight*sizeof(uint32);
+			}
+		}
+		else {
+			debug_read_file_result wave = PackerReadEntireFile(&thread, source->mFileName);
+			uint32 sampleCount = 0;
+			if (wave.mContents && PackerLoadWAV(wave.mContents, wave.mContentsSize, &sampleCount, &samples)) {
+				asset->mSound.mSampleCount = sampleCount;
+				data = samples;
+				dataSize = (uint64)sampleCount*ASSET_SOUND_CHANNEL_COUNT*sizeof(int16);
+			}
+		}
+
+		if (data) {
+			result = PackerWritePadding(file, ASSET_PACK_DATA_ALIGNMENT);
+			asset->mDataOffset = (uint64)ftell(file);
+			asset->mDataSize = dataSize;
+			result = result && (fwrite(data, 1, (size_t)dataSize, file) == dataSize);
+		}
+		else {
+			fprintf(stderr, "%s(%u): could not load %s\n", state->mManifestName, source->mLineNumber, source->mFileName);
+			result = false;
+		}
+
+		free(samples);
+		PackerFreeLastFile();
+	}
+
+	if (result) {
+		result = ((fseek(file, 0, SEEK_SET) == 0) &&
+				  (fwrite(&header, sizeof(header), 1, file) == 1) &&
+				  (fwrite(types, sizeof(asset_pack_type), header.mTypeCount, file) == header.mTypeCount) &&
+				  (fwrite(tags, sizeof(asset_pack_tag), header.mTagCount, file) == header.mTagCount) &&
+				  PackerWritePadding(file, 8) &&
+				  (fwrite(assets, sizeof(asset_pack_asset), header.mAssetCount, file) == header.mAssetCount));
+	}
+	result = (fclose(file) == 0) && result;
+
+	if (result) {
+		remove(packName);
+		result = (rename(tempName, packName) == 0);
+	}
+	if (!result) {
+		fprintf(stderr, "Could not write %s\n", packName);
+		remove(tempName);
+	}
+
+	free(scratchMemory);
+	free(sources);
+	free(tags);
+	free(assets);
+	return result;
+}
+
+int
+main(int argCount, char** args) {
+	if (argCount != 3) {
+		fprintf(stderr, "Usage: %s <manifest> <pack>\n", args[0]);
+		return 1;
+	}
+
+	packer_state* state = (packer_state*)calloc(1, sizeof(packer_state));
+	if (!state || !PackerReadManifest(state, args[1]) || !PackerWritePack(state, args[2])) {
+		return 1;
+	}
+
+	printf("%s: %u assets, %u tags\n", args[2], state->mAssetCount, state->mTagCount);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,1167 @@
+/*
+ * Author: Jheremy Strom
+ */
+
+/*
+ * Console benchmark driver. Built from the same unity build as the game so it
+ * measures the exact engine code, without a window, sound or hot reloading.
+ */
+
+#if !defined(_MSC_VER)
+#include <x86intrin.h>
+#endif
+
+// Compiles in the engine entry points only the benchmarks call
+#define ENGINE_BENCH 1
+#include "engine.cpp"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+struct bench_timer {
+	uint64 mTotalCycles;
+	uint64 mMaxCycles;
+	uint64 mSampleCount;
+};
+
+inline void
+BenchRecord(bench_timer* timer, uint64 cycles) {
+	timer->mTotalCycles += cycles;
+	if (cycles > timer->mMaxCycles) {
+		timer->mMaxCycles = cycles;
+	}
+	++timer->mSampleCount;
+}
+
+inline real64
+BenchAverage(bench_timer* timer) {
+	real64 result = timer->mSampleCount ? ((real64)timer->mTotalCycles / (real64)timer->mSampleCount) : 0.0;
+	return result;
+}
+
+internal void
+BenchInitializeArena(memory_areana* arena, memory_index size) {
+	uint8* base = (uint8*)calloc(1, size);
+	Assert(base);
+	InitializeArena(arena, size, base);
+}
+
+internal void
+BenchFreeArena(memory_areana* arena) {
+	free(arena->mBase);
+	arena->mBase = 0;
+}
+
+internal tile_map*
+BenchCreateTileMap(memory_areana* arena, uint32 chunkShift, uint32 chunkCountX, uint32 chunkCountY, uint32 chunkCountZ,
+				   bool32 isMortonOrdered) {
+	tile_map* tileMap = PushStruct(arena, tile_map);
+
+	tileMap->mChunkShift = chunkShift;
+	tileMap->mChunkMask = (1 << tileMap->mChunkShift) - 1;
+	tileMap->mChunkDim = (1 << tileMap->mChunkShift);
+	tileMap->mTileChunkCountX = chunkCountX;
+	tileMap->mTileChunkCountY = chunkCountY;
+	tileMap->mTileChunkCountZ = chunkCountZ;
+	InitializeTileChunkLayout(tileMap, isMortonOrdered);
+	tileMap->mTileChunks = PushArray(arena, GetTileChunkCount(tileMap), tile_chunk);
+	tileMap->mTileSideInMeters = 1.4f;
+	InitializeTileChunkStorage(tileMap, arena);
+	InitializeTileTypes(tileMap);
+
+	return tileMap;
+}
+
+// Lays out screens of walled rooms with doors in the middle of each wall, like the game's world
+internal void
+BenchBuildRooms(tile_map* tileMap, uint32 screenCountX, uint32 screenCountY, uint32 absTileZ) {
+	uint32 tilesPerWidth = 17;
+	uint32 tilesPerHeight = 9;
+	for (uint32 screenY = 0; screenY < screenCountY; ++screenY) {
+		for (uint32 screenX = 0; screenX < screenCountX; ++screenX) {
+			for (uint32 tileY = 0; tileY < tilesPerHeight; ++tileY) {
+				for (uint32 tileX = 0; tileX < tilesPerWidth; ++tileX) {
+					uint32 tileValue = 1;
+					if ((tileX == 0) || (tileX == (tilesPerWidth - 1))) {
+						tileValue = (tileY == (tilesPerHeight / 2)) ? 1 : 2;
+					}
+					if ((tileY == 0) || (tileY == (tilesPerHeight - 1))) {
+						tileValue = (tileX == (tilesPerWidth / 2)) ? 1 : 2;
+					}
+
+					SetTileValue(tileMap, screenX*tilesPerWidth + tileX, screenY*tilesPerHeight + tileY, absTileZ, tileValue);
+				}
+			}
+		}
+	}
+}
+
+// Walks the camera over a world one hundred times larger than the resident budget,
+// writing a tile under the camera every frame so evictions have to write back.
+internal void
+BenchTileChunkStreaming(void) {
+	uint32 chunkShift = 4;
+	uint32 chunkCountX = 160;
+	uint32 chunkCountY = 160;
+	uint32 residentBudget = (chunkCountX*chunkCountY) / 100;
+	uint32 chunkRadius = 2;
+	uint32 tilesPerFrame = 4;
+
+	memory_areana arena;
+	BenchInitializeArena(&arena, Megabytes(8));
+	tile_map* tileMap = BenchCreateTileMap(&arena, chunkShift, chunkCountX, chunkCountY, 1, false);
+
+	// Heap memory stands in for the mapping, this measures the LRU and copy costs, not the disk
+	platform_mapped_file worldFile = {};
+	worldFile.mSize = GetWorldFileSize(tileMap);
+	worldFile.mMemory = calloc(1, (size_t)worldFile.mSize);
+	worldFile.mWasCreated = true;
+	Assert(worldFile.mMemory);
+
+	tile_chunk_stream stream = {};
+	InitializeTileChunkStream(tileMap, &stream, worldFile, residentBudget);
+
+	bench_timer frameTimer = {};
+	uint32 chunkDiameter = 2*chunkRadius + 1;
+	uint32 worldTileCountX = chunkCountX << chunkShift;
+	uint32 laneCount = 0;
+	for (uint32 chunkY = chunkRadius; chunkY < chunkCountY + chunkRadius; chunkY += chunkDiameter, ++laneCount) {
+		uint32 cameraChunkY = Minimum(chunkY, chunkCountY - 1);
+		tile_map_location camera = {};
+		camera.mAbsTileY = (cameraChunkY << chunkShift) + (tileMap->mChunkDim / 2);
+
+		for (uint32 step = 0; step < worldTileCountX; step += tilesPerFrame) {
+			// Serpentine so the camera never jumps across the world
+			camera.mAbsTileX = (laneCount & 1) ? (worldTileCountX - 1 - step) : step;
+
+			uint64 startCycles = __rdtsc();
+			UpdateResidentTileChunks(tileMap, camera, chunkRadius);
+			SetTileValue(tileMap, camera.mAbsTileX, camera.mAbsTileY, camera.mAbsTileZ, 2);
+			BenchRecord(&frameTimer, __rdtsc() - startCycles);
+		}
+	}
+
+	uint64 startFlushCycles = __rdtsc();
+	FlushTileChunkStream(0, 0, tileMap);
+	uint64 flushCycles = __rdtsc() - startFlushCycles;
+
+	uint64 unpackedBytes = (uint64)residentBudget*stream.mHeader->mRecordSize;
+	printf("tile chunk streaming: %ux%u chunks, budget %u chunks (%llu KB unpacked, %llu KB packed, %llu KB file)\n",
+		chunkCountX, chunkCountY, residentBudget, (unsigned long long)(unpackedBytes / 1024),
+		(unsigned long long)(tileMap->mChunkStorage.mUsedBytes / 1024), (unsigned long long)(worldFile.mSize / 1024));
+	printf("  frames %llu, avg %.0f cycles/frame, max %llu cycles/frame, final flush %llu cycles\n",
+		(unsigned long long)frameTimer.mSampleCount, BenchAverage(&frameTimer),
+		(unsigned long long)frameTimer.mMaxCycles, (unsigned long long)flushCycles);
+	printf("  page ins %u, evictions %u, write backs %u, records %u\n",
+		stream.mPageInCount, stream.mEvictionCount, stream.mWriteBackCount, stream.mHeader->mRecordCount);
+
+	free(worldFile.mMemory);
+	BenchFreeArena(&arena);
+}
+
+// Compresses every packed chunk of a room world, then times unpacking each one through GetTileChunk
+internal void
+BenchColdChunkCompression(void) {
+	uint32 chunkCountX = 64;
+	uint32 chunkCountY = 64;
+
+	memory_areana arena;
+	BenchInitializeArena(&arena, Megabytes(16));
+	tile_map* tileMap = BenchCreateTileMap(&arena, 4, chunkCountX, chunkCountY, 1, false);
+	InitializeTileChunkCompression(tileMap, &arena, Megabytes(4));
+	BenchBuildRooms(tileMap, (chunkCountX*tileMap->mChunkDim) / 17, (chunkCountY*tileMap->mChunkDim) / 9, 0);
+
+	uint32 chunkCount = GetTileChunkCount(tileMap);
+	uint64 packedBytes = 0;
+	uint64 compressedBytes = 0;
+	uint32 compressedCount = 0;
+	uint32 keptPackedCount = 0;
+	for (uint32 chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+		tile_chunk* tileChunk = &tileMap->mTileChunks[chunkIndex];
+		if (tileChunk->mPalette && tileChunk->mBitsPerTile) {
+			memory_index blockSize = GetTileChunkBlockSize(tileMap, tileChunk->mPaletteCapacity);
+			if (CompressTileChunk(tileMap, tileChunk)) {
+				packedBytes += blockSize;
+				compressedBytes += tileChunk->mCompressedSize;
+				++compressedCount;
+			}
+			else {
+				++keptPackedCount;
+			}
+		}
+	}
+
+	// Reads go through the compressed rows, the unpacked chunk has to read back the same tiles
+	uint32 tileCount = GetTileChunkTileCount(tileMap);
+	uint32* compressedTiles = (uint32*)malloc(tileCount*sizeof(uint32));
+	uint32 mismatchCount = 0;
+	bench_timer readTimer = {};
+	bench_timer decompressTimer = {};
+	for (uint32 chunkY = 0; chunkY < chunkCountY; ++chunkY) {
+		for (uint32 chunkX = 0; chunkX < chunkCountX; ++chunkX) {
+			tile_chunk* tileChunk = GetTileChunk(tileMap, chunkX, chunkY, 0);
+			if (tileChunk->mCompressed) {
+				uint64 startCycles = __rdtsc();
+				for (uint32 tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
+					compressedTiles[tileIndex] = GetTileValue(tileMap, tileChunk,
+						tileIndex & tileMap->mChunkMask, tileIndex >> tileMap->mChunkShift);
+				}
+				BenchRecord(&readTimer, (__rdtsc() - startCycles) / tileCount);
+
+				startCycles = __rdtsc();
+				UseTileChunk(tileMap, tileChunk);
+				BenchRecord(&decompressTimer, __rdtsc() - startCycles);
+
+				for (uint32 tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
+					if (compressedTiles[tileIndex] != GetTileValue(tileMap, tileChunk,
+						tileIndex & tileMap->mChunkMask, tileIndex >> tileMap->mChunkShift)) {
+						++mismatchCount;
+					}
+				}
+			}
+		}
+	}
+	free(compressedTiles);
+
+	printf("cold chunk compression: %u chunks, %u compressed, %u not worth compressing\n",
+		chunkCount, compressedCount, keptPackedCount);
+	printf("  %llu packed bytes -> %llu compressed bytes (ratio %.2f, %.2f vs unpacked)\n",
+		(unsigned long long)packedBytes, (unsigned long long)compressedBytes,
+		compressedBytes ? ((real64)packedBytes / (real64)compressedBytes) : 0.0,
+		compressedBytes ? ((real64)compressedCount*GetTileChunkTileCount(tileMap)*sizeof(uint32) / (real64)compressedBytes) : 0.0);
+	printf("  decompress avg %.0f cycles/chunk, max %llu cycles/chunk\n",
+		BenchAverage(&decompressTimer), (unsigned long long)decompressTimer.mMaxCycles);
+	printf("  compressed reads avg %.0f cycles/tile, %u tiles read back differently\n",
+		BenchAverage(&readTimer), mismatchCount);
+
+	BenchFreeArena(&arena);
+}
+
+#define BENCH_CACHE_LINE_SIZE 64
+#define BENCH_PAGE_SIZE 4096
+
+// Adds the block holding address to the list unless it is already there, returns the new count
+inline uint32
+BenchTouchBlock(uintptr_t* blocks, uint32 blockCount, void* address, uintptr_t blockSize) {
+	uintptr_t block = (uintptr_t)address / blockSize;
+	uint32 blockIndex = 0;
+	while ((blockIndex < blockCount) && (blocks[blockIndex] != block)) {
+		++blockIndex;
+	}
+	if (blockIndex == blockCount) {
+		blocks[blockCount++] = block;
+	}
+	return blockCount;
+}
+
+// Reads every tile within tileRadius of random centers, the way collision and region walks do.
+// Alongside the cycles it counts the distinct cache lines and pages the reads land on, which is
+// what the chunk and tile order change; hardware miss counters are not portable enough to use here.
+internal void
+BenchNeighborhoodQueries(bool32 isMortonOrdered, uint32 tileRadius) {
+	uint32 chunkShift = 4;
+	uint32 chunkCountX = 256;
+	uint32 chunkCountY = 256;
+	uint32 queryCount = 1 << 16;
+
+	memory_areana arena;
+	BenchInitializeArena(&arena, Megabytes(64));
+	tile_map* tileMap = BenchCreateTileMap(&arena, chunkShift, chunkCountX, chunkCountY, 1, isMortonOrdered);
+	BenchBuildRooms(tileMap, (chunkCountX*tileMap->mChunkDim) / 17, (chunkCountY*tileMap->mChunkDim) / 9, 0);
+
+	uint32 tileDiameter = 2*tileRadius + 1;
+	uint32 maxBlockCount = 2*tileDiameter*tileDiameter;
+	uintptr_t* lines = (uintptr_t*)malloc(maxBlockCount*sizeof(uintptr_t));
+	uintptr_t* pages = (uintptr_t*)malloc(maxBlockCount*sizeof(uintptr_t));
+
+	uint32 worldTileCountX = (chunkCountX << chunkShift) - tileDiameter;
+	uint32 worldTileCountY = (chunkCountY << chunkShift) - tileDiameter;
+	uint32 randomState = 0x9E3779B9;
+	uint64 lineCount = 0;
+	uint64 pageCount = 0;
+	uint32 wallCount = 0;
+	bench_timer queryTimer = {};
+	for (uint32 queryIndex = 0; queryIndex < queryCount; ++queryIndex) {
+		randomState ^= randomState << 13;
+		randomState ^= randomState >> 17;
+		randomState ^= randomState << 5;
+		uint32 minTileX = (randomState & 0xFFFF) % worldTileCountX;
+		uint32 minTileY = (randomState >> 16) % worldTileCountY;
+
+		uint64 startCycles = __rdtsc();
+		for (uint32 tileY = minTileY; tileY < minTileY + tileDiameter; ++tileY) {
+			for (uint32 tileX = minTileX; tileX < minTileX + tileDiameter; ++tileX) {
+				wallCount += (GetTileValue(tileMap, tileX, tileY, 0) == 2);
+			}
+		}
+		BenchRecord(&queryTimer, __rdtsc() - startCycles);
+
+		// Replays the addresses the reads above went through
+		uint32 queryLineCount = 0;
+		uint32 queryPageCount = 0;
+		for (uint32 tileY = minTileY; tileY < minTileY + tileDiameter; ++tileY) {
+			for (uint32 tileX = minTileX; tileX < minTileX + tileDiameter; ++tileX) {
+				tile_chunk_location chunkLoc = GetChunkLocationFor(tileMap, tileX, tileY, 0);
+				tile_chunk* tileChunk = &tileMap->mTileChunks[GetTileChunkIndex(tileMap, chunkLoc.mTileChunkX, chunkLoc.mTileChunkY, 0)];
+				uint32 bitIndex = GetTileIndexInChunk(tileMap, chunkLoc.mRelTileX, chunkLoc.mRelTileY)*tileChunk->mBitsPerTile;
+				uint32* indexWord = &tileChunk->mIndices[bitIndex >> 5];
+
+				queryLineCount = BenchTouchBlock(lines, queryLineCount, tileChunk, BENCH_CACHE_LINE_SIZE);
+				queryLineCount = BenchTouchBlock(lines, queryLineCount, indexWord, BENCH_CACHE_LINE_SIZE);
+				queryPageCount = BenchTouchBlock(pages, queryPageCount, tileChunk, BENCH_PAGE_SIZE);
+				queryPageCount = BenchTouchBlock(pages, queryPageCount, indexWord, BENCH_PAGE_SIZE);
+			}
+		}
+		lineCount += queryLineCount;
+		pageCount += queryPageCount;
+	}
+
+	printf("neighborhood queries (%s, %ux%u tiles%s): avg %.0f cycles/query, %.1f lines/query, %.1f pages/query (%u walls)\n",
+		isMortonOrdered ? "morton" : "row major", tileDiameter, tileDiameter, (isMortonOrdered && ENGINE_BMI2) ? ", bmi2" : "",
+		BenchAverage(&queryTimer), (real64)lineCount / (real64)queryCount, (real64)pageCount / (real64)queryCount, wallCount);
+
+	free(pages);
+	free(lines);
+	BenchFreeArena(&arena);
+}
+
+// Breadth first search over every tile, the baseline a hierarchical search has to beat.
+// Returns the step count of the shortest path, or -1 when there is none.
+internal int32
+BenchFlatPathLength(tile_map* tileMap, tile_map_location start, tile_map_location goal, int32* distances, uint32* queue) {
+	uint32 tileCountX = tileMap->mTileChunkCountX << tileMap->mChunkShift;
+	uint32 tileCountY = tileMap->mTileChunkCountY << tileMap->mChunkShift;
+	uint32 tileCountZ = tileMap->mTileChunkCountZ;
+	uint32 tileCount = tileCountX*tileCountY*tileCountZ;
+	for (uint32 tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
+		distances[tileIndex] = -1;
+	}
+
+	uint32 startIndex = ((uint32)start.mAbsTileZ*tileCountY + (uint32)start.mAbsTileY)*tileCountX + (uint32)start.mAbsTileX;
+	uint32 goalIndex = ((uint32)goal.mAbsTileZ*tileCountY + (uint32)goal.mAbsTileY)*tileCountX + (uint32)goal.mAbsTileX;
+	uint32 queueRead = 0;
+	uint32 queueWrite = 0;
+	distances[startIndex] = 0;
+	queue[queueWrite++] = startIndex;
+	while ((queueRead < queueWrite) && (distances[goalIndex] < 0)) {
+		uint32 tileIndex = queue[queueRead++];
+		uint32 tileX = tileIndex % tileCountX;
+		uint32 tileY = (tileIndex / tileCountX) % tileCountY;
+		uint32 tileZ = tileIndex / (tileCountX*tileCountY);
+		uint32 tileValue = GetTileValue(tileMap, tileX, tileY, tileZ);
+
+		uint32 neighbors[5][3] = {
+			{tileX - 1, tileY, tileZ}, {tileX + 1, tileY, tileZ},
+			{tileX, tileY - 1, tileZ}, {tileX, tileY + 1, tileZ},
+			{tileX, tileY, (tileValue == 3) ? (tileZ + 1) : (tileZ - 1)},
+		};
+		uint32 neighborCount = ((tileValue == 3) || (tileValue == 4)) ? 5 : 4;
+		for (uint32 neighborIndex = 0; neighborIndex < neighborCount; ++neighborIndex) {
+			uint32* neighbor = neighbors[neighborIndex];
+			if ((neighbor[0] < tileCountX) && (neighbor[1] < tileCountY) && (neighbor[2] < tileCountZ)) {
+				uint32 neighborTileIndex = (neighbor[2]*tileCountY + neighbor[1])*tileCountX + neighbor[0];
+				uint32 neighborValue = GetTileValue(tileMap, neighbor[0], neighbor[1], neighbor[2]);
+				bool32 isDoorPair = ((neighborIndex < 4) ||
+									((tileValue == 3) && (neighborValue == 4)) ||
+									((tileValue == 4) && (neighborValue == 3)));
+				if ((distances[neighborTileIndex] < 0) && IsTileValueEmpty(tileMap, neighborValue) && isDoorPair) {
+					distances[neighborTileIndex] = distances[tileIndex] + 1;
+					queue[queueWrite++] = neighborTileIndex;
+				}
+			}
+		}
+	}
+
+	return distances[goalIndex];
+}
+
+// Plans between random floor tiles of a two floor room world the size of the game's,
+// with a z-door in every room, and compares a few of the routes against a flat search
+internal void
+BenchTilePathfinding(void) {
+	uint32 chunkCountX = 128;
+	uint32 chunkCountY = 128;
+	uint32 queryCount = 2000;
+	uint32 flatQueryCount = 8;
+
+	memory_areana arena;
+	BenchInitializeArena(&arena, Megabytes(64));
+	tile_map* tileMap = BenchCreateTileMap(&arena, 4, chunkCountX, chunkCountY, 2, true);
+	uint32 screenCountX = (chunkCountX*tileMap->mChunkDim) / 17;
+	uint32 screenCountY = (chunkCountY*tileMap->mChunkDim) / 9;
+	BenchBuildRooms(tileMap, screenCountX, screenCountY, 0);
+	BenchBuildRooms(tileMap, screenCountX, screenCountY, 1);
+	for (uint32 screenY = 0; screenY < screenCountY; ++screenY) {
+		for (uint32 screenX = 0; screenX < screenCountX; ++screenX) {
+			SetTileValue(tileMap, screenX*17 + 10, screenY*9 + 6, 0, 3);
+			SetTileValue(tileMap, screenX*17 + 10, screenY*9 + 6, 1, 4);
+		}
+	}
+
+	tile_path_cache cache = {};
+	InitializeTilePathCache(tileMap, &cache, &arena, 65536, Megabytes(16), 1 << 18);
+
+	uint32 maxTileCount = 1 << 16;
+	tile_map_location* tiles = (tile_map_location*)malloc(maxTileCount*sizeof(tile_map_location));
+	uint32 tileCount = (chunkCountX*chunkCountY*2) << (2*tileMap->mChunkShift);
+	int32* flatDistances = (int32*)malloc(tileCount*sizeof(int32));
+	uint32* flatQueue = (uint32*)malloc(tileCount*sizeof(uint32));
+
+	uint32 randomState = 0x2545F491;
+	bench_timer pathTimer = {};
+	bench_timer flatTimer = {};
+	uint64 expandedCount = 0;
+	uint64 pathLength = 0;
+	uint64 flatPathLength = 0;
+	uint64 comparedPathLength = 0;
+	uint32 foundCount = 0;
+	uint32 flatMismatchCount = 0;
+	for (uint32 queryIndex = 0; queryIndex < queryCount; ++queryIndex) {
+		tile_map_location ends[2];
+		for (uint32 endIndex = 0; endIndex < 2; ++endIndex) {
+			randomState ^= randomState << 13;
+			randomState ^= randomState >> 17;
+			randomState ^= randomState << 5;
+			ends[endIndex] = CenteredTilePoint((randomState % screenCountX)*17 + 1 + ((randomState >> 8) % 15),
+				((randomState >> 12) % screenCountY)*9 + 1 + ((randomState >> 24) % 7), (randomState >> 31));
+		}
+
+		uint64 startCycles = __rdtsc();
+		tile_path path = FindTilePath(tileMap, &cache, ends[0], ends[1], tiles, maxTileCount);
+		BenchRecord(&pathTimer, __rdtsc() - startCycles);
+
+		if (path.mFound) {
+			++foundCount;
+			expandedCount += path.mExpandedNodeCount;
+			pathLength += path.mTileCount - 1;
+		}
+
+		if (queryIndex < flatQueryCount) {
+			startCycles = __rdtsc();
+			int32 flatLength = BenchFlatPathLength(tileMap, ends[0], ends[1], flatDistances, flatQueue);
+			BenchRecord(&flatTimer, __rdtsc() - startCycles);
+
+			if ((flatLength >= 0) != (path.mFound != 0)) {
+				++flatMismatchCount;
+			}
+			else if (path.mFound) {
+				flatPathLength += flatLength;
+				comparedPathLength += path.mTileCount - 1;
+			}
+		}
+	}
+
+	printf("tile pathfinding: %ux%ux2 chunks, %u of %u queries found a path, %u chunk graphs built\n",
+		chunkCountX, chunkCountY, foundCount, queryCount, cache.mBuildCount);
+	printf("  hierarchical avg %.0f cycles/query, max %llu cycles/query, %.1f nodes expanded, %.1f tiles long\n",
+		BenchAverage(&pathTimer), (unsigned long long)pathTimer.mMaxCycles,
+		foundCount ? ((real64)expandedCount / (real64)foundCount) : 0.0,
+		foundCount ? ((real64)pathLength / (real64)foundCount) : 0.0);
+	printf("  flat BFS avg %.0f cycles/query over %u queries, routes %.3fx the shortest, %u disagreements\n",
+		BenchAverage(&flatTimer), flatQueryCount,
+		flatPathLength ? ((real64)comparedPathLength / (real64)flatPathLength) : 0.0, flatMismatchCount);
+
+	free(flatQueue);
+	free(flatDistances);
+	free(tiles);
+	BenchFreeArena(&arena);
+}
+
+internal void
+BenchFlowField(void) {
+	uint32 chunkCountX = 32;
+	uint32 chunkCountY = 32;
+	uint32 frameCount = 2000;
+	uint32 agentCount = 10000;
+
+	memory_areana arena;
+	BenchInitializeArena(&arena, Megabytes(64));
+	tile_map* tileMap = BenchCreateTileMap(&arena, 4, chunkCountX, chunkCountY, 2, true);
+	uint32 screenCountX = (chunkCountX*tileMap->mChunkDim) / 17;
+	uint32 screenCountY = (chunkCountY*tileMap->mChunkDim) / 9;
+	BenchBuildRooms(tileMap, screenCountX, screenCountY, 0);
+	BenchBuildRooms(tileMap, screenCountX, screenCountY, 1);
+	for (uint32 screenY = 0; screenY < screenCountY; ++screenY) {
+		for (uint32 screenX = 0; screenX < screenCountX; ++screenX) {
+			SetTileValue(tileMap, screenX*17 + 10, screenY*9 + 6, 0, 3);
+			SetTileValue(tileMap, screenX*17 + 10, screenY*9 + 6, 1, 4);
+		}
+	}
+
+	tile_flow_field field = {};
+	InitializeTileFlowField(tileMap, &field, &arena, 3);
+
+	uint32 randomState = 0x2545F491;
+	tile_map_location* agents = (tile_map_location*)malloc(agentCount*sizeof(tile_map_location));
+	tile_map_location goal = CenteredTilePoint(8*17 + 5, 8*9 + 3, 0);
+
+	bench_timer buildTimer = {};
+	bench_timer updateTimer = {};
+	bench_timer sampleTimer = {};
+	uint64 updatedTileCount = 0;
+	uint32 arrivedCount = 0;
+	for (uint32 frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+		// The goal wanders one open tile per frame, as a leader the crowd follows would
+		tile_map_location nextGoal = goal;
+		for (uint32 tryIndex = 0; tryIndex < 8; ++tryIndex) {
+			randomState ^= randomState << 13;
+			randomState ^= randomState >> 17;
+			randomState ^= randomState << 5;
+			nextGoal = goal;
+			int32 step = (randomState & 1) ? 1 : -1;
+			if (randomState & 2) {
+				nextGoal.mAbsTileX += step;
+			}
+			else {
+				nextGoal.mAbsTileY += step;
+			}
+			if (GetTilePathClass(tileMap, GetTileValue(tileMap, nextGoal.mAbsTileX, nextGoal.mAbsTileY, nextGoal.mAbsTileZ))) {
+				break;
+			}
+			nextGoal = goal;
+		}
+		goal = nextGoal;
+
+		uint32 rebuildCount = field.mRebuildCount;
+		uint64 startCycles = __rdtsc();
+		if (frameIndex == 0) {
+			BuildTileFlowField(tileMap, &field, goal);
+		}
+		else {
+			UpdateTileFlowGoal(tileMap, &field, goal);
+		}
+		uint64 elapsedCycles = __rdtsc() - startCycles;
+		if (field.mRebuildCount != rebuildCount) {
+			BenchRecord(&buildTimer, elapsedCycles);
+		}
+		else {
+			BenchRecord(&updateTimer, elapsedCycles);
+			updatedTileCount += field.mLastUpdateTileCount;
+		}
+
+		if ((frameIndex % 100) == 0) {
+			tile_coord fieldSide = (tile_coord)field.mChunkDiameter << tileMap->mChunkShift;
+			for (uint32 agentIndex = 0; agentIndex < agentCount; ++agentIndex) {
+				randomState ^= randomState << 13;
+				randomState ^= randomState >> 17;
+				randomState ^= randomState << 5;
+				agents[agentIndex] = CenteredTilePoint((field.mMinChunkX << tileMap->mChunkShift) + (randomState % fieldSide),
+					(field.mMinChunkY << tileMap->mChunkShift) + ((randomState >> 16) % fieldSide), 0);
+			}
+		}
+
+		startCycles = __rdtsc();
+		for (uint32 agentIndex = 0; agentIndex < agentCount; ++agentIndex) {
+			tile_map_location* agent = agents + agentIndex;
+			uint32 direction = GetTileFlowDirection(tileMap, &field, *agent);
+			Vector2 step = GetTileFlowVector(direction);
+			agent->mAbsTileX += (tile_delta)step.x;
+			agent->mAbsTileY += (tile_delta)step.y;
+			if (direction == TILE_FLOW_UP) {
+				++agent->mAbsTileZ;
+			}
+			else if (direction == TILE_FLOW_DOWN) {
+				--agent->mAbsTileZ;
+			}
+			else if (direction == TILE_FLOW_AT_GOAL) {
+				++arrivedCount;
+			}
+		}
+		BenchRecord(&sampleTimer, __rdtsc() - startCycles);
+	}
+
+	printf("flow field: %u tiles, goal moved %u frames, %u rebuilds, %u incremental updates\n",
+		field.mTileCount, frameCount, field.mRebuildCount, field.mIncrementalUpdateCount);
+	printf("  rebuild avg %.0f cycles, incremental avg %.0f cycles touching %.1f tiles, %u agent arrivals\n",
+		BenchAverage(&buildTimer), BenchAverage(&updateTimer),
+		updateTimer.mSampleCount ? ((real64)updatedTileCount / (real64)updateTimer.mSampleCount) : 0.0, arrivedCount);
+	printf("  %u agents sampled in avg %.0f cycles/frame, %.1f cycles/agent\n",
+		agentCount, BenchAverage(&sampleTimer), BenchAverage(&sampleTimer) / (real64)agentCount);
+
+	free(agents);
+	BenchFreeArena(&arena);
+}
+
+internal void
+BenchTileRaycast(void) {
+	uint32 chunkCountX = 64;
+	uint32 chunkCountY = 64;
+	uint32 rayCount = 1 << 16;
+	uint32 rayTileLengths[] = {4, 16, 64, 256};
+
+	memory_areana arena;
+	BenchInitializeArena(&arena, Megabytes(64));
+	tile_map* tileMap = BenchCreateTileMap(&arena, 4, chunkCountX, chunkCountY, 1, true);
+	for (uint32 chunkIndex = 0; chunkIndex < GetTileChunkCount(tileMap); ++chunkIndex) {
+		MakeTileChunkUniform(tileMap->mTileChunks + chunkIndex, 1);
+	}
+
+	// Scattered pillars, sparse enough that the longest rays still cover most of their length
+	uint32 randomState = 0x2545F491;
+	uint32 mapTileCountX = chunkCountX*tileMap->mChunkDim;
+	uint32 mapTileCountY = chunkCountY*tileMap->mChunkDim;
+	for (uint32 pillarIndex = 0; pillarIndex < (mapTileCountX*mapTileCountY) / 400; ++pillarIndex) {
+		randomState ^= randomState << 13;
+		randomState ^= randomState >> 17;
+		randomState ^= randomState << 5;
+		SetTileValue(tileMap, randomState % mapTileCountX, (randomState >> 16) % mapTileCountY, 0, 2);
+	}
+
+	tile_map_location center = CenteredTilePoint(mapTileCountX / 2, mapTileCountY / 2, 0);
+	tile_sight_grid grid = {};
+	InitializeTileSightGrid(tileMap, &grid, &arena, 20);
+	uint64 startCycles = __rdtsc();
+	UpdateTileSightGrid(tileMap, &grid, center);
+	uint64 gridCycles = __rdtsc() - startCycles;
+
+	tile_ray* rays = (tile_ray*)malloc(rayCount*sizeof(tile_ray));
+	tile_ray_hit* hits = (tile_ray_hit*)malloc(rayCount*sizeof(tile_ray_hit));
+
+	printf("tile raycast: %u rays per length, sight grid of %ux%u tiles copied in %llu cycles\n",
+		rayCount, grid.mSide, grid.mSide, (unsigned long long)gridCycles);
+	for (uint32 lengthIndex = 0; lengthIndex < ArrayCount(rayTileLengths); ++lengthIndex) {
+		real32 rayLength = rayTileLengths[lengthIndex]*tileMap->mTileSideInMeters;
+		for (uint32 rayIndex = 0; rayIndex < rayCount; ++rayIndex) {
+			randomState ^= randomState << 13;
+			randomState ^= randomState >> 17;
+			randomState ^= randomState << 5;
+			tile_ray* ray = rays + rayIndex;
+			ray->mStart = CenteredTilePoint(center.mAbsTileX - 32 + (randomState & 63), center.mAbsTileY - 32 + ((randomState >> 6) & 63), 0);
+			real32 angle = (real32)(randomState >> 12)*(6.2831853f / 1048576.0f);
+			ray->mDelta = Vector2(Cos(angle)*rayLength, Sin(angle)*rayLength);
+		}
+
+		uint64 scalarStepCount = 0;
+		uint32 scalarHitCount = 0;
+		clock_t startClock = clock();
+		startCycles = __rdtsc();
+		for (uint32 rayIndex = 0; rayIndex < rayCount; ++rayIndex) {
+			tile_ray_hit hit = TraceTileRay(tileMap, rays[rayIndex].mStart, rays[rayIndex].mDelta);
+			scalarStepCount += hit.mTileStepCount;
+			scalarHitCount += hit.mHit ? 1 : 0;
+		}
+		uint64 scalarCycles = __rdtsc() - startCycles;
+		real64 scalarSeconds = (real64)(clock() - startClock) / CLOCKS_PER_SEC;
+
+		startClock = clock();
+		startCycles = __rdtsc();
+		TraceTileSightRays(tileMap, &grid, rays, rayCount, hits);
+		uint64 batchCycles = __rdtsc() - startCycles;
+		real64 batchSeconds = (real64)(clock() - startClock) / CLOCKS_PER_SEC;
+
+		uint32 batchHitCount = 0;
+		for (uint32 rayIndex = 0; rayIndex < rayCount; ++rayIndex) {
+			batchHitCount += hits[rayIndex].mHit ? 1 : 0;
+		}
+
+		printf("  %3u tiles: scalar %.0f cycles/ray %.2fM rays/s, batch %.0f cycles/ray %.2fM rays/s, %.1f tiles/ray, %u/%u hits\n",
+			rayTileLengths[lengthIndex],
+			(real64)scalarCycles / rayCount, scalarSeconds > 0.0 ? (rayCount / scalarSeconds) / 1.0e6 : 0.0,
+			(real64)batchCycles / rayCount, batchSeconds > 0.0 ? (rayCount / batchSeconds) / 1.0e6 : 0.0,
+			(real64)scalarStepCount / rayCount, scalarHitCount, batchHitCount);
+	}
+
+	free(hits);
+	free(rays);
+	BenchFreeArena(&arena);
+}
+
+internal void
+BenchTileLighting(void) {
+	uint32 chunkCountX = 32;
+	uint32 chunkCountY = 32;
+	uint32 frameCount = 2000;
+
+	memory_areana arena;
+	BenchInitializeArena(&arena, Megabytes(64));
+	tile_map* tileMap = BenchCreateTileMap(&arena, 4, chunkCountX, chunkCountY, 1, true);
+	uint32 screenCountX = (chunkCountX*tileMap->mChunkDim) / 17;
+	uint32 screenCountY = (chunkCountY*tileMap->mChunkDim) / 9;
+	BenchBuildRooms(tileMap, screenCountX, screenCountY, 0);
+
+	tile_light_map lights = {};
+	InitializeTileLightMap(tileMap, &lights, &arena, 4096, 1 << 18, Megabytes(8));
+	for (uint32 screenY = 0; screenY < screenCountY; ++screenY) {
+		for (uint32 screenX = 0; screenX < screenCountX; ++screenX) {
+			AddTileLight(tileMap, CenteredTilePoint(screenX*17 + 8, screenY*9 + 4, 0), 10);
+		}
+	}
+
+	uint64 startCycles = __rdtsc();
+	RebuildTileLights(tileMap);
+	uint64 rebuildCycles = __rdtsc() - startCycles;
+	uint32 rebuildTileCount = lights.mLastUpdateTileCount;
+
+	// A torch walks along the middle row of rooms while a wall tile somewhere near it flips every frame
+	tile_map_location torch = CenteredTilePoint(1, 4, 0);
+	uint32 torchIndex = AddTileLight(tileMap, torch, TILE_LIGHT_MAX_LEVEL);
+	uint32 randomState = 0x2545F491;
+	bench_timer moveTimer = {};
+	bench_timer editTimer = {};
+	uint64 moveTileCount = 0;
+	uint64 editTileCount = 0;
+	for (uint32 frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+		torch.mAbsTileX = 1 + (frameIndex % (screenCountX*17 - 2));
+		startCycles = __rdtsc();
+		MoveTileLight(tileMap, torchIndex, torch);
+		BenchRecord(&moveTimer, __rdtsc() - startCycles);
+		moveTileCount += lights.mLastUpdateTileCount;
+
+		randomState ^= randomState << 13;
+		randomState ^= randomState >> 17;
+		randomState ^= randomState << 5;
+		tile_coord tileX = torch.mAbsTileX + (randomState % 17) - 8;
+		tile_coord tileY = torch.mAbsTileY + ((randomState >> 8) % 9) - 4;
+		uint32 tileValue = GetTileValue(tileMap, tileX, tileY, 0);
+		if ((tileValue == 1) || (tileValue == 2)) {
+			SetTileValue(tileMap, tileX, tileY, 0, 3 - tileValue);
+			startCycles = __rdtsc();
+			UpdateTileLights(tileMap);
+			BenchRecord(&editTimer, __rdtsc() - startCycles);
+			editTileCount += lights.mLastUpdateTileCount;
+		}
+	}
+
+	printf("tile lighting: %u lights over %ux%u chunks\n", lights.mSourceCount, chunkCountX, chunkCountY);
+	printf("  full relight %llu cycles touching %u tiles\n", (unsigned long long)rebuildCycles, rebuildTileCount);
+	printf("  torch move avg %.0f cycles touching %.1f tiles, wall edit avg %.0f cycles touching %.1f tiles\n",
+		BenchAverage(&moveTimer), (real64)moveTileCount / (real64)frameCount,
+		BenchAverage(&editTimer), editTimer.mSampleCount ? ((real64)editTileCount / (real64)editTimer.mSampleCount) : 0.0);
+
+	BenchFreeArena(&arena);
+}
+
+internal void
+BenchTileFov(void) {
+	uint32 chunkCountX = 32;
+	uint32 chunkCountY = 32;
+	uint32 frameCount = 20000;
+
+	memory_areana arena;
+	BenchInitializeArena(&arena, Megabytes(64));
+	tile_map* tileMap = BenchCreateTileMap(&arena, 4, chunkCountX, chunkCountY, 1, true);
+	uint32 screenCountX = (chunkCountX*tileMap->mChunkDim) / 17;
+	uint32 screenCountY = (chunkCountY*tileMap->mChunkDim) / 9;
+	BenchBuildRooms(tileMap, screenCountX, screenCountY, 0);
+
+	tile_fov_map fov = {};
+	InitializeTileFovMap(tileMap, &fov, &arena, Megabytes(4));
+
+	// The viewer walks a tenth of a tile per frame along the middle row of rooms, like a player would
+	tile_map_location viewerP = CenteredTilePoint(1, 4, 0);
+	uint32 viewerIndex = AddTileFovViewer(tileMap, viewerP, 10);
+	bench_timer updateTimer = {};
+	uint64 revealedTileCount = 0;
+	uint64 frameCycles = 0;
+	for (uint32 frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+		viewerP.mAbsTileX = 1 + ((frameIndex / 10) % (screenCountX*17 - 2));
+		uint32 updateCount = fov.mUpdateCount;
+		uint64 startCycles = __rdtsc();
+		MoveTileFovViewer(tileMap, viewerIndex, viewerP);
+		UpdateTileFov(tileMap);
+		uint64 cycles = __rdtsc() - startCycles;
+		frameCycles += cycles;
+		if (fov.mUpdateCount != updateCount) {
+			BenchRecord(&updateTimer, cycles);
+			revealedTileCount += fov.mLastUpdateTileCount;
+		}
+	}
+
+	printf("tile fov: radius 10 viewer over %ux%u chunks\n", chunkCountX, chunkCountY);
+	printf("  %u rescans in %u frames, avg %.0f cycles revealing %.1f tiles, %.0f cycles per frame overall\n",
+		(uint32)updateTimer.mSampleCount, frameCount, BenchAverage(&updateTimer),
+		updateTimer.mSampleCount ? ((real64)revealedTileCount / (real64)updateTimer.mSampleCount) : 0.0,
+		(real64)frameCycles / (real64)frameCount);
+
+	BenchFreeArena(&arena);
+}
+
+// Same rooms as BenchBuildRooms, written as two rect fills and four door tiles each
+internal void
+BenchFillRooms(tile_map* tileMap, uint32 screenCountX, uint32 screenCountY, uint32 absTileZ) {
+	uint32 tilesPerWidth = 17;
+	uint32 tilesPerHeight = 9;
+	for (uint32 screenY = 0; screenY < screenCountY; ++screenY) {
+		for (uint32 screenX = 0; screenX < screenCountX; ++screenX) {
+			uint32 roomX = screenX*tilesPerWidth;
+			uint32 roomY = screenY*tilesPerHeight;
+			FillTileRect(tileMap, roomX, roomY, absTileZ, tilesPerWidth, tilesPerHeight, 2);
+			FillTileRect(tileMap, roomX + 1, roomY + 1, absTileZ, tilesPerWidth - 2, tilesPerHeight - 2, 1);
+			SetTileValue(tileMap, roomX, roomY + tilesPerHeight / 2, absTileZ, 1);
+			SetTileValue(tileMap, roomX + tilesPerWidth - 1, roomY + tilesPerHeight / 2, absTileZ, 1);
+			SetTileValue(tileMap, roomX + tilesPerWidth / 2, roomY, absTileZ, 1);
+			SetTileValue(tileMap, roomX + tilesPerWidth / 2, roomY + tilesPerHeight - 1, absTileZ, 1);
+		}
+	}
+}
+
+internal void
+BenchBulkTileEdits(bool32 isMortonOrdered) {
+	uint32 chunkCountX = 64;
+	uint32 chunkCountY = 64;
+	uint32 screenCountX = (chunkCountX*16) / 17;
+	uint32 screenCountY = (chunkCountY*16) / 9;
+
+	uint64 cycles[2];
+	memory_index usedBytes[2];
+	for (uint32 useFills = 0; useFills < 2; ++useFills) {
+		memory_areana arena;
+		BenchInitializeArena(&arena, Megabytes(16));
+		tile_map* tileMap = BenchCreateTileMap(&arena, 4, chunkCountX, chunkCountY, 1, isMortonOrdered);
+
+		uint64 startCycles = __rdtsc();
+		if (useFills) {
+			BenchFillRooms(tileMap, screenCountX, screenCountY, 0);
+		}
+		else {
+			BenchBuildRooms(tileMap, screenCountX, screenCountY, 0);
+		}
+		cycles[useFills] = __rdtsc() - startCycles;
+		usedBytes[useFills] = tileMap->mChunkStorage.mUsedBytes;
+
+		BenchFreeArena(&arena);
+	}
+
+	// Whole chunks of one value stay uniform and cost no tile storage
+	memory_areana arena;
+	BenchInitializeArena(&arena, Megabytes(16));
+	tile_map* tileMap = BenchCreateTileMap(&arena, 4, chunkCountX, chunkCountY, 1, isMortonOrdered);
+	uint64 startCycles = __rdtsc();
+	FillTileRect(tileMap, 0, 0, 0, chunkCountX*16, chunkCountY*16, 2);
+	uint64 solidCycles = __rdtsc() - startCycles;
+	memory_index solidBytes = tileMap->mChunkStorage.mUsedBytes;
+	BenchFreeArena(&arena);
+
+	uint32 roomCount = screenCountX*screenCountY;
+	printf("bulk tile edits (%s): %u rooms\n", isMortonOrdered ? "morton" : "row major", roomCount);
+	printf("  per tile %.0f cycles per room, fills %.0f cycles per room, storage %llu vs %llu bytes\n",
+		(real64)cycles[0] / (real64)roomCount, (real64)cycles[1] / (real64)roomCount,
+		(unsigned long long)usedBytes[0], (unsigned long long)usedBytes[1]);
+	printf("  solid fill of %u chunks %llu cycles, %llu bytes\n", chunkCountX*chunkCountY,
+		(unsigned long long)solidCycles, (unsigned long long)solidBytes);
+}
+
+// Copies rects larger than the copy block through CopyTileRect and checks the result against the same
+// copy done on a flat copy of the map, once between floors and once shifted onto itself in each
+// direction, so the blocks of an overlapping copy have to be taken in the right order.
+internal void
+BenchCopyTileRect(bool32 isMortonOrdered) {
+	uint32 chunkCountX = 32;
+	uint32 chunkCountY = 32;
+	uint32 tileCountX = chunkCountX*16;
+	uint32 tileCountY = chunkCountY*16;
+	uint32 width = 3*TILE_COPY_BLOCK_DIM + 17;
+	uint32 height = 2*TILE_COPY_BLOCK_DIM + 9;
+
+	memory_areana arena;
+	BenchInitializeArena(&arena, Megabytes(32));
+	tile_map* tileMap = BenchCreateTileMap(&arena, 4, chunkCountX, chunkCountY, 2, isMortonOrdered);
+
+	// Noise so a block copied from the wrong place can not match by accident
+	uint32 floorTileCount = tileCountX*tileCountY;
+	uint32* expected = (uint32*)malloc(2*floorTileCount*sizeof(uint32));
+	uint32* actual = (uint32*)malloc(floorTileCount*sizeof(uint32));
+	uint32 randomState = 0x2545F491;
+	for (uint32 absTileZ = 0; absTileZ < 2; ++absTileZ) {
+		for (uint32 tileY = 0; tileY < tileCountY; ++tileY) {
+			for (uint32 tileX = 0; tileX < tileCountX; ++tileX) {
+				randomState ^= randomState << 13;
+				randomState ^= randomState >> 17;
+				randomState ^= randomState << 5;
+				uint32 tileValue = 1 + (randomState & 1);
+				SetTileValue(tileMap, tileX, tileY, absTileZ, tileValue);
+				expected[absTileZ*floorTileCount + tileY*tileCountX + tileX] = tileValue;
+			}
+		}
+	}
+
+	struct bench_copy {
+		const char* mName;
+		uint32 mSourceX;
+		uint32 mSourceY;
+		uint32 mSourceZ;
+		uint32 mDestX;
+		uint32 mDestY;
+		uint32 mDestZ;
+	};
+	bench_copy copies[] = {
+		{"other floor", 40, 30, 0, 40, 30, 1},
+		{"overlap up right", 40, 30, 0, 40 + 37, 30 + 21, 0},
+		{"overlap down left", 40 + 37, 30 + 21, 0, 40, 30, 0},
+		{"overlap right", 100, 200, 1, 100 + TILE_COPY_BLOCK_DIM / 2, 200, 1},
+		{"overlap down", 100, 200 + 5, 1, 100, 200, 1},
+	};
+
+	uint32* rowBuffer = (uint32*)malloc(width*height*sizeof(uint32));
+	printf("copy tile rect (%s): %ux%u tiles through %ux%u blocks\n", isMortonOrdered ? "morton" : "row major",
+		width, height, TILE_COPY_BLOCK_DIM, TILE_COPY_BLOCK_DIM);
+	for (uint32 copyIndex = 0; copyIndex < ArrayCount(copies); ++copyIndex) {
+		bench_copy* copy = copies + copyIndex;
+
+		uint64 startCycles = __rdtsc();
+		CopyTileRect(tileMap, copy->mSourceX, copy->mSourceY, copy->mSourceZ,
+			copy->mDestX, copy->mDestY, copy->mDestZ, width, height);
+		uint64 cycles = __rdtsc() - startCycles;
+
+		// The whole source is read before anything is written, like memmove
+		for (uint32 rowIndex = 0; rowIndex < height; ++rowIndex) {
+			memcpy(rowBuffer + rowIndex*width,
+				expected + copy->mSourceZ*floorTileCount + (copy->mSourceY + rowIndex)*tileCountX + copy->mSourceX,
+				width*sizeof(uint32));
+		}
+		for (uint32 rowIndex = 0; rowIndex < height; ++rowIndex) {
+			memcpy(expected + copy->mDestZ*floorTileCount + (copy->mDestY + rowIndex)*tileCountX + copy->mDestX,
+				rowBuffer + rowIndex*width, width*sizeof(uint32));
+		}
+
+		uint32 mismatchCount = 0;
+		for (uint32 absTileZ = 0; absTileZ < 2; ++absTileZ) {
+			ReadTileRect(tileMap, 0, 0, absTileZ, tileCountX, tileCountY, actual);
+			for (uint32 tileIndex = 0; tileIndex < floorTileCount; ++tileIndex) {
+				if (actual[tileIndex] != expected[absTileZ*floorTileCount + tileIndex]) {
+					++mismatchCount;
+				}
+			}
+		}
+		Assert(mismatchCount == 0);
+
+		printf("  %-18s %.1f cycles per tile, %u mismatched tiles\n", copy->mName,
+			(real64)cycles / (real64)(width*height), mismatchCount);
+	}
+
+	free(rowBuffer);
+	free(actual);
+	free(expected);
+	BenchFreeArena(&arena);
+}
+
+internal void
+BenchTileJournal(void) {
+	uint32 chunkCountX = 32;
+	uint32 chunkCountY = 32;
+	uint32 editCount = 200000;
+	uint32 tileCountX = chunkCountX*16;
+	uint32 tileCountY = chunkCountY*16;
+
+	uint64 editCycles[2];
+	uint64 undoCycles = 0;
+	uint32 undoneCount = 0;
+	for (uint32 isJournaled = 0; isJournaled < 2; ++isJournaled) {
+		memory_areana arena;
+		BenchInitializeArena(&arena, Megabytes(32));
+		tile_map* tileMap = BenchCreateTileMap(&arena, 4, chunkCountX, chunkCountY, 1, true);
+		BenchBuildRooms(tileMap, tileCountX / 17, tileCountY / 9, 0);
+
+		tile_journal journal = {};
+		if (isJournaled) {
+			InitializeTileJournal(tileMap, &journal, &arena, 1 << 18, 1 << 16);
+		}
+
+		// Edits come in batches of four, like a brush stroke
+		uint32 randomState = 0x9E3779B9;
+		uint64 startCycles = __rdtsc();
+		for (uint32 editIndex = 0; editIndex < editCount; ++editIndex) {
+			randomState ^= randomState << 13;
+			randomState ^= randomState >> 17;
+			randomState ^= randomState << 5;
+			if ((editIndex % 4) == 0) {
+				BeginTileEditBatch(tileMap);
+			}
+			SetTileValue(tileMap, randomState % tileCountX, (randomState >> 12) % tileCountY, 0, 1 + ((randomState >> 24) & 1));
+			if ((editIndex % 4) == 3) {
+				EndTileEditBatch(tileMap);
+			}
+		}
+		editCycles[isJournaled] = __rdtsc() - startCycles;
+
+		if (isJournaled) {
+			startCycles = __rdtsc();
+			while (UndoTileEdits(tileMap)) {
+				++undoneCount;
+			}
+			undoCycles = __rdtsc() - startCycles;
+		}
+
+		BenchFreeArena(&arena);
+	}
+
+	printf("tile journal: %u edits in batches of 4\n", editCount);
+	printf("  SetTileValue %.0f cycles plain, %.0f cycles journaled, undo %.0f cycles per batch over %u batches\n",
+		(real64)editCycles[0] / (real64)editCount, (real64)editCycles[1] / (real64)editCount,
+		undoneCount ? ((real64)undoCycles / (real64)undoneCount) : 0.0, undoneCount);
+}
+
+// The compare chain the tile type table replaced
+inline uint32
+BenchGetTilePathClassByCompare(uint32 tileValue) {
+	uint32 result = 0;
+	if ((tileValue == 1) || (tileValue == 3) || (tileValue == 4)) {
+		result = ((tileValue == 3) || (tileValue == 4)) ? tileValue : 1;
+	}
+	return result;
+}
+
+internal void
+BenchTileTypes(void) {
+	uint32 valueCount = 1 << 20;
+	uint32 passCount = 16;
+
+	memory_areana arena;
+	BenchInitializeArena(&arena, Megabytes(8));
+	tile_map* tileMap = BenchCreateTileMap(&arena, 4, 1, 1, 1, true);
+
+	// Mostly floor and wall with a few doors, in an order the branch predictor cannot learn
+	uint32* values = PushArray(&arena, valueCount, uint32);
+	uint32 randomState = 0x9E3779B9;
+	for (uint32 valueIndex = 0; valueIndex < valueCount; ++valueIndex) {
+		randomState ^= randomState << 13;
+		randomState ^= randomState >> 17;
+		randomState ^= randomState << 5;
+		uint32 roll = randomState % 16;
+		values[valueIndex] = (roll < 9) ? 1 : (roll < 14) ? 2 : (roll == 14) ? 3 : 4;
+	}
+
+	uint64 classSums[2] = {};
+	uint64 cycles[2];
+	for (uint32 isTable = 0; isTable < 2; ++isTable) {
+		uint64 startCycles = __rdtsc();
+		for (uint32 passIndex = 0; passIndex < passCount; ++passIndex) {
+			for (uint32 valueIndex = 0; valueIndex < valueCount; ++valueIndex) {
+				classSums[isTable] += (isTable ?
+					GetTilePathClass(tileMap, values[valueIndex]) :
+					BenchGetTilePathClassByCompare(values[valueIndex]));
+			}
+		}
+		cycles[isTable] = __rdtsc() - startCycles;
+	}
+	Assert(classSums[0] == classSums[1]);
+
+	uint64 lookupCount = (uint64)valueCount*passCount;
+	printf("tile types: %u path class lookups\n", (uint32)lookupCount);
+	printf("  compare chain %.2f cycles, type table %.2f cycles per lookup\n",
+		(real64)cycles[0] / (real64)lookupCount, (real64)cycles[1] / (real64)lookupCount);
+
+	BenchFreeArena(&arena);
+}
+
+// The tile pass as it was before the chunk bitmap cache, one rectangle per drawn tile
+internal void
+BenchDrawTileRectangles(game_offscreen_buffer* buffer, tile_map* tileMap, tile_map_location cameraP,
+						int32 tileSideInPixels, real32 ambientLight) {
+	bool32 isFogged = (tileMap->mFov->mActiveViewerCount > 0);
+	for (int32 relRow = -10; relRow < 10; ++relRow) {
+		for (int32 relColumn = -20; relColumn < 20; ++relColumn) {
+			tile_coord column = relColumn + cameraP.mAbsTileX;
+			tile_coord row = relRow + cameraP.mAbsTileY;
+			tile_type* tileType = GetTileType(tileMap, GetTileValue(tileMap, column, row, cameraP.mAbsTileZ));
+			if ((tileType->mFlags & TILE_TYPE_DRAWN) && (!isFogged || IsTileVisible(tileMap, column, row, cameraP.mAbsTileZ))) {
+				real32 brightness = GetTileLightBrightness(GetTileLightLevel(tileMap, column, row, cameraP.mAbsTileZ), ambientLight);
+				Vector2 tileSide(0.5f*(real32)tileSideInPixels, 0.5f*(real32)tileSideInPixels);
+				Vector2 cen(0.5f*(real32)buffer->mWidth + (real32)relColumn*(real32)tileSideInPixels,
+						  0.5f*(real32)buffer->mHeight - (real32)relRow*(real32)tileSideInPixels);
+				DrawRectangle(buffer, cen - 0.9f*tileSide, cen + 0.9f*tileSide,
+					brightness*(real32)((tileType->mColor >> 16) & 0xFF) / 255.0f,
+					brightness*(real32)((tileType->mColor >> 8) & 0xFF) / 255.0f,
+					brightness*(real32)(tileType->mColor & 0xFF) / 255.0f);
+			}
+		}
+	}
+}
+
+internal void
+BenchTileRenderCache(void) {
+	uint32 chunkCountX = 16;
+	uint32 chunkCountY = 16;
+	uint32 frameCount = 2000;
+	int32 tileSideInPixels = 60;
+	real32 ambientLight = 0.2f;
+
+	memory_areana arena;
+	BenchInitializeArena(&arena, Megabytes(128));
+	tile_map* tileMap = BenchCreateTileMap(&arena, 4, chunkCountX, chunkCountY, 1, true);
+	uint32 screenCountX = (chunkCountX*tileMap->mChunkDim) / 17;
+	BenchBuildRooms(tileMap, screenCountX, (chunkCountY*tileMap->mChunkDim) / 9, 0);
+
+	tile_light_map lights = {};
+	InitializeTileLightMap(tileMap, &lights, &arena, 64, 1 << 16, Megabytes(4));
+	tile_fov_map fov = {};
+	InitializeTileFovMap(tileMap, &fov, &arena, Megabytes(4));
+	tile_render_cache cache = {};
+	InitializeTileRenderCache(tileMap, &cache, &arena, tileSideInPixels, 16, ambientLight);
+
+	game_offscreen_buffer buffer = {};
+	buffer.mWidth = 960;
+	buffer.mHeight = 540;
+	buffer.mBytesPerPixel = 4;
+	buffer.mPitch = buffer.mWidth*buffer.mBytesPerPixel;
+	buffer.mMemory = PushArray(&arena, buffer.mWidth*buffer.mHeight, uint32);
+
+	// A player walks a tenth of a tile per frame along the middle row of rooms carrying a torch, the
+	// camera stays on the player's room like the game's camera does
+	tile_map_location playerP = CenteredTilePoint(1, 4, 0);
+	uint32 lightIndex = AddTileLight(tileMap, playerP, TILE_LIGHT_MAX_LEVEL);
+	uint32 viewerIndex = AddTileFovViewer(tileMap, playerP, 10);
+	bench_timer timers[2] = {};
+	bench_timer stillTimer = {};
+	uint64 cellCount = 0;
+	for (uint32 frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+		playerP.mAbsTileX = 1 + ((frameIndex / 10) % (screenCountX*17 - 2));
+		MoveTileLight(tileMap, lightIndex, playerP);
+		MoveTileFovViewer(tileMap, viewerIndex, playerP);
+		UpdateTileLights(tileMap);
+		UpdateTileFov(tileMap);
+
+		tile_map_location cameraP = CenteredTilePoint((playerP.mAbsTileX / 17)*17 + 17 / 2, 9 / 2, 0);
+		for (uint32 isCached = 0; isCached < 2; ++isCached) {
+			uint64 startCycles = __rdtsc();
+			if (isCached) {
+				DrawTileLayer(0, &buffer, tileMap, &cache, cameraP, (real32)tileSideInPixels / tileMap->mTileSideInMeters);
+			}
+			else {
+				BenchDrawTileRectangles(&buffer, tileMap, cameraP, tileSideInPixels, ambientLight);
+			}
+			uint64 cycles = __rdtsc() - startCycles;
+			BenchRecord(&timers[isCached], cycles);
+			if (isCached) {
+				cellCount += cache.mLastFrameCellCount;
+				if (!cache.mLastFrameCellCount) {
+					BenchRecord(&stillTimer, cycles);
+				}
+			}
+		}
+	}
+
+	printf("tile render cache: %ux%u buffer, player walking with a torch and a radius 10 view\n", buffer.mWidth, buffer.mHeight);
+	printf("  rectangles avg %.0f cycles/frame, cached chunks avg %.0f cycles/frame redrawing %.1f cells, %u hits %u misses\n",
+		BenchAverage(&timers[0]), BenchAverage(&timers[1]), (real64)cellCount / (real64)frameCount,
+		cache.mHitCount, cache.mMissCount);
+	printf("  cached chunks avg %.0f cycles over the %u frames where nothing had to be redrawn\n",
+		BenchAverage(&stillTimer), (uint32)stillTimer.mSampleCount);
+
+	BenchFreeArena(&arena);
+}
+
+int
+main(int argCount, char** args) {
+	BenchTileChunkStreaming();
+	BenchColdChunkCompression();
+	BenchNeighborhoodQueries(false, 1);
+	BenchNeighborhoodQueries(true, 1);
+	BenchNeighborhoodQueries(false, 8);
+	BenchNeighborhoodQueries(true, 8);
+	BenchTilePathfinding();
+	BenchFlowField();
+	BenchTileRaycast();
+	BenchTileLighting();
+	BenchTileFov();
+	BenchBulkTileEdits(false);
+	BenchBulkTileEdits(true);
+	BenchCopyTileRect(false);
+	BenchCopyTileRect(true);
+	BenchTileJournal();
+	BenchTileTypes();
+	BenchTileRenderCache();
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,135 @@
+#if !defined(ENGINE_DEBUG_H)
+
+/*
+ * Author: Jheremy Strom
+ */
+
+/*
+ * TIMED_BLOCK(name) stamps the cycle counter where it is declared and again where its scope ends. Every
+ * thread writes its stamps into a ring of its own that only the platform reads, between frames, so a
+ * stamp is an rdtsc and a few stores with no lock and no atomic. A full ring drops the stamp and counts
+ * it. Blocks do nothing until the platform hands the game a debug_table, building with ENGINE_PROFILE
+ * set to 0 takes them out altogether.
+ */
+#if !defined(ENGINE_PROFILE)
+#define ENGINE_PROFILE 1
+#endif
+
+#if !COMPILER_MSVC
+#include <x86intrin.h>
+#endif
+
+#define DEBUG_EVENT_BEGIN_BLOCK 0
+#define DEBUG_EVENT_END_BLOCK 1
+
+// Threads past this many go untimed
+#define DEBUG_MAX_THREAD_COUNT 64
+// Per thread, has to be a power of two
+#define DEBUG_RING_EVENT_COUNT 16384
+
+struct debug_event {
+	uint64 mClock;
+	const char* mName;  // Points into the code that recorded it, the platform copies it before the code can be reloaded
+	uint32 mType;
+};
+
+struct debug_event_ring {
+	uint64 volatile mThreadID;  // 0 while no thread has claimed the ring
+
+	// Only the owning thread moves the write index and only the reader moves the read index
+	uint32 volatile mWriteIndex;
+	uint32 volatile mReadIndex;
+	uint32 volatile mDroppedCount;
+
+	debug_event mEvents[DEBUG_RING_EVENT_COUNT];
+};
+
+// Made by the platform, zeroed
+struct debug_table {
+	debug_event_ring mRings[DEBUG_MAX_THREAD_COUNT];
+};
+
+// Set by the platform for its own blocks and by the game code at every entry point for the game's
+global_variable debug_table* gDebugTable;
+
+// The address of the thread's own control block, unique per live thread and never 0
+inline uint64
+GetThreadID(void) {
+	uint64 result;
+#if COMPILER_MSVC
+	result = __readgsqword(0x30);
+#else
+	asm volatile("mov %%fs:0x10, %0" : "=r"(result));
+#endif
+	return result;
+}
+
+// Threads claim rings by their ID, so a reloaded game finds the rings its threads already had
+inline debug_event_ring*
+GetDebugEventRing(debug_table* table) {
+	debug_event_ring* result = 0;
+	uint64 threadID = GetThreadID();
+	uint32 firstIndex = (uint32)((threadID*11400714819323198485ull) >> 58) & (DEBUG_MAX_THREAD_COUNT - 1);
+	for (uint32 probeIndex = 0; probeIndex < DEBUG_MAX_THREAD_COUNT; ++probeIndex) {
+		debug_event_ring* ring = table->mRings + ((firstIndex + probeIndex) & (DEBUG_MAX_THREAD_COUNT - 1));
+		uint64 owner = ring->mThreadID;
+		if (!owner) {
+			owner = AtomicCompareExchangeUInt64(&ring->mThreadID, threadID, 0);
+			if (!owner) {
+				owner = threadID;
+			}
+		}
+		if (owner == threadID) {
+			result = ring;
+			break;
+		}
+	}
+	return result;
+}
+
+inline void
+RecordDebugEvent(const char* name, uint32 type) {
+	debug_table* table = gDebugTable;
+	if (table) {
+		debug_event_ring* ring = GetDebugEventRing(table);
+		if (ring) {
+			uint32 writeIndex = ring->mWriteIndex;
+			if ((writeIndex - ring->mReadIndex) < DEBUG_RING_EVENT_COUNT) {
+				debug_event* event = ring->mEvents + (writeIndex & (DEBUG_RING_EVENT_COUNT - 1));
+				event->mClock = __rdtsc();
+				event->mName = name;
+				event->mType = type;
+				CompletePreviousWritesBeforeFutureWrites;
+				ring->mWriteIndex = writeIndex + 1;
+			}
+			else {
+				ring->mDroppedCount = ring->mDroppedCount + 1;
+			}
+		}
+	}
+}
+
+struct timed_block {
+	const char* mName;
+
+	timed_block(const char* name) {
+		mName = name;
+		RecordDebugEvent(name, DEBUG_EVENT_BEGIN_BLOCK);
+	}
+
+	~timed_block() {
+		RecordDebugEvent(mName, DEBUG_EVENT_END_BLOCK);
+	}
+};
+
+#if ENGINE_PROFILE
+#define TIMED_BLOCK__(name, line) timed_block timedBlock##line(name)
+#define TIMED_BLOCK_(name, line) TIMED_BLOCK__(name, line)
+#define TIMED_BLOCK(name) TIMED_BLOCK_(name, __LINE__)
+#else
+#define TIMED_BLOCK(name)
+#endif
+#define TIMED_FUNCTION() TIMED_BLOCK((char*)__FUNCTION__)
+
+#define ENGINE_DEBUG_H
+#endif
\ No newline at end of file
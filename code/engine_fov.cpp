@@ -0,0 +1,260 @@
+/*
+ * Author: Jheremy Strom
+ */
+
+// North, south, east and west quadrants, as the step away from the viewer and the step across a row
+global_variable tile_delta gTileFovDepthX[4] = {0, 0, 1, -1};
+global_variable tile_delta gTileFovDepthY[4] = {1, -1, 0, 0};
+global_variable tile_delta gTileFovColumnX[4] = {1, 1, 0, 0};
+global_variable tile_delta gTileFovColumnY[4] = {0, 0, 1, 1};
+
+internal void
+InitializeTileFovMap(tile_map* tileMap, tile_fov_map* fov, memory_areana* arena, memory_index bitStorageSize) {
+	uint32 chunkCount = GetTileChunkCount(tileMap);
+	fov->mChunkBits = PushArray(arena, chunkCount, uint32*);
+	for (uint32 chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+		fov->mChunkBits[chunkIndex] = 0;
+	}
+	InitializeArena(&fov->mBitArena, bitStorageSize, (uint8*)PushSize_(arena, bitStorageSize));
+	fov->mWordsPerLayer = (GetTileChunkTileCount(tileMap) + 31) / 32;
+
+	for (uint32 viewerIndex = 0; viewerIndex < TILE_FOV_MAX_VIEWERS; ++viewerIndex) {
+		fov->mViewers[viewerIndex].mIsActive = false;
+		fov->mViewers[viewerIndex].mNeedsUpdate = false;
+		fov->mViewers[viewerIndex].mHasVisibleTiles = false;
+	}
+	fov->mActiveViewerCount = 0;
+
+	fov->mUpdateCount = 0;
+	fov->mLastUpdateTileCount = 0;
+
+	tileMap->mFov = fov;
+}
+
+// Bit layers of the tile's chunk, null off the map or, unless asked to allocate, where nothing was ever seen
+internal uint32*
+GetTileFovBits(tile_map* tileMap, tile_coord absTileX, tile_coord absTileY, uint32 absTileZ, bool32 allocate, uint32* bitIndex) {
+	uint32* result = 0;
+	tile_fov_map* fov = tileMap->mFov;
+	tile_chunk_location chunkLoc = GetChunkLocationFor(tileMap, absTileX, absTileY, absTileZ);
+	if ((chunkLoc.mTileChunkX < tileMap->mTileChunkCountX) &&
+		(chunkLoc.mTileChunkY < tileMap->mTileChunkCountY) &&
+		(chunkLoc.mTileChunkZ < tileMap->mTileChunkCountZ)) {
+		uint32 chunkIndex = GetTileChunkIndex(tileMap, (uint32)chunkLoc.mTileChunkX, (uint32)chunkLoc.mTileChunkY, chunkLoc.mTileChunkZ);
+		result = fov->mChunkBits[chunkIndex];
+		if (!result && allocate) {
+			uint32 wordCount = TILE_FOV_LAYER_COUNT*fov->mWordsPerLayer;
+			result = PushArray(&fov->mBitArena, wordCount, uint32);
+			for (uint32 wordIndex = 0; wordIndex < wordCount; ++wordIndex) {
+				result[wordIndex] = 0;
+			}
+			fov->mChunkBits[chunkIndex] = result;
+		}
+		*bitIndex = chunkLoc.mRelTileY*tileMap->mChunkDim + chunkLoc.mRelTileX;
+	}
+	return result;
+}
+
+inline bool32
+IsTileExplored(tile_map* tileMap, tile_coord absTileX, tile_coord absTileY, uint32 absTileZ) {
+	bool32 result = false;
+	uint32 bitIndex;
+	uint32* bits = tileMap->mFov ? GetTileFovBits(tileMap, absTileX, absTileY, absTileZ, false, &bitIndex) : 0;
+	if (bits) {
+		result = (bits[bitIndex / 32] >> (bitIndex % 32)) & 1;
+	}
+	return result;
+}
+
+// True when any viewer currently sees the tile
+inline bool32
+IsTileVisible(tile_map* tileMap, tile_coord absTileX, tile_coord absTileY, uint32 absTileZ) {
+	bool32 result = false;
+	uint32 bitIndex;
+	uint32* bits = tileMap->mFov ? GetTileFovBits(tileMap, absTileX, absTileY, absTileZ, false, &bitIndex) : 0;
+	if (bits) {
+		uint32 wordsPerLayer = tileMap->mFov->mWordsPerLayer;
+		for (uint32 viewerIndex = 0; viewerIndex < TILE_FOV_MAX_VIEWERS; ++viewerIndex) {
+			uint32* visible = bits + (1 + viewerIndex)*wordsPerLayer;
+			if ((visible[bitIndex / 32] >> (bitIndex % 32)) & 1) {
+				result = true;
+				break;
+			}
+		}
+	}
+	return result;
+}
+
+// Returns a handle for MoveTileFovViewer and RemoveTileFovViewer
+internal uint32
+AddTileFovViewer(tile_map* tileMap, tile_map_location location, uint32 radius) {
+	tile_fov_map* fov = tileMap->mFov;
+	uint32 viewerIndex = 0;
+	while ((viewerIndex < TILE_FOV_MAX_VIEWERS) && fov->mViewers[viewerIndex].mIsActive) {
+		++viewerIndex;
+	}
+	Assert(viewerIndex < TILE_FOV_MAX_VIEWERS);
+
+	tile_fov_viewer* viewer = fov->mViewers + viewerIndex;
+	viewer->mLocation = location;
+	viewer->mRadius = radius;
+	viewer->mIsActive = true;
+	viewer->mNeedsUpdate = true;
+	viewer->mHasVisibleTiles = false;
+	++fov->mActiveViewerCount;
+
+	return viewerIndex;
+}
+
+// Clears the viewer's visible bits in every chunk its last scan could have reached
+internal void
+ClearTileFovViewer(tile_map* tileMap, uint32 viewerIndex) {
+	tile_fov_map* fov = tileMap->mFov;
+	tile_fov_viewer* viewer = fov->mViewers + viewerIndex;
+	if (viewer->mHasVisibleTiles) {
+		tile_map_location* center = &viewer->mVisibleCenter;
+		tile_coord minTileX = (center->mAbsTileX > viewer->mRadius) ? (center->mAbsTileX - viewer->mRadius) : 0;
+		tile_coord minTileY = (center->mAbsTileY > viewer->mRadius) ? (center->mAbsTileY - viewer->mRadius) : 0;
+		tile_coord maxChunkX = (center->mAbsTileX + viewer->mRadius) >> tileMap->mChunkShift;
+		tile_coord maxChunkY = (center->mAbsTileY + viewer->mRadius) >> tileMap->mChunkShift;
+		for (tile_coord chunkY = minTileY >> tileMap->mChunkShift; chunkY <= maxChunkY; ++chunkY) {
+			for (tile_coord chunkX = minTileX >> tileMap->mChunkShift; chunkX <= maxChunkX; ++chunkX) {
+				if ((chunkX < tileMap->mTileChunkCountX) &&
+					(chunkY < tileMap->mTileChunkCountY) &&
+					(center->mAbsTileZ < tileMap->mTileChunkCountZ)) {
+					uint32* bits = fov->mChunkBits[GetTileChunkIndex(tileMap, (uint32)chunkX, (uint32)chunkY, center->mAbsTileZ)];
+					if (bits) {
+						uint32* visible = bits + (1 + viewerIndex)*fov->mWordsPerLayer;
+						for (uint32 wordIndex = 0; wordIndex < fov->mWordsPerLayer; ++wordIndex) {
+							visible[wordIndex] = 0;
+						}
+					}
+				}
+			}
+		}
+		viewer->mHasVisibleTiles = false;
+	}
+}
+
+internal void
+RemoveTileFovViewer(tile_map* tileMap, uint32 viewerIndex) {
+	tile_fov_map* fov = tileMap->mFov;
+	Assert(viewerIndex < TILE_FOV_MAX_VIEWERS);
+	Assert(fov->mViewers[viewerIndex].mIsActive);
+
+	ClearTileFovViewer(tileMap, viewerIndex);
+	fov->mViewers[viewerIndex].mIsActive = false;
+	fov->mViewers[viewerIndex].mNeedsUpdate = false;
+	--fov->mActiveViewerCount;
+}
+
+internal void
+MoveTileFovViewer(tile_map* tileMap, uint32 viewerIndex, tile_map_location location) {
+	tile_fov_map* fov = tileMap->mFov;
+	Assert(viewerIndex < TILE_FOV_MAX_VIEWERS);
+	tile_fov_viewer* viewer = fov->mViewers + viewerIndex;
+	Assert(viewer->mIsActive);
+
+	if (!AreOnSameTile(&viewer->mLocation, &location)) {
+		viewer->mNeedsUpdate = true;
+	}
+	viewer->mLocation = location;
+}
+
+internal void
+RevealTileFovTile(tile_fov_scan* scan, tile_coord absTileX, tile_coord absTileY) {
+	tile_fov_map* fov = scan->mTileMap->mFov;
+	uint32 bitIndex;
+	uint32* bits = GetTileFovBits(scan->mTileMap, absTileX, absTileY, scan->mOrigin.mAbsTileZ, true, &bitIndex);
+	if (bits) {
+		uint32 mask = ((uint32)1 << (bitIndex % 32));
+		bits[bitIndex / 32] |= mask;
+		bits[(1 + scan->mViewerIndex)*fov->mWordsPerLayer + bitIndex / 32] |= mask;
+		++scan->mRevealedCount;
+	}
+}
+
+// Rounds numerator/denominator down, for a positive denominator
+inline int32
+FloorTileFovRatio(int32 numerator, int32 denominator) {
+	int32 result = (numerator >= 0) ? (numerator / denominator) : -((denominator - 1 - numerator) / denominator);
+	return result;
+}
+
+// Scans the row at the given depth between the start and end slopes, given as numerator/denominator
+// pairs of column over depth, and recurses into the rows behind each unblocked run of tiles
+internal void
+ScanTileFovRow(tile_fov_scan* scan, int32 depth, int32 startNumerator, int32 startDenominator,
+			   int32 endNumerator, int32 endDenominator) {
+	if (depth > scan->mRadius) {
+		return;
+	}
+
+	// Columns whose centers round into the slopes, ties rounded toward the middle of the row
+	int32 minColumn = FloorTileFovRatio(2*depth*startNumerator + startDenominator, 2*startDenominator);
+	int32 maxColumn = -FloorTileFovRatio(endDenominator - 2*depth*endNumerator, 2*endDenominator);
+	int32 radiusSquared = scan->mRadius*scan->mRadius + scan->mRadius;
+
+	// 0 before the first tile, then 1 for open and 2 for blocking
+	uint32 previousKind = 0;
+	for (int32 column = minColumn; column <= maxColumn; ++column) {
+		tile_coord absTileX = scan->mOrigin.mAbsTileX + depth*scan->mDepthX + column*scan->mColumnX;
+		tile_coord absTileY = scan->mOrigin.mAbsTileY + depth*scan->mDepthY + column*scan->mColumnY;
+		bool32 isBlocking = IsTileLightBlocking(scan->mTileMap, GetTileValue(scan->mTileMap, absTileX, absTileY, scan->mOrigin.mAbsTileZ));
+
+		// Open tiles only show when their center is inside the slopes, which is what keeps the result symmetric
+		bool32 isInside = ((column*startDenominator >= depth*startNumerator) &&
+						   (column*endDenominator <= depth*endNumerator));
+		if ((isBlocking || isInside) && ((column*column + depth*depth) <= radiusSquared)) {
+			RevealTileFovTile(scan, absTileX, absTileY);
+		}
+
+		if ((previousKind == 2) && !isBlocking) {
+			startNumerator = 2*column - 1;
+			startDenominator = 2*depth;
+		}
+		if ((previousKind == 1) && isBlocking) {
+			ScanTileFovRow(scan, depth + 1, startNumerator, startDenominator, 2*column - 1, 2*depth);
+		}
+		previousKind = isBlocking ? 2 : 1;
+	}
+
+	if (previousKind == 1) {
+		ScanTileFovRow(scan, depth + 1, startNumerator, startDenominator, endNumerator, endDenominator);
+	}
+}
+
+// Rescans every viewer that moved or had a tile change within its radius
+internal void
+UpdateTileFov(tile_map* tileMap) {
+	TIMED_FUNCTION();
+	tile_fov_map* fov = tileMap->mFov;
+	for (uint32 viewerIndex = 0; viewerIndex < TILE_FOV_MAX_VIEWERS; ++viewerIndex) {
+		tile_fov_viewer* viewer = fov->mViewers + viewerIndex;
+		if (viewer->mIsActive && viewer->mNeedsUpdate) {
+			ClearTileFovViewer(tileMap, viewerIndex);
+
+			tile_fov_scan scan;
+			scan.mTileMap = tileMap;
+			scan.mViewerIndex = viewerIndex;
+			scan.mOrigin = viewer->mLocation;
+			scan.mRadius = (int32)viewer->mRadius;
+			scan.mRevealedCount = 0;
+
+			RevealTileFovTile(&scan, scan.mOrigin.mAbsTileX, scan.mOrigin.mAbsTileY);
+			for (uint32 quadrant = 0; quadrant < 4; ++quadrant) {
+				scan.mDepthX = gTileFovDepthX[quadrant];
+				scan.mDepthY = gTileFovDepthY[quadrant];
+				scan.mColumnX = gTileFovColumnX[quadrant];
+				scan.mColumnY = gTileFovColumnY[quadrant];
+				ScanTileFovRow(&scan, 1, -1, 1, 1, 1);
+			}
+
+			viewer->mVisibleCenter = viewer->mLocation;
+			viewer->mHasVisibleTiles = true;
+			viewer->mNeedsUpdate = false;
+			fov->mLastUpdateTileCount = scan.mRevealedCount;
+			++fov->mUpdateCount;
+		}
+	}
+}
\ No newline at end of file
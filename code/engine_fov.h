@@ -0,0 +1,59 @@
+#if !defined(ENGINE_FOV_H)
+
+/*
+ * Author: Jheremy Strom
+ */
+
+/*
+ * Field of view by symmetric shadowcasting: a tile is visible from a viewer exactly when the
+ * viewer is visible from it. Each viewer rescans its quadrants only after it changes tile or
+ * a tile within its radius starts or stops blocking sight. Every chunk keeps an explored bit
+ * per tile plus one visible bit per tile for each viewer.
+ */
+
+#define TILE_FOV_MAX_VIEWERS 4
+
+// Explored bits, then the visible bits of every viewer
+#define TILE_FOV_LAYER_COUNT (1 + TILE_FOV_MAX_VIEWERS)
+
+struct tile_fov_viewer {
+	tile_map_location mLocation;
+	uint32 mRadius;
+	bool32 mIsActive;
+	bool32 mNeedsUpdate;
+
+	// Where the viewer stood when its visible bits were last written
+	tile_map_location mVisibleCenter;
+	bool32 mHasVisibleTiles;
+};
+
+struct tile_fov_map {
+	// TILE_FOV_LAYER_COUNT bit layers per chunk, null until some viewer first sees into it
+	uint32** mChunkBits;
+	memory_areana mBitArena;
+	uint32 mWordsPerLayer;
+
+	tile_fov_viewer mViewers[TILE_FOV_MAX_VIEWERS];
+	uint32 mActiveViewerCount;
+
+	uint32 mUpdateCount;
+	uint32 mLastUpdateTileCount;
+};
+
+// One quadrant of one viewer's scan
+struct tile_fov_scan {
+	tile_map* mTileMap;
+	uint32 mViewerIndex;
+	tile_map_location mOrigin;
+	int32 mRadius;
+
+	tile_delta mDepthX;
+	tile_delta mDepthY;
+	tile_delta mColumnX;
+	tile_delta mColumnY;
+
+	uint32 mRevealedCount;
+};
+
+#define ENGINE_FOV_H
+#endif
\ No newline at end of file
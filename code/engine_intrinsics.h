@@ -10,12 +10,25 @@
 
 inline uint32
 RotateLeft(uint32 value, int32 shift) {
-	return _rotl(value, shift);
+#if COMPILER_MSVC
+	uint32 result = _rotl(value, shift);
+#else
+	// Compilers turn this into a single rotate
+	shift &= 31;
+	uint32 result = (value << shift) | (value >> ((32 - shift) & 31));
+#endif
+	return result;
 }
 
 inline uint32
 RotateRight(uint32 value, int32 shift) {
-	return _rotr(value, shift);
+#if COMPILER_MSVC
+	uint32 result = _rotr(value, shift);
+#else
+	shift &= 31;
+	uint32 result = (value >> shift) | (value << ((32 - shift) & 31));
+#endif
+	return result;
 }
 
 inline uint32
@@ -69,6 +82,116 @@ SignOf(int32 value) {
 	return MSB(value) ? 1 : -1;
 }
 
+// BMI2 is implied by AVX2, which is the only way MSVC tells us it may be used
+#if defined(__BMI2__) || defined(__AVX2__)
+#include <immintrin.h>
+#define ENGINE_BMI2 1
+#else
+#define ENGINE_BMI2 0
+#endif
+
+// Moves the low 16 bits of value into the even bits of the result
+inline uint32
+SpreadBitsEven(uint32 value) {
+#if ENGINE_BMI2
+	uint32 result = _pdep_u32(value, 0x55555555);
+#else
+	uint32 result = value & 0x0000FFFF;
+	result = (result | (result << 8)) & 0x00FF00FF;
+	result = (result | (result << 4)) & 0x0F0F0F0F;
+	result = (result | (result << 2)) & 0x33333333;
+	result = (result | (result << 1)) & 0x55555555;
+#endif
+	return result;
+}
+
+// Gathers the even bits of value into the low 16 bits of the result
+inline uint32
+CompactBitsEven(uint32 value) {
+#if ENGINE_BMI2
+	uint32 result = _pext_u32(value, 0x55555555);
+#else
+	uint32 result = value & 0x55555555;
+	result = (result | (result >> 1)) & 0x33333333;
+	result = (result | (result >> 2)) & 0x0F0F0F0F;
+	result = (result | (result >> 4)) & 0x00FF00FF;
+	result = (result | (result >> 8)) & 0x0000FFFF;
+#endif
+	return result;
+}
+
+// Z-order index: x goes to the even bits and y to the odd bits
+inline uint32
+MortonEncode(uint32 x, uint32 y) {
+	uint32 result = SpreadBitsEven(x) | (SpreadBitsEven(y) << 1);
+	return result;
+}
+
+inline uint32
+MortonDecodeX(uint32 code) {
+	uint32 result = CompactBitsEven(code);
+	return result;
+}
+
+inline uint32
+MortonDecodeY(uint32 code) {
+	uint32 result = CompactBitsEven(code >> 1);
+	return result;
+}
+
+/*
+ * Atomics for memory that threads share. x86 never moves a store ahead of an older store or a load ahead
+ * of an older load, so the barriers only have to keep the compiler from reordering.
+ */
+#if COMPILER_MSVC
+#define CompletePreviousWritesBeforeFutureWrites _WriteBarrier()
+#define CompletePreviousReadsBeforeFutureReads _ReadBarrier()
+// The one reordering x86 does, a load moving ahead of an older store, needs a real fence
+#define CompletePreviousWritesBeforeFutureReads _mm_mfence()
+
+// Returns the value before the exchange, the exchange happened when that equals expected
+inline uint32
+AtomicCompareExchangeUInt32(uint32 volatile* value, uint32 newValue, uint32 expected) {
+	uint32 result = (uint32)_InterlockedCompareExchange((long volatile*)value, (long)newValue, (long)expected);
+	return result;
+}
+
+inline uint64
+AtomicCompareExchangeUInt64(uint64 volatile* value, uint64 newValue, uint64 expected) {
+	uint64 result = (uint64)_InterlockedCompareExchange64((__int64 volatile*)value, (__int64)newValue, (__int64)expected);
+	return result;
+}
+
+// Returns the value before the add
+inline uint32
+AtomicAddUInt32(uint32 volatile* value, uint32 addend) {
+	uint32 result = (uint32)_InterlockedExchangeAdd((long volatile*)value, (long)addend);
+	return result;
+}
+#else
+#define CompletePreviousWritesBeforeFutureWrites asm volatile("" ::: "memory")
+#define CompletePreviousReadsBeforeFutureReads asm volatile("" ::: "memory")
+#define CompletePreviousWritesBeforeFutureReads __sync_synchronize()
+
+inline uint32
+AtomicCompareExchangeUInt32(uint32 volatile* value, uint32 newValue, uint32 expected) {
+	uint32 result = __sync_val_compare_and_swap(value, expected, newValue);
+	return result;
+}
+
+inline uint64
+AtomicCompareExchangeUInt64(uint64 volatile* value, uint64 newValue, uint64 expected) {
+	uint64 result = __sync_val_compare_and_swap(value, expected, newValue);
+	return result;
+}
+
+inline uint32
+AtomicAddUInt32(uint32 volatile* value, uint32 addend) {
+	uint32 result = __sync_fetch_and_add(value, addend);
+	return result;
+}
+#endif
+
 struct bit_scan {
 	bool32 mFound;
 	uint32 mIndex;
@@ -76,9 +199,8 @@ struct bit_scan {
 
 // Find the east significant bit that is set, manually or through instrinsics
 inline bit_scan
-FindLeastSignificantSetBit() {
-	bit_scan result;
-	ZeroMemory(result, sizeof(bit_scan));
+FindLeastSignificantSetBit(uint32 value) {
+	bit_scan result = {};
 
 #if COMPILER_MSVC
 	result.mFound = _BitScanForward((unsigned long *)&result.mIndex, value);
@@ -90,6 +212,8 @@ FindLeastSignificantSetBit() {
 			break;
 		}
 	}
+#endif
+	return result;
 }
 
 #define ENGINE_INTRINSICS_H
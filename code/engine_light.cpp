@@ -0,0 +1,415 @@
+/*
+ * Author: Jheremy Strom
+ */
+
+// West, east, south and north steps, then the tile itself
+global_variable tile_delta gTileLightOffsetX[5] = {-1, 1, 0, 0, 0};
+global_variable tile_delta gTileLightOffsetY[5] = {0, 0, -1, 1, 0};
+
+// Notes down what the next update has to patch. Tiles of an edit that started or stopped blocking
+// are patched one by one, a chunk that paged in is relit as a whole and an evicted one keeps its
+// levels. Beyond what the pending lists hold everything is relit.
+internal TILE_CHUNK_CHANGED(TileLightChunkChanged) {
+	tile_light_map* lights = (tile_light_map*)subscriberData;
+	if (!lights->mNeedsRebuild) {
+		if (change->mType == TILE_CHANGE_LOAD) {
+			if (lights->mPendingChunkCount < TILE_LIGHT_MAX_PENDING_CHUNKS) {
+				lights->mPendingChunks[lights->mPendingChunkCount++] = change->mChunkIndex;
+			}
+			else {
+				lights->mNeedsRebuild = true;
+			}
+		}
+		else if (DoesTileChangeMoveLight(change)) {
+			uint64 tileCount = ((uint64)(change->mOnePastMaxTileX - change->mMinTileX)*
+								(uint64)(change->mOnePastMaxTileY - change->mMinTileY));
+			if ((lights->mPendingCount + tileCount) <= TILE_LIGHT_MAX_PENDING_CHANGES) {
+				for (tile_coord absTileY = change->mMinTileY; absTileY < change->mOnePastMaxTileY; ++absTileY) {
+					for (tile_coord absTileX = change->mMinTileX; absTileX < change->mOnePastMaxTileX; ++absTileX) {
+						tile_map_location* tile = lights->mPendingTiles + lights->mPendingCount++;
+						tile->mAbsTileX = absTileX;
+						tile->mAbsTileY = absTileY;
+						tile->mAbsTileZ = change->mAbsTileZ;
+					}
+				}
+			}
+			else {
+				lights->mNeedsRebuild = true;
+			}
+		}
+	}
+}
+
+internal void
+InitializeTileLightMap(tile_map* tileMap, tile_light_map* lights, memory_areana* arena,
+					   uint32 maxSourceCount, uint32 queueCapacity, memory_index levelStorageSize) {
+	uint32 chunkCount = GetTileChunkCount(tileMap);
+	lights->mChunkLevels = PushArray(arena, chunkCount, uint8*);
+	for (uint32 chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+		lights->mChunkLevels[chunkIndex] = 0;
+	}
+	InitializeArena(&lights->mLevelArena, levelStorageSize, (uint8*)PushSize_(arena, levelStorageSize));
+	lights->mFirstFreeLevels = 0;
+
+	lights->mSources = PushArray(arena, maxSourceCount, tile_light_source);
+	lights->mSourceCount = 0;
+	lights->mMaxSourceCount = maxSourceCount;
+
+	lights->mSpreadQueue = PushArray(arena, queueCapacity, tile_light_node);
+	lights->mDarkenQueue = PushArray(arena, queueCapacity, tile_light_node);
+	lights->mQueueCapacity = queueCapacity;
+
+	lights->mPendingCount = 0;
+	lights->mPendingChunkCount = 0;
+	lights->mNeedsRebuild = false;
+	lights->mRebuildCount = 0;
+	lights->mLastUpdateTileCount = 0;
+
+	tileMap->mLights = lights;
+	lights->mSubscriberIndex = SubscribeToTileChanges(tileMap, TileLightChunkChanged, lights);
+}
+
+// Level byte of the tile, null off the map or, unless asked to allocate, in a chunk that is all dark
+internal uint8*
+GetTileLightSlot(tile_map* tileMap, tile_coord absTileX, tile_coord absTileY, uint32 absTileZ, bool32 allocate) {
+	uint8* result = 0;
+	tile_light_map* lights = tileMap->mLights;
+	tile_chunk_location chunkLoc = GetChunkLocationFor(tileMap, absTileX, absTileY, absTileZ);
+	if ((chunkLoc.mTileChunkX < tileMap->mTileChunkCountX) &&
+		(chunkLoc.mTileChunkY < tileMap->mTileChunkCountY) &&
+		(chunkLoc.mTileChunkZ < tileMap->mTileChunkCountZ)) {
+		uint32 chunkIndex = GetTileChunkIndex(tileMap, (uint32)chunkLoc.mTileChunkX, (uint32)chunkLoc.mTileChunkY, chunkLoc.mTileChunkZ);
+		uint8* levels = lights->mChunkLevels[chunkIndex];
+		if (!levels && allocate) {
+			uint32 tileCount = GetTileChunkTileCount(tileMap);
+			if (lights->mFirstFreeLevels) {
+				levels = (uint8*)lights->mFirstFreeLevels;
+				lights->mFirstFreeLevels = *(void**)lights->mFirstFreeLevels;
+			}
+			else {
+				levels = PushArray(&lights->mLevelArena, tileCount, uint8);
+			}
+			for (uint32 tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
+				levels[tileIndex] = 0;
+			}
+			lights->mChunkLevels[chunkIndex] = levels;
+		}
+
+		if (levels) {
+			result = levels + chunkLoc.mRelTileY*tileMap->mChunkDim + chunkLoc.mRelTileX;
+		}
+	}
+	return result;
+}
+
+inline uint32
+GetTileLightLevel(tile_map* tileMap, tile_coord absTileX, tile_coord absTileY, uint32 absTileZ) {
+	uint32 result = 0;
+	if (tileMap->mLights) {
+		uint8* slot = GetTileLightSlot(tileMap, absTileX, absTileY, absTileZ, false);
+		if (slot) {
+			result = *slot;
+		}
+	}
+	return result;
+}
+
+// Brightness from 0 to 1 that a tile's color is scaled by, never below the ambient floor
+inline real32
+GetTileLightBrightness(uint32 level, real32 ambient) {
+	real32 result = ambient + (1.0f - ambient)*((real32)level / (real32)TILE_LIGHT_MAX_LEVEL);
+	return result;
+}
+
+inline void
+PushTileLightNode(tile_light_node* queue, uint32* queueCount, uint32 queueCapacity,
+				  tile_coord absTileX, tile_coord absTileY, uint32 absTileZ, uint32 level) {
+	Assert(*queueCount < queueCapacity);
+	tile_light_node* node = queue + (*queueCount)++;
+	node->mAbsTileX = absTileX;
+	node->mAbsTileY = absTileY;
+	node->mAbsTileZ = absTileZ;
+	node->mLevel = level;
+}
+
+// Spreads the queued tiles' light outward, one level less per step, wherever it is brighter
+// than what is already there. Returns how many tiles were lit.
+internal uint32
+SpreadTileLight(tile_map* tileMap, uint32 spreadCount) {
+	tile_light_map* lights = tileMap->mLights;
+	uint32 litCount = 0;
+	for (uint32 spreadIndex = 0; spreadIndex < spreadCount; ++spreadIndex) {
+		tile_light_node node = lights->mSpreadQueue[spreadIndex];
+
+		// Nodes that were darkened or outshone after they were queued are stale
+		if ((node.mLevel <= 1) || (GetTileLightLevel(tileMap, node.mAbsTileX, node.mAbsTileY, node.mAbsTileZ) != node.mLevel) ||
+			IsTileLightBlocking(tileMap, GetTileValue(tileMap, node.mAbsTileX, node.mAbsTileY, node.mAbsTileZ))) {
+			continue;
+		}
+
+		for (uint32 neighborIndex = 0; neighborIndex < 4; ++neighborIndex) {
+			tile_coord neighborX = node.mAbsTileX + gTileLightOffsetX[neighborIndex];
+			tile_coord neighborY = node.mAbsTileY + gTileLightOffsetY[neighborIndex];
+			uint8* slot = GetTileLightSlot(tileMap, neighborX, neighborY, node.mAbsTileZ, true);
+			if (slot && (*slot < (node.mLevel - 1))) {
+				*slot = (uint8)(node.mLevel - 1);
+				++litCount;
+				PushTileLightNode(lights->mSpreadQueue, &spreadCount, lights->mQueueCapacity,
+					neighborX, neighborY, node.mAbsTileZ, node.mLevel - 1);
+			}
+		}
+	}
+	return litCount;
+}
+
+// Clears every tile whose light may have come through the darkened tiles, queuing the brighter
+// tiles around the cleared area to spread back in. Returns the spread queue count.
+internal uint32
+DarkenTileLight(tile_map* tileMap, uint32 darkenCount, uint32 spreadCount) {
+	tile_light_map* lights = tileMap->mLights;
+	for (uint32 darkenIndex = 0; darkenIndex < darkenCount; ++darkenIndex) {
+		tile_light_node node = lights->mDarkenQueue[darkenIndex];
+
+		for (uint32 neighborIndex = 0; neighborIndex < 4; ++neighborIndex) {
+			tile_coord neighborX = node.mAbsTileX + gTileLightOffsetX[neighborIndex];
+			tile_coord neighborY = node.mAbsTileY + gTileLightOffsetY[neighborIndex];
+			uint8* slot = GetTileLightSlot(tileMap, neighborX, neighborY, node.mAbsTileZ, false);
+			uint32 level = slot ? *slot : 0;
+			if (level && (level < node.mLevel)) {
+				*slot = 0;
+				if (!IsTileLightBlocking(tileMap, GetTileValue(tileMap, neighborX, neighborY, node.mAbsTileZ))) {
+					PushTileLightNode(lights->mDarkenQueue, &darkenCount, lights->mQueueCapacity,
+						neighborX, neighborY, node.mAbsTileZ, level);
+				}
+				else {
+					// A wall may also be lit from its other side, which this wave never reaches
+					for (uint32 wallNeighborIndex = 0; wallNeighborIndex < 4; ++wallNeighborIndex) {
+						tile_coord wallNeighborX = neighborX + gTileLightOffsetX[wallNeighborIndex];
+						tile_coord wallNeighborY = neighborY + gTileLightOffsetY[wallNeighborIndex];
+						uint32 wallNeighborLevel = GetTileLightLevel(tileMap, wallNeighborX, wallNeighborY, node.mAbsTileZ);
+						if (wallNeighborLevel) {
+							PushTileLightNode(lights->mSpreadQueue, &spreadCount, lights->mQueueCapacity,
+								wallNeighborX, wallNeighborY, node.mAbsTileZ, wallNeighborLevel);
+						}
+					}
+				}
+			}
+			else if (level) {
+				PushTileLightNode(lights->mSpreadQueue, &spreadCount, lights->mQueueCapacity,
+					neighborX, neighborY, node.mAbsTileZ, level);
+			}
+		}
+	}
+	return spreadCount;
+}
+
+// Sources sitting in a darkened area lost their own light too, so every source is topped back up
+internal uint32
+ReseedTileLightSources(tile_map* tileMap, uint32 spreadCount) {
+	tile_light_map* lights = tileMap->mLights;
+	for (uint32 sourceIndex = 0; sourceIndex < lights->mSourceCount; ++sourceIndex) {
+		tile_light_source* source = lights->mSources + sourceIndex;
+		if (source->mIsActive) {
+			tile_map_location* location = &source->mLocation;
+			uint8* slot = GetTileLightSlot(tileMap, location->mAbsTileX, location->mAbsTileY, location->mAbsTileZ, true);
+			if (slot && (*slot < source->mLevel)) {
+				*slot = (uint8)source->mLevel;
+				PushTileLightNode(lights->mSpreadQueue, &spreadCount, lights->mQueueCapacity,
+					location->mAbsTileX, location->mAbsTileY, location->mAbsTileZ, source->mLevel);
+			}
+		}
+	}
+	return spreadCount;
+}
+
+internal void
+RebuildTileLights(tile_map* tileMap) {
+	tile_light_map* lights = tileMap->mLights;
+	uint32 chunkCount = GetTileChunkCount(tileMap);
+	for (uint32 chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+		uint8* levels = lights->mChunkLevels[chunkIndex];
+		if (levels) {
+			*(void**)levels = lights->mFirstFreeLevels;
+			lights->mFirstFreeLevels = levels;
+			lights->mChunkLevels[chunkIndex] = 0;
+		}
+	}
+
+	uint32 spreadCount = ReseedTileLightSources(tileMap, 0);
+	lights->mLastUpdateTileCount = spreadCount + SpreadTileLight(tileMap, spreadCount);
+
+	lights->mPendingCount = 0;
+	lights->mPendingChunkCount = 0;
+	lights->mNeedsRebuild = false;
+	++lights->mRebuildCount;
+}
+
+// Returns a handle for RemoveTileLight
+internal uint32
+AddTileLight(tile_map* tileMap, tile_map_location location, uint32 level) {
+	tile_light_map* lights = tileMap->mLights;
+	Assert(level <= TILE_LIGHT_MAX_LEVEL);
+
+	uint32 sourceIndex = 0;
+	while ((sourceIndex < lights->mSourceCount) && lights->mSources[sourceIndex].mIsActive) {
+		++sourceIndex;
+	}
+	if (sourceIndex == lights->mSourceCount) {
+		Assert(lights->mSourceCount < lights->mMaxSourceCount);
+		++lights->mSourceCount;
+	}
+
+	tile_light_source* source = lights->mSources + sourceIndex;
+	source->mLocation = CenteredTilePoint(location.mAbsTileX, location.mAbsTileY, location.mAbsTileZ);
+	source->mLevel = level;
+	source->mIsActive = true;
+
+	if (!lights->mNeedsRebuild) {
+		uint32 spreadCount = ReseedTileLightSources(tileMap, 0);
+		lights->mLastUpdateTileCount = spreadCount + SpreadTileLight(tileMap, spreadCount);
+	}
+
+	return sourceIndex;
+}
+
+// Clears the light an inactive source left behind, returning the spread queue count for what relights it
+internal uint32
+DarkenTileLightSource(tile_map* tileMap, tile_light_source* source) {
+	tile_light_map* lights = tileMap->mLights;
+	Assert(!source->mIsActive);
+
+	uint32 spreadCount = 0;
+	tile_map_location* location = &source->mLocation;
+	uint8* slot = GetTileLightSlot(tileMap, location->mAbsTileX, location->mAbsTileY, location->mAbsTileZ, false);
+	if (slot && *slot) {
+		uint32 darkenCount = 0;
+		PushTileLightNode(lights->mDarkenQueue, &darkenCount, lights->mQueueCapacity,
+			location->mAbsTileX, location->mAbsTileY, location->mAbsTileZ, *slot);
+		*slot = 0;
+		spreadCount = DarkenTileLight(tileMap, darkenCount, 0);
+	}
+	return spreadCount;
+}
+
+internal void
+RemoveTileLight(tile_map* tileMap, uint32 sourceIndex) {
+	tile_light_map* lights = tileMap->mLights;
+	Assert(sourceIndex < lights->mSourceCount);
+	tile_light_source* source = lights->mSources + sourceIndex;
+	Assert(source->mIsActive);
+	source->mIsActive = false;
+
+	if (!lights->mNeedsRebuild) {
+		uint32 spreadCount = DarkenTileLightSource(tileMap, source);
+		spreadCount = ReseedTileLightSources(tileMap, spreadCount);
+		lights->mLastUpdateTileCount = spreadCount + SpreadTileLight(tileMap, spreadCount);
+	}
+}
+
+// Same as removing and adding the light again, but the handle stays valid
+internal void
+MoveTileLight(tile_map* tileMap, uint32 sourceIndex, tile_map_location location) {
+	tile_light_map* lights = tileMap->mLights;
+	Assert(sourceIndex < lights->mSourceCount);
+	tile_light_source* source = lights->mSources + sourceIndex;
+	Assert(source->mIsActive);
+
+	if (!AreOnSameTile(&source->mLocation, &location)) {
+		source->mIsActive = false;
+		uint32 spreadCount = lights->mNeedsRebuild ? 0 : DarkenTileLightSource(tileMap, source);
+
+		source->mLocation = CenteredTilePoint(location.mAbsTileX, location.mAbsTileY, location.mAbsTileZ);
+		source->mIsActive = true;
+		if (!lights->mNeedsRebuild) {
+			spreadCount = ReseedTileLightSources(tileMap, spreadCount);
+			lights->mLastUpdateTileCount = spreadCount + SpreadTileLight(tileMap, spreadCount);
+		}
+	}
+}
+
+// Queues the light of a chunk whose tiles all changed at once to be darkened, taking along whatever
+// spread out of it, and the lit tiles around it to spread back in. Returns the darken queue count.
+internal uint32
+DarkenTileLightChunk(tile_map* tileMap, uint32 chunkIndex, uint32 darkenCount, uint32* spreadCount) {
+	tile_light_map* lights = tileMap->mLights;
+	tile_chunk_location chunkLoc = GetTileChunkLocation(tileMap, chunkIndex);
+	uint32 chunkDim = tileMap->mChunkDim;
+	tile_coord minTileX = chunkLoc.mTileChunkX << tileMap->mChunkShift;
+	tile_coord minTileY = chunkLoc.mTileChunkY << tileMap->mChunkShift;
+	uint32 absTileZ = chunkLoc.mTileChunkZ;
+
+	uint8* levels = lights->mChunkLevels[chunkIndex];
+	if (levels) {
+		for (uint32 tileY = 0; tileY < chunkDim; ++tileY) {
+			for (uint32 tileX = 0; tileX < chunkDim; ++tileX) {
+				uint8* slot = levels + tileY*chunkDim + tileX;
+				if (*slot) {
+					PushTileLightNode(lights->mDarkenQueue, &darkenCount, lights->mQueueCapacity,
+						minTileX + tileX, minTileY + tileY, absTileZ, *slot);
+					*slot = 0;
+				}
+			}
+		}
+	}
+
+	for (uint32 borderIndex = 0; borderIndex < chunkDim; ++borderIndex) {
+		tile_coord borderX[4] = {minTileX - 1, minTileX + chunkDim, minTileX + borderIndex, minTileX + borderIndex};
+		tile_coord borderY[4] = {minTileY + borderIndex, minTileY + borderIndex, minTileY - 1, minTileY + chunkDim};
+		for (uint32 sideIndex = 0; sideIndex < 4; ++sideIndex) {
+			uint32 level = GetTileLightLevel(tileMap, borderX[sideIndex], borderY[sideIndex], absTileZ);
+			if (level) {
+				PushTileLightNode(lights->mSpreadQueue, spreadCount, lights->mQueueCapacity,
+					borderX[sideIndex], borderY[sideIndex], absTileZ, level);
+			}
+		}
+	}
+	return darkenCount;
+}
+
+// Patches the light around every tile that started or stopped blocking since the last update
+internal void
+UpdateTileLights(tile_map* tileMap) {
+	TIMED_FUNCTION();
+	tile_light_map* lights = tileMap->mLights;
+	if (lights->mNeedsRebuild) {
+		RebuildTileLights(tileMap);
+	}
+	else if (lights->mPendingCount || lights->mPendingChunkCount) {
+		uint32 darkenCount = 0;
+		uint32 spreadCount = 0;
+		for (uint32 pendingIndex = 0; pendingIndex < lights->mPendingChunkCount; ++pendingIndex) {
+			darkenCount = DarkenTileLightChunk(tileMap, lights->mPendingChunks[pendingIndex], darkenCount, &spreadCount);
+		}
+
+		for (uint32 pendingIndex = 0; pendingIndex < lights->mPendingCount; ++pendingIndex) {
+			tile_map_location* tile = lights->mPendingTiles + pendingIndex;
+			uint8* slot = GetTileLightSlot(tileMap, tile->mAbsTileX, tile->mAbsTileY, tile->mAbsTileZ, false);
+			if (IsTileLightBlocking(tileMap, GetTileValue(tileMap, *tile))) {
+				// Light that flowed through the tile has to go, the wall itself is relit from its sides
+				if (slot && *slot) {
+					PushTileLightNode(lights->mDarkenQueue, &darkenCount, lights->mQueueCapacity,
+						tile->mAbsTileX, tile->mAbsTileY, tile->mAbsTileZ, *slot);
+					*slot = 0;
+				}
+			}
+			else {
+				// The opened tile and its lit neighbors spread again now that it lets light through
+				for (uint32 neighborIndex = 0; neighborIndex < 5; ++neighborIndex) {
+					tile_coord neighborX = tile->mAbsTileX + gTileLightOffsetX[neighborIndex];
+					tile_coord neighborY = tile->mAbsTileY + gTileLightOffsetY[neighborIndex];
+					uint32 level = GetTileLightLevel(tileMap, neighborX, neighborY, tile->mAbsTileZ);
+					if (level) {
+						PushTileLightNode(lights->mSpreadQueue, &spreadCount, lights->mQueueCapacity,
+							neighborX, neighborY, tile->mAbsTileZ, level);
+					}
+				}
+			}
+		}
+
+		spreadCount = DarkenTileLight(tileMap, darkenCount, spreadCount);
+		spreadCount = ReseedTileLightSources(tileMap, spreadCount);
+		lights->mLastUpdateTileCount = spreadCount + SpreadTileLight(tileMap, spreadCount);
+		lights->mPendingCount = 0;
+		lights->mPendingChunkCount = 0;
+	}
+}
\ No newline at end of file
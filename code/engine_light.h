@@ -0,0 +1,65 @@
+#if !defined(ENGINE_LIGHT_H)
+
+/*
+ * Author: Jheremy Strom
+ */
+
+/*
+ * Tile lighting spreads from each source by flood fill, losing one level per tile.
+ * Walls catch light on their faces but do not pass it on. Adding a light only spreads
+ * outward from it; removing one, or walling off a lit tile, darkens what it used to
+ * light and relights that area from whatever else still reaches it. A chunk paging in
+ * is darkened as a whole the same way. Evicted chunks keep their levels.
+ */
+
+#define TILE_LIGHT_MAX_LEVEL 15
+
+// Tiles that changed between lit and blocking since the last update, beyond this everything is relit
+#define TILE_LIGHT_MAX_PENDING_CHANGES 64
+
+// Chunks that paged in or were created since the last update, beyond this everything is relit
+#define TILE_LIGHT_MAX_PENDING_CHUNKS 16
+
+struct tile_light_source {
+	tile_map_location mLocation;
+	uint32 mLevel;
+	bool32 mIsActive;
+};
+
+struct tile_light_node {
+	tile_coord mAbsTileX;
+	tile_coord mAbsTileY;
+	uint32 mAbsTileZ;
+	uint32 mLevel;
+};
+
+struct tile_light_map {
+	// Row major level of every tile per chunk, null while the whole chunk is dark
+	uint8** mChunkLevels;
+	memory_areana mLevelArena;
+	void* mFirstFreeLevels;
+
+	tile_light_source* mSources;
+	uint32 mSourceCount;
+	uint32 mMaxSourceCount;
+
+	// Work lists of the spreading and darkening waves
+	tile_light_node* mSpreadQueue;
+	tile_light_node* mDarkenQueue;
+	uint32 mQueueCapacity;
+
+	tile_map_location mPendingTiles[TILE_LIGHT_MAX_PENDING_CHANGES];
+	uint32 mPendingCount;
+	uint32 mPendingChunks[TILE_LIGHT_MAX_PENDING_CHUNKS];
+	uint32 mPendingChunkCount;
+	bool32 mNeedsRebuild;
+
+	// Handle of TileLightChunkChanged in the tile map's subscribers
+	uint32 mSubscriberIndex;
+
+	uint32 mRebuildCount;
+	uint32 mLastUpdateTileCount;
+};
+
+#define ENGINE_LIGHT_H
+#endif
\ No newline at end of file
@@ -1,12 +1,14 @@
 #if !defined(ENGINE_MATH_H)
 
+#include <string.h>
+
 #define Min(A, B) ((A < B) ? (A) : (B))
 #define Max(A, B) ((A > B) ? (A) : (B))
 #define Clamp(value, lower, upper) (Min((upper), Max((lower), (value))))
-#define Lerp(a, b, f) ((a) + (f) * ((b) - (a)))
-//inline float Lerp(float a, float b, float f) {
-//	return a + f * (b - a);
-//}
+// A macro would take over the vector Lerps below
+inline float Lerp(float a, float b, float f) {
+	return a + f * (b - a);
+}
 
 namespace Math {
 	const float Pi = 3.1415926535f;
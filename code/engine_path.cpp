@@ -0,0 +1,965 @@
+/*
+ * Author: Jheremy Strom
+ */
+
+#define TILE_PATH_START_NODE (UInt32Max - 1)
+#define TILE_PATH_GOAL_NODE UInt32Max
+
+// Reads the version without stamping or unpacking the chunk, zero outside the map
+inline uint32
+GetTilePathVersion(tile_map* tileMap, uint32 chunkX, uint32 chunkY, uint32 chunkZ) {
+	uint32 result = 0;
+	if ((chunkX < tileMap->mTileChunkCountX) &&
+		(chunkY < tileMap->mTileChunkCountY) &&
+		(chunkZ < tileMap->mTileChunkCountZ)) {
+		result = tileMap->mTileChunks[GetTileChunkIndex(tileMap, chunkX, chunkY, chunkZ)].mPathVersion;
+	}
+	return result;
+}
+
+// A chunk's portals depend on the tiles across its borders, so its neighbors' versions count too
+inline void
+GetTilePathVersions(tile_map* tileMap, uint32 chunkX, uint32 chunkY, uint32 chunkZ, uint32* versions) {
+	versions[0] = GetTilePathVersion(tileMap, chunkX, chunkY, chunkZ);
+	versions[1] = GetTilePathVersion(tileMap, chunkX - 1, chunkY, chunkZ);
+	versions[2] = GetTilePathVersion(tileMap, chunkX + 1, chunkY, chunkZ);
+	versions[3] = GetTilePathVersion(tileMap, chunkX, chunkY - 1, chunkZ);
+	versions[4] = GetTilePathVersion(tileMap, chunkX, chunkY + 1, chunkZ);
+}
+
+inline memory_index
+GetTilePathGridSize(tile_map* tileMap) {
+	// Classes, distances and the BFS queue of one chunk
+	memory_index result = GetTileChunkTileCount(tileMap)*(sizeof(uint8) + sizeof(uint16) + sizeof(uint32));
+	return result;
+}
+
+internal void
+InitializeTilePathCache(tile_map* tileMap, tile_path_cache* cache, memory_areana* arena,
+						uint32 entryCount, memory_index nodeStorageSize, uint32 maxSearchNodeCount) {
+	Assert(tileMap->mChunkShift <= 8);
+	Assert(entryCount > 0);
+
+	// A border alternates between open and blocked at worst, which bounds its portals
+	cache->mMaxNodesPerChunk = 4*((tileMap->mChunkDim + 1) / 2) + TILE_PATH_MAX_DOORS_PER_CHUNK;
+
+	uint32 chunkCount = GetTileChunkCount(tileMap);
+	cache->mEntryIndices = PushArray(arena, chunkCount, uint32);
+	for (uint32 chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+		cache->mEntryIndices[chunkIndex] = TILE_PATH_NO_ENTRY;
+	}
+
+	cache->mEntryCount = entryCount;
+	cache->mUsedEntryCount = 0;
+	cache->mEntries = PushArray(arena, entryCount, tile_path_chunk);
+	InitializeArena(&cache->mNodeArena, nodeStorageSize, (uint8*)PushSize_(arena, nodeStorageSize));
+
+	// The largest possible chunk graph has to fit on its own
+	Assert(nodeStorageSize >= cache->mMaxNodesPerChunk*(sizeof(tile_path_node) + cache->mMaxNodesPerChunk*sizeof(uint16)));
+
+	// The open set needs a record, a heap slot and two hash slots per node, plus room for
+	// the start and goal grids and one chunk being built or refined at the same time
+	uint32 hashCount = 1;
+	while (hashCount < 2*maxSearchNodeCount) {
+		hashCount <<= 1;
+	}
+	memory_index scratchSize = (maxSearchNodeCount*(sizeof(tile_path_search_node) + sizeof(uint32)) +
+								hashCount*sizeof(uint32) +
+								cache->mMaxNodesPerChunk*(sizeof(uint16) + sizeof(tile_path_node)) +
+								2*GetTilePathGridSize(tileMap));
+	InitializeArena(&cache->mScratchArena, scratchSize, (uint8*)PushSize_(arena, scratchSize));
+	cache->mMaxSearchNodeCount = maxSearchNodeCount;
+
+	cache->mBuildCount = 0;
+	cache->mFlushCount = 0;
+	cache->mSearchCount = 0;
+}
+
+// Fills classes with the path class of every tile of the chunk, all blocked when it is not loaded
+internal void
+ReadTilePathClasses(tile_map* tileMap, uint32 chunkX, uint32 chunkY, uint32 chunkZ, uint8* classes) {
+	uint32 chunkDim = tileMap->mChunkDim;
+	tile_chunk* tileChunk = GetTileChunk(tileMap, chunkX, chunkY, chunkZ);
+	for (uint32 tileY = 0; tileY < chunkDim; ++tileY) {
+		for (uint32 tileX = 0; tileX < chunkDim; ++tileX) {
+			classes[tileY*chunkDim + tileX] = (uint8)GetTilePathClass(tileMap, GetTileValue(tileMap, tileChunk, tileX, tileY));
+		}
+	}
+}
+
+// Breadth first distances from one tile to every tile of the chunk reachable without leaving it
+internal void
+ComputeTilePathDistances(tile_map* tileMap, uint8* classes, uint32 fromTileX, uint32 fromTileY,
+						 uint16* distances, uint32* queue) {
+	uint32 chunkDim = tileMap->mChunkDim;
+	uint32 tileCount = GetTileChunkTileCount(tileMap);
+	for (uint32 tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
+		distances[tileIndex] = TILE_PATH_UNREACHABLE;
+	}
+
+	uint32 fromTileIndex = fromTileY*chunkDim + fromTileX;
+	if (classes[fromTileIndex]) {
+		uint32 queueRead = 0;
+		uint32 queueWrite = 0;
+		distances[fromTileIndex] = 0;
+		queue[queueWrite++] = fromTileIndex;
+
+		while (queueRead < queueWrite) {
+			uint32 tileIndex = queue[queueRead++];
+			uint32 tileX = tileIndex & (chunkDim - 1);
+			uint32 tileY = tileIndex >> tileMap->mChunkShift;
+			uint16 nextDistance = distances[tileIndex] + 1;
+
+			uint32 neighbors[4];
+			uint32 neighborCount = 0;
+			if (tileX > 0) {
+				neighbors[neighborCount++] = tileIndex - 1;
+			}
+			if (tileX < (chunkDim - 1)) {
+				neighbors[neighborCount++] = tileIndex + 1;
+			}
+			if (tileY > 0) {
+				neighbors[neighborCount++] = tileIndex - chunkDim;
+			}
+			if (tileY < (chunkDim - 1)) {
+				neighbors[neighborCount++] = tileIndex + chunkDim;
+			}
+
+			for (uint32 neighborIndex = 0; neighborIndex < neighborCount; ++neighborIndex) {
+				uint32 neighbor = neighbors[neighborIndex];
+				if (classes[neighbor] && (distances[neighbor] == TILE_PATH_UNREACHABLE)) {
+					distances[neighbor] = nextDistance;
+					queue[queueWrite++] = neighbor;
+				}
+			}
+		}
+	}
+}
+
+inline void
+AddTilePathNode(tile_path_node* nodes, uint32* nodeCount, uint32 relTileX, uint32 relTileY, uint32 kind) {
+	tile_path_node* node = &nodes[(*nodeCount)++];
+	node->mRelTileX = (uint16)relTileX;
+	node->mRelTileY = (uint16)relTileY;
+	node->mKind = kind;
+}
+
+// Forgets every chunk graph at once, they are rebuilt as searches ask for them again
+internal void
+FlushTilePathCache(tile_path_cache* cache) {
+	for (uint32 entryIndex = 0; entryIndex < cache->mUsedEntryCount; ++entryIndex) {
+		cache->mEntryIndices[cache->mEntries[entryIndex].mChunkIndex] = TILE_PATH_NO_ENTRY;
+	}
+	cache->mUsedEntryCount = 0;
+	cache->mNodeArena.mUsed = 0;
+	++cache->mFlushCount;
+}
+
+// Finds the chunk's portals and doors and the distances between them. Storage is sized to
+// the node count, and when the cache has no room left it is flushed first.
+internal tile_path_chunk*
+BuildTilePathChunk(tile_map* tileMap, tile_path_cache* cache, uint32 chunkX, uint32 chunkY, uint32 chunkZ) {
+	memory_areana* scratch = &cache->mScratchArena;
+	memory_index scratchUsed = scratch->mUsed;
+
+	uint32 chunkDim = tileMap->mChunkDim;
+	uint32 tileCount = GetTileChunkTileCount(tileMap);
+	uint8* classes = PushArray(scratch, tileCount, uint8);
+	uint16* distances = PushArray(scratch, tileCount, uint16);
+	uint32* queue = PushArray(scratch, tileCount, uint32);
+	tile_path_node* nodes = PushArray(scratch, cache->mMaxNodesPerChunk, tile_path_node);
+	uint32 nodeCount = 0;
+	ReadTilePathClasses(tileMap, chunkX, chunkY, chunkZ, classes);
+
+	// One portal in the middle of every run of tiles open on both sides of a border.
+	// The chunk across the border finds the same runs, so the portals pair up.
+	tile_coord minTileX = (tile_coord)chunkX << tileMap->mChunkShift;
+	tile_coord minTileY = (tile_coord)chunkY << tileMap->mChunkShift;
+	for (uint32 side = TILE_PATH_NODE_WEST; side <= TILE_PATH_NODE_NORTH; ++side) {
+		uint32 runStart = 0;
+		uint32 runLength = 0;
+		for (uint32 borderIndex = 0; borderIndex <= chunkDim; ++borderIndex) {
+			uint32 relTileX = borderIndex;
+			uint32 relTileY = borderIndex;
+			tile_coord outsideTileX = minTileX + borderIndex;
+			tile_coord outsideTileY = minTileY + borderIndex;
+			if (side == TILE_PATH_NODE_WEST) {
+				relTileX = 0;
+				outsideTileX = minTileX - 1;
+			}
+			else if (side == TILE_PATH_NODE_EAST) {
+				relTileX = chunkDim - 1;
+				outsideTileX = minTileX + chunkDim;
+			}
+			else if (side == TILE_PATH_NODE_SOUTH) {
+				relTileY = 0;
+				outsideTileY = minTileY - 1;
+			}
+			else {
+				relTileY = chunkDim - 1;
+				outsideTileY = minTileY + chunkDim;
+			}
+
+			bool32 isOpen = false;
+			if (borderIndex < chunkDim) {
+				isOpen = (classes[relTileY*chunkDim + relTileX] &&
+						IsTileValueEmpty(tileMap, GetTileValue(tileMap, outsideTileX, outsideTileY, chunkZ)));
+			}
+
+			if (isOpen) {
+				if (runLength == 0) {
+					runStart = borderIndex;
+				}
+				++runLength;
+			}
+			else if (runLength) {
+				uint32 portalIndex = runStart + (runLength - 1) / 2;
+				if ((side == TILE_PATH_NODE_WEST) || (side == TILE_PATH_NODE_EAST)) {
+					AddTilePathNode(nodes, &nodeCount, relTileX, portalIndex, side);
+				}
+				else {
+					AddTilePathNode(nodes, &nodeCount, portalIndex, relTileY, side);
+				}
+				runLength = 0;
+			}
+		}
+	}
+
+	uint32 doorCount = 0;
+	for (uint32 tileIndex = 0; (tileIndex < tileCount) && (doorCount < TILE_PATH_MAX_DOORS_PER_CHUNK); ++tileIndex) {
+		if ((classes[tileIndex] == TILE_PATH_CLASS_DOOR_UP) || (classes[tileIndex] == TILE_PATH_CLASS_DOOR_DOWN)) {
+			AddTilePathNode(nodes, &nodeCount, tileIndex & (chunkDim - 1), tileIndex >> tileMap->mChunkShift,
+				(classes[tileIndex] == TILE_PATH_CLASS_DOOR_UP) ? TILE_PATH_NODE_DOOR_UP : TILE_PATH_NODE_DOOR_DOWN);
+			++doorCount;
+		}
+	}
+	Assert(nodeCount <= cache->mMaxNodesPerChunk);
+
+	uint32 chunkIndex = GetTileChunkIndex(tileMap, chunkX, chunkY, chunkZ);
+	memory_index nodeBytes = nodeCount*sizeof(tile_path_node);
+	memory_index storageSize = nodeBytes + nodeCount*nodeCount*sizeof(uint16);
+	storageSize = (storageSize + sizeof(uint32) - 1) & ~(sizeof(uint32) - 1);
+
+	// A rebuilt chunk takes fresh storage, what it had before is reclaimed by the next flush
+	uint32 entryIndex = cache->mEntryIndices[chunkIndex];
+	memory_areana* nodeArena = &cache->mNodeArena;
+	if (((entryIndex == TILE_PATH_NO_ENTRY) && (cache->mUsedEntryCount == cache->mEntryCount)) ||
+		((nodeArena->mUsed + storageSize) > nodeArena->mSize)) {
+		FlushTilePathCache(cache);
+		entryIndex = TILE_PATH_NO_ENTRY;
+	}
+	if (entryIndex == TILE_PATH_NO_ENTRY) {
+		entryIndex = cache->mUsedEntryCount++;
+		cache->mEntryIndices[chunkIndex] = entryIndex;
+	}
+
+	tile_path_chunk* entry = &cache->mEntries[entryIndex];
+	uint8* storage = (uint8*)PushSize_(nodeArena, storageSize);
+	entry->mNodes = (tile_path_node*)storage;
+	entry->mDistances = (uint16*)(storage + nodeBytes);
+	entry->mNodeCount = nodeCount;
+	for (uint32 nodeIndex = 0; nodeIndex < nodeCount; ++nodeIndex) {
+		entry->mNodes[nodeIndex] = nodes[nodeIndex];
+	}
+
+	for (uint32 fromIndex = 0; fromIndex < nodeCount; ++fromIndex) {
+		tile_path_node* from = &nodes[fromIndex];
+		ComputeTilePathDistances(tileMap, classes, from->mRelTileX, from->mRelTileY, distances, queue);
+		for (uint32 toIndex = 0; toIndex < nodeCount; ++toIndex) {
+			tile_path_node* to = &nodes[toIndex];
+			entry->mDistances[fromIndex*nodeCount + toIndex] = distances[to->mRelTileY*chunkDim + to->mRelTileX];
+		}
+	}
+
+	GetTilePathVersions(tileMap, chunkX, chunkY, chunkZ, entry->mVersions);
+	entry->mChunkIndex = chunkIndex;
+	++cache->mBuildCount;
+
+	scratch->mUsed = scratchUsed;
+	return entry;
+}
+
+// Returns the chunk's abstract graph, building it if it is missing or out of date.
+// Building can flush the cache, so graphs returned earlier must not be used afterwards.
+internal tile_path_chunk*
+GetTilePathChunk(tile_map* tileMap, tile_path_cache* cache, uint32 chunkX, uint32 chunkY, uint32 chunkZ) {
+	Assert(chunkX < tileMap->mTileChunkCountX);
+	Assert(chunkY < tileMap->mTileChunkCountY);
+	Assert(chunkZ < tileMap->mTileChunkCountZ);
+
+	uint32 entryIndex = cache->mEntryIndices[GetTileChunkIndex(tileMap, chunkX, chunkY, chunkZ)];
+	bool32 isUpToDate = (entryIndex != TILE_PATH_NO_ENTRY);
+	if (isUpToDate) {
+		uint32 versions[5];
+		GetTilePathVersions(tileMap, chunkX, chunkY, chunkZ, versions);
+		for (uint32 versionIndex = 0; versionIndex < ArrayCount(versions); ++versionIndex) {
+			if (versions[versionIndex] != cache->mEntries[entryIndex].mVersions[versionIndex]) {
+				isUpToDate = false;
+			}
+		}
+	}
+
+	tile_path_chunk* entry = 0;
+	if (isUpToDate) {
+		entry = &cache->mEntries[entryIndex];
+	}
+	else {
+		entry = BuildTilePathChunk(tileMap, cache, chunkX, chunkY, chunkZ);
+	}
+
+	return entry;
+}
+
+inline uint32
+FindTilePathNode(tile_path_chunk* entry, uint32 relTileX, uint32 relTileY, uint32 kind) {
+	uint32 result = TILE_PATH_NO_ENTRY;
+	for (uint32 nodeIndex = 0; nodeIndex < entry->mNodeCount; ++nodeIndex) {
+		tile_path_node* node = &entry->mNodes[nodeIndex];
+		if ((node->mRelTileX == relTileX) && (node->mRelTileY == relTileY) && (node->mKind == kind)) {
+			result = nodeIndex;
+			break;
+		}
+	}
+	return result;
+}
+
+inline tile_coord
+GetTileCoordDistance(tile_coord a, tile_coord b) {
+	tile_coord result = (a > b) ? (a - b) : (b - a);
+	return result;
+}
+
+// Ties go to the node further along, otherwise every equally short detour on a grid gets expanded
+inline bool32
+IsTilePathNodeCheaper(tile_path_search* search, uint32 a, uint32 b) {
+	tile_path_search_node* nodeA = &search->mNodes[a];
+	tile_path_search_node* nodeB = &search->mNodes[b];
+	bool32 result = ((nodeA->mEstimate < nodeB->mEstimate) ||
+					((nodeA->mEstimate == nodeB->mEstimate) && (nodeA->mCost > nodeB->mCost)));
+	return result;
+}
+
+inline void
+SwapTilePathHeapEntries(tile_path_search* search, uint32 a, uint32 b) {
+	uint32 temp = search->mHeap[a];
+	search->mHeap[a] = search->mHeap[b];
+	search->mHeap[b] = temp;
+	search->mNodes[search->mHeap[a]].mHeapIndex = a;
+	search->mNodes[search->mHeap[b]].mHeapIndex = b;
+}
+
+internal void
+SiftTilePathHeapUp(tile_path_search* search, uint32 heapIndex) {
+	while (heapIndex > 0) {
+		uint32 parentIndex = (heapIndex - 1) / 2;
+		if (!IsTilePathNodeCheaper(search, search->mHeap[heapIndex], search->mHeap[parentIndex])) {
+			break;
+		}
+		SwapTilePathHeapEntries(search, heapIndex, parentIndex);
+		heapIndex = parentIndex;
+	}
+}
+
+internal uint32
+PopCheapestTilePathNode(tile_path_search* search) {
+	Assert(search->mHeapCount > 0);
+	uint32 result = search->mHeap[0];
+	SwapTilePathHeapEntries(search, 0, --search->mHeapCount);
+
+	uint32 heapIndex = 0;
+	for (;;) {
+		uint32 cheapest = heapIndex;
+		uint32 left = 2*heapIndex + 1;
+		uint32 right = left + 1;
+		if ((left < search->mHeapCount) && IsTilePathNodeCheaper(search, search->mHeap[left], search->mHeap[cheapest])) {
+			cheapest = left;
+		}
+		if ((right < search->mHeapCount) && IsTilePathNodeCheaper(search, search->mHeap[right], search->mHeap[cheapest])) {
+			cheapest = right;
+		}
+		if (cheapest == heapIndex) {
+			break;
+		}
+		SwapTilePathHeapEntries(search, heapIndex, cheapest);
+		heapIndex = cheapest;
+	}
+
+	search->mNodes[result].mHeapIndex = TILE_PATH_NO_ENTRY;
+	return result;
+}
+
+// Opens the node or lowers its cost, keyed by chunk and node index
+internal void
+RelaxTilePathNode(tile_map* tileMap, tile_path_search* search, uint32 chunkIndex, uint32 nodeIndex,
+				  tile_coord absTileX, tile_coord absTileY, uint32 absTileZ, uint32 cost, uint32 parent) {
+	uint64 key = ((uint64)chunkIndex << 32) | nodeIndex;
+	if (nodeIndex == TILE_PATH_GOAL_NODE) {
+		key = TILE_PATH_GOAL_NODE;
+	}
+
+	uint32 hashIndex = (uint32)((key*11400714819323198485ull) >> 32) & search->mHashMask;
+	while ((search->mHash[hashIndex] != TILE_PATH_NO_ENTRY) && (search->mNodes[search->mHash[hashIndex]].mKey != key)) {
+		hashIndex = (hashIndex + 1) & search->mHashMask;
+	}
+
+	tile_path_search_node* node = 0;
+	if (search->mHash[hashIndex] == TILE_PATH_NO_ENTRY) {
+		if (search->mNodeCount < search->mMaxNodeCount) {
+			uint32 searchNodeIndex = search->mNodeCount++;
+			search->mHash[hashIndex] = searchNodeIndex;
+
+			node = &search->mNodes[searchNodeIndex];
+			node->mKey = key;
+			node->mCost = UInt32Max;
+			node->mAbsTileX = absTileX;
+			node->mAbsTileY = absTileY;
+			node->mAbsTileZ = absTileZ;
+			node->mNodeIndex = nodeIndex;
+			node->mHeapIndex = search->mHeapCount;
+			search->mHeap[search->mHeapCount++] = searchNodeIndex;
+		}
+		else {
+			search->mIsOutOfMemory = true;
+		}
+	}
+	else {
+		node = &search->mNodes[search->mHash[hashIndex]];
+	}
+
+	// Closed nodes are final, the estimate never overshoots a Manhattan walk
+	if (node && (node->mHeapIndex != TILE_PATH_NO_ENTRY) && (cost < node->mCost)) {
+		tile_map_location* goal = &search->mGoal;
+		uint32 estimate = (uint32)(GetTileCoordDistance(absTileX, goal->mAbsTileX) +
+								GetTileCoordDistance(absTileY, goal->mAbsTileY) +
+								GetTileCoordDistance(absTileZ, goal->mAbsTileZ));
+		node->mCost = cost;
+		node->mEstimate = cost + estimate;
+		node->mParent = parent;
+		SiftTilePathHeapUp(search, node->mHeapIndex);
+	}
+}
+
+internal void
+AppendTilePathTile(tile_path* path, tile_map_location* tiles, uint32 maxTileCount,
+				   tile_coord absTileX, tile_coord absTileY, uint32 absTileZ) {
+	if (path->mTileCount < maxTileCount) {
+		tiles[path->mTileCount++] = CenteredTilePoint(absTileX, absTileY, absTileZ);
+	}
+	else {
+		path->mIsComplete = false;
+	}
+}
+
+// Walks down the BFS distances from one tile to another inside a chunk, appending every step after the first tile
+internal void
+RefineTilePathSegment(tile_map* tileMap, tile_path_cache* cache, tile_path* path, tile_map_location* tiles, uint32 maxTileCount,
+					  tile_path_search_node* from, tile_path_search_node* to) {
+	memory_areana* scratch = &cache->mScratchArena;
+	memory_index scratchUsed = scratch->mUsed;
+
+	uint32 chunkDim = tileMap->mChunkDim;
+	uint32 tileCount = GetTileChunkTileCount(tileMap);
+	uint8* classes = PushArray(scratch, tileCount, uint8);
+	uint16* distances = PushArray(scratch, tileCount, uint16);
+	uint32* queue = PushArray(scratch, tileCount, uint32);
+
+	tile_chunk_location chunkLoc = GetChunkLocationFor(tileMap, to->mAbsTileX, to->mAbsTileY, to->mAbsTileZ);
+	ReadTilePathClasses(tileMap, (uint32)chunkLoc.mTileChunkX, (uint32)chunkLoc.mTileChunkY, chunkLoc.mTileChunkZ, classes);
+	ComputeTilePathDistances(tileMap, classes, chunkLoc.mRelTileX, chunkLoc.mRelTileY, distances, queue);
+
+	tile_coord minTileX = to->mAbsTileX - chunkLoc.mRelTileX;
+	tile_coord minTileY = to->mAbsTileY - chunkLoc.mRelTileY;
+	uint32 tileX = (uint32)(from->mAbsTileX - minTileX);
+	uint32 tileY = (uint32)(from->mAbsTileY - minTileY);
+	Assert(distances[tileY*chunkDim + tileX] != TILE_PATH_UNREACHABLE);
+
+	while (distances[tileY*chunkDim + tileX] > 0) {
+		uint16 nextDistance = distances[tileY*chunkDim + tileX] - 1;
+		if ((tileX > 0) && (distances[tileY*chunkDim + tileX - 1] == nextDistance)) {
+			--tileX;
+		}
+		else if ((tileX < (chunkDim - 1)) && (distances[tileY*chunkDim + tileX + 1] == nextDistance)) {
+			++tileX;
+		}
+		else if ((tileY > 0) && (distances[(tileY - 1)*chunkDim + tileX] == nextDistance)) {
+			--tileY;
+		}
+		else {
+			Assert((tileY < (chunkDim - 1)) && (distances[(tileY + 1)*chunkDim + tileX] == nextDistance));
+			++tileY;
+		}
+		AppendTilePathTile(path, tiles, maxTileCount, minTileX + tileX, minTileY + tileY, to->mAbsTileZ);
+	}
+
+	scratch->mUsed = scratchUsed;
+}
+
+// Searches the abstract graph of chunk portals and z-doors, then refines only the chunks
+// along the route into tiles. Tiles of chunks that are not loaded count as blocked.
+internal tile_path
+FindTilePath(tile_map* tileMap, tile_path_cache* cache, tile_map_location start, tile_map_location goal,
+			 tile_map_location* tiles, uint32 maxTileCount) {
+	tile_path path = {};
+	path.mIsComplete = true;
+	++cache->mSearchCount;
+
+	tile_chunk_location startLoc = GetChunkLocationFor(tileMap, start.mAbsTileX, start.mAbsTileY, start.mAbsTileZ);
+	tile_chunk_location goalLoc = GetChunkLocationFor(tileMap, goal.mAbsTileX, goal.mAbsTileY, goal.mAbsTileZ);
+	bool32 isInMap = ((startLoc.mTileChunkX < tileMap->mTileChunkCountX) &&
+					(startLoc.mTileChunkY < tileMap->mTileChunkCountY) &&
+					(startLoc.mTileChunkZ < tileMap->mTileChunkCountZ) &&
+					(goalLoc.mTileChunkX < tileMap->mTileChunkCountX) &&
+					(goalLoc.mTileChunkY < tileMap->mTileChunkCountY) &&
+					(goalLoc.mTileChunkZ < tileMap->mTileChunkCountZ));
+	if (!isInMap || !IsTileMapPointEmpty(tileMap, start) || !IsTileMapPointEmpty(tileMap, goal)) {
+		return path;
+	}
+
+	// Endpoints in different regions can never meet, so that is answered without a search
+	if (tileMap->mRegions && !AreTilesConnected(tileMap, start, goal)) {
+		return path;
+	}
+
+	memory_areana* scratch = &cache->mScratchArena;
+	memory_index scratchUsed = scratch->mUsed;
+
+	tile_path_search search = {};
+	search.mMaxNodeCount = cache->mMaxSearchNodeCount;
+	search.mNodes = PushArray(scratch, search.mMaxNodeCount, tile_path_search_node);
+	search.mHeap = PushArray(scratch, search.mMaxNodeCount, uint32);
+	uint32 hashCount = 1;
+	while (hashCount < 2*search.mMaxNodeCount) {
+		hashCount <<= 1;
+	}
+	search.mHash = PushArray(scratch, hashCount, uint32);
+	search.mHashMask = hashCount - 1;
+	for (uint32 hashIndex = 0; hashIndex < hashCount; ++hashIndex) {
+		search.mHash[hashIndex] = TILE_PATH_NO_ENTRY;
+	}
+	search.mGoal = goal;
+
+	uint32 chunkDim = tileMap->mChunkDim;
+	uint32 tileCount = GetTileChunkTileCount(tileMap);
+	uint8* classes = PushArray(scratch, tileCount, uint8);
+	uint16* distances = PushArray(scratch, tileCount, uint16);
+	uint32* queue = PushArray(scratch, tileCount, uint32);
+
+	uint32 startChunkX = (uint32)startLoc.mTileChunkX;
+	uint32 startChunkY = (uint32)startLoc.mTileChunkY;
+	uint32 goalChunkX = (uint32)goalLoc.mTileChunkX;
+	uint32 goalChunkY = (uint32)goalLoc.mTileChunkY;
+	uint32 startChunkIndex = GetTileChunkIndex(tileMap, startChunkX, startChunkY, startLoc.mTileChunkZ);
+	uint32 goalChunkIndex = GetTileChunkIndex(tileMap, goalChunkX, goalChunkY, goalLoc.mTileChunkZ);
+
+	// The goal joins the graph through the nodes of its own chunk
+	uint16* goalNodeDistances = PushArray(scratch, cache->mMaxNodesPerChunk, uint16);
+	tile_path_chunk* goalEntry = GetTilePathChunk(tileMap, cache, goalChunkX, goalChunkY, goalLoc.mTileChunkZ);
+	ReadTilePathClasses(tileMap, goalChunkX, goalChunkY, goalLoc.mTileChunkZ, classes);
+	ComputeTilePathDistances(tileMap, classes, goalLoc.mRelTileX, goalLoc.mRelTileY, distances, queue);
+	for (uint32 nodeIndex = 0; nodeIndex < goalEntry->mNodeCount; ++nodeIndex) {
+		tile_path_node* node = &goalEntry->mNodes[nodeIndex];
+		goalNodeDistances[nodeIndex] = distances[node->mRelTileY*chunkDim + node->mRelTileX];
+	}
+
+	// So does the start, and it reaches the goal directly when they share a chunk
+	tile_coord startMinTileX = start.mAbsTileX - startLoc.mRelTileX;
+	tile_coord startMinTileY = start.mAbsTileY - startLoc.mRelTileY;
+	RelaxTilePathNode(tileMap, &search, startChunkIndex, TILE_PATH_START_NODE,
+		start.mAbsTileX, start.mAbsTileY, start.mAbsTileZ, 0, TILE_PATH_NO_ENTRY);
+	PopCheapestTilePathNode(&search);
+
+	tile_path_chunk* startEntry = GetTilePathChunk(tileMap, cache, startChunkX, startChunkY, startLoc.mTileChunkZ);
+	ReadTilePathClasses(tileMap, startChunkX, startChunkY, startLoc.mTileChunkZ, classes);
+	ComputeTilePathDistances(tileMap, classes, startLoc.mRelTileX, startLoc.mRelTileY, distances, queue);
+	for (uint32 nodeIndex = 0; nodeIndex < startEntry->mNodeCount; ++nodeIndex) {
+		tile_path_node* node = &startEntry->mNodes[nodeIndex];
+		uint16 distance = distances[node->mRelTileY*chunkDim + node->mRelTileX];
+		if (distance != TILE_PATH_UNREACHABLE) {
+			RelaxTilePathNode(tileMap, &search, startChunkIndex, nodeIndex,
+				startMinTileX + node->mRelTileX, startMinTileY + node->mRelTileY, start.mAbsTileZ, distance, 0);
+		}
+	}
+	if ((startChunkIndex == goalChunkIndex) && (distances[goalLoc.mRelTileY*chunkDim + goalLoc.mRelTileX] != TILE_PATH_UNREACHABLE)) {
+		RelaxTilePathNode(tileMap, &search, goalChunkIndex, TILE_PATH_GOAL_NODE,
+			goal.mAbsTileX, goal.mAbsTileY, goal.mAbsTileZ, distances[goalLoc.mRelTileY*chunkDim + goalLoc.mRelTileX], 0);
+	}
+
+	uint32 goalSearchNode = TILE_PATH_NO_ENTRY;
+	while ((search.mHeapCount > 0) && !search.mIsOutOfMemory) {
+		uint32 current = PopCheapestTilePathNode(&search);
+		++path.mExpandedNodeCount;
+
+		tile_path_search_node node = search.mNodes[current];
+		if (node.mNodeIndex == TILE_PATH_GOAL_NODE) {
+			goalSearchNode = current;
+			break;
+		}
+
+		tile_chunk_location chunkLoc = GetChunkLocationFor(tileMap, node.mAbsTileX, node.mAbsTileY, node.mAbsTileZ);
+		uint32 chunkX = (uint32)chunkLoc.mTileChunkX;
+		uint32 chunkY = (uint32)chunkLoc.mTileChunkY;
+		uint32 chunkZ = chunkLoc.mTileChunkZ;
+		uint32 chunkIndex = GetTileChunkIndex(tileMap, chunkX, chunkY, chunkZ);
+		tile_coord minTileX = node.mAbsTileX - chunkLoc.mRelTileX;
+		tile_coord minTileY = node.mAbsTileY - chunkLoc.mRelTileY;
+
+		// Edges inside the chunk come from the cached distances
+		tile_path_chunk* entry = GetTilePathChunk(tileMap, cache, chunkX, chunkY, chunkZ);
+		uint32 nodeCount = entry->mNodeCount;
+		for (uint32 toIndex = 0; toIndex < nodeCount; ++toIndex) {
+			uint16 distance = entry->mDistances[node.mNodeIndex*nodeCount + toIndex];
+			if ((toIndex != node.mNodeIndex) && (distance != TILE_PATH_UNREACHABLE)) {
+				tile_path_node* to = &entry->mNodes[toIndex];
+				RelaxTilePathNode(tileMap, &search, chunkIndex, toIndex,
+					minTileX + to->mRelTileX, minTileY + to->mRelTileY, chunkZ, node.mCost + distance, current);
+			}
+		}
+		if ((chunkIndex == goalChunkIndex) && (goalNodeDistances[node.mNodeIndex] != TILE_PATH_UNREACHABLE)) {
+			RelaxTilePathNode(tileMap, &search, goalChunkIndex, TILE_PATH_GOAL_NODE,
+				goal.mAbsTileX, goal.mAbsTileY, goal.mAbsTileZ, node.mCost + goalNodeDistances[node.mNodeIndex], current);
+		}
+
+		// Getting the neighbor may evict this entry, so nothing of it is used past here
+		uint32 kind = entry->mNodes[node.mNodeIndex].mKind;
+		uint32 toChunkX = chunkX;
+		uint32 toChunkY = chunkY;
+		uint32 toChunkZ = chunkZ;
+		uint32 toRelTileX = chunkLoc.mRelTileX;
+		uint32 toRelTileY = chunkLoc.mRelTileY;
+		uint32 toKind = kind;
+		if (kind == TILE_PATH_NODE_WEST) {
+			--toChunkX;
+			toRelTileX = chunkDim - 1;
+			toKind = TILE_PATH_NODE_EAST;
+		}
+		else if (kind == TILE_PATH_NODE_EAST) {
+			++toChunkX;
+			toRelTileX = 0;
+			toKind = TILE_PATH_NODE_WEST;
+		}
+		else if (kind == TILE_PATH_NODE_SOUTH) {
+			--toChunkY;
+			toRelTileY = chunkDim - 1;
+			toKind = TILE_PATH_NODE_NORTH;
+		}
+		else if (kind == TILE_PATH_NODE_NORTH) {
+			++toChunkY;
+			toRelTileY = 0;
+			toKind = TILE_PATH_NODE_SOUTH;
+		}
+		else if (kind == TILE_PATH_NODE_DOOR_UP) {
+			++toChunkZ;
+			toKind = TILE_PATH_NODE_DOOR_DOWN;
+		}
+		else {
+			--toChunkZ;
+			toKind = TILE_PATH_NODE_DOOR_UP;
+		}
+
+		if ((toChunkX < tileMap->mTileChunkCountX) &&
+			(toChunkY < tileMap->mTileChunkCountY) &&
+			(toChunkZ < tileMap->mTileChunkCountZ)) {
+			tile_path_chunk* toEntry = GetTilePathChunk(tileMap, cache, toChunkX, toChunkY, toChunkZ);
+			uint32 toIndex = FindTilePathNode(toEntry, toRelTileX, toRelTileY, toKind);
+			if (toIndex != TILE_PATH_NO_ENTRY) {
+				tile_coord toMinTileX = (tile_coord)toChunkX << tileMap->mChunkShift;
+				tile_coord toMinTileY = (tile_coord)toChunkY << tileMap->mChunkShift;
+				RelaxTilePathNode(tileMap, &search, GetTileChunkIndex(tileMap, toChunkX, toChunkY, toChunkZ), toIndex,
+					toMinTileX + toRelTileX, toMinTileY + toRelTileY, toChunkZ, node.mCost + 1, current);
+			}
+		}
+	}
+
+	if (goalSearchNode != TILE_PATH_NO_ENTRY) {
+		path.mFound = true;
+
+		// Parents run from the goal back to the start, flip them into the heap array which is free now
+		uint32* route = search.mHeap;
+		uint32 routeCount = 0;
+		for (uint32 searchNode = goalSearchNode; searchNode != TILE_PATH_NO_ENTRY; searchNode = search.mNodes[searchNode].mParent) {
+			route[routeCount++] = searchNode;
+		}
+		path.mAbstractNodeCount = routeCount;
+
+		AppendTilePathTile(&path, tiles, maxTileCount, start.mAbsTileX, start.mAbsTileY, start.mAbsTileZ);
+		for (uint32 routeIndex = routeCount - 1; routeIndex > 0; --routeIndex) {
+			tile_path_search_node* from = &search.mNodes[route[routeIndex]];
+			tile_path_search_node* to = &search.mNodes[route[routeIndex - 1]];
+			if ((from->mAbsTileZ == to->mAbsTileZ) &&
+				((from->mAbsTileX >> tileMap->mChunkShift) == (to->mAbsTileX >> tileMap->mChunkShift)) &&
+				((from->mAbsTileY >> tileMap->mChunkShift) == (to->mAbsTileY >> tileMap->mChunkShift))) {
+				RefineTilePathSegment(tileMap, cache, &path, tiles, maxTileCount, from, to);
+			}
+			else {
+				// Across a border or through a z-door, one step
+				AppendTilePathTile(&path, tiles, maxTileCount, to->mAbsTileX, to->mAbsTileY, to->mAbsTileZ);
+			}
+		}
+	}
+
+	scratch->mUsed = scratchUsed;
+	return path;
+}
+
+internal void
+InitializeTileFlowField(tile_map* tileMap, tile_flow_field* field, memory_areana* arena, uint32 chunkRadius) {
+	field->mChunkRadius = chunkRadius;
+	field->mChunkDiameter = 2*chunkRadius + 1;
+	field->mTileCount = field->mChunkDiameter*field->mChunkDiameter*tileMap->mTileChunkCountZ*GetTileChunkTileCount(tileMap);
+
+	// Distances are 16-bit and no path inside the field can be longer than its tile count
+	Assert(field->mTileCount < TILE_PATH_UNREACHABLE);
+
+	field->mDirections = PushArray(arena, field->mTileCount, uint8);
+	field->mClasses = PushArray(arena, field->mTileCount, uint8);
+	field->mDistances = PushArray(arena, field->mTileCount, uint16);
+	field->mQueue = PushArray(arena, field->mTileCount, uint32);
+
+	field->mIsBuilt = false;
+	field->mRebuildCount = 0;
+	field->mIncrementalUpdateCount = 0;
+	field->mLastUpdateTileCount = 0;
+}
+
+// Field tiles are stored chunk by chunk, and row major inside each chunk
+inline uint32
+GetTileFlowIndex(tile_map* tileMap, tile_flow_field* field, uint32 fieldX, uint32 fieldY, uint32 tileZ) {
+	uint32 chunkBlock = (tileZ*field->mChunkDiameter + (fieldY >> tileMap->mChunkShift))*field->mChunkDiameter + (fieldX >> tileMap->mChunkShift);
+	uint32 result = ((chunkBlock << (2*tileMap->mChunkShift)) |
+					((fieldY & tileMap->mChunkMask) << tileMap->mChunkShift) |
+					(fieldX & tileMap->mChunkMask));
+	return result;
+}
+
+// Field indices of the tiles a path can step to from tileIndex, in TILE_FLOW_WEST to TILE_FLOW_DOWN
+// order, TILE_PATH_NO_ENTRY where the step is blocked or leaves the field
+internal void
+GetTileFlowNeighbors(tile_map* tileMap, tile_flow_field* field, uint32 tileIndex, uint32* neighbors) {
+	uint32 chunkShift = tileMap->mChunkShift;
+	uint32 chunkBlock = tileIndex >> (2*chunkShift);
+	uint32 fieldX = (chunkBlock % field->mChunkDiameter) << chunkShift | (tileIndex & tileMap->mChunkMask);
+	uint32 fieldY = ((chunkBlock / field->mChunkDiameter) % field->mChunkDiameter) << chunkShift | ((tileIndex >> chunkShift) & tileMap->mChunkMask);
+	uint32 tileZ = chunkBlock / (field->mChunkDiameter*field->mChunkDiameter);
+	uint32 fieldSide = field->mChunkDiameter << chunkShift;
+	uint32 tileClass = field->mClasses[tileIndex];
+
+	neighbors[0] = (fieldX > 0) ? GetTileFlowIndex(tileMap, field, fieldX - 1, fieldY, tileZ) : TILE_PATH_NO_ENTRY;
+	neighbors[1] = (fieldX < (fieldSide - 1)) ? GetTileFlowIndex(tileMap, field, fieldX + 1, fieldY, tileZ) : TILE_PATH_NO_ENTRY;
+	neighbors[2] = (fieldY > 0) ? GetTileFlowIndex(tileMap, field, fieldX, fieldY - 1, tileZ) : TILE_PATH_NO_ENTRY;
+	neighbors[3] = (fieldY < (fieldSide - 1)) ? GetTileFlowIndex(tileMap, field, fieldX, fieldY + 1, tileZ) : TILE_PATH_NO_ENTRY;
+	neighbors[4] = (((tileClass == TILE_PATH_CLASS_DOOR_UP) && ((tileZ + 1) < tileMap->mTileChunkCountZ)) ?
+					GetTileFlowIndex(tileMap, field, fieldX, fieldY, tileZ + 1) : TILE_PATH_NO_ENTRY);
+	neighbors[5] = (((tileClass == TILE_PATH_CLASS_DOOR_DOWN) && (tileZ > 0)) ?
+					GetTileFlowIndex(tileMap, field, fieldX, fieldY, tileZ - 1) : TILE_PATH_NO_ENTRY);
+
+	for (uint32 neighborIndex = 0; neighborIndex < 6; ++neighborIndex) {
+		uint32 neighbor = neighbors[neighborIndex];
+		if (neighbor != TILE_PATH_NO_ENTRY) {
+			uint32 neighborClass = field->mClasses[neighbor];
+			bool32 isOpen = ((neighborIndex < 4) ? (neighborClass != TILE_PATH_CLASS_BLOCKED) :
+							(neighborClass == ((neighborIndex == 4) ? TILE_PATH_CLASS_DOOR_DOWN : TILE_PATH_CLASS_DOOR_UP)));
+			if (!tileClass || !isOpen) {
+				neighbors[neighborIndex] = TILE_PATH_NO_ENTRY;
+			}
+		}
+	}
+}
+
+// Spreads distances out from the tiles already queued, only where they get shorter.
+// Returns how many tiles were queued in total, which are exactly the tiles that changed.
+internal uint32
+SpreadTileFlowWave(tile_map* tileMap, tile_flow_field* field, uint32 queueWrite) {
+	uint32 queueRead = 0;
+	while (queueRead < queueWrite) {
+		uint32 tileIndex = field->mQueue[queueRead++];
+		uint16 nextDistance = field->mDistances[tileIndex] + 1;
+
+		uint32 neighbors[6];
+		GetTileFlowNeighbors(tileMap, field, tileIndex, neighbors);
+		for (uint32 neighborIndex = 0; neighborIndex < ArrayCount(neighbors); ++neighborIndex) {
+			uint32 neighbor = neighbors[neighborIndex];
+			if ((neighbor != TILE_PATH_NO_ENTRY) && (nextDistance < field->mDistances[neighbor])) {
+				field->mDistances[neighbor] = nextDistance;
+				field->mQueue[queueWrite++] = neighbor;
+			}
+		}
+	}
+
+	return queueWrite;
+}
+
+internal void
+UpdateTileFlowDirection(tile_map* tileMap, tile_flow_field* field, uint32 tileIndex) {
+	uint32 direction = TILE_FLOW_NONE;
+	uint16 distance = field->mDistances[tileIndex];
+	if (distance == 0) {
+		direction = TILE_FLOW_AT_GOAL;
+	}
+	else if (distance != TILE_PATH_UNREACHABLE) {
+		uint32 neighbors[6];
+		GetTileFlowNeighbors(tileMap, field, tileIndex, neighbors);
+		uint16 bestDistance = distance;
+		for (uint32 neighborIndex = 0; neighborIndex < ArrayCount(neighbors); ++neighborIndex) {
+			uint32 neighbor = neighbors[neighborIndex];
+			if ((neighbor != TILE_PATH_NO_ENTRY) && (field->mDistances[neighbor] < bestDistance)) {
+				bestDistance = field->mDistances[neighbor];
+				direction = TILE_FLOW_WEST + neighborIndex;
+			}
+		}
+	}
+	field->mDirections[tileIndex] = (uint8)direction;
+}
+
+// Index of the location in the field, TILE_PATH_NO_ENTRY when it lies outside
+inline uint32
+GetTileFlowIndexFor(tile_map* tileMap, tile_flow_field* field, tile_map_location location) {
+	uint32 result = TILE_PATH_NO_ENTRY;
+	tile_coord fieldSide = (tile_coord)field->mChunkDiameter << tileMap->mChunkShift;
+	tile_coord fieldX = location.mAbsTileX - (field->mMinChunkX << tileMap->mChunkShift);
+	tile_coord fieldY = location.mAbsTileY - (field->mMinChunkY << tileMap->mChunkShift);
+	if ((fieldX < fieldSide) && (fieldY < fieldSide) && (location.mAbsTileZ < tileMap->mTileChunkCountZ)) {
+		result = GetTileFlowIndex(tileMap, field, (uint32)fieldX, (uint32)fieldY, location.mAbsTileZ);
+	}
+	return result;
+}
+
+// One breadth first wave out from the goal over every floor of the chunks around it
+internal void
+BuildTileFlowField(tile_map* tileMap, tile_flow_field* field, tile_map_location goal) {
+	tile_chunk_location goalLoc = GetChunkLocationFor(tileMap, goal.mAbsTileX, goal.mAbsTileY, goal.mAbsTileZ);
+	field->mMinChunkX = goalLoc.mTileChunkX - field->mChunkRadius;
+	field->mMinChunkY = goalLoc.mTileChunkY - field->mChunkRadius;
+
+	uint32 chunkTileCount = GetTileChunkTileCount(tileMap);
+	for (uint32 chunkZ = 0; chunkZ < tileMap->mTileChunkCountZ; ++chunkZ) {
+		for (uint32 chunkOffsetY = 0; chunkOffsetY < field->mChunkDiameter; ++chunkOffsetY) {
+			for (uint32 chunkOffsetX = 0; chunkOffsetX < field->mChunkDiameter; ++chunkOffsetX) {
+				tile_coord chunkX = field->mMinChunkX + chunkOffsetX;
+				tile_coord chunkY = field->mMinChunkY + chunkOffsetY;
+				uint32 chunkBlock = (chunkZ*field->mChunkDiameter + chunkOffsetY)*field->mChunkDiameter + chunkOffsetX;
+				uint8* classes = field->mClasses + chunkBlock*chunkTileCount;
+				if ((chunkX < tileMap->mTileChunkCountX) && (chunkY < tileMap->mTileChunkCountY)) {
+					ReadTilePathClasses(tileMap, (uint32)chunkX, (uint32)chunkY, chunkZ, classes);
+				}
+				else {
+					for (uint32 tileIndex = 0; tileIndex < chunkTileCount; ++tileIndex) {
+						classes[tileIndex] = 0;
+					}
+				}
+			}
+		}
+	}
+
+	for (uint32 tileIndex = 0; tileIndex < field->mTileCount; ++tileIndex) {
+		field->mDistances[tileIndex] = TILE_PATH_UNREACHABLE;
+	}
+
+	uint32 goalIndex = GetTileFlowIndexFor(tileMap, field, goal);
+	Assert(goalIndex != TILE_PATH_NO_ENTRY);
+	if (field->mClasses[goalIndex]) {
+		field->mDistances[goalIndex] = 0;
+		field->mQueue[0] = goalIndex;
+		SpreadTileFlowWave(tileMap, field, 1);
+	}
+
+	for (uint32 tileIndex = 0; tileIndex < field->mTileCount; ++tileIndex) {
+		UpdateTileFlowDirection(tileMap, field, tileIndex);
+	}
+
+	field->mIsBuilt = true;
+	field->mGoal = goal;
+	++field->mRebuildCount;
+	field->mLastUpdateTileCount = field->mTileCount;
+}
+
+// Moves the goal. Within the same tile only the offset changes, a step to a neighboring tile
+// while the goal stays in the center chunk is repaired in place, anything else rebuilds.
+internal void
+UpdateTileFlowGoal(tile_map* tileMap, tile_flow_field* field, tile_map_location goal) {
+	if (field->mIsBuilt && AreOnSameTile(&field->mGoal, &goal)) {
+		field->mGoal = goal;
+		field->mLastUpdateTileCount = 0;
+		return;
+	}
+
+	bool32 canRepair = false;
+	uint32 oldGoalIndex = TILE_PATH_NO_ENTRY;
+	uint32 newGoalIndex = TILE_PATH_NO_ENTRY;
+	if (field->mIsBuilt) {
+		tile_chunk_location goalLoc = GetChunkLocationFor(tileMap, goal.mAbsTileX, goal.mAbsTileY, goal.mAbsTileZ);
+		oldGoalIndex = GetTileFlowIndexFor(tileMap, field, field->mGoal);
+		newGoalIndex = GetTileFlowIndexFor(tileMap, field, goal);
+		if ((goalLoc.mTileChunkX == (field->mMinChunkX + field->mChunkRadius)) &&
+			(goalLoc.mTileChunkY == (field->mMinChunkY + field->mChunkRadius)) &&
+			(newGoalIndex != TILE_PATH_NO_ENTRY) &&
+			(field->mDistances[oldGoalIndex] == 0)) {
+			uint32 neighbors[6];
+			GetTileFlowNeighbors(tileMap, field, newGoalIndex, neighbors);
+			for (uint32 neighborIndex = 0; neighborIndex < ArrayCount(neighbors); ++neighborIndex) {
+				if (neighbors[neighborIndex] == oldGoalIndex) {
+					canRepair = true;
+				}
+			}
+		}
+	}
+
+	if (canRepair) {
+		// Every route can take one more step onto the new goal, so each distance grows by at most one.
+		// That bound is a flat sweep, the wave then only visits the tiles that got closer.
+		for (uint32 tileIndex = 0; tileIndex < field->mTileCount; ++tileIndex) {
+			if (field->mDistances[tileIndex] != TILE_PATH_UNREACHABLE) {
+				++field->mDistances[tileIndex];
+			}
+		}
+
+		field->mDistances[newGoalIndex] = 0;
+		field->mQueue[0] = newGoalIndex;
+		uint32 changedCount = SpreadTileFlowWave(tileMap, field, 1);
+
+		// A uniform shift keeps every direction. Neighboring distances never differ by more than one,
+		// so a tile whose distance held still keeps a neighbor one closer. Only the changed tiles and the old goal can turn.
+		for (uint32 changedIndex = 0; changedIndex < changedCount; ++changedIndex) {
+			UpdateTileFlowDirection(tileMap, field, field->mQueue[changedIndex]);
+		}
+		UpdateTileFlowDirection(tileMap, field, oldGoalIndex);
+
+		field->mGoal = goal;
+		++field->mIncrementalUpdateCount;
+		field->mLastUpdateTileCount = changedCount;
+	}
+	else {
+		BuildTileFlowField(tileMap, field, goal);
+	}
+}
+
+// Which way to step from the location toward the goal, TILE_FLOW_NONE outside the field or when the goal is unreachable
+inline uint32
+GetTileFlowDirection(tile_map* tileMap, tile_flow_field* field, tile_map_location location) {
+	uint32 result = TILE_FLOW_NONE;
+	if (field->mIsBuilt) {
+		uint32 tileIndex = GetTileFlowIndexFor(tileMap, field, location);
+		if (tileIndex != TILE_PATH_NO_ENTRY) {
+			result = field->mDirections[tileIndex];
+		}
+	}
+	return result;
+}
+
+// Unit vector along a planar direction, zero for the z-door steps and the goal itself
+inline Vector2
+GetTileFlowVector(uint32 direction) {
+	Vector2 result(0.0f, 0.0f);
+	if (direction == TILE_FLOW_WEST) {
+		result.x = -1.0f;
+	}
+	else if (direction == TILE_FLOW_EAST) {
+		result.x = 1.0f;
+	}
+	else if (direction == TILE_FLOW_SOUTH) {
+		result.y = -1.0f;
+	}
+	else if (direction == TILE_FLOW_NORTH) {
+		result.y = 1.0f;
+	}
+	return result;
+}
\ No newline at end of file
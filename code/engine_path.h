@@ -0,0 +1,146 @@
+#if !defined(ENGINE_PATH_H)
+
+/*
+ * Author: Jheremy Strom
+ */
+
+/*
+ * Hierarchical pathfinding over tile chunks. Every chunk gets an abstract graph of
+ * nodes on the tiles where a path can leave it: one portal per run of open tiles
+ * across each border, plus every z-door. Distances between the nodes of a chunk are
+ * found by BFS when the chunk is first needed and cached until one of its tiles, or
+ * a tile across its border, changes how paths can cross it.
+ */
+
+#define TILE_PATH_NODE_WEST 0
+#define TILE_PATH_NODE_EAST 1
+#define TILE_PATH_NODE_SOUTH 2
+#define TILE_PATH_NODE_NORTH 3
+#define TILE_PATH_NODE_DOOR_UP 4
+#define TILE_PATH_NODE_DOOR_DOWN 5
+
+// Doors beyond this many in one chunk are left out of the abstract graph
+#define TILE_PATH_MAX_DOORS_PER_CHUNK 8
+#define TILE_PATH_UNREACHABLE 0xFFFF
+#define TILE_PATH_NO_ENTRY UInt32Max
+
+struct tile_path_node {
+	uint16 mRelTileX;
+	uint16 mRelTileY;
+	uint32 mKind;
+};
+
+struct tile_path_chunk {
+	// Path versions of the chunk and its west, east, south and north neighbors when it was built
+	uint32 mVersions[5];
+	uint32 mChunkIndex;
+
+	uint32 mNodeCount;
+	tile_path_node* mNodes;
+
+	// mNodeCount*mNodeCount tile distances, TILE_PATH_UNREACHABLE between disconnected nodes
+	uint16* mDistances;
+};
+
+struct tile_path_cache {
+	uint32 mMaxNodesPerChunk;
+
+	// Cache entry of every chunk, TILE_PATH_NO_ENTRY when it has none
+	uint32* mEntryIndices;
+	uint32 mEntryCount;
+	uint32 mUsedEntryCount;
+	tile_path_chunk* mEntries;
+
+	// Nodes and distances of every entry, sized to each chunk's node count
+	memory_areana mNodeArena;
+
+	// Searches carve their open set and BFS grids from here and give it all back when done
+	memory_areana mScratchArena;
+	uint32 mMaxSearchNodeCount;
+
+	uint32 mBuildCount;
+	uint32 mFlushCount;
+	uint32 mSearchCount;
+};
+
+struct tile_path_search_node {
+	uint64 mKey;
+	uint32 mParent;
+	uint32 mCost;
+	uint32 mEstimate;
+
+	// Position in the open heap, TILE_PATH_NO_ENTRY once the node is closed
+	uint32 mHeapIndex;
+
+	tile_coord mAbsTileX;
+	tile_coord mAbsTileY;
+	uint32 mAbsTileZ;
+	uint32 mNodeIndex;
+};
+
+struct tile_path_search {
+	tile_path_search_node* mNodes;
+	uint32 mNodeCount;
+	uint32 mMaxNodeCount;
+
+	// Binary heap of open nodes by estimate
+	uint32* mHeap;
+	uint32 mHeapCount;
+
+	// Open addressing from node key to search node
+	uint32* mHash;
+	uint32 mHashMask;
+
+	tile_map_location mGoal;
+	bool32 mIsOutOfMemory;
+};
+
+struct tile_path {
+	bool32 mFound;
+
+	// True when the whole route fit in the caller's tile array
+	bool32 mIsComplete;
+	uint32 mTileCount;
+
+	uint32 mAbstractNodeCount;
+	uint32 mExpandedNodeCount;
+};
+
+/*
+ * Flow fields point every tile within a chunk radius of a shared goal one step closer to it,
+ * so any number of entities heading for the same place can each read their next step in O(1).
+ * Tiles are stored chunk by chunk, one direction byte per tile.
+ */
+#define TILE_FLOW_NONE 0
+#define TILE_FLOW_WEST 1
+#define TILE_FLOW_EAST 2
+#define TILE_FLOW_SOUTH 3
+#define TILE_FLOW_NORTH 4
+#define TILE_FLOW_UP 5
+#define TILE_FLOW_DOWN 6
+#define TILE_FLOW_AT_GOAL 7
+
+struct tile_flow_field {
+	uint32 mChunkRadius;
+	uint32 mChunkDiameter;
+	uint32 mTileCount;
+
+	// The field covers mChunkDiameter^2 chunks around the goal's chunk on every floor
+	tile_coord mMinChunkX;
+	tile_coord mMinChunkY;
+
+	bool32 mIsBuilt;
+	tile_map_location mGoal;
+
+	uint8* mDirections;
+	uint8* mClasses;
+	uint16* mDistances;
+	uint32* mQueue;
+
+	uint32 mRebuildCount;
+	uint32 mIncrementalUpdateCount;
+	uint32 mLastUpdateTileCount;
+};
+
+#define ENGINE_PATH_H
+#endif
\ No newline at end of file
@@ -12,6 +12,10 @@
  * ENGINE_SLOW:
  * 0 - No slow code allowed
  * 1 - Slow code is allowed (can debug)
+ *
+ * ENGINE_BENCH:
+ * 0 - Build the game
+ * 1 - Build engine_bench, with the entry points only the benchmarks call
  */
 
 #ifdef __cplusplus
@@ -39,6 +43,8 @@ extern "C" {
 
 #if COMPILER_MSVC
 #include <intrin.h>
+#else
+#include <x86intrin.h>
 #endif
 
 // TODO Implement sin
@@ -68,6 +74,8 @@ typedef double real64;
 #define Pi32 3.14159265359f
 
 #define UInt32Max 0xFFFFFFFF
+#define Int32Min ((int32)0x80000000)
+#define Real32Maximum 3.402823466e+38f
 
 #if ENGINE_SLOW
 #define Assert(Expression) if(!(Expression)) {*(int*)0 = 0;}
@@ -107,10 +115,10 @@ struct debug_read_file_result {
 	void* mContents;
 };
 
-#define DEBUG_PLATFORM_READ_ENTIRE_FILE(name) debug_read_file_result name(thread_context* thread, char* pFilename)
+#define DEBUG_PLATFORM_READ_ENTIRE_FILE(name) debug_read_file_result name(thread_context* thread, const char* pFilename)
 typedef DEBUG_PLATFORM_READ_ENTIRE_FILE(debug_platform_read_entire_file);
 
-#define DEBUG_PLATFORM_WRITE_ENTIRE_FILE(name) bool32 name(thread_context* thread, char* pFilename, uint32 pMemorySize, void* pMemory)
+#define DEBUG_PLATFORM_WRITE_ENTIRE_FILE(name) bool32 name(thread_context* thread, const char* pFilename, uint32 pMemorySize, void* pMemory)
 typedef DEBUG_PLATFORM_WRITE_ENTIRE_FILE(debug_platform_write_entire_file);
 
 #define DEBUG_PLATFORM_FREE_FILE_MEMORY(name) void name(thread_context* thread, void* pBitmapMemory)
@@ -118,6 +126,120 @@ typedef DEBUG_PLATFORM_FREE_FILE_MEMORY(debug_platform_free_file_memory);
 
 #endif
 
+// A file mapped read/write into the address space. The platform handles are opaque to the game.
+typedef struct platform_mapped_file {
+	uint64 mSize;
+	void* mMemory;
+	bool32 mWasCreated;  // The file did not exist (or was too small) and was grown to the requested size
+
+	void* mPlatformFileHandle;
+	void* mPlatformMapHandle;
+} platform_mapped_file;
+
+// Opens (or creates) the file and maps at least pMinimumSize bytes of it
+#define PLATFORM_MAP_FILE(name) platform_mapped_file name(thread_context* thread, const char* pFilename, uint64 pMinimumSize)
+typedef PLATFORM_MAP_FILE(platform_map_file);
+
+// Writes the dirty pages in the range back to disk
+#define PLATFORM_FLUSH_MAPPED_FILE(name) bool32 name(thread_context* thread, platform_mapped_file* pMappedFile, uint64 pOffset, uint64 pSize)
+typedef PLATFORM_FLUSH_MAPPED_FILE(platform_flush_mapped_file);
+
+#define PLATFORM_UNMAP_FILE(name) void name(thread_context* thread, platform_mapped_file* pMappedFile)
+typedef PLATFORM_UNMAP_FILE(platform_unmap_file);
+
+/*
+ * A read-only view of part of a file. Pages come in from the file cache as they are first touched and
+ * nothing is copied, so a view costs the same to make whatever the size. Writing through it faults.
+ */
+typedef struct platform_file_view {
+	void* mMemory;  // The requested offset, 0 when the view could not be made
+	uint64 mSize;
+
+	// The mapping itself starts on the page (or allocation granularity) boundary at or before mMemory
+	void* mPlatformBase;
+	uint64 mPlatformSize;
+} platform_file_view;
+
+// Hints for how a view is about to be read, they can be combined
+#define PLATFORM_VIEW_ACCESS_NORMAL 0x0
+#define PLATFORM_VIEW_ACCESS_SEQUENTIAL 0x1  // Read front to back once, pages behind the reader can go
+#define PLATFORM_VIEW_ACCESS_WILL_NEED 0x2   // Start paging the whole view in now, in the background
+
+// A size of 0 maps from the offset to the end of the file
+#define PLATFORM_MAP_FILE_VIEW(name) platform_file_view name(thread_context* thread, const char* pFilename, uint64 pOffset, uint64 pSize, uint32 pAccessHints)
+typedef PLATFORM_MAP_FILE_VIEW(platform_map_file_view);
+
+// Starts paging in part of a view without waiting for it, for what is about to be used
+#define PLATFORM_PREFETCH_FILE_VIEW(name) void name(platform_file_view* pView, uint64 pOffset, uint64 pSize)
+typedef PLATFORM_PREFETCH_FILE_VIEW(platform_prefetch_file_view);
+
+#define PLATFORM_UNMAP_FILE_VIEW(name) void name(thread_context* thread, platform_file_view* pView)
+typedef PLATFORM_UNMAP_FILE_VIEW(platform_unmap_file_view);
+
+/*
+ * Reads that never block the caller. The data lands straight in pDest, memory the game owns (usually an
+ * arena), which must be left alone until the fence says the read is done. A fence can cover any number of
+ * reads and is done once its pending count is back to zero. Start fences cleared to zero.
+ */
+typedef struct platform_file_handle {
+	uint64 mSize;
+	bool32 mIsValid;  // False when the file could not be opened
+
+	void* mPlatformHandle;
+} platform_file_handle;
+
+typedef struct platform_read_fence {
+	uint32 volatile mPendingCount;
+	uint32 volatile mFailedCount;  // Reads that hit an error or the end of the file, what they left in pDest is undefined
+} platform_read_fence;
+
+#define PLATFORM_OPEN_FILE(name) platform_file_handle name(thread_context* thread, const char* pFilename)
+typedef PLATFORM_OPEN_FILE(platform_open_file);
+
+// Every read of the file has to be done before it is closed
+#define PLATFORM_CLOSE_FILE(name) void name(thread_context* thread, platform_file_handle* pFile)
+typedef PLATFORM_CLOSE_FILE(platform_close_file);
+
+// Can be called from any thread
+#define PLATFORM_READ_DATA_FROM_FILE(name) void name(platform_file_handle* pFile, uint64 pOffset, uint64 pSize, void* pDest, platform_read_fence* pFence)
+typedef PLATFORM_READ_DATA_FROM_FILE(platform_read_data_from_file);
+
+// Sleeps until every read on the fence is done, returns true when none of them failed
+#define PLATFORM_WAIT_FOR_READS(name) bool32 name(platform_read_fence* pFence)
+typedef PLATFORM_WAIT_FOR_READS(platform_wait_for_reads);
+
+/*
+ * Work queues run callbacks on the platform's worker threads. Entries start in the order they were added
+ * but can finish in any order, on any thread. The game code can be reloaded once the queues are empty,
+ * so the platform completes all work before it swaps the code.
+ */
+typedef struct platform_work_queue platform_work_queue;
+
+#define PLATFORM_WORK_QUEUE_CALLBACK(name) void name(platform_work_queue* pQueue, void* pData)
+typedef PLATFORM_WORK_QUEUE_CALLBACK(platform_work_queue_callback);
+
+// Can be called from any thread, including from inside a callback. A full queue runs the entry right away.
+#define PLATFORM_ADD_ENTRY(name) void name(platform_work_queue* pQueue, platform_work_queue_callback* pCallback, void* pData)
+typedef PLATFORM_ADD_ENTRY(platform_add_entry);
+
+// The calling thread works on the queue until no entry is left unfinished
+#define PLATFORM_COMPLETE_ALL_WORK(name) void name(platform_work_queue* pQueue)
+typedef PLATFORM_COMPLETE_ALL_WORK(platform_complete_all_work);
+
+/*
+ * ParallelFor splits a range between the platform's worker threads. Every worker keeps its own deque of
+ * pieces and takes work from the others when it runs out, so uneven pieces still keep every core busy.
+ * It returns once the whole range is done, and callbacks may call it again for nested ranges.
+ */
+typedef struct platform_scheduler platform_scheduler;
+
+#define PARALLEL_FOR_CALLBACK(name) void name(void* pData, uint32 pBegin, uint32 pEnd)
+typedef PARALLEL_FOR_CALLBACK(parallel_for_callback);
+
+// Pieces are never split below pGrain indices
+#define PLATFORM_PARALLEL_FOR(name) void name(platform_scheduler* pScheduler, uint32 pBegin, uint32 pEnd, uint32 pGrain, parallel_for_callback* pCallback, void* pData)
+typedef PLATFORM_PARALLEL_FOR(platform_parallel_for);
+
 /*
 Services that the game provides to the platform layer
 */
@@ -183,6 +305,9 @@ typedef struct game_input {
 	game_controller_input mControllers[5];
 } game_input;
 
+// Where TIMED_BLOCK stamps go, laid out in engine_debug.h
+typedef struct debug_table debug_table;
+
 typedef struct game_memory {
 	bool32 IsInitialized;
 
@@ -195,6 +320,31 @@ typedef struct game_memory {
 	debug_platform_read_entire_file* DEBUGPlatformReadEntireFile;
 	debug_platform_write_entire_file* DEBUGPlatformWriteEntireFile;
 	debug_platform_free_file_memory* DEBUGPlatformFreeFileMemory;
+
+	platform_map_file* PlatformMapFile;
+	platform_flush_mapped_file* PlatformFlushMappedFile;
+	platform_unmap_file* PlatformUnmapFile;
+
+	platform_map_file_view* PlatformMapFileView;
+	platform_prefetch_file_view* PlatformPrefetchFileView;
+	platform_unmap_file_view* PlatformUnmapFileView;
+
+	platform_open_file* PlatformOpenFile;
+	platform_close_file* PlatformCloseFile;
+	platform_read_data_from_file* PlatformReadDataFromFile;
+	platform_wait_for_reads* PlatformWaitForReads;
+
+	// High priority work is waited on within the frame, low priority work (loads, generation) can span frames
+	platform_work_queue* mHighPriorityQueue;
+	platform_work_queue* mLowPriorityQueue;
+	platform_add_entry* PlatformAddEntry;
+	platform_complete_all_work* PlatformCompleteAllWork;
+
+	platform_scheduler* mScheduler;
+	platform_parallel_for* PlatformParallelFor;
+
+	// Null when the platform does not collect TIMED_BLOCK stamps
+	debug_table* mDebugTable;
 } game_memory;
 
 #define GAME_UPDATE_AND_RENDER(name) void name(thread_context* thread, game_memory* pMemory, game_input* pInput, game_offscreen_buffer* pScreenBuffer)
@@ -204,6 +354,29 @@ typedef GAME_UPDATE_AND_RENDER(game_update_and_render);
 #define GAME_GET_SOUND_SAMPLES(name) void name(thread_context* thread, game_memory* pMemory, game_sound_output_buffer* pSoundBuffer)
 typedef GAME_GET_SOUND_SAMPLES(game_get_sound_samples);
 
+// Runs the whole range on the calling thread when the platform has no scheduler
+inline void
+ParallelFor(game_memory* pMemory, uint32 pBegin, uint32 pEnd, uint32 pGrain, parallel_for_callback* pCallback, void* pData) {
+	if (pMemory && pMemory->mScheduler) {
+		pMemory->PlatformParallelFor(pMemory->mScheduler, pBegin, pEnd, pGrain, pCallback, pData);
+	}
+	else if (pBegin < pEnd) {
+		pCallback(pData, pBegin, pEnd);
+	}
+}
+
+// For polling once a frame, the data the reads brought in can be used once this returns true
+inline bool32
+IsReadFenceDone(platform_read_fence* pFence) {
+	bool32 result = (pFence->mPendingCount == 0);
+#if COMPILER_MSVC
+	_ReadBarrier();
+#else
+	asm volatile("" ::: "memory");
+#endif
+	return result;
+}
+
 inline game_controller_input* GetController(game_input* pInput, unsigned int pControllerIndex) {
 	Assert(pControllerIndex < ArrayCount(pInput->mControllers));
 	return &pInput->mControllers[pControllerIndex];
@@ -0,0 +1,287 @@
+/*
+ * Author: Jheremy Strom
+ */
+
+// Crossing times along one axis, in fractions of the ray: tMax to the first tile edge, tDelta between edges
+inline void
+GetTileRayAxis(real32 offset, real32 delta, real32 tileSideInMeters, int32* step, real32* tMax, real32* tDelta) {
+	// Position inside the start tile, 0 at its low edge and 1 at its high edge
+	real32 fraction = offset/tileSideInMeters + 0.5f;
+	real32 tiles = delta/tileSideInMeters;
+
+	if (tiles > 0.0f) {
+		*step = 1;
+		*tDelta = 1.0f/tiles;
+		*tMax = (1.0f - fraction)*(*tDelta);
+	}
+	else if (tiles < 0.0f) {
+		*step = -1;
+		*tDelta = -1.0f/tiles;
+		*tMax = fraction*(*tDelta);
+	}
+	else {
+		*step = 0;
+		*tDelta = TILE_RAY_NEVER;
+		*tMax = TILE_RAY_NEVER;
+	}
+}
+
+// Walks the ray tile by tile. Only crossing into another chunk looks the chunk up again,
+// every other step reads the packed tile straight out of the chunk it is already in.
+internal tile_ray_hit
+TraceTileRay(tile_map* tileMap, tile_map_location start, Vector2 delta) {
+	tile_ray_hit result = {};
+
+	int32 stepX, stepY;
+	real32 tMaxX, tMaxY, tDeltaX, tDeltaY;
+	GetTileRayAxis(start.mOffset.x, delta.x, tileMap->mTileSideInMeters, &stepX, &tMaxX, &tDeltaX);
+	GetTileRayAxis(start.mOffset.y, delta.y, tileMap->mTileSideInMeters, &stepY, &tMaxY, &tDeltaY);
+
+	tile_coord tileX = start.mAbsTileX;
+	tile_coord tileY = start.mAbsTileY;
+	tile_chunk_location chunkLoc = GetChunkLocationFor(tileMap, tileX, tileY, start.mAbsTileZ);
+	tile_chunk* tileChunk = GetTileChunk(tileMap, chunkLoc.mTileChunkX, chunkLoc.mTileChunkY, chunkLoc.mTileChunkZ);
+	uint32 relTileX = chunkLoc.mRelTileX;
+	uint32 relTileY = chunkLoc.mRelTileY;
+
+	real32 t = 0.0f;
+	for (;;) {
+		uint32 tileValue = GetTileValue(tileMap, tileChunk, relTileX, relTileY);
+		++result.mTileStepCount;
+		if (IsTileLightBlocking(tileMap, tileValue)) {
+			result.mHit = true;
+			result.mTileValue = tileValue;
+			break;
+		}
+
+		// Ties step along Y, the batch tracer breaks them the same way
+		if (tMaxX < tMaxY) {
+			if (tMaxX > 1.0f) {
+				break;
+			}
+			t = tMaxX;
+			tMaxX += tDeltaX;
+			tileX += stepX;
+			relTileX += stepX;
+			result.mNormal = Vector2((real32)-stepX, 0.0f);
+		}
+		else {
+			if (tMaxY > 1.0f) {
+				break;
+			}
+			t = tMaxY;
+			tMaxY += tDeltaY;
+			tileY += stepY;
+			relTileY += stepY;
+			result.mNormal = Vector2(0.0f, (real32)-stepY);
+		}
+
+		// Stepping below zero wraps the relative tile past the mask as well
+		if ((relTileX > tileMap->mChunkMask) || (relTileY > tileMap->mChunkMask)) {
+			chunkLoc = GetChunkLocationFor(tileMap, tileX, tileY, start.mAbsTileZ);
+			tileChunk = GetTileChunk(tileMap, chunkLoc.mTileChunkX, chunkLoc.mTileChunkY, chunkLoc.mTileChunkZ);
+			relTileX = chunkLoc.mRelTileX;
+			relTileY = chunkLoc.mRelTileY;
+		}
+	}
+
+	result.mT = result.mHit ? t : 1.0f;
+	result.mTile = CenteredTilePoint(tileX, tileY, start.mAbsTileZ);
+
+	return result;
+}
+
+// Points on different floors never see each other
+internal bool32
+HasTileLineOfSight(tile_map* tileMap, tile_map_location from, tile_map_location to) {
+	bool32 result = false;
+	if (from.mAbsTileZ == to.mAbsTileZ) {
+		tile_map_difference difference = Subtract(tileMap, &to, &from);
+		tile_ray_hit hit = TraceTileRay(tileMap, from, Vector2(difference.mVector.x, difference.mVector.y));
+		result = !hit.mHit;
+	}
+	return result;
+}
+
+// The game traces its few rays one at a time, only engine_bench runs them in batches
+#if ENGINE_BENCH
+internal void
+InitializeTileSightGrid(tile_map* tileMap, tile_sight_grid* grid, memory_areana* arena, uint32 chunkRadius) {
+	grid->mChunkRadius = chunkRadius;
+	grid->mSide = (2*chunkRadius + 1) << tileMap->mChunkShift;
+	grid->mStrideShift = 0;
+	while ((1u << grid->mStrideShift) < grid->mSide) {
+		++grid->mStrideShift;
+	}
+	grid->mTiles = PushArray(arena, (memory_index)grid->mSide << grid->mStrideShift, uint8);
+}
+
+// Copies the tiles of every chunk within the grid's radius of the center chunk
+internal void
+UpdateTileSightGrid(tile_map* tileMap, tile_sight_grid* grid, tile_map_location center) {
+	tile_chunk_location centerLoc = GetChunkLocationFor(tileMap, center.mAbsTileX, center.mAbsTileY, center.mAbsTileZ);
+	tile_coord minChunkX = centerLoc.mTileChunkX - grid->mChunkRadius;
+	tile_coord minChunkY = centerLoc.mTileChunkY - grid->mChunkRadius;
+	grid->mMinTileX = minChunkX << tileMap->mChunkShift;
+	grid->mMinTileY = minChunkY << tileMap->mChunkShift;
+	grid->mAbsTileZ = center.mAbsTileZ;
+
+	uint32 chunkDim = tileMap->mChunkDim;
+	uint32 chunkDiameter = 2*grid->mChunkRadius + 1;
+	for (uint32 chunkOffsetY = 0; chunkOffsetY < chunkDiameter; ++chunkOffsetY) {
+		for (uint32 chunkOffsetX = 0; chunkOffsetX < chunkDiameter; ++chunkOffsetX) {
+			tile_chunk* tileChunk = GetTileChunk(tileMap, minChunkX + chunkOffsetX, minChunkY + chunkOffsetY, center.mAbsTileZ);
+			for (uint32 tileY = 0; tileY < chunkDim; ++tileY) {
+				uint8* row = grid->mTiles + ((((chunkOffsetY*chunkDim) + tileY) << grid->mStrideShift) + chunkOffsetX*chunkDim);
+				for (uint32 tileX = 0; tileX < chunkDim; ++tileX) {
+					uint32 tileValue = GetTileValue(tileMap, tileChunk, tileX, tileY);
+					row[tileX] = (tileValue <= 0xFF) ? (uint8)tileValue : 0;
+				}
+			}
+		}
+	}
+}
+
+// Traces the rays TILE_RAY_LANE_COUNT at a time against the sight grid, each SSE lane running its
+// own traversal until every lane has hit something or run out of ray. Rays that start off the grid
+// or on another floor come back as hits at their start; rays that leave the grid stop at its edge.
+// Stepping matches TraceTileRay exactly, so both agree on every tile and crossing time.
+internal void
+TraceTileSightRays(tile_map* tileMap, tile_sight_grid* grid, tile_ray* rays, uint32 rayCount, tile_ray_hit* hits) {
+	__m128i minusOne = _mm_set1_epi32(-1);
+	__m128i side = _mm_set1_epi32((int32)grid->mSide);
+	__m128i strideShift = _mm_cvtsi32_si128((int32)grid->mStrideShift);
+	__m128i opaqueFlag = _mm_set1_epi32(TILE_TYPE_OPAQUE);
+	tile_type* types = tileMap->mTypes;
+	__m128 one = _mm_set1_ps(1.0f);
+
+	for (uint32 firstRay = 0; firstRay < rayCount; firstRay += TILE_RAY_LANE_COUNT) {
+		int32 laneTileX[TILE_RAY_LANE_COUNT];
+		int32 laneTileY[TILE_RAY_LANE_COUNT];
+		int32 laneStepX[TILE_RAY_LANE_COUNT];
+		int32 laneStepY[TILE_RAY_LANE_COUNT];
+		real32 laneTMaxX[TILE_RAY_LANE_COUNT];
+		real32 laneTMaxY[TILE_RAY_LANE_COUNT];
+		real32 laneTDeltaX[TILE_RAY_LANE_COUNT];
+		real32 laneTDeltaY[TILE_RAY_LANE_COUNT];
+		int32 laneActive[TILE_RAY_LANE_COUNT];
+
+		for (uint32 lane = 0; lane < TILE_RAY_LANE_COUNT; ++lane) {
+			laneTileX[lane] = -1;
+			laneTileY[lane] = -1;
+			laneStepX[lane] = 0;
+			laneStepY[lane] = 0;
+			laneTMaxX[lane] = TILE_RAY_NEVER;
+			laneTMaxY[lane] = TILE_RAY_NEVER;
+			laneTDeltaX[lane] = TILE_RAY_NEVER;
+			laneTDeltaY[lane] = TILE_RAY_NEVER;
+			laneActive[lane] = 0;
+
+			uint32 rayIndex = firstRay + lane;
+			if (rayIndex < rayCount) {
+				tile_ray* ray = rays + rayIndex;
+				GetTileRayAxis(ray->mStart.mOffset.x, ray->mDelta.x, tileMap->mTileSideInMeters,
+					&laneStepX[lane], &laneTMaxX[lane], &laneTDeltaX[lane]);
+				GetTileRayAxis(ray->mStart.mOffset.y, ray->mDelta.y, tileMap->mTileSideInMeters,
+					&laneStepY[lane], &laneTMaxY[lane], &laneTDeltaY[lane]);
+
+				tile_coord gridX = ray->mStart.mAbsTileX - grid->mMinTileX;
+				tile_coord gridY = ray->mStart.mAbsTileY - grid->mMinTileY;
+				if ((gridX < grid->mSide) && (gridY < grid->mSide) && (ray->mStart.mAbsTileZ == grid->mAbsTileZ)) {
+					laneTileX[lane] = (int32)gridX;
+					laneTileY[lane] = (int32)gridY;
+				}
+				laneActive[lane] = -1;
+			}
+		}
+
+		__m128i tileX = _mm_loadu_si128((__m128i*)laneTileX);
+		__m128i tileY = _mm_loadu_si128((__m128i*)laneTileY);
+		__m128i stepX = _mm_loadu_si128((__m128i*)laneStepX);
+		__m128i stepY = _mm_loadu_si128((__m128i*)laneStepY);
+		__m128 tMaxX = _mm_loadu_ps(laneTMaxX);
+		__m128 tMaxY = _mm_loadu_ps(laneTMaxY);
+		__m128 tDeltaX = _mm_loadu_ps(laneTDeltaX);
+		__m128 tDeltaY = _mm_loadu_ps(laneTDeltaY);
+		__m128i active = _mm_loadu_si128((__m128i*)laneActive);
+
+		__m128 t = _mm_setzero_ps();
+		__m128i hit = _mm_setzero_si128();
+		__m128i hitValue = _mm_setzero_si128();
+		__m128i stepCount = _mm_setzero_si128();
+		__m128i lastMoveX = _mm_setzero_si128();
+
+		while (_mm_movemask_epi8(active)) {
+			__m128i inside = _mm_and_si128(
+				_mm_and_si128(_mm_cmpgt_epi32(tileX, minusOne), _mm_cmplt_epi32(tileX, side)),
+				_mm_and_si128(_mm_cmpgt_epi32(tileY, minusOne), _mm_cmplt_epi32(tileY, side)));
+			__m128i tileIndex = _mm_and_si128(_mm_add_epi32(_mm_sll_epi32(tileY, strideShift), tileX), inside);
+
+			// SSE2 has no gather, so the four tile bytes and their types are fetched one lane at a time.
+			// Grid bytes are whole tile values, which always index the type table.
+			int32 laneIndex[TILE_RAY_LANE_COUNT];
+			_mm_storeu_si128((__m128i*)laneIndex, tileIndex);
+			uint8 laneValue[TILE_RAY_LANE_COUNT] = {grid->mTiles[laneIndex[0]], grid->mTiles[laneIndex[1]],
+													grid->mTiles[laneIndex[2]], grid->mTiles[laneIndex[3]]};
+			__m128i value = _mm_setr_epi32(laneValue[0], laneValue[1], laneValue[2], laneValue[3]);
+			value = _mm_and_si128(value, inside);
+			__m128i flags = _mm_setr_epi32(types[laneValue[0]].mFlags, types[laneValue[1]].mFlags,
+										   types[laneValue[2]].mFlags, types[laneValue[3]].mFlags);
+
+			__m128i isClear = _mm_andnot_si128(_mm_cmpeq_epi32(_mm_and_si128(flags, opaqueFlag), opaqueFlag), inside);
+			__m128i newHit = _mm_andnot_si128(isClear, active);
+			stepCount = _mm_sub_epi32(stepCount, active);
+			hit = _mm_or_si128(hit, newHit);
+			hitValue = _mm_or_si128(hitValue, _mm_and_si128(newHit, value));
+			active = _mm_andnot_si128(newHit, active);
+
+			__m128i moveX = _mm_castps_si128(_mm_cmplt_ps(tMaxX, tMaxY));
+			__m128 tNext = _mm_min_ps(tMaxX, tMaxY);
+			active = _mm_andnot_si128(_mm_castps_si128(_mm_cmpgt_ps(tNext, one)), active);
+
+			__m128i activeMoveX = _mm_and_si128(moveX, active);
+			__m128i activeMoveY = _mm_andnot_si128(moveX, active);
+			tileX = _mm_add_epi32(tileX, _mm_and_si128(activeMoveX, stepX));
+			tileY = _mm_add_epi32(tileY, _mm_and_si128(activeMoveY, stepY));
+			tMaxX = _mm_add_ps(tMaxX, _mm_and_ps(_mm_castsi128_ps(activeMoveX), tDeltaX));
+			tMaxY = _mm_add_ps(tMaxY, _mm_and_ps(_mm_castsi128_ps(activeMoveY), tDeltaY));
+
+			__m128 activeMask = _mm_castsi128_ps(active);
+			t = _mm_or_ps(_mm_and_ps(activeMask, tNext), _mm_andnot_ps(activeMask, t));
+			lastMoveX = _mm_or_si128(activeMoveX, _mm_andnot_si128(active, lastMoveX));
+		}
+
+		int32 laneHit[TILE_RAY_LANE_COUNT];
+		int32 laneHitValue[TILE_RAY_LANE_COUNT];
+		int32 laneStepCount[TILE_RAY_LANE_COUNT];
+		int32 laneLastMoveX[TILE_RAY_LANE_COUNT];
+		real32 laneT[TILE_RAY_LANE_COUNT];
+		_mm_storeu_si128((__m128i*)laneTileX, tileX);
+		_mm_storeu_si128((__m128i*)laneTileY, tileY);
+		_mm_storeu_si128((__m128i*)laneHit, hit);
+		_mm_storeu_si128((__m128i*)laneHitValue, hitValue);
+		_mm_storeu_si128((__m128i*)laneStepCount, stepCount);
+		_mm_storeu_si128((__m128i*)laneLastMoveX, lastMoveX);
+		_mm_storeu_ps(laneT, t);
+
+		for (uint32 lane = 0; (lane < TILE_RAY_LANE_COUNT) && ((firstRay + lane) < rayCount); ++lane) {
+			tile_ray* ray = rays + firstRay + lane;
+			tile_ray_hit* result = hits + firstRay + lane;
+
+			result->mHit = (laneHit[lane] != 0);
+			result->mT = result->mHit ? laneT[lane] : 1.0f;
+			result->mTileValue = (uint32)laneHitValue[lane];
+			result->mTileStepCount = (uint32)laneStepCount[lane];
+
+			if (laneStepCount[lane] <= 1) {
+				result->mTile = CenteredTilePoint(ray->mStart.mAbsTileX, ray->mStart.mAbsTileY, ray->mStart.mAbsTileZ);
+				result->mNormal = Vector2(0.0f, 0.0f);
+			}
+			else {
+				result->mTile = CenteredTilePoint(grid->mMinTileX + laneTileX[lane], grid->mMinTileY + laneTileY[lane], grid->mAbsTileZ);
+				result->mNormal = laneLastMoveX[lane] ? Vector2((real32)-laneStepX[lane], 0.0f) : Vector2(0.0f, (real32)-laneStepY[lane]);
+			}
+		}
+	}
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+#if !defined(ENGINE_RAY_H)
+
+/*
+ * Author: Jheremy Strom
+ */
+
+/*
+ * Rays walk the tile grid of one floor with the Amanatides-Woo traversal, visiting every
+ * tile the segment touches in order. A ray stops on the first opaque tile, the same tiles
+ * that stop light and field of view, and unloaded tiles or tiles off the map stop it too.
+ */
+
+#include <emmintrin.h>
+
+// Stands in for the crossing time of an axis the ray never moves along
+#define TILE_RAY_NEVER 1.0e30f
+
+// The batch tracer runs this many rays side by side, one per SSE lane
+#define TILE_RAY_LANE_COUNT 4
+
+struct tile_ray {
+	tile_map_location mStart;
+
+	// Whole length of the ray in meters, in the plane of the start floor
+	Vector2 mDelta;
+};
+
+struct tile_ray_hit {
+	bool32 mHit;
+
+	// Fraction of the ray traveled when it entered the blocking tile, 1 when it got through
+	real32 mT;
+
+	// Blocking tile, or the last tile the ray reached
+	tile_map_location mTile;
+	uint32 mTileValue;
+
+	// Side of the blocking tile the ray came through, zero when it started inside it
+	Vector2 mNormal;
+	uint32 mTileStepCount;
+};
+
+// Tile values of a square of chunks on one floor, copied out once so batches of rays
+// read plain bytes instead of unpacking chunks. Rows are padded to a power of two.
+struct tile_sight_grid {
+	uint32 mChunkRadius;
+	uint32 mSide;
+	uint32 mStrideShift;
+
+	tile_coord mMinTileX;
+	tile_coord mMinTileY;
+	uint32 mAbsTileZ;
+
+	// Tile values clamped to a byte, zero for unloaded tiles and tiles off the map
+	uint8* mTiles;
+};
+
+#define ENGINE_RAY_H
+#endif
\ No newline at end of file
@@ -0,0 +1,495 @@
+/*
+ * Author: Jheremy Strom
+ */
+
+// Queues the chunk to be relabeled on the next query when paths across it may have changed.
+// Closing can split a region, which the union-find cannot undo, so the chunk also remembers
+// to split what it was part of. Evicted chunks keep their labels.
+internal TILE_CHUNK_CHANGED(TileRegionChunkChanged) {
+	tile_region_map* regions = (tile_region_map*)subscriberData;
+	if (!regions->mNeedsRebuild && DoesTileChangeMovePaths(change)) {
+		tile_region_chunk* regionChunk = regions->mChunks + change->mChunkIndex;
+		bool32 mayDisconnect = MayTileChangeDisconnect(change);
+		if (regionChunk->mIsPending) {
+			regionChunk->mMayDisconnect |= mayDisconnect;
+		}
+		else if (regions->mPendingCount == TILE_REGION_MAX_PENDING_CHUNKS) {
+			regions->mNeedsRebuild = true;
+		}
+		else {
+			regionChunk->mIsPending = true;
+			regionChunk->mMayDisconnect = mayDisconnect;
+			regions->mPendingChunks[regions->mPendingCount++] = change->mChunkIndex;
+		}
+	}
+}
+
+internal void
+InitializeTileRegionMap(tile_map* tileMap, tile_region_map* regions, memory_areana* arena,
+						uint32 maxRegionCount, memory_index labelStorageSize) {
+	uint32 chunkCount = GetTileChunkCount(tileMap);
+	uint32 tileCount = GetTileChunkTileCount(tileMap);
+	Assert(tileCount <= 2*TILE_REGION_LABEL_MASK);
+
+	regions->mChunks = PushArray(arena, chunkCount, tile_region_chunk);
+	for (uint32 chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+		tile_region_chunk* regionChunk = regions->mChunks + chunkIndex;
+		regionChunk->mIsLabeled = false;
+		regionChunk->mIsPending = false;
+		regionChunk->mMayDisconnect = false;
+		regionChunk->mIsSplit = false;
+		regionChunk->mLabels = 0;
+		regionChunk->mRegionCount = 0;
+		regionChunk->mDoorCount = 0;
+		regionChunk->mUniformClass = TILE_PATH_CLASS_BLOCKED;
+		regionChunk->mFirstRegion = 0;
+	}
+
+	// Morton order pads the chunk array, so coordinates are filled in from the chunk side
+	for (uint32 chunkZ = 0; chunkZ < tileMap->mTileChunkCountZ; ++chunkZ) {
+		for (uint32 chunkY = 0; chunkY < tileMap->mTileChunkCountY; ++chunkY) {
+			for (uint32 chunkX = 0; chunkX < tileMap->mTileChunkCountX; ++chunkX) {
+				tile_region_chunk* regionChunk = regions->mChunks + GetTileChunkIndex(tileMap, chunkX, chunkY, chunkZ);
+				regionChunk->mChunkX = chunkX;
+				regionChunk->mChunkY = chunkY;
+				regionChunk->mChunkZ = chunkZ;
+			}
+		}
+	}
+
+	regions->mParents = PushArray(arena, maxRegionCount, uint32);
+	regions->mSplitRoots = PushArray(arena, maxRegionCount, uint8);
+	for (uint32 region = 0; region < maxRegionCount; ++region) {
+		regions->mSplitRoots[region] = false;
+	}
+	regions->mRegionCount = 0;
+	regions->mMaxRegionCount = maxRegionCount;
+	regions->mPendingCount = 0;
+	regions->mNeedsRebuild = true;
+
+	InitializeArena(&regions->mLabelArena, labelStorageSize, (uint8*)PushSize_(arena, labelStorageSize));
+	regions->mFirstFreeLabels = 0;
+
+	regions->mClasses = PushArray(arena, tileCount, uint8);
+	regions->mStack = PushArray(arena, tileCount, uint32);
+
+	regions->mRebuildCount = 0;
+	regions->mPatchCount = 0;
+	regions->mSplitCount = 0;
+	regions->mLabelCount = 0;
+
+	tileMap->mRegions = regions;
+	regions->mSubscriberIndex = SubscribeToTileChanges(tileMap, TileRegionChunkChanged, regions);
+}
+
+inline uint32
+GetTileRegionLabel(tile_map* tileMap, tile_region_chunk* regionChunk, uint32 relTileX, uint32 relTileY) {
+	uint32 result = regionChunk->mRegionCount;
+	if (regionChunk->mLabels) {
+		result = regionChunk->mLabels[relTileY*tileMap->mChunkDim + relTileX] & TILE_REGION_LABEL_MASK;
+	}
+	return result;
+}
+
+// Path class of the tile when the chunk was labeled, only z-doors are told apart from other open tiles
+inline uint32
+GetTileRegionPathClass(tile_map* tileMap, tile_region_chunk* regionChunk, uint32 relTileX, uint32 relTileY) {
+	uint32 result = regionChunk->mUniformClass;
+	if (regionChunk->mLabels) {
+		uint32 label = regionChunk->mLabels[relTileY*tileMap->mChunkDim + relTileX];
+		if (label & TILE_REGION_DOOR_UP) {
+			result = TILE_PATH_CLASS_DOOR_UP;
+		}
+		else if (label & TILE_REGION_DOOR_DOWN) {
+			result = TILE_PATH_CLASS_DOOR_DOWN;
+		}
+		else {
+			result = label ? TILE_PATH_CLASS_OPEN : TILE_PATH_CLASS_BLOCKED;
+		}
+	}
+	return result;
+}
+
+// Path halving keeps the trees flat without a second pass
+inline uint32
+FindTileRegionRoot(tile_region_map* regions, uint32 region) {
+	while (regions->mParents[region] != region) {
+		regions->mParents[region] = regions->mParents[regions->mParents[region]];
+		region = regions->mParents[region];
+	}
+	return region;
+}
+
+// Older slots stay the roots, so chunks that did not change keep their region ids
+inline void
+JoinTileRegions(tile_region_map* regions, uint32 a, uint32 b) {
+	uint32 rootA = FindTileRegionRoot(regions, a);
+	uint32 rootB = FindTileRegionRoot(regions, b);
+	if (rootA < rootB) {
+		regions->mParents[rootB] = rootA;
+	}
+	else if (rootB < rootA) {
+		regions->mParents[rootA] = rootB;
+	}
+}
+
+// Flood fills the chunk's open tiles into labels. Unloaded chunks are labeled from their world file
+// record, the tiles they will page back in with. Chunks that were never written have no open tiles.
+internal void
+LabelTileRegionChunk(tile_map* tileMap, tile_region_map* regions, tile_region_chunk* regionChunk) {
+	tile_chunk* tileChunk = GetTileChunk(tileMap, regionChunk->mChunkX, regionChunk->mChunkY, regionChunk->mChunkZ);
+	uint32 chunkDim = tileMap->mChunkDim;
+	uint32 tileCount = GetTileChunkTileCount(tileMap);
+
+	uint32* record = 0;
+	tile_chunk_stream* stream = tileMap->mStream;
+	if (!IsTileChunkLoaded(tileChunk) && stream) {
+		uint32 recordIndex = stream->mDirectory[tileChunk - tileMap->mTileChunks];
+		if (recordIndex != WORLD_FILE_NO_RECORD) {
+			record = GetWorldFileRecord(stream, recordIndex);
+		}
+	}
+
+	// One bit per path class found, a single bit means the chunk needs no labels
+	uint32 classMask = (1 << TILE_PATH_CLASS_BLOCKED);
+	uint32 openCount = 0;
+	regionChunk->mDoorCount = 0;
+	if (IsTileChunkLoaded(tileChunk) && !tileChunk->mCompressed && (tileChunk->mBitsPerTile == 0)) {
+		// Uniform chunks skip the per tile reads, all of their tiles share one class
+		uint32 pathClass = GetTilePathClass(tileMap, tileChunk->mPalette[0]);
+		classMask = (1 << pathClass);
+		openCount = pathClass ? tileCount : 0;
+		regionChunk->mDoorCount = (pathClass > TILE_PATH_CLASS_OPEN) ? tileCount : 0;
+	}
+	else if (IsTileChunkLoaded(tileChunk) || record) {
+		classMask = 0;
+		for (uint32 tileY = 0; tileY < chunkDim; ++tileY) {
+			for (uint32 tileX = 0; tileX < chunkDim; ++tileX) {
+				uint32 tileValue = record ? record[tileY*chunkDim + tileX] : GetTileValue(tileMap, tileChunk, tileX, tileY);
+				uint32 pathClass = GetTilePathClass(tileMap, tileValue);
+				regions->mClasses[tileY*chunkDim + tileX] = (uint8)pathClass;
+				classMask |= (1 << pathClass);
+				openCount += pathClass ? 1 : 0;
+				regionChunk->mDoorCount += (pathClass > TILE_PATH_CLASS_OPEN) ? 1 : 0;
+			}
+		}
+	}
+
+	if ((classMask & (classMask - 1)) == 0) {
+		if (regionChunk->mLabels) {
+			*(void**)regionChunk->mLabels = regions->mFirstFreeLabels;
+			regions->mFirstFreeLabels = regionChunk->mLabels;
+			regionChunk->mLabels = 0;
+		}
+		regionChunk->mRegionCount = openCount ? 1 : 0;
+		regionChunk->mUniformClass = FindLeastSignificantSetBit(classMask).mIndex;
+	}
+	else {
+		if (!regionChunk->mLabels) {
+			if (regions->mFirstFreeLabels) {
+				regionChunk->mLabels = (uint16*)regions->mFirstFreeLabels;
+				regions->mFirstFreeLabels = *(void**)regions->mFirstFreeLabels;
+			}
+			else {
+				regionChunk->mLabels = PushArray(&regions->mLabelArena, tileCount, uint16);
+			}
+		}
+
+		uint16* labels = regionChunk->mLabels;
+		for (uint32 tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
+			labels[tileIndex] = 0;
+		}
+
+		uint32 regionCount = 0;
+		for (uint32 seedIndex = 0; seedIndex < tileCount; ++seedIndex) {
+			if (regions->mClasses[seedIndex] && !labels[seedIndex]) {
+				uint16 label = (uint16)++regionCount;
+				uint32 stackCount = 0;
+				labels[seedIndex] = label;
+				regions->mStack[stackCount++] = seedIndex;
+				while (stackCount) {
+					uint32 tileIndex = regions->mStack[--stackCount];
+					uint32 tileX = tileIndex & tileMap->mChunkMask;
+					uint32 tileY = tileIndex >> tileMap->mChunkShift;
+
+					uint32 neighbors[4];
+					uint32 neighborCount = 0;
+					if (tileX > 0) {
+						neighbors[neighborCount++] = tileIndex - 1;
+					}
+					if (tileX < (chunkDim - 1)) {
+						neighbors[neighborCount++] = tileIndex + 1;
+					}
+					if (tileY > 0) {
+						neighbors[neighborCount++] = tileIndex - chunkDim;
+					}
+					if (tileY < (chunkDim - 1)) {
+						neighbors[neighborCount++] = tileIndex + chunkDim;
+					}
+
+					for (uint32 neighborIndex = 0; neighborIndex < neighborCount; ++neighborIndex) {
+						uint32 neighbor = neighbors[neighborIndex];
+						if (regions->mClasses[neighbor] && !labels[neighbor]) {
+							labels[neighbor] = label;
+							regions->mStack[stackCount++] = neighbor;
+						}
+					}
+				}
+			}
+		}
+
+		for (uint32 tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
+			if (regions->mClasses[tileIndex] == TILE_PATH_CLASS_DOOR_UP) {
+				labels[tileIndex] |= TILE_REGION_DOOR_UP;
+			}
+			else if (regions->mClasses[tileIndex] == TILE_PATH_CLASS_DOOR_DOWN) {
+				labels[tileIndex] |= TILE_REGION_DOOR_DOWN;
+			}
+		}
+		regionChunk->mRegionCount = regionCount;
+	}
+
+	regionChunk->mLabelVersion = tileChunk->mPathVersion;
+	regionChunk->mIsLabeled = true;
+	++regions->mLabelCount;
+}
+
+inline void
+AssignTileRegionSlots(tile_region_map* regions, tile_region_chunk* regionChunk) {
+	Assert((regions->mRegionCount + regionChunk->mRegionCount) <= regions->mMaxRegionCount);
+	regionChunk->mFirstRegion = regions->mRegionCount;
+	for (uint32 label = 0; label < regionChunk->mRegionCount; ++label) {
+		regions->mParents[regions->mRegionCount + label] = regions->mRegionCount + label;
+	}
+	regions->mRegionCount += regionChunk->mRegionCount;
+}
+
+// Joins the regions facing each other across the border with the neighbor at (chunkX + offsetX, chunkY + offsetY)
+internal void
+JoinTileRegionNeighbor(tile_map* tileMap, tile_region_map* regions, tile_region_chunk* regionChunk, int32 offsetX, int32 offsetY) {
+	uint32 neighborX = regionChunk->mChunkX + offsetX;
+	uint32 neighborY = regionChunk->mChunkY + offsetY;
+	if ((neighborX < tileMap->mTileChunkCountX) && (neighborY < tileMap->mTileChunkCountY) && regionChunk->mRegionCount) {
+		tile_region_chunk* neighbor = regions->mChunks + GetTileChunkIndex(tileMap, neighborX, neighborY, regionChunk->mChunkZ);
+		if (neighbor->mRegionCount) {
+			uint32 lastTile = tileMap->mChunkDim - 1;
+			for (uint32 borderIndex = 0; borderIndex <= lastTile; ++borderIndex) {
+				uint32 tileX = offsetX ? ((offsetX > 0) ? lastTile : 0) : borderIndex;
+				uint32 tileY = offsetY ? ((offsetY > 0) ? lastTile : 0) : borderIndex;
+				uint32 label = GetTileRegionLabel(tileMap, regionChunk, tileX, tileY);
+				uint32 neighborLabel = GetTileRegionLabel(tileMap, neighbor,
+					offsetX ? (lastTile - tileX) : tileX, offsetY ? (lastTile - tileY) : tileY);
+				if (label && neighborLabel) {
+					JoinTileRegions(regions, regionChunk->mFirstRegion + label - 1, neighbor->mFirstRegion + neighborLabel - 1);
+				}
+			}
+		}
+	}
+}
+
+// Joins each z-door of the chunk with the matching door on the floor it leads to
+internal void
+JoinTileRegionDoors(tile_map* tileMap, tile_region_map* regions, tile_region_chunk* regionChunk, bool32 isDownIncluded) {
+	if (regionChunk->mDoorCount) {
+		for (uint32 tileY = 0; tileY < tileMap->mChunkDim; ++tileY) {
+			for (uint32 tileX = 0; tileX < tileMap->mChunkDim; ++tileX) {
+				uint32 pathClass = GetTileRegionPathClass(tileMap, regionChunk, tileX, tileY);
+				uint32 otherZ = UInt32Max;
+				uint32 otherClass = TILE_PATH_CLASS_BLOCKED;
+				if (pathClass == TILE_PATH_CLASS_DOOR_UP) {
+					otherZ = regionChunk->mChunkZ + 1;
+					otherClass = TILE_PATH_CLASS_DOOR_DOWN;
+				}
+				else if ((pathClass == TILE_PATH_CLASS_DOOR_DOWN) && isDownIncluded) {
+					otherZ = regionChunk->mChunkZ - 1;
+					otherClass = TILE_PATH_CLASS_DOOR_UP;
+				}
+
+				if (otherZ < tileMap->mTileChunkCountZ) {
+					tile_region_chunk* other = regions->mChunks + GetTileChunkIndex(tileMap, regionChunk->mChunkX, regionChunk->mChunkY, otherZ);
+					if (GetTileRegionPathClass(tileMap, other, tileX, tileY) == otherClass) {
+						JoinTileRegions(regions,
+							regionChunk->mFirstRegion + GetTileRegionLabel(tileMap, regionChunk, tileX, tileY) - 1,
+							other->mFirstRegion + GetTileRegionLabel(tileMap, other, tileX, tileY) - 1);
+					}
+				}
+			}
+		}
+	}
+}
+
+// Relabels every chunk whose tiles changed since it was labeled and rebuilds the union-find
+internal void
+RebuildTileRegions(tile_map* tileMap, tile_region_map* regions) {
+	regions->mRegionCount = 0;
+	for (uint32 chunkZ = 0; chunkZ < tileMap->mTileChunkCountZ; ++chunkZ) {
+		for (uint32 chunkY = 0; chunkY < tileMap->mTileChunkCountY; ++chunkY) {
+			for (uint32 chunkX = 0; chunkX < tileMap->mTileChunkCountX; ++chunkX) {
+				uint32 chunkIndex = GetTileChunkIndex(tileMap, chunkX, chunkY, chunkZ);
+				tile_region_chunk* regionChunk = regions->mChunks + chunkIndex;
+				if (!regionChunk->mIsLabeled || (regionChunk->mLabelVersion != tileMap->mTileChunks[chunkIndex].mPathVersion)) {
+					LabelTileRegionChunk(tileMap, regions, regionChunk);
+				}
+				regionChunk->mIsPending = false;
+				regionChunk->mMayDisconnect = false;
+				AssignTileRegionSlots(regions, regionChunk);
+			}
+		}
+	}
+
+	// Each border and door pair is joined once, from its west, south or lower side
+	for (uint32 chunkZ = 0; chunkZ < tileMap->mTileChunkCountZ; ++chunkZ) {
+		for (uint32 chunkY = 0; chunkY < tileMap->mTileChunkCountY; ++chunkY) {
+			for (uint32 chunkX = 0; chunkX < tileMap->mTileChunkCountX; ++chunkX) {
+				tile_region_chunk* regionChunk = regions->mChunks + GetTileChunkIndex(tileMap, chunkX, chunkY, chunkZ);
+				JoinTileRegionNeighbor(tileMap, regions, regionChunk, 1, 0);
+				JoinTileRegionNeighbor(tileMap, regions, regionChunk, 0, 1);
+				JoinTileRegionDoors(tileMap, regions, regionChunk, false);
+			}
+		}
+	}
+
+	regions->mPendingCount = 0;
+	regions->mNeedsRebuild = false;
+	++regions->mRebuildCount;
+}
+
+inline void
+JoinTileRegionChunk(tile_map* tileMap, tile_region_map* regions, tile_region_chunk* regionChunk) {
+	JoinTileRegionNeighbor(tileMap, regions, regionChunk, -1, 0);
+	JoinTileRegionNeighbor(tileMap, regions, regionChunk, 1, 0);
+	JoinTileRegionNeighbor(tileMap, regions, regionChunk, 0, -1);
+	JoinTileRegionNeighbor(tileMap, regions, regionChunk, 0, 1);
+	JoinTileRegionDoors(tileMap, regions, regionChunk, true);
+}
+
+// A chunk that closed tiles may have split the regions its old labels were in. Every other chunk
+// with a region in them drops its unions and joins its neighbors again, the rest of the map stays.
+// Slots are only ever joined to slots of the same region, so resetting a split one leaves others alone.
+internal void
+SplitTileRegions(tile_map* tileMap, tile_region_map* regions) {
+	uint32 chunkCount = GetTileChunkCount(tileMap);
+	for (uint32 chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+		tile_region_chunk* regionChunk = regions->mChunks + chunkIndex;
+		regionChunk->mIsSplit = false;
+		if (!regionChunk->mIsPending) {
+			for (uint32 label = 0; label < regionChunk->mRegionCount; ++label) {
+				if (regions->mSplitRoots[FindTileRegionRoot(regions, regionChunk->mFirstRegion + label)]) {
+					regionChunk->mIsSplit = true;
+					break;
+				}
+			}
+		}
+	}
+
+	for (uint32 chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+		tile_region_chunk* regionChunk = regions->mChunks + chunkIndex;
+		if (regionChunk->mIsSplit) {
+			for (uint32 label = 0; label < regionChunk->mRegionCount; ++label) {
+				regions->mParents[regionChunk->mFirstRegion + label] = regionChunk->mFirstRegion + label;
+			}
+		}
+	}
+
+	for (uint32 chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+		tile_region_chunk* regionChunk = regions->mChunks + chunkIndex;
+		if (regionChunk->mIsSplit) {
+			JoinTileRegionChunk(tileMap, regions, regionChunk);
+			regionChunk->mIsSplit = false;
+		}
+	}
+	++regions->mSplitCount;
+}
+
+// Brings the regions up to date with every tile change so far. Changed chunks are relabeled into
+// fresh slots and joined to their neighbors, after the regions a closed chunk was in are split apart.
+internal void
+UpdateTileRegions(tile_map* tileMap) {
+	tile_region_map* regions = tileMap->mRegions;
+	if (!regions->mNeedsRebuild && regions->mPendingCount) {
+		// The old labels are still in place, so are the roots of what a closed chunk was part of
+		bool32 isSplitPending = false;
+		for (uint32 pendingIndex = 0; pendingIndex < regions->mPendingCount; ++pendingIndex) {
+			tile_region_chunk* regionChunk = regions->mChunks + regions->mPendingChunks[pendingIndex];
+			if (regionChunk->mMayDisconnect) {
+				for (uint32 label = 0; label < regionChunk->mRegionCount; ++label) {
+					regions->mSplitRoots[FindTileRegionRoot(regions, regionChunk->mFirstRegion + label)] = true;
+				}
+				isSplitPending = true;
+			}
+		}
+
+		uint32 newRegionCount = 0;
+		for (uint32 pendingIndex = 0; pendingIndex < regions->mPendingCount; ++pendingIndex) {
+			tile_region_chunk* regionChunk = regions->mChunks + regions->mPendingChunks[pendingIndex];
+			LabelTileRegionChunk(tileMap, regions, regionChunk);
+			newRegionCount += regionChunk->mRegionCount;
+		}
+
+		// The slots of the old labels are abandoned, once they run out everything is compacted
+		if ((regions->mRegionCount + newRegionCount) > regions->mMaxRegionCount) {
+			regions->mNeedsRebuild = true;
+		}
+		else {
+			for (uint32 pendingIndex = 0; pendingIndex < regions->mPendingCount; ++pendingIndex) {
+				AssignTileRegionSlots(regions, regions->mChunks + regions->mPendingChunks[pendingIndex]);
+			}
+
+			if (isSplitPending) {
+				SplitTileRegions(tileMap, regions);
+			}
+
+			for (uint32 pendingIndex = 0; pendingIndex < regions->mPendingCount; ++pendingIndex) {
+				tile_region_chunk* regionChunk = regions->mChunks + regions->mPendingChunks[pendingIndex];
+				JoinTileRegionChunk(tileMap, regions, regionChunk);
+				regionChunk->mIsPending = false;
+				regionChunk->mMayDisconnect = false;
+			}
+
+			regions->mPendingCount = 0;
+			++regions->mPatchCount;
+		}
+
+		if (isSplitPending) {
+			for (uint32 region = 0; region < regions->mMaxRegionCount; ++region) {
+				regions->mSplitRoots[region] = false;
+			}
+		}
+	}
+
+	if (regions->mNeedsRebuild) {
+		RebuildTileRegions(tileMap, regions);
+	}
+}
+
+// Region id of the tile, TILE_REGION_NONE for blocked, never written or off-map tiles.
+// Ids stay stable until a tile change splits the region.
+internal uint32
+GetTileRegion(tile_map* tileMap, tile_map_location location) {
+	uint32 result = TILE_REGION_NONE;
+	tile_region_map* regions = tileMap->mRegions;
+	UpdateTileRegions(tileMap);
+
+	tile_chunk_location chunkLoc = GetChunkLocationFor(tileMap, location.mAbsTileX, location.mAbsTileY, location.mAbsTileZ);
+	if ((chunkLoc.mTileChunkX < tileMap->mTileChunkCountX) &&
+		(chunkLoc.mTileChunkY < tileMap->mTileChunkCountY) &&
+		(chunkLoc.mTileChunkZ < tileMap->mTileChunkCountZ)) {
+		uint32 chunkIndex = GetTileChunkIndex(tileMap, (uint32)chunkLoc.mTileChunkX, (uint32)chunkLoc.mTileChunkY, chunkLoc.mTileChunkZ);
+		tile_region_chunk* regionChunk = regions->mChunks + chunkIndex;
+		Assert(regionChunk->mLabelVersion == tileMap->mTileChunks[chunkIndex].mPathVersion);
+
+		uint32 label = GetTileRegionLabel(tileMap, regionChunk, chunkLoc.mRelTileX, chunkLoc.mRelTileY);
+		if (label) {
+			result = FindTileRegionRoot(regions, regionChunk->mFirstRegion + label - 1);
+		}
+	}
+	return result;
+}
+
+// True when a path between the two tiles exists, without searching for it
+internal bool32
+AreTilesConnected(tile_map* tileMap, tile_map_location a, tile_map_location b) {
+	uint32 regionA = GetTileRegion(tileMap, a);
+	bool32 result = ((regionA != TILE_REGION_NONE) && (regionA == GetTileRegion(tileMap, b)));
+	return result;
+}
\ No newline at end of file
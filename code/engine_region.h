@@ -0,0 +1,85 @@
+#if !defined(ENGINE_REGION_H)
+
+/*
+ * Author: Jheremy Strom
+ */
+
+/*
+ * Connected regions answer whether two tiles can reach each other without a search.
+ * Each chunk labels its own open tiles by flood fill, and a union-find joins chunk
+ * regions that touch across a chunk border or share a z-door. Opening tiles only
+ * adds unions. Closing one can split the regions it was part of, only the chunks still
+ * in them are rejoined. Chunks that go out to the world file keep the labels of the
+ * tiles written back, so they go on connecting their neighbors while unloaded.
+ */
+
+#define TILE_REGION_NONE UInt32Max
+
+// Labels carry the z-door class of their tile in the top bits, so doors join without reading tiles
+#define TILE_REGION_LABEL_MASK 0x3FFF
+#define TILE_REGION_DOOR_UP 0x4000
+#define TILE_REGION_DOOR_DOWN 0x8000
+
+// Chunks that opened since the last query, beyond this the next query rebuilds everything
+#define TILE_REGION_MAX_PENDING_CHUNKS 64
+
+struct tile_region_chunk {
+	uint32 mChunkX;
+	uint32 mChunkY;
+	uint32 mChunkZ;
+
+	// Path version of the tile chunk the labels were taken from
+	uint32 mLabelVersion;
+	bool32 mIsLabeled;
+	bool32 mIsPending;
+
+	// Set while pending when a tile closed, and during an update for chunks of split regions
+	bool32 mMayDisconnect;
+	bool32 mIsSplit;
+
+	// Row major label per tile, 0 for blocked tiles and 1 to mRegionCount for the rest.
+	// Null when every tile has the same path class mUniformClass, they then have label mRegionCount.
+	uint16* mLabels;
+	uint32 mRegionCount;
+	uint32 mDoorCount;
+	uint32 mUniformClass;
+
+	// Union-find slot of label 1, the chunk's other labels follow it
+	uint32 mFirstRegion;
+};
+
+struct tile_region_map {
+	// One entry per tile chunk, in the tile map's chunk order
+	tile_region_chunk* mChunks;
+
+	// Union-find parents of every chunk region. Opened chunks take fresh slots at the end
+	// until they run out, then everything is relabeled into a compact range.
+	uint32* mParents;
+	uint32 mRegionCount;
+	uint32 mMaxRegionCount;
+
+	uint32 mPendingChunks[TILE_REGION_MAX_PENDING_CHUNKS];
+	uint32 mPendingCount;
+	bool32 mNeedsRebuild;
+
+	// Handle of TileRegionChunkChanged in the tile map's subscribers
+	uint32 mSubscriberIndex;
+
+	memory_areana mLabelArena;
+	void* mFirstFreeLabels;
+
+	// Flood fill scratch for one chunk
+	uint8* mClasses;
+	uint32* mStack;
+
+	// One flag per union-find slot, set on the roots a closed chunk belonged to
+	uint8* mSplitRoots;
+
+	uint32 mRebuildCount;
+	uint32 mPatchCount;
+	uint32 mSplitCount;
+	uint32 mLabelCount;
+};
+
+#define ENGINE_REGION_H
+#endif
\ No newline at end of file
@@ -2,46 +2,46 @@
  * Author: Jheremy Strom
  */
 
+// Called once per frame, before anything reads the tile map
+inline void
+BeginTileMapFrame(tile_map* tileMap) {
+	++tileMap->mFrameIndex;
+}
+
+// Only looks the chunk up, reads never change the map so workers can read tiles in parallel.
+// Wide chunk coordinates are range checked before they are narrowed, so indexing stays 32-bit.
 inline tile_chunk*
-GetTileChunk(tile_map* tileMap, uint32 tileChunkX, uint32 tileChunkY, uint32 tileChunkZ) {
+GetTileChunk(tile_map* tileMap, tile_coord tileChunkX, tile_coord tileChunkY, uint32 tileChunkZ) {
 	tile_chunk* tileChunk = 0;
-	if ((tileChunkX >= 0) && (tileChunkX < tileMap->mTileChunkCountX) &&
-		(tileChunkY >= 0) && (tileChunkY < tileMap->mTileChunkCountY) &&
-		(tileChunkZ >= 0) && (tileChunkZ < tileMap->mTileChunkCountZ))
+	if ((tileChunkX < tileMap->mTileChunkCountX) &&
+		(tileChunkY < tileMap->mTileChunkCountY) &&
+		(tileChunkZ < tileMap->mTileChunkCountZ))
 	{
-		tileChunk = &tileMap->mTileChunks[
-			tileChunkZ*tileMap->mTileChunkCountY*tileMap->mTileChunkCountX +
-				tileChunkY * tileMap->mTileChunkCountX +
-				tileChunkX];
+		tileChunk = &tileMap->mTileChunks[GetTileChunkIndex(tileMap, (uint32)tileChunkX, (uint32)tileChunkY, tileChunkZ)];
 	}
 	return tileChunk;
 }
 
-inline uint32
-GetTileValueUnchecked(tile_map* tileMap, tile_chunk* tileChunk, uint32 tileX, uint32 tileY) {
-	Assert(tileChunk);
-	Assert(tileX < tileMap->mChunkDim);
-	Assert(tileY < tileMap->mChunkDim);
-
-	uint32 tileChunkValue = tileChunk->mTiles[tileY*tileMap->mChunkDim + tileX];
-	return tileChunkValue;
-}
-
+// Keeps the chunk from going cold and unpacks it if it already did. Only for the thread that edits the map.
 inline void
-SetTileValueUnchecked(tile_map* tileMap, tile_chunk* tileChunk, uint32 tileX, uint32 tileY, uint32 tileValue) {
-	Assert(tileChunk);
-	Assert(tileX < tileMap->mChunkDim);
-	Assert(tileY < tileMap->mChunkDim);
-
-	tileChunk->mTiles[tileY*tileMap->mChunkDim + tileX] = tileValue;
+UseTileChunk(tile_map* tileMap, tile_chunk* tileChunk) {
+	tileChunk->mLastUsedFrame = tileMap->mFrameIndex;
+	if (tileChunk->mCompressed) {
+		DecompressTileChunk(tileMap, tileChunk);
+	}
 }
 
 inline uint32
 GetTileValue(tile_map* tileMap, tile_chunk* tileChunk, uint32 testTileX, uint32 testTileY) {
 	uint32 tileChunkValue = 0;
 
-	if (tileChunk && tileChunk->mTiles) {
-		tileChunkValue = GetTileValueUnchecked(tileMap, tileChunk, testTileX, testTileY);
+	if (tileChunk && IsTileChunkLoaded(tileChunk)) {
+		if (tileChunk->mCompressed) {
+			tileChunkValue = GetCompressedTileValue(tileMap, tileChunk, testTileX, testTileY);
+		}
+		else {
+			tileChunkValue = GetTileValueUnchecked(tileMap, tileChunk, testTileX, testTileY);
+		}
 	}
 
 	return tileChunkValue;
@@ -49,26 +49,26 @@ GetTileValue(tile_map* tileMap, tile_chunk* tileChunk, uint32 testTileX, uint32
 
 inline void
 SetTileValue(tile_map* tileMap, tile_chunk* tileChunk, uint32 testTileX, uint32 testTileY, uint32 tileValue) {
-	if (tileChunk && tileChunk->mTiles) {
+	if (tileChunk && IsTileChunkLoaded(tileChunk)) {
 		SetTileValueUnchecked(tileMap, tileChunk, testTileX, testTileY, tileValue);
 	}
 }
 
 inline tile_chunk_location
-GetChunkLocationFor(tile_map* tileMap, uint32 absTileX, uint32 absTileY, uint32 absTileZ) {
+GetChunkLocationFor(tile_map* tileMap, tile_coord absTileX, tile_coord absTileY, uint32 absTileZ) {
 	tile_chunk_location result;
 
 	result.mTileChunkX = absTileX >> tileMap->mChunkShift;
 	result.mTileChunkY = absTileY >> tileMap->mChunkShift;
 	result.mTileChunkZ = absTileZ;
-	result.mRelTileX = absTileX & tileMap->mChunkMask;
-	result.mRelTileY = absTileY & tileMap->mChunkMask;
+	result.mRelTileX = (uint32)(absTileX & tileMap->mChunkMask);
+	result.mRelTileY = (uint32)(absTileY & tileMap->mChunkMask);
 
 	return result;
 }
 
 internal uint32
-GetTileValue(tile_map* tileMap, uint32 absTileX, uint32 absTileY, uint32 absTileZ) {
+GetTileValue(tile_map* tileMap, tile_coord absTileX, tile_coord absTileY, uint32 absTileZ) {
 	tile_chunk_location chunkLoc = GetChunkLocationFor(tileMap, absTileX, absTileY, absTileZ);
 	tile_chunk* tileChunk = GetTileChunk(tileMap, chunkLoc.mTileChunkX, chunkLoc.mTileChunkY, chunkLoc.mTileChunkZ);
 	uint32 tileChunkValue = GetTileValue(tileMap, tileChunk, chunkLoc.mRelTileX, chunkLoc.mRelTileY);
@@ -84,39 +84,438 @@ GetTileValue(tile_map* tileMap, tile_map_location loc)
 	return tileChunkValue;
 }
 
+inline tile_type*
+GetTileType(tile_map* tileMap, uint32 tileValue) {
+	tile_type* result = tileMap->mTypes + ((tileValue < TILE_TYPE_COUNT) ? tileValue : 0);
+	return result;
+}
+
+inline bool32
+IsTileValueEmpty(tile_map* tileMap, uint32 tileValue) {
+	bool32 isEmpty = (GetTileType(tileMap, tileValue)->mFlags & TILE_TYPE_PASSABLE);
+
+	return isEmpty;
+}
+
+// Walls stop light, and so do tiles that are not loaded since nothing is known about them
+inline bool32
+IsTileLightBlocking(tile_map* tileMap, uint32 tileValue) {
+	bool32 result = (GetTileType(tileMap, tileValue)->mFlags & TILE_TYPE_OPAQUE);
+	return result;
+}
+
+inline uint32
+GetTilePathClass(tile_map* tileMap, uint32 tileValue) {
+	uint32 result = GetTileType(tileMap, tileValue)->mPathClass;
+	return result;
+}
+
 internal bool32
 IsTileMapPointEmpty(tile_map* tileMap, tile_map_location canLoc) {
 	uint32 tileChunkValue = GetTileValue(tileMap, canLoc);
-	bool32 isEmpty = ((tileChunkValue == 1) ||
-						(tileChunkValue == 3) ||
-						(tileChunkValue == 4));
+	bool32 isEmpty = IsTileValueEmpty(tileMap, tileChunkValue);
 
 	return isEmpty;
 }
 
+// Viewers within sight of any tile of the rect rescan on their next update
 internal void
-SetTileValue(memory_areana* arena, tile_map* tileMap, uint32 absTileX, uint32 absTileY, uint32 absTileZ, uint32 tileValue) {
-	tile_chunk_location chunkLoc = GetChunkLocationFor(tileMap, absTileX, absTileY, absTileZ);
-	tile_chunk* tileChunk = GetTileChunk(tileMap, chunkLoc.mTileChunkX, chunkLoc.mTileChunkY, chunkLoc.mTileChunkZ);
+MarkTileFovChanged(tile_map* tileMap, tile_coord minTileX, tile_coord minTileY,
+				   tile_coord onePastMaxTileX, tile_coord onePastMaxTileY, uint32 absTileZ) {
+	tile_fov_map* fov = tileMap->mFov;
+	if (fov) {
+		for (uint32 viewerIndex = 0; viewerIndex < TILE_FOV_MAX_VIEWERS; ++viewerIndex) {
+			tile_fov_viewer* viewer = fov->mViewers + viewerIndex;
+			if (viewer->mIsActive && (viewer->mLocation.mAbsTileZ == absTileZ)) {
+				tile_delta radius = (tile_delta)viewer->mRadius;
+				tile_delta minDeltaX = (tile_delta)(minTileX - viewer->mLocation.mAbsTileX);
+				tile_delta minDeltaY = (tile_delta)(minTileY - viewer->mLocation.mAbsTileY);
+				tile_delta maxDeltaX = (tile_delta)(onePastMaxTileX - 1 - viewer->mLocation.mAbsTileX);
+				tile_delta maxDeltaY = (tile_delta)(onePastMaxTileY - 1 - viewer->mLocation.mAbsTileY);
+				if ((minDeltaX <= radius) && (maxDeltaX >= -radius) &&
+					(minDeltaY <= radius) && (maxDeltaY >= -radius)) {
+					viewer->mNeedsUpdate = true;
+				}
+			}
+		}
+	}
+}
 
-	Assert(tileChunk);
-	if (!tileChunk->mTiles) {
-		uint32 tileCount = tileMap->mChunkDim*tileMap->mChunkDim;
-		tileChunk->mTiles = PushArray(arena, tileCount, uint32);
+// Everything written until the matching EndTileEditBatch undoes as one step. Batches nest.
+internal void
+BeginTileEditBatch(tile_map* tileMap) {
+	tile_journal* journal = tileMap->mJournal;
+	if (journal && !journal->mIsReplaying) {
+		++journal->mBatchDepth;
+	}
+}
+
+internal void
+EndTileEditBatch(tile_map* tileMap) {
+	tile_journal* journal = tileMap->mJournal;
+	if (journal && !journal->mIsReplaying) {
+		Assert(journal->mBatchDepth > 0);
+		if ((--journal->mBatchDepth == 0) && journal->mHasOpenBatch) {
+			if (journal->mIsBatchLost) {
+				tile_edit_batch* batch = journal->mBatches + (journal->mNewestBatch % journal->mBatchCapacity);
+				journal->mNextEdit = batch->mFirstEdit;
+				++journal->mLostBatchCount;
+			}
+			else {
+				++journal->mNewestBatch;
+				journal->mUndoBatch = journal->mNewestBatch;
+			}
+			journal->mHasOpenBatch = false;
+		}
+	}
+}
+
+// Adds the edit to the open batch, forgetting the oldest batches to make room in the ring
+internal void
+RecordTileEdit(tile_map* tileMap, tile_chunk* tileChunk, tile_coord absTileX, tile_coord absTileY, uint32 absTileZ,
+			   uint32 oldValue, uint32 newValue) {
+	tile_journal* journal = tileMap->mJournal;
+	if (journal && !journal->mIsReplaying && !journal->mHasOpenBatch) {
+		Assert(journal->mBatchDepth > 0);
+
+		// The batch's first edit forgets everything that could have been redone
+		journal->mNewestBatch = journal->mUndoBatch;
+		if (journal->mUndoBatch > journal->mOldestBatch) {
+			tile_edit_batch* lastBatch = journal->mBatches + ((journal->mUndoBatch - 1) % journal->mBatchCapacity);
+			journal->mNextEdit = lastBatch->mFirstEdit + lastBatch->mEditCount;
+		}
+
+		if ((journal->mNewestBatch - journal->mOldestBatch) == journal->mBatchCapacity) {
+			++journal->mOldestBatch;
+		}
+
+		tile_edit_batch* batch = journal->mBatches + (journal->mNewestBatch % journal->mBatchCapacity);
+		batch->mFirstEdit = journal->mNextEdit;
+		batch->mEditCount = 0;
+		journal->mHasOpenBatch = true;
+		journal->mIsBatchLost = false;
+	}
+
+	if (journal && !journal->mIsReplaying && !journal->mIsBatchLost) {
+		while ((journal->mNextEdit - journal->mBatches[journal->mOldestBatch % journal->mBatchCapacity].mFirstEdit) ==
+			journal->mEditCapacity) {
+			if (journal->mOldestBatch == journal->mNewestBatch) {
+				journal->mIsBatchLost = true;
+				break;
+			}
+			++journal->mOldestBatch;
+		}
 
-		for (uint32 tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
-			tileChunk->mTiles[tileIndex] = 1;
+		if (!journal->mIsBatchLost) {
+			tile_edit* edit = journal->mEdits + (journal->mNextEdit++ % journal->mEditCapacity);
+			edit->mChunkIndex = (uint32)(tileChunk - tileMap->mTileChunks);
+			edit->mAbsTileX = absTileX;
+			edit->mAbsTileY = absTileY;
+			edit->mAbsTileZ = absTileZ;
+			edit->mOldValue = oldValue;
+			edit->mNewValue = newValue;
+			++journal->mBatches[journal->mNewestBatch % journal->mBatchCapacity].mEditCount;
 		}
 	}
+}
 
+// Pages the chunk in, or gives it its lazy uniform storage, and unpacks it so it can be written
+internal tile_chunk*
+GetTileChunkForWrite(tile_map* tileMap, tile_coord tileChunkX, tile_coord tileChunkY, uint32 tileChunkZ) {
+	tile_chunk* tileChunk = GetTileChunk(tileMap, tileChunkX, tileChunkY, tileChunkZ);
+
+	Assert(tileChunk);
+	UseTileChunk(tileMap, tileChunk);
+	if (tileMap->mStream) {
+		if (IsTileChunkLoaded(tileChunk)) {
+			TouchTileChunk(tileMap->mStream, tileChunk);
+		}
+		else {
+			PageInTileChunk(tileMap, tileChunk);
+		}
+	}
+	else if (!IsTileChunkLoaded(tileChunk)) {
+		// Starts out costing no tile memory, the first different value promotes it
+		MakeTileChunkUniform(tileChunk, 1);
+		InvalidateTileFov(tileMap);
+		NotifyTileChunkChanged(tileMap, tileChunk, TILE_CHANGE_LOAD);
+	}
+
+	return tileChunk;
+}
+
+inline uint32
+GetTileEditKinds(tile_map* tileMap, uint32 tileValue) {
+	uint32 result = ((1 << GetTilePathClass(tileMap, tileValue)) |
+					(IsTileLightBlocking(tileMap, tileValue) ? TILE_EDIT_LIGHT_BLOCKING : TILE_EDIT_LIGHT_OPEN));
+	return result;
+}
+
+// Kinds of every value in the chunk's palette, which covers at least the tiles it holds
+internal uint32
+GetTileChunkEditKinds(tile_map* tileMap, tile_chunk* tileChunk) {
+	uint32 result = 0;
+	for (uint32 paletteIndex = 0; paletteIndex < tileChunk->mPaletteCount; ++paletteIndex) {
+		result |= GetTileEditKinds(tileMap, tileChunk->mPalette[paletteIndex]);
+	}
+	return result;
+}
+
+// Tells the subscribers about tiles of the chunk that were written. Without knowing the old value
+// of each tile, anything one of the old kinds could have turned into one of the new is assumed.
+// Cached path graphs of this chunk and its neighbors rebuild when they see its new path version.
+internal void
+MarkTileRectChanged(tile_map* tileMap, tile_chunk* tileChunk, tile_coord minTileX, tile_coord minTileY,
+					tile_coord onePastMaxTileX, tile_coord onePastMaxTileY, uint32 absTileZ, uint32 oldKinds, uint32 newKinds) {
+	tile_change change = {};
+	change.mType = TILE_CHANGE_EDIT;
+	change.mMinTileX = minTileX;
+	change.mMinTileY = minTileY;
+	change.mOnePastMaxTileX = onePastMaxTileX;
+	change.mOnePastMaxTileY = onePastMaxTileY;
+	change.mAbsTileZ = absTileZ;
+	change.mOldKinds = oldKinds;
+	change.mNewKinds = newKinds;
+	NotifyTileChunkChanged(tileMap, tileChunk, &change);
+
+	if (DoesTileChangeMoveLight(&change)) {
+		MarkTileFovChanged(tileMap, minTileX, minTileY, onePastMaxTileX, onePastMaxTileY, absTileZ);
+	}
+}
+
+internal void
+SetTileValue(tile_map* tileMap, tile_coord absTileX, tile_coord absTileY, uint32 absTileZ, uint32 tileValue) {
+	tile_chunk_location chunkLoc = GetChunkLocationFor(tileMap, absTileX, absTileY, absTileZ);
+	tile_chunk* tileChunk = GetTileChunkForWrite(tileMap, chunkLoc.mTileChunkX, chunkLoc.mTileChunkY, chunkLoc.mTileChunkZ);
+
+	uint32 oldTileValue = GetTileValue(tileMap, tileChunk, chunkLoc.mRelTileX, chunkLoc.mRelTileY);
 	SetTileValue(tileMap, tileChunk, chunkLoc.mRelTileX, chunkLoc.mRelTileY, tileValue);
+	if (oldTileValue != tileValue) {
+		BeginTileEditBatch(tileMap);
+		RecordTileEdit(tileMap, tileChunk, absTileX, absTileY, absTileZ, oldTileValue, tileValue);
+		EndTileEditBatch(tileMap);
+		MarkTileRectChanged(tileMap, tileChunk, absTileX, absTileY, absTileX + 1, absTileY + 1, absTileZ,
+			GetTileEditKinds(tileMap, oldTileValue), GetTileEditKinds(tileMap, tileValue));
+	}
+}
+
+// Writes a rect of tiles one chunk at a time, either from a row major pattern of width*height values
+// or, without a pattern, all set to tileValue. Each chunk is looked up once, and every run of equal
+// values along a row is written with FillTileChunkRect.
+internal void
+WriteTileRect(tile_map* tileMap, tile_coord minTileX, tile_coord minTileY, uint32 absTileZ,
+			  uint32 width, uint32 height, uint32* pattern, uint32 tileValue) {
+	if (width && height) {
+		BeginTileEditBatch(tileMap);
+		tile_journal* journal = tileMap->mJournal;
+		bool32 isRecording = (journal && !journal->mIsReplaying);
+
+		tile_coord onePastMaxTileX = minTileX + width;
+		tile_coord onePastMaxTileY = minTileY + height;
+		tile_coord maxChunkX = (onePastMaxTileX - 1) >> tileMap->mChunkShift;
+		tile_coord maxChunkY = (onePastMaxTileY - 1) >> tileMap->mChunkShift;
+		for (tile_coord chunkY = minTileY >> tileMap->mChunkShift; chunkY <= maxChunkY; ++chunkY) {
+			for (tile_coord chunkX = minTileX >> tileMap->mChunkShift; chunkX <= maxChunkX; ++chunkX) {
+				tile_chunk* tileChunk = GetTileChunkForWrite(tileMap, chunkX, chunkY, absTileZ);
+
+				// The part of the rect inside this chunk
+				tile_coord chunkMinTileX = chunkX << tileMap->mChunkShift;
+				tile_coord chunkMinTileY = chunkY << tileMap->mChunkShift;
+				tile_coord partMinTileX = Maximum(minTileX, chunkMinTileX);
+				tile_coord partMinTileY = Maximum(minTileY, chunkMinTileY);
+				tile_coord partOnePastMaxTileX = Minimum(onePastMaxTileX, chunkMinTileX + tileMap->mChunkDim);
+				tile_coord partOnePastMaxTileY = Minimum(onePastMaxTileY, chunkMinTileY + tileMap->mChunkDim);
+				uint32 relMinTileX = (uint32)(partMinTileX - chunkMinTileX);
+				uint32 relMinTileY = (uint32)(partMinTileY - chunkMinTileY);
+				uint32 relOnePastMaxTileX = (uint32)(partOnePastMaxTileX - chunkMinTileX);
+				uint32 relOnePastMaxTileY = (uint32)(partOnePastMaxTileY - chunkMinTileY);
+
+				// The journal needs every old value, so recording costs a read per tile on top of the fills
+				if (isRecording) {
+					for (uint32 relTileY = relMinTileY; relTileY < relOnePastMaxTileY; ++relTileY) {
+						for (uint32 relTileX = relMinTileX; relTileX < relOnePastMaxTileX; ++relTileX) {
+							tile_coord absTileX = chunkMinTileX + relTileX;
+							tile_coord absTileY = chunkMinTileY + relTileY;
+							uint32 newValue = pattern ? pattern[(uint64)(absTileY - minTileY)*width + (absTileX - minTileX)] : tileValue;
+							uint32 oldValue = GetTileValueUnchecked(tileMap, tileChunk, relTileX, relTileY);
+							if ((newValue != TILE_PATTERN_KEEP) && (newValue != oldValue)) {
+								RecordTileEdit(tileMap, tileChunk, absTileX, absTileY, absTileZ, oldValue, newValue);
+							}
+						}
+					}
+				}
+
+				uint32 oldKinds = GetTileChunkEditKinds(tileMap, tileChunk);
+				uint32 newKinds = 0;
+				bool32 changed = false;
+				if (pattern) {
+					for (uint32 relTileY = relMinTileY; relTileY < relOnePastMaxTileY; ++relTileY) {
+						uint32* row = pattern + (uint64)(chunkMinTileY + relTileY - minTileY)*width;
+						uint32 patternX = (uint32)(partMinTileX - minTileX);
+						uint32 relTileX = relMinTileX;
+						while (relTileX < relOnePastMaxTileX) {
+							uint32 runValue = row[patternX];
+							uint32 runCount = 1;
+							while (((relTileX + runCount) < relOnePastMaxTileX) && (row[patternX + runCount] == runValue)) {
+								++runCount;
+							}
+
+							if (runValue != TILE_PATTERN_KEEP) {
+								if (FillTileChunkRect(tileMap, tileChunk, relTileX, relTileY, relTileX + runCount, relTileY + 1, runValue)) {
+									changed = true;
+								}
+								newKinds |= GetTileEditKinds(tileMap, runValue);
+							}
+							relTileX += runCount;
+							patternX += runCount;
+						}
+					}
+				}
+				else {
+					changed = FillTileChunkRect(tileMap, tileChunk, relMinTileX, relMinTileY,
+						relOnePastMaxTileX, relOnePastMaxTileY, tileValue);
+					newKinds = GetTileEditKinds(tileMap, tileValue);
+				}
+
+				if (changed) {
+					MarkTileRectChanged(tileMap, tileChunk, partMinTileX, partMinTileY,
+						partOnePastMaxTileX, partOnePastMaxTileY, absTileZ, oldKinds, newKinds);
+				}
+			}
+		}
+		EndTileEditBatch(tileMap);
+	}
+}
+
+internal void
+FillTileRect(tile_map* tileMap, tile_coord minTileX, tile_coord minTileY, uint32 absTileZ,
+			 uint32 width, uint32 height, uint32 tileValue) {
+	WriteTileRect(tileMap, minTileX, minTileY, absTileZ, width, height, 0, tileValue);
+}
+
+// Pattern entries of TILE_PATTERN_KEEP leave the tile under them unchanged
+internal void
+StampTilePattern(tile_map* tileMap, tile_coord minTileX, tile_coord minTileY, uint32 absTileZ,
+				 uint32 width, uint32 height, uint32* pattern) {
+	Assert(pattern);
+	WriteTileRect(tileMap, minTileX, minTileY, absTileZ, width, height, pattern, 0);
+}
+
+// Reads a rect of tiles into a row major array, looking each chunk up once per row. Like GetTileValue
+// this never pages anything in, tiles that are not loaded read as 0 unless PageInTileRect runs first.
+internal void
+ReadTileRect(tile_map* tileMap, tile_coord minTileX, tile_coord minTileY, uint32 absTileZ,
+			 uint32 width, uint32 height, uint32* tiles) {
+	for (uint32 rowIndex = 0; rowIndex < height; ++rowIndex) {
+		uint32* row = tiles + (uint64)rowIndex*width;
+		uint32 columnIndex = 0;
+		while (columnIndex < width) {
+			tile_chunk_location chunkLoc = GetChunkLocationFor(tileMap, minTileX + columnIndex, minTileY + rowIndex, absTileZ);
+			tile_chunk* tileChunk = GetTileChunk(tileMap, chunkLoc.mTileChunkX, chunkLoc.mTileChunkY, chunkLoc.mTileChunkZ);
+			uint32 runCount = Minimum(width - columnIndex, tileMap->mChunkDim - chunkLoc.mRelTileX);
+			for (uint32 runIndex = 0; runIndex < runCount; ++runIndex) {
+				row[columnIndex + runIndex] = GetTileValue(tileMap, tileChunk, chunkLoc.mRelTileX + runIndex, chunkLoc.mRelTileY);
+			}
+			columnIndex += runCount;
+		}
+	}
+}
+
+// Pages in every chunk the rect touches and marks them as most recently used, so reads of the rect
+// see what the world file holds. Without a stream every chunk is already in.
+internal void
+PageInTileRect(tile_map* tileMap, tile_coord minTileX, tile_coord minTileY, uint32 absTileZ, uint32 width, uint32 height) {
+	tile_chunk_stream* stream = tileMap->mStream;
+	if (stream && width && height) {
+		tile_coord minChunkX = minTileX >> tileMap->mChunkShift;
+		tile_coord minChunkY = minTileY >> tileMap->mChunkShift;
+		tile_coord maxChunkX = (minTileX + width - 1) >> tileMap->mChunkShift;
+		tile_coord maxChunkY = (minTileY + height - 1) >> tileMap->mChunkShift;
+		Assert((maxChunkX - minChunkX + 1)*(maxChunkY - minChunkY + 1) <= stream->mResidentBudget);
+
+		for (tile_coord chunkY = minChunkY; chunkY <= maxChunkY; ++chunkY) {
+			for (tile_coord chunkX = minChunkX; chunkX <= maxChunkX; ++chunkX) {
+				tile_chunk* tileChunk = GetTileChunk(tileMap, chunkX, chunkY, absTileZ);
+				if (tileChunk) {
+					if (IsTileChunkLoaded(tileChunk)) {
+						TouchTileChunk(stream, tileChunk);
+					}
+					else {
+						PageInTileChunk(tileMap, tileChunk);
+					}
+				}
+			}
+		}
+	}
+}
+
+// The rects may overlap. Like memmove, blocks are copied starting from the side the rect moves toward,
+// so no source tile is overwritten before it has been read. Each source block is paged in before it is
+// read, a streamed out chunk would otherwise copy over as zeros and be journaled as a real edit.
+// The whole copy undoes as one step.
+internal void
+CopyTileRect(tile_map* tileMap, tile_coord sourceMinTileX, tile_coord sourceMinTileY, uint32 sourceTileZ,
+			 tile_coord destMinTileX, tile_coord destMinTileY, uint32 destTileZ, uint32 width, uint32 height) {
+	uint32 block[TILE_COPY_BLOCK_DIM*TILE_COPY_BLOCK_DIM];
+
+	bool32 isSameFloor = (sourceTileZ == destTileZ);
+	bool32 isReversedX = (isSameFloor && (destMinTileX > sourceMinTileX));
+	bool32 isReversedY = (isSameFloor && (destMinTileY > sourceMinTileY));
+	uint32 blockCountX = (width + TILE_COPY_BLOCK_DIM - 1) / TILE_COPY_BLOCK_DIM;
+	uint32 blockCountY = (height + TILE_COPY_BLOCK_DIM - 1) / TILE_COPY_BLOCK_DIM;
+	BeginTileEditBatch(tileMap);
+	for (uint32 blockStepY = 0; blockStepY < blockCountY; ++blockStepY) {
+		uint32 offsetY = (isReversedY ? (blockCountY - 1 - blockStepY) : blockStepY)*TILE_COPY_BLOCK_DIM;
+		uint32 blockHeight = Minimum(height - offsetY, TILE_COPY_BLOCK_DIM);
+		for (uint32 blockStepX = 0; blockStepX < blockCountX; ++blockStepX) {
+			uint32 offsetX = (isReversedX ? (blockCountX - 1 - blockStepX) : blockStepX)*TILE_COPY_BLOCK_DIM;
+			uint32 blockWidth = Minimum(width - offsetX, TILE_COPY_BLOCK_DIM);
+
+			PageInTileRect(tileMap, sourceMinTileX + offsetX, sourceMinTileY + offsetY, sourceTileZ, blockWidth, blockHeight);
+			ReadTileRect(tileMap, sourceMinTileX + offsetX, sourceMinTileY + offsetY, sourceTileZ, blockWidth, blockHeight, block);
+			WriteTileRect(tileMap, destMinTileX + offsetX, destMinTileY + offsetY, destTileZ, blockWidth, blockHeight, block, 0);
+		}
+	}
+	EndTileEditBatch(tileMap);
+}
+
+// Pages in every chunk within chunkRadius of the center, marks them as most recently used and keeps
+// them unpacked. Reads never page in or unpack, so anything outside the radius may read as empty until
+// it is requested, and cold chunks read through their compressed rows.
+internal void
+UpdateResidentTileChunks(tile_map* tileMap, tile_map_location center, uint32 chunkRadius) {
+	TIMED_FUNCTION();
+	tile_chunk_stream* stream = tileMap->mStream;
+	uint32 chunkDiameter = 2*chunkRadius + 1;
+	Assert(!stream || (chunkDiameter*chunkDiameter <= stream->mResidentBudget));
+
+	tile_chunk_location centerChunk = GetChunkLocationFor(tileMap, center.mAbsTileX, center.mAbsTileY, center.mAbsTileZ);
+	for (uint32 chunkOffsetY = 0; chunkOffsetY < chunkDiameter; ++chunkOffsetY) {
+		for (uint32 chunkOffsetX = 0; chunkOffsetX < chunkDiameter; ++chunkOffsetX) {
+			tile_chunk* tileChunk = GetTileChunk(tileMap,
+				centerChunk.mTileChunkX + chunkOffsetX - chunkRadius,
+				centerChunk.mTileChunkY + chunkOffsetY - chunkRadius,
+				centerChunk.mTileChunkZ);
+			if (tileChunk) {
+				UseTileChunk(tileMap, tileChunk);
+				if (stream) {
+					if (IsTileChunkLoaded(tileChunk)) {
+						TouchTileChunk(stream, tileChunk);
+					}
+					else {
+						PageInTileChunk(tileMap, tileChunk);
+					}
+				}
+			}
+		}
+	}
 }
 
 inline void
-RecanonicalizeCoord(tile_map* tileMap, uint32* tile, real32* tileRelative) {
-	// Toroidal topology
+RecanonicalizeCoord(tile_map* tileMap, tile_coord* tile, real32* tileRelative) {
+	// Toroidal topology, the tile step is integer math so it is exact at any distance from the origin
 	int32 offset = RoundReal32ToInt32(*tileRelative / tileMap->mTileSideInMeters);
-	*tile += offset;
+	*tile += (tile_delta)offset;
 	*tileRelative -= offset * tileMap->mTileSideInMeters;
 
 	// TODO: Fix floating point math to make < ?
@@ -128,8 +527,8 @@ inline tile_map_location
 RecanonicalizeLocation(tile_map* tileMap, tile_map_location loc) {
 	tile_map_location result = loc;
 
-	RecanonicalizeCoord(tileMap, &result.mAbsTileX, &result.mOffsetX);
-	RecanonicalizeCoord(tileMap, &result.mAbsTileY, &result.mOffsetY);
+	RecanonicalizeCoord(tileMap, &result.mAbsTileX, &result.mOffset.x);
+	RecanonicalizeCoord(tileMap, &result.mAbsTileY, &result.mOffset.y);
 
 	return result;
 }
@@ -143,26 +542,29 @@ AreOnSameTile(tile_map_location* x, tile_map_location* y) {
 	return result;
 }
 
+// The tile delta is taken in integers before it becomes meters, so two nearby locations
+// stay exact however far they are from the origin. Unsigned wraparound keeps the
+// 32-bit toroidal world working: the shortest signed delta comes out of the cast.
 inline tile_map_difference
-Subtract(tile_map* TileMap, tile_map_location* x, tile_map_location* y) {
+Subtract(tile_map* tileMap, tile_map_location* x, tile_map_location* y) {
 	tile_map_difference result;
 
-	Vector2 dTileXY = { (real32)x->mAbsTileX - (real32)y->mAbsTileX,
-				   (real32)x->mAbsTileY - (real32)y->mAbsTileY };
-
-	real32 dTileZ = (real32)x->mAbsTileZ - (real32)y->mAbsTileZ;
+	tile_delta dTileX = (tile_delta)(x->mAbsTileX - y->mAbsTileX);
+	tile_delta dTileY = (tile_delta)(x->mAbsTileY - y->mAbsTileY);
+	int32 dTileZ = (int32)(x->mAbsTileZ - y->mAbsTileZ);
 
-	Vector2 temp = TileMap->TileSideInMeters*dTileXY + (x->mOffset - y->mOffset);
+	Vector2 dTileXY((real32)dTileX, (real32)dTileY);
+	Vector2 temp = tileMap->mTileSideInMeters*dTileXY + (x->mOffset - y->mOffset);
 
 	result.mVector.x = temp.x;
 	result.mVector.y = temp.y;
-	result.mVector.z = tileMap->mTileSideInMeters*dTileZ;
+	result.mVector.z = tileMap->mTileSideInMeters*(real32)dTileZ;
 
 	return result;
 }
 
 inline tile_map_location
-CenteredTilePoint(uint32 absTileX, uint32 absTileY, uint32 absTileZ) {
+CenteredTilePoint(tile_coord absTileX, tile_coord absTileY, uint32 absTileZ) {
 	tile_map_location result = {};
 
 	result.mAbsTileX = absTileX;
@@ -175,7 +577,7 @@ CenteredTilePoint(uint32 absTileX, uint32 absTileY, uint32 absTileZ) {
 inline tile_map_location
 Offset(tile_map* tileMap, tile_map_location p, Vector2 offset) {
 	p.mOffset += offset;
-	p = RecanonicalizePosition(tileMap, p);
+	p = RecanonicalizeLocation(tileMap, p);
 
 	return p;
 }
\ No newline at end of file
@@ -4,6 +4,23 @@
  * Author: Jheremy Strom
  */
 
+/*
+ * ENGINE_WIDE_TILES:
+ * 0 - 32-bit absolute tile X and Y, the world wraps around toroidally
+ * 1 - 64-bit absolute tile X and Y
+ */
+#if !defined(ENGINE_WIDE_TILES)
+#define ENGINE_WIDE_TILES 0
+#endif
+
+#if ENGINE_WIDE_TILES
+typedef uint64 tile_coord;
+typedef int64 tile_delta;
+#else
+typedef uint32 tile_coord;
+typedef int32 tile_delta;
+#endif
+
 struct tile_map_difference {
 	Vector3 mVector;
 };
@@ -13,27 +30,147 @@ struct tile_map_location {
 	// These are fixed point tile locations
 	// The high bits are the tile chunk index
 	// The low bits are the tile index in the chunk
-	uint32 mAbsTileX;
-	uint32 mAbsTileY;
+	tile_coord mAbsTileX;
+	tile_coord mAbsTileY;
 	uint32 mAbsTileZ;
 
 	// Offsets from the tile center
 	Vector2 mOffset;
 };
 
+#define TILE_CHUNK_MAX_BITS_PER_TILE 8
+#define TILE_CHUNK_MAX_PALETTE_COUNT (1 << TILE_CHUNK_MAX_BITS_PER_TILE)
+
+// Compressed chunks are allocated in 8-byte granules, one free list per granule count
+#define TILE_CHUNK_COMPRESSED_GRANULE_SIZE 8
+#define TILE_CHUNK_COMPRESSED_CLASS_COUNT 128
+
 struct tile_chunk {
-	uint32* mTiles;
+	// Tiles are mBitsPerTile-bit indices into mPalette, packed into 32-bit words.
+	// A uniform chunk uses zero bits per tile, so every read lands on mUniformIndices
+	// and returns palette entry zero without any tile storage.
+	// A chunk is loaded when mPalette or mCompressed is set.
+	uint32* mIndices;
+	uint32* mPalette;
+	uint32 mBitsPerTile;  // 0, 1, 2, 4 or 8
+	uint32 mIndexMask;
+	uint32 mPaletteCount;
+	uint32 mPaletteCapacity;  // A power of two, 8-bit chunks only pay for the palette entries they use
+	uint32 mUniformIndices;
+	uint32 mUniformValue;
+
+	// Cold chunks are compressed, reads go through the compressed rows until a write or UseTileChunk unpacks them
+	uint8* mCompressed;
+	uint32 mCompressedSize;
+	uint32 mLastUsedFrame;
+
+	// Bumped whenever the chunk's tiles change how paths can cross it
+	uint32 mPathVersion;
+
+	// Bumped whenever any tile of the chunk changes
+	uint32 mEditVersion;
+
+	// Streaming state, only used when the tile map is backed by a world file
+	bool32 mIsDirty;
+	tile_chunk* mNextResident;
+	tile_chunk* mPrevResident;
+};
+
+// A run of consecutive packed tile indices in a chunk
+struct tile_index_run {
+	uint32 mFirstIndex;
+	uint32 mCount;
 };
 
 struct tile_chunk_location {
-	uint32 mTileChunkX;
-	uint32 mTileChunkY;
+	tile_coord mTileChunkX;
+	tile_coord mTileChunkY;
 	uint32 mTileChunkZ;
 
 	uint32 mRelTileX;
 	uint32 mRelTileY;
 };
 
+// Pattern entries that leave the tile under them as it is
+#define TILE_PATTERN_KEEP UInt32Max
+
+// CopyTileRect moves tiles through a stack buffer of this many tiles squared
+#define TILE_COPY_BLOCK_DIM 64
+
+// What a bulk edit may have changed: one bit per path class, then whether light gets through
+#define TILE_EDIT_PATH_KINDS 0x1F
+#define TILE_EDIT_LIGHT_BLOCKING (1 << 5)
+#define TILE_EDIT_LIGHT_OPEN (1 << 6)
+#define TILE_EDIT_LIGHT_KINDS (TILE_EDIT_LIGHT_BLOCKING | TILE_EDIT_LIGHT_OPEN)
+
+// Path classes: 0 blocked, 1 open, otherwise the z-door it is (3 up, 4 down)
+#define TILE_PATH_CLASS_BLOCKED 0
+#define TILE_PATH_CLASS_OPEN 1
+#define TILE_PATH_CLASS_DOOR_UP 3
+#define TILE_PATH_CLASS_DOOR_DOWN 4
+
+// What a tile change notification is about
+#define TILE_CHANGE_EDIT 0   // Tiles were written, the change says which and what kinds they were and are
+#define TILE_CHANGE_LOAD 1   // The whole chunk paged in or was created, any of its tiles can be new
+#define TILE_CHANGE_EVICT 2  // The chunk went out to the world file, its tiles read as 0 until they page back in
+
+struct tile_change {
+	uint32 mType;
+	uint32 mChunkIndex;
+
+	// Edits only, the rect of tiles written and the TILE_EDIT_ kinds of what they held and now hold
+	tile_coord mMinTileX;
+	tile_coord mMinTileY;
+	tile_coord mOnePastMaxTileX;
+	tile_coord mOnePastMaxTileY;
+	uint32 mAbsTileZ;
+	uint32 mOldKinds;
+	uint32 mNewKinds;
+};
+
+#define TILE_MAX_SUBSCRIBERS 8
+
+struct tile_map;
+#define TILE_CHUNK_CHANGED(name) void name(tile_map* tileMap, void* subscriberData, tile_change* change)
+typedef TILE_CHUNK_CHANGED(tile_chunk_changed);
+
+struct tile_subscriber {
+	tile_chunk_changed* mCallback;
+	void* mData;
+};
+
+// Tile values index the tile type table, values past its end behave like unloaded tiles
+#define TILE_TYPE_COUNT 256
+
+#define TILE_TYPE_PASSABLE (1 << 0)
+#define TILE_TYPE_OPAQUE (1 << 1)
+#define TILE_TYPE_DOOR_UP (1 << 2)
+#define TILE_TYPE_DOOR_DOWN (1 << 3)
+#define TILE_TYPE_DRAWN (1 << 4)
+
+struct tile_type {
+	uint8 mFlags;
+	uint8 mPathClass;  // Derived from mFlags when the type is set
+	uint16 mBitmapID;  // 0 when the type is drawn as a flat rectangle of mColor
+	uint32 mColor;     // 0xRRGGBB
+};
+
+// Packed chunk storage is carved from the world arena and recycled through a free list per palette
+// capacity, which also sets the bit depth
+struct tile_chunk_storage {
+	memory_areana* mArena;
+	void* mFirstFreeBlock[TILE_CHUNK_MAX_BITS_PER_TILE + 1];  // Indexed by log2 of the palette capacity
+	memory_index mUsedBytes;
+
+	memory_areana mCompressedArena;
+	void* mFirstFreeCompressed[TILE_CHUNK_COMPRESSED_CLASS_COUNT + 1];
+	memory_index mCompressedBytes;
+	uint32 mCompactionCursor;
+
+	uint32 mCompressedChunkCount;
+	uint32 mDecompressionCount;
+};
+
 struct tile_map {
 	uint32 mChunkShift;
 	uint32 mChunkMask;
@@ -45,7 +182,37 @@ struct tile_map {
 	uint32 mTileChunkCountY;
 	uint32 mTileChunkCountZ;
 
+	// Morton order interleaves X and Y so vertical neighbors stay close in memory,
+	// both in the chunk array and in the packed tiles of each chunk
+	bool32 mIsMortonOrdered;
+	uint32 mChunkMortonSharedBits;
+	uint32 mChunkMortonAreaPerZ;
+
 	tile_chunk* mTileChunks;
+	tile_chunk_storage mChunkStorage;
+	uint32 mFrameIndex;
+
+	// Null when every chunk lives in the world arena
+	struct tile_chunk_stream* mStream;
+
+	// Null when connected regions are not tracked
+	struct tile_region_map* mRegions;
+
+	// Null when the map is not lit
+	struct tile_light_map* mLights;
+
+	// Null when nobody's view is tracked
+	struct tile_fov_map* mFov;
+
+	// Null when edits are not recorded
+	struct tile_journal* mJournal;
+
+	// Caches built from the tiles, told about every change. The callbacks point into the game code,
+	// so whoever subscribed hands theirs in again with RefreshTileSubscription after a reload.
+	tile_subscriber mSubscribers[TILE_MAX_SUBSCRIBERS];
+
+	// What every tile value means, set before any tile uses it
+	tile_type mTypes[TILE_TYPE_COUNT];
 };
 
 #define ENGINE_TILE_H
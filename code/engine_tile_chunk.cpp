@@ -0,0 +1,927 @@
+/*
+ * Author: Jheremy Strom
+ */
+
+inline uint32
+GetTileChunkTileCount(tile_map* tileMap) {
+	uint32 result = tileMap->mChunkDim*tileMap->mChunkDim;
+	return result;
+}
+
+// Number of slots in the chunk array, Morton order pads each axis to a power of two
+inline uint32
+GetTileChunkCount(tile_map* tileMap) {
+	uint32 result;
+	if (tileMap->mIsMortonOrdered) {
+		result = tileMap->mChunkMortonAreaPerZ*tileMap->mTileChunkCountZ;
+	}
+	else {
+		result = (tileMap->mTileChunkCountX*
+				tileMap->mTileChunkCountY*
+				tileMap->mTileChunkCountZ);
+	}
+	return result;
+}
+
+// Must be called once the chunk counts are set and before the chunk array is allocated
+internal void
+InitializeTileChunkLayout(tile_map* tileMap, bool32 isMortonOrdered) {
+	tileMap->mIsMortonOrdered = isMortonOrdered;
+	if (isMortonOrdered) {
+		uint32 bitsX = 0;
+		while ((1u << bitsX) < tileMap->mTileChunkCountX) {
+			++bitsX;
+		}
+		uint32 bitsY = 0;
+		while ((1u << bitsY) < tileMap->mTileChunkCountY) {
+			++bitsY;
+		}
+
+		Assert(tileMap->mChunkShift <= 16);
+		Assert((bitsX + bitsY) < 32);
+		tileMap->mChunkMortonSharedBits = Minimum(bitsX, bitsY);
+		tileMap->mChunkMortonAreaPerZ = (1 << (bitsX + bitsY));
+	}
+}
+
+inline uint32
+GetTileChunkIndex(tile_map* tileMap, uint32 tileChunkX, uint32 tileChunkY, uint32 tileChunkZ) {
+	uint32 result;
+	if (tileMap->mIsMortonOrdered) {
+		// The axes interleave their shared low bits, the longer axis keeps its remaining high bits on top
+		uint32 sharedBits = tileMap->mChunkMortonSharedBits;
+		uint32 sharedMask = (1 << sharedBits) - 1;
+		result = (tileChunkZ*tileMap->mChunkMortonAreaPerZ +
+				MortonEncode(tileChunkX & sharedMask, tileChunkY & sharedMask) +
+				(((tileChunkX | tileChunkY) >> sharedBits) << (2*sharedBits)));
+	}
+	else {
+		result = (tileChunkZ*tileMap->mTileChunkCountY*tileMap->mTileChunkCountX +
+				tileChunkY*tileMap->mTileChunkCountX +
+				tileChunkX);
+	}
+	return result;
+}
+
+// Chunk coordinates of a slot in the chunk array, the inverse of GetTileChunkIndex
+inline tile_chunk_location
+GetTileChunkLocation(tile_map* tileMap, uint32 chunkIndex) {
+	tile_chunk_location result = {};
+	if (tileMap->mIsMortonOrdered) {
+		uint32 sharedBits = tileMap->mChunkMortonSharedBits;
+		uint32 inner = chunkIndex & (tileMap->mChunkMortonAreaPerZ - 1);
+		uint32 interleaved = inner & ((1 << (2*sharedBits)) - 1);
+		uint32 high = (inner >> (2*sharedBits)) << sharedBits;
+		bool32 isXLonger = (tileMap->mTileChunkCountX > (1u << sharedBits));
+		result.mTileChunkX = MortonDecodeX(interleaved) | (isXLonger ? high : 0);
+		result.mTileChunkY = MortonDecodeY(interleaved) | (isXLonger ? 0 : high);
+		result.mTileChunkZ = chunkIndex / tileMap->mChunkMortonAreaPerZ;
+	}
+	else {
+		uint32 areaPerZ = tileMap->mTileChunkCountY*tileMap->mTileChunkCountX;
+		result.mTileChunkX = chunkIndex % tileMap->mTileChunkCountX;
+		result.mTileChunkY = (chunkIndex % areaPerZ) / tileMap->mTileChunkCountX;
+		result.mTileChunkZ = chunkIndex / areaPerZ;
+	}
+	return result;
+}
+
+// Position of a tile in the chunk's packed indices
+inline uint32
+GetTileIndexInChunk(tile_map* tileMap, uint32 tileX, uint32 tileY) {
+	uint32 result = tileMap->mIsMortonOrdered ? MortonEncode(tileX, tileY) : (tileY*tileMap->mChunkDim + tileX);
+	return result;
+}
+
+// Unpacked tile arrays, like world file records, are always row major whatever the packed order is
+inline uint32
+GetRowMajorTileIndex(tile_map* tileMap, uint32 tileIndex) {
+	uint32 result = tileIndex;
+	if (tileMap->mIsMortonOrdered) {
+		result = MortonDecodeY(tileIndex)*tileMap->mChunkDim + MortonDecodeX(tileIndex);
+	}
+	return result;
+}
+
+inline void
+InitializeTileChunkStorage(tile_map* tileMap, memory_areana* arena) {
+	tileMap->mChunkStorage.mArena = arena;
+}
+
+// Cold chunks are only compressed while this arena has room, so it bounds the memory compaction can use
+inline void
+InitializeTileChunkCompression(tile_map* tileMap, memory_areana* arena, memory_index compressedArenaSize) {
+	InitializeArena(&tileMap->mChunkStorage.mCompressedArena, compressedArenaSize,
+		(uint8*)PushSize_(arena, compressedArenaSize));
+}
+
+inline bool32
+IsTileChunkLoaded(tile_chunk* tileChunk) {
+	bool32 result = ((tileChunk->mPalette != 0) || (tileChunk->mCompressed != 0));
+	return result;
+}
+
+inline uint32
+GetBitsPerTileForPaletteCount(uint32 paletteCount) {
+	uint32 result = 1;
+	while ((uint32)(1 << result) < paletteCount) {
+		result *= 2;
+	}
+	return result;
+}
+
+inline uint32
+GetTileChunkIndexWordCount(tile_map* tileMap, uint32 bitsPerTile) {
+	uint32 result = (GetTileChunkTileCount(tileMap)*bitsPerTile + 31) / 32;
+	return result;
+}
+
+// Smallest power of two that holds the palette, never less than two entries
+inline uint32
+GetTilePaletteCapacity(uint32 paletteCount) {
+	uint32 result = 2;
+	while (result < paletteCount) {
+		result *= 2;
+	}
+	return result;
+}
+
+inline uint32
+GetTileChunkBlockClass(uint32 paletteCapacity) {
+	uint32 result = FindLeastSignificantSetBit(paletteCapacity).mIndex;
+	Assert((result > 0) && (result <= TILE_CHUNK_MAX_BITS_PER_TILE));
+	return result;
+}
+
+// A block is the palette followed by the packed indices at the bit depth the palette needs
+inline memory_index
+GetTileChunkBlockSize(tile_map* tileMap, uint32 paletteCapacity) {
+	uint32 bitsPerTile = GetBitsPerTileForPaletteCount(paletteCapacity);
+	memory_index result = (paletteCapacity + GetTileChunkIndexWordCount(tileMap, bitsPerTile))*sizeof(uint32);
+	return result;
+}
+
+// Bit depths are powers of two, so an index never straddles two words
+inline uint32
+GetTilePaletteIndex(uint32* indices, uint32 bitsPerTile, uint32 indexMask, uint32 tileIndex) {
+	uint32 bitIndex = tileIndex*bitsPerTile;
+	uint32 result = (indices[bitIndex >> 5] >> (bitIndex & 31)) & indexMask;
+	return result;
+}
+
+inline void
+SetTilePaletteIndex(uint32* indices, uint32 bitsPerTile, uint32 indexMask, uint32 tileIndex, uint32 paletteIndex) {
+	uint32 bitIndex = tileIndex*bitsPerTile;
+	uint32 shift = bitIndex & 31;
+	uint32* word = indices + (bitIndex >> 5);
+	*word = (*word & ~(indexMask << shift)) | (paletteIndex << shift);
+}
+
+internal void
+MakeTileChunkUniform(tile_chunk* tileChunk, uint32 tileValue) {
+	tileChunk->mIndices = &tileChunk->mUniformIndices;
+	tileChunk->mPalette = &tileChunk->mUniformValue;
+	tileChunk->mBitsPerTile = 0;
+	tileChunk->mIndexMask = 0;
+	tileChunk->mPaletteCount = 1;
+	tileChunk->mPaletteCapacity = 1;
+	tileChunk->mUniformIndices = 0;
+	tileChunk->mUniformValue = tileValue;
+}
+
+internal void
+FreeTileChunkBlock(tile_map* tileMap, uint32* block, uint32 paletteCapacity) {
+	tile_chunk_storage* storage = &tileMap->mChunkStorage;
+	uint32 blockClass = GetTileChunkBlockClass(paletteCapacity);
+
+	*(void**)block = storage->mFirstFreeBlock[blockClass];
+	storage->mFirstFreeBlock[blockClass] = block;
+	storage->mUsedBytes -= GetTileChunkBlockSize(tileMap, paletteCapacity);
+}
+
+// Gives the chunk an empty palette and zeroed indices at the bit depth the capacity needs
+internal void
+AllocateTileChunkBlock(tile_map* tileMap, tile_chunk* tileChunk, uint32 paletteCapacity) {
+	tile_chunk_storage* storage = &tileMap->mChunkStorage;
+	uint32 blockClass = GetTileChunkBlockClass(paletteCapacity);
+	Assert(paletteCapacity == (1u << blockClass));
+
+	memory_index blockSize = GetTileChunkBlockSize(tileMap, paletteCapacity);
+	Assert(blockSize >= sizeof(void*));
+
+	uint32* block = (uint32*)storage->mFirstFreeBlock[blockClass];
+	if (block) {
+		storage->mFirstFreeBlock[blockClass] = *(void**)block;
+	}
+	else {
+		Assert(storage->mArena);
+		block = (uint32*)PushSize_(storage->mArena, blockSize);
+	}
+	storage->mUsedBytes += blockSize;
+
+	uint32 bitsPerTile = GetBitsPerTileForPaletteCount(paletteCapacity);
+	tileChunk->mPalette = block;
+	tileChunk->mIndices = block + paletteCapacity;
+	tileChunk->mBitsPerTile = bitsPerTile;
+	tileChunk->mIndexMask = (1 << bitsPerTile) - 1;
+	tileChunk->mPaletteCount = 0;
+	tileChunk->mPaletteCapacity = paletteCapacity;
+
+	uint32 wordCount = GetTileChunkIndexWordCount(tileMap, bitsPerTile);
+	for (uint32 wordIndex = 0; wordIndex < wordCount; ++wordIndex) {
+		tileChunk->mIndices[wordIndex] = 0;
+	}
+}
+
+inline uint8*
+AllocateCompressedTileChunk(tile_chunk_storage* storage, uint32 size) {
+	uint8* result = 0;
+
+	uint32 granuleCount = (size + TILE_CHUNK_COMPRESSED_GRANULE_SIZE - 1) / TILE_CHUNK_COMPRESSED_GRANULE_SIZE;
+	memory_index granuleBytes = granuleCount*TILE_CHUNK_COMPRESSED_GRANULE_SIZE;
+	if (granuleCount <= TILE_CHUNK_COMPRESSED_CLASS_COUNT) {
+		memory_areana* arena = &storage->mCompressedArena;
+		result = (uint8*)storage->mFirstFreeCompressed[granuleCount];
+		if (result) {
+			storage->mFirstFreeCompressed[granuleCount] = *(void**)result;
+		}
+		else if ((arena->mUsed + granuleBytes) <= arena->mSize) {
+			result = (uint8*)PushSize_(arena, granuleBytes);
+		}
+	}
+
+	if (result) {
+		storage->mCompressedBytes += granuleBytes;
+	}
+
+	return result;
+}
+
+inline void
+FreeCompressedTileChunk(tile_chunk_storage* storage, uint8* compressed, uint32 size) {
+	uint32 granuleCount = (size + TILE_CHUNK_COMPRESSED_GRANULE_SIZE - 1) / TILE_CHUNK_COMPRESSED_GRANULE_SIZE;
+	Assert(granuleCount <= TILE_CHUNK_COMPRESSED_CLASS_COUNT);
+
+	*(void**)compressed = storage->mFirstFreeCompressed[granuleCount];
+	storage->mFirstFreeCompressed[granuleCount] = compressed;
+	storage->mCompressedBytes -= granuleCount*TILE_CHUNK_COMPRESSED_GRANULE_SIZE;
+}
+
+// Returns the chunk's memory (if any) to the free lists and marks it unloaded
+internal void
+FreeTileChunkStorage(tile_map* tileMap, tile_chunk* tileChunk) {
+	if (tileChunk->mCompressed) {
+		FreeCompressedTileChunk(&tileMap->mChunkStorage, tileChunk->mCompressed, tileChunk->mCompressedSize);
+		tileChunk->mCompressed = 0;
+		tileChunk->mCompressedSize = 0;
+		--tileMap->mChunkStorage.mCompressedChunkCount;
+	}
+	else if (tileChunk->mBitsPerTile) {
+		FreeTileChunkBlock(tileMap, tileChunk->mPalette, tileChunk->mPaletteCapacity);
+	}
+
+	tileChunk->mIndices = 0;
+	tileChunk->mPalette = 0;
+	tileChunk->mBitsPerTile = 0;
+	tileChunk->mIndexMask = 0;
+	tileChunk->mPaletteCount = 0;
+	tileChunk->mPaletteCapacity = 0;
+}
+
+// Doubles the palette once it is full. Indices are copied over as they are while the bit depth stays,
+// otherwise every one is re-packed.
+internal void
+PromoteTileChunk(tile_map* tileMap, tile_chunk* tileChunk) {
+	uint32* oldIndices = tileChunk->mIndices;
+	uint32* oldPalette = tileChunk->mPalette;
+	uint32 oldBitsPerTile = tileChunk->mBitsPerTile;
+	uint32 oldIndexMask = tileChunk->mIndexMask;
+	uint32 oldPaletteCapacity = tileChunk->mPaletteCapacity;
+	uint32 paletteCount = tileChunk->mPaletteCount;
+
+	AllocateTileChunkBlock(tileMap, tileChunk, 2*oldPaletteCapacity);
+
+	for (uint32 paletteIndex = 0; paletteIndex < paletteCount; ++paletteIndex) {
+		tileChunk->mPalette[paletteIndex] = oldPalette[paletteIndex];
+	}
+	tileChunk->mPaletteCount = paletteCount;
+
+	uint32 newBitsPerTile = tileChunk->mBitsPerTile;
+	if (newBitsPerTile == oldBitsPerTile) {
+		MemoryCopy(tileChunk->mIndices, oldIndices, GetTileChunkIndexWordCount(tileMap, newBitsPerTile)*sizeof(uint32));
+	}
+	else {
+		uint32 tileCount = GetTileChunkTileCount(tileMap);
+		for (uint32 tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
+			uint32 paletteIndex = GetTilePaletteIndex(oldIndices, oldBitsPerTile, oldIndexMask, tileIndex);
+			SetTilePaletteIndex(tileChunk->mIndices, newBitsPerTile, tileChunk->mIndexMask, tileIndex, paletteIndex);
+		}
+	}
+
+	if (oldBitsPerTile) {
+		FreeTileChunkBlock(tileMap, oldPalette, oldPaletteCapacity);
+	}
+}
+
+// Overwritten values stay in the palette, so this drops the entries no tile uses any more and renumbers
+// the indices in place. The tile about to be overwritten does not keep its value alive.
+internal void
+CompactTileChunkPalette(tile_map* tileMap, tile_chunk* tileChunk, uint32 overwrittenTileIndex) {
+	Assert(tileChunk->mBitsPerTile);
+
+	uint32 tileCount = GetTileChunkTileCount(tileMap);
+	uint32 bitsPerTile = tileChunk->mBitsPerTile;
+	uint32 indexMask = tileChunk->mIndexMask;
+	uint8 isUsed[TILE_CHUNK_MAX_PALETTE_COUNT] = {};
+	for (uint32 tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
+		if (tileIndex != overwrittenTileIndex) {
+			isUsed[GetTilePaletteIndex(tileChunk->mIndices, bitsPerTile, indexMask, tileIndex)] = 1;
+		}
+	}
+
+	uint32 newPaletteIndices[TILE_CHUNK_MAX_PALETTE_COUNT];
+	uint32 paletteCount = 0;
+	for (uint32 paletteIndex = 0; paletteIndex < tileChunk->mPaletteCount; ++paletteIndex) {
+		newPaletteIndices[paletteIndex] = 0;
+		if (isUsed[paletteIndex]) {
+			newPaletteIndices[paletteIndex] = paletteCount;
+			tileChunk->mPalette[paletteCount++] = tileChunk->mPalette[paletteIndex];
+		}
+	}
+
+	if (paletteCount < tileChunk->mPaletteCount) {
+		for (uint32 tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
+			uint32 paletteIndex = GetTilePaletteIndex(tileChunk->mIndices, bitsPerTile, indexMask, tileIndex);
+			SetTilePaletteIndex(tileChunk->mIndices, bitsPerTile, indexMask, tileIndex, newPaletteIndices[paletteIndex]);
+		}
+		tileChunk->mPaletteCount = paletteCount;
+	}
+}
+
+// The caller writes the value to overwrittenTileIndex right after, along with any other tiles it sets.
+// A full palette is compacted before it is promoted, and it never grows past TILE_CHUNK_MAX_PALETTE_COUNT.
+inline uint32
+GetOrAddTilePaletteIndex(tile_map* tileMap, tile_chunk* tileChunk, uint32 tileValue, uint32 overwrittenTileIndex) {
+	uint32 paletteIndex = 0;
+	while ((paletteIndex < tileChunk->mPaletteCount) && (tileChunk->mPalette[paletteIndex] != tileValue)) {
+		++paletteIndex;
+	}
+
+	if (paletteIndex == tileChunk->mPaletteCount) {
+		if ((tileChunk->mPaletteCount == tileChunk->mPaletteCapacity) && tileChunk->mBitsPerTile) {
+			CompactTileChunkPalette(tileMap, tileChunk, overwrittenTileIndex);
+		}
+		if ((tileChunk->mPaletteCount == tileChunk->mPaletteCapacity) &&
+			(tileChunk->mPaletteCapacity < TILE_CHUNK_MAX_PALETTE_COUNT)) {
+			PromoteTileChunk(tileMap, tileChunk);
+		}
+
+		// Only chunks with more tiles than the deepest palette has entries can still be full, and like
+		// EncodeTileChunk they cannot hold another value, so the tile keeps the one it has
+		Assert(tileChunk->mPaletteCount < tileChunk->mPaletteCapacity);
+		if (tileChunk->mPaletteCount < tileChunk->mPaletteCapacity) {
+			paletteIndex = tileChunk->mPaletteCount++;
+			tileChunk->mPalette[paletteIndex] = tileValue;
+		}
+		else {
+			paletteIndex = GetTilePaletteIndex(tileChunk->mIndices, tileChunk->mBitsPerTile, tileChunk->mIndexMask,
+				overwrittenTileIndex);
+		}
+	}
+
+	return paletteIndex;
+}
+
+inline uint32
+GetTileValueUnchecked(tile_map* tileMap, tile_chunk* tileChunk, uint32 tileX, uint32 tileY) {
+	Assert(tileChunk);
+	Assert(tileX < tileMap->mChunkDim);
+	Assert(tileY < tileMap->mChunkDim);
+
+	// No branch on the bit depth: a uniform chunk shifts by zero and masks everything away
+	uint32 paletteIndex = GetTilePaletteIndex(tileChunk->mIndices, tileChunk->mBitsPerTile, tileChunk->mIndexMask,
+		GetTileIndexInChunk(tileMap, tileX, tileY));
+	uint32 tileChunkValue = tileChunk->mPalette[paletteIndex];
+	return tileChunkValue;
+}
+
+inline void
+SetTileValueUnchecked(tile_map* tileMap, tile_chunk* tileChunk, uint32 tileX, uint32 tileY, uint32 tileValue) {
+	Assert(tileChunk);
+	Assert(tileX < tileMap->mChunkDim);
+	Assert(tileY < tileMap->mChunkDim);
+
+	uint32 tileIndex = GetTileIndexInChunk(tileMap, tileX, tileY);
+	uint32 paletteIndex = GetOrAddTilePaletteIndex(tileMap, tileChunk, tileValue, tileIndex);
+	SetTilePaletteIndex(tileChunk->mIndices, tileChunk->mBitsPerTile, tileChunk->mIndexMask, tileIndex, paletteIndex);
+	tileChunk->mIsDirty = true;
+}
+
+// Sets count packed indices from firstIndex on. Everything between the two partial end words is
+// written a whole word at a time with the index repeated across it.
+internal void
+FillTilePaletteIndices(uint32* indices, uint32 bitsPerTile, uint32 firstIndex, uint32 count, uint32 paletteIndex) {
+	Assert((bitsPerTile > 0) && (count > 0));
+
+	uint32 pattern = paletteIndex*(UInt32Max / ((1 << bitsPerTile) - 1));
+	uint32 firstBit = firstIndex*bitsPerTile;
+	uint32 onePastLastBit = (firstIndex + count)*bitsPerTile;
+	uint32 firstWord = firstBit >> 5;
+	uint32 lastWord = (onePastLastBit - 1) >> 5;
+	uint32 firstMask = UInt32Max << (firstBit & 31);
+	uint32 lastMask = UInt32Max >> ((32 - (onePastLastBit & 31)) & 31);
+
+	if (firstWord == lastWord) {
+		uint32 mask = firstMask & lastMask;
+		indices[firstWord] = (indices[firstWord] & ~mask) | (pattern & mask);
+	}
+	else {
+		indices[firstWord] = (indices[firstWord] & ~firstMask) | (pattern & firstMask);
+		for (uint32 wordIndex = firstWord + 1; wordIndex < lastWord; ++wordIndex) {
+			indices[wordIndex] = pattern;
+		}
+		indices[lastWord] = (indices[lastWord] & ~lastMask) | (pattern & lastMask);
+	}
+}
+
+// Adds the indices to the run, filling the run first if they do not continue it
+inline void
+AppendTileIndexRun(tile_chunk* tileChunk, tile_index_run* run, uint32 firstIndex, uint32 count, uint32 paletteIndex) {
+	if (run->mCount && ((run->mFirstIndex + run->mCount) == firstIndex)) {
+		run->mCount += count;
+	}
+	else {
+		if (run->mCount) {
+			FillTilePaletteIndices(tileChunk->mIndices, tileChunk->mBitsPerTile, run->mFirstIndex, run->mCount, paletteIndex);
+		}
+		run->mFirstIndex = firstIndex;
+		run->mCount = count;
+	}
+}
+
+// In Morton order every aligned square block is one run of indices, so the rect is split into the
+// largest blocks it covers. Blocks are visited in index order, which lets neighbors merge into one run.
+internal void
+FillTileChunkMortonBlock(tile_chunk* tileChunk, tile_index_run* run, uint32 blockX, uint32 blockY, uint32 blockDim,
+						 uint32 minTileX, uint32 minTileY, uint32 onePastMaxTileX, uint32 onePastMaxTileY, uint32 paletteIndex) {
+	if ((blockX < onePastMaxTileX) && (blockY < onePastMaxTileY) &&
+		((blockX + blockDim) > minTileX) && ((blockY + blockDim) > minTileY)) {
+		if ((blockX >= minTileX) && (blockY >= minTileY) &&
+			((blockX + blockDim) <= onePastMaxTileX) && ((blockY + blockDim) <= onePastMaxTileY)) {
+			AppendTileIndexRun(tileChunk, run, MortonEncode(blockX, blockY), blockDim*blockDim, paletteIndex);
+		}
+		else {
+			uint32 halfDim = blockDim / 2;
+			FillTileChunkMortonBlock(tileChunk, run, blockX, blockY, halfDim,
+				minTileX, minTileY, onePastMaxTileX, onePastMaxTileY, paletteIndex);
+			FillTileChunkMortonBlock(tileChunk, run, blockX + halfDim, blockY, halfDim,
+				minTileX, minTileY, onePastMaxTileX, onePastMaxTileY, paletteIndex);
+			FillTileChunkMortonBlock(tileChunk, run, blockX, blockY + halfDim, halfDim,
+				minTileX, minTileY, onePastMaxTileX, onePastMaxTileY, paletteIndex);
+			FillTileChunkMortonBlock(tileChunk, run, blockX + halfDim, blockY + halfDim, halfDim,
+				minTileX, minTileY, onePastMaxTileX, onePastMaxTileY, paletteIndex);
+		}
+	}
+}
+
+// Sets every tile of the chunk relative rect to the value. A rect covering the whole chunk leaves it
+// uniform without tile storage. Returns false when the chunk was already uniformly that value.
+internal bool32
+FillTileChunkRect(tile_map* tileMap, tile_chunk* tileChunk, uint32 minTileX, uint32 minTileY,
+				  uint32 onePastMaxTileX, uint32 onePastMaxTileY, uint32 tileValue) {
+	Assert(IsTileChunkLoaded(tileChunk) && !tileChunk->mCompressed);
+	Assert((minTileX < onePastMaxTileX) && (onePastMaxTileX <= tileMap->mChunkDim));
+	Assert((minTileY < onePastMaxTileY) && (onePastMaxTileY <= tileMap->mChunkDim));
+
+	bool32 result = false;
+	if (tileChunk->mBitsPerTile || (tileChunk->mUniformValue != tileValue)) {
+		result = true;
+		if ((minTileX == 0) && (minTileY == 0) &&
+			(onePastMaxTileX == tileMap->mChunkDim) && (onePastMaxTileY == tileMap->mChunkDim)) {
+			if (tileChunk->mBitsPerTile) {
+				FreeTileChunkBlock(tileMap, tileChunk->mPalette, tileChunk->mPaletteCapacity);
+			}
+			MakeTileChunkUniform(tileChunk, tileValue);
+		}
+		else {
+			uint32 paletteIndex = GetOrAddTilePaletteIndex(tileMap, tileChunk, tileValue,
+				GetTileIndexInChunk(tileMap, minTileX, minTileY));
+			if (tileMap->mIsMortonOrdered) {
+				tile_index_run run = {};
+				FillTileChunkMortonBlock(tileChunk, &run, 0, 0, tileMap->mChunkDim,
+					minTileX, minTileY, onePastMaxTileX, onePastMaxTileY, paletteIndex);
+				FillTilePaletteIndices(tileChunk->mIndices, tileChunk->mBitsPerTile, run.mFirstIndex, run.mCount, paletteIndex);
+			}
+			else {
+				for (uint32 tileY = minTileY; tileY < onePastMaxTileY; ++tileY) {
+					FillTilePaletteIndices(tileChunk->mIndices, tileChunk->mBitsPerTile,
+						tileY*tileMap->mChunkDim + minTileX, onePastMaxTileX - minTileX, paletteIndex);
+				}
+			}
+		}
+		tileChunk->mIsDirty = true;
+	}
+	return result;
+}
+
+// Packs a full array of tile values at the smallest bit depth that holds their palette. Returns false,
+// leaving the chunk unloaded, when the tiles have more distinct values than the deepest palette holds.
+internal bool32
+EncodeTileChunk(tile_map* tileMap, tile_chunk* tileChunk, uint32* tiles) {
+	Assert(!IsTileChunkLoaded(tileChunk));
+
+	uint32 tileCount = GetTileChunkTileCount(tileMap);
+	uint32 palette[TILE_CHUNK_MAX_PALETTE_COUNT];
+	uint32 paletteCount = 0;
+	for (uint32 tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
+		uint32 paletteIndex = 0;
+		while ((paletteIndex < paletteCount) && (palette[paletteIndex] != tiles[tileIndex])) {
+			++paletteIndex;
+		}
+		if (paletteIndex == paletteCount) {
+			if (paletteCount == TILE_CHUNK_MAX_PALETTE_COUNT) {
+				return false;
+			}
+			palette[paletteCount++] = tiles[tileIndex];
+		}
+	}
+
+	if (paletteCount == 1) {
+		MakeTileChunkUniform(tileChunk, palette[0]);
+	}
+	else {
+		AllocateTileChunkBlock(tileMap, tileChunk, GetTilePaletteCapacity(paletteCount));
+		uint32 bitsPerTile = tileChunk->mBitsPerTile;
+		for (uint32 paletteIndex = 0; paletteIndex < paletteCount; ++paletteIndex) {
+			tileChunk->mPalette[paletteIndex] = palette[paletteIndex];
+		}
+		tileChunk->mPaletteCount = paletteCount;
+
+		for (uint32 tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
+			uint32 tileValue = tiles[GetRowMajorTileIndex(tileMap, tileIndex)];
+			uint32 paletteIndex = 0;
+			while (palette[paletteIndex] != tileValue) {
+				++paletteIndex;
+			}
+			SetTilePaletteIndex(tileChunk->mIndices, bitsPerTile, tileChunk->mIndexMask, tileIndex, paletteIndex);
+		}
+	}
+	return true;
+}
+
+internal void
+DecodeTileChunk(tile_map* tileMap, tile_chunk* tileChunk, uint32* tiles) {
+	Assert(IsTileChunkLoaded(tileChunk));
+
+	uint32 tileCount = GetTileChunkTileCount(tileMap);
+	for (uint32 tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
+		uint32 paletteIndex = GetTilePaletteIndex(tileChunk->mIndices, tileChunk->mBitsPerTile, tileChunk->mIndexMask, tileIndex);
+		tiles[GetRowMajorTileIndex(tileMap, tileIndex)] = tileChunk->mPalette[paletteIndex];
+	}
+}
+
+/*
+ * Compressed chunk layout:
+ *   uint8 paletteCount - 1
+ *   uint8 flags             low bits are the bit depth, TILE_CHUNK_COMPRESSED_BYTE_PALETTE
+ *   palette[paletteCount]   uint8 entries with the byte palette flag, uint32 otherwise
+ *   commands until every row is covered:
+ *     0x80 | (n - 1)        the previous row repeats n times
+ *     0x00 | (n - 1)        n literal rows of packed indices follow
+ *
+ * Packed indices are little endian, so a row of a chunk is a contiguous run of bytes.
+ * Walls and floors repeat row after row, which is what the repeat command captures.
+ * In Morton order a "row" is mChunkDim consecutive packed tiles, a small square block.
+ */
+#define TILE_CHUNK_COMPRESSED_BYTE_PALETTE 0x80
+#define TILE_CHUNK_COMPRESSED_REPEAT 0x80
+#define TILE_CHUNK_COMPRESSED_MAX_RUN 128
+
+inline bool32
+AreTileChunkRowsEqual(uint8* a, uint8* b, uint32 rowBytes) {
+	bool32 result = true;
+	for (uint32 byteIndex = 0; byteIndex < rowBytes; ++byteIndex) {
+		if (a[byteIndex] != b[byteIndex]) {
+			result = false;
+			break;
+		}
+	}
+	return result;
+}
+
+// Returns the compressed size, writing the data out when dest is not null
+internal uint32
+WriteCompressedTileChunk(tile_map* tileMap, tile_chunk* tileChunk, uint8* dest) {
+	uint32 rowBytes = (tileMap->mChunkDim*tileChunk->mBitsPerTile) / 8;
+	uint8* rows = (uint8*)tileChunk->mIndices;
+
+	bool32 isBytePalette = true;
+	for (uint32 paletteIndex = 0; paletteIndex < tileChunk->mPaletteCount; ++paletteIndex) {
+		if (tileChunk->mPalette[paletteIndex] > 0xFF) {
+			isBytePalette = false;
+		}
+	}
+
+	uint32 size = 2 + tileChunk->mPaletteCount*(isBytePalette ? sizeof(uint8) : sizeof(uint32));
+	if (dest) {
+		dest[0] = (uint8)(tileChunk->mPaletteCount - 1);
+		dest[1] = (uint8)(tileChunk->mBitsPerTile | (isBytePalette ? TILE_CHUNK_COMPRESSED_BYTE_PALETTE : 0));
+		for (uint32 paletteIndex = 0; paletteIndex < tileChunk->mPaletteCount; ++paletteIndex) {
+			if (isBytePalette) {
+				dest[2 + paletteIndex] = (uint8)tileChunk->mPalette[paletteIndex];
+			}
+			else {
+				MemoryCopy(dest + 2 + paletteIndex*sizeof(uint32), &tileChunk->mPalette[paletteIndex], sizeof(uint32));
+			}
+		}
+	}
+
+	uint32 rowIndex = 0;
+	while (rowIndex < tileMap->mChunkDim) {
+		uint32 runLength = 0;
+		bool32 isRepeat = ((rowIndex > 0) &&
+			AreTileChunkRowsEqual(rows + rowIndex*rowBytes, rows + (rowIndex - 1)*rowBytes, rowBytes));
+		if (isRepeat) {
+			while (((rowIndex + runLength) < tileMap->mChunkDim) && (runLength < TILE_CHUNK_COMPRESSED_MAX_RUN) &&
+				AreTileChunkRowsEqual(rows + (rowIndex + runLength)*rowBytes, rows + (rowIndex - 1)*rowBytes, rowBytes)) {
+				++runLength;
+			}
+		}
+		else {
+			// Literal rows run until the next row that repeats its predecessor
+			runLength = 1;
+			while (((rowIndex + runLength) < tileMap->mChunkDim) && (runLength < TILE_CHUNK_COMPRESSED_MAX_RUN) &&
+				!AreTileChunkRowsEqual(rows + (rowIndex + runLength)*rowBytes, rows + (rowIndex + runLength - 1)*rowBytes, rowBytes)) {
+				++runLength;
+			}
+		}
+
+		if (dest) {
+			dest[size] = (uint8)((runLength - 1) | (isRepeat ? TILE_CHUNK_COMPRESSED_REPEAT : 0));
+			if (!isRepeat) {
+				MemoryCopy(dest + size + 1, rows + rowIndex*rowBytes, runLength*rowBytes);
+			}
+		}
+		size += 1 + (isRepeat ? 0 : runLength*rowBytes);
+		rowIndex += runLength;
+	}
+
+	return size;
+}
+
+// Replaces a packed chunk with its compressed rows. Leaves the chunk packed and returns false when that
+// would not be smaller than the packed block or the compressed arena is out of room.
+internal bool32
+CompressTileChunk(tile_map* tileMap, tile_chunk* tileChunk) {
+	bool32 result = false;
+
+	// Uniform chunks already take no tile memory, and rows must start on a byte
+	if (tileChunk->mPalette && tileChunk->mBitsPerTile &&
+		(((tileMap->mChunkDim*tileChunk->mBitsPerTile) % 8) == 0)) {
+		tile_chunk_storage* storage = &tileMap->mChunkStorage;
+
+		uint32 compressedSize = WriteCompressedTileChunk(tileMap, tileChunk, 0);
+		if (compressedSize < GetTileChunkBlockSize(tileMap, tileChunk->mPaletteCapacity)) {
+			uint8* compressed = AllocateCompressedTileChunk(storage, compressedSize);
+			if (compressed) {
+				WriteCompressedTileChunk(tileMap, tileChunk, compressed);
+
+				FreeTileChunkBlock(tileMap, tileChunk->mPalette, tileChunk->mPaletteCapacity);
+				tileChunk->mIndices = 0;
+				tileChunk->mPalette = 0;
+				tileChunk->mBitsPerTile = 0;
+				tileChunk->mIndexMask = 0;
+				tileChunk->mPaletteCount = 0;
+				tileChunk->mPaletteCapacity = 0;
+
+				tileChunk->mCompressed = compressed;
+				tileChunk->mCompressedSize = compressedSize;
+				++storage->mCompressedChunkCount;
+				result = true;
+			}
+		}
+	}
+
+	return result;
+}
+
+internal void
+DecompressTileChunk(tile_map* tileMap, tile_chunk* tileChunk) {
+	tile_chunk_storage* storage = &tileMap->mChunkStorage;
+	Assert(tileChunk->mCompressed);
+
+	uint8* source = tileChunk->mCompressed;
+	uint32 paletteCount = (uint32)source[0] + 1;
+	uint32 bitsPerTile = source[1] & ~TILE_CHUNK_COMPRESSED_BYTE_PALETTE;
+	bool32 isBytePalette = (source[1] & TILE_CHUNK_COMPRESSED_BYTE_PALETTE);
+	source += 2;
+
+	AllocateTileChunkBlock(tileMap, tileChunk, GetTilePaletteCapacity(paletteCount));
+	Assert(tileChunk->mBitsPerTile == bitsPerTile);
+	for (uint32 paletteIndex = 0; paletteIndex < paletteCount; ++paletteIndex) {
+		if (isBytePalette) {
+			tileChunk->mPalette[paletteIndex] = source[paletteIndex];
+		}
+		else {
+			// The palette is only byte aligned
+			MemoryCopy(&tileChunk->mPalette[paletteIndex], source + paletteIndex*sizeof(uint32), sizeof(uint32));
+		}
+	}
+	tileChunk->mPaletteCount = paletteCount;
+	source += paletteCount*(isBytePalette ? sizeof(uint8) : sizeof(uint32));
+
+	uint32 rowBytes = (tileMap->mChunkDim*bitsPerTile) / 8;
+	uint8* rows = (uint8*)tileChunk->mIndices;
+	uint32 rowIndex = 0;
+	while (rowIndex < tileMap->mChunkDim) {
+		uint8 command = *source++;
+		uint32 runLength = (uint32)(command & ~TILE_CHUNK_COMPRESSED_REPEAT) + 1;
+		if (command & TILE_CHUNK_COMPRESSED_REPEAT) {
+			for (uint32 runRow = 0; runRow < runLength; ++runRow) {
+				MemoryCopy(rows + (rowIndex + runRow)*rowBytes, rows + (rowIndex - 1)*rowBytes, rowBytes);
+			}
+		}
+		else {
+			MemoryCopy(rows + rowIndex*rowBytes, source, runLength*rowBytes);
+			source += runLength*rowBytes;
+		}
+		rowIndex += runLength;
+	}
+	Assert(rowIndex == tileMap->mChunkDim);
+	Assert((uint32)(source - tileChunk->mCompressed) == tileChunk->mCompressedSize);
+
+	FreeCompressedTileChunk(storage, tileChunk->mCompressed, tileChunk->mCompressedSize);
+	tileChunk->mCompressed = 0;
+	tileChunk->mCompressedSize = 0;
+	--storage->mCompressedChunkCount;
+	++storage->mDecompressionCount;
+}
+
+// Reads one tile straight from the compressed rows, leaving the chunk as it is so readers on any
+// thread can see a cold chunk. A repeated row reads from the last literal row before it.
+internal uint32
+GetCompressedTileValue(tile_map* tileMap, tile_chunk* tileChunk, uint32 tileX, uint32 tileY) {
+	Assert(tileChunk->mCompressed);
+
+	uint8* source = tileChunk->mCompressed;
+	uint32 paletteCount = (uint32)source[0] + 1;
+	uint32 bitsPerTile = source[1] & ~TILE_CHUNK_COMPRESSED_BYTE_PALETTE;
+	bool32 isBytePalette = (source[1] & TILE_CHUNK_COMPRESSED_BYTE_PALETTE);
+	uint8* palette = source + 2;
+	source = palette + paletteCount*(isBytePalette ? sizeof(uint8) : sizeof(uint32));
+
+	uint32 tileIndex = GetTileIndexInChunk(tileMap, tileX, tileY);
+	uint32 wantedRow = tileIndex >> tileMap->mChunkShift;
+	uint32 rowBytes = (tileMap->mChunkDim*bitsPerTile) / 8;
+	uint8* literalRow = 0;
+	uint32 rowIndex = 0;
+	for (;;) {
+		uint8 command = *source++;
+		uint32 runLength = (uint32)(command & ~TILE_CHUNK_COMPRESSED_REPEAT) + 1;
+		if (!(command & TILE_CHUNK_COMPRESSED_REPEAT)) {
+			if (wantedRow < (rowIndex + runLength)) {
+				literalRow = source + (wantedRow - rowIndex)*rowBytes;
+				break;
+			}
+			literalRow = source + (runLength - 1)*rowBytes;
+			source += runLength*rowBytes;
+		}
+		else if (wantedRow < (rowIndex + runLength)) {
+			break;
+		}
+		rowIndex += runLength;
+		Assert(rowIndex < tileMap->mChunkDim);
+	}
+
+	// Bit depths are powers of two up to 8, so an index never straddles two bytes
+	uint32 bitIndex = (tileIndex & tileMap->mChunkMask)*bitsPerTile;
+	uint32 paletteIndex = (literalRow[bitIndex >> 3] >> (bitIndex & 7)) & ((1 << bitsPerTile) - 1);
+	Assert(paletteIndex < paletteCount);
+
+	uint32 result;
+	if (isBytePalette) {
+		result = palette[paletteIndex];
+	}
+	else {
+		MemoryCopy(&result, palette + paletteIndex*sizeof(uint32), sizeof(uint32));
+	}
+	return result;
+}
+
+// Visits a bounded slice of the chunks each call and compresses the packed ones that have not been
+// written or kept resident around the camera for coldFrameCount frames. Returns how many were compressed.
+internal uint32
+CompactColdTileChunks(tile_map* tileMap, uint32 coldFrameCount, uint32 chunksPerPass) {
+	TIMED_FUNCTION();
+	tile_chunk_storage* storage = &tileMap->mChunkStorage;
+	uint32 chunkCount = GetTileChunkCount(tileMap);
+	uint32 compressedCount = 0;
+
+	for (uint32 visitIndex = 0; (visitIndex < chunksPerPass) && (visitIndex < chunkCount); ++visitIndex) {
+		if (storage->mCompactionCursor >= chunkCount) {
+			storage->mCompactionCursor = 0;
+		}
+
+		tile_chunk* tileChunk = &tileMap->mTileChunks[storage->mCompactionCursor++];
+		if (tileChunk->mPalette && tileChunk->mBitsPerTile &&
+			((tileMap->mFrameIndex - tileChunk->mLastUsedFrame) >= coldFrameCount)) {
+			if (CompressTileChunk(tileMap, tileChunk)) {
+				++compressedCount;
+			}
+		}
+	}
+
+	return compressedCount;
+}
+
+// True when the change may have altered how paths cross the chunk
+inline bool32
+DoesTileChangeMovePaths(tile_change* change) {
+	uint32 pathKinds = (change->mOldKinds | change->mNewKinds) & TILE_EDIT_PATH_KINDS;
+	bool32 result = ((change->mType == TILE_CHANGE_LOAD) ||
+					((change->mType == TILE_CHANGE_EDIT) && (pathKinds & (pathKinds - 1))));
+	return result;
+}
+
+// True when the change may have cut a path through the chunk. Opening tiles or turning
+// floor into a z-door only ever joins, and so does a chunk paging in.
+inline bool32
+MayTileChangeDisconnect(tile_change* change) {
+	bool32 result = ((change->mType == TILE_CHANGE_EDIT) && DoesTileChangeMovePaths(change) &&
+					((change->mNewKinds & (1 << TILE_PATH_CLASS_BLOCKED)) ||
+					(change->mOldKinds & ((1 << TILE_PATH_CLASS_DOOR_UP) | (1 << TILE_PATH_CLASS_DOOR_DOWN)))));
+	return result;
+}
+
+// True when tiles of an edit may have started or stopped letting light through
+inline bool32
+DoesTileChangeMoveLight(tile_change* change) {
+	bool32 result = ((change->mType == TILE_CHANGE_EDIT) &&
+					(((change->mOldKinds | change->mNewKinds) & TILE_EDIT_LIGHT_KINDS) == TILE_EDIT_LIGHT_KINDS));
+	return result;
+}
+
+// For whole chunks appearing or going away, every viewer rescans
+internal void
+InvalidateTileFov(tile_map* tileMap) {
+	tile_fov_map* fov = tileMap->mFov;
+	if (fov) {
+		for (uint32 viewerIndex = 0; viewerIndex < TILE_FOV_MAX_VIEWERS; ++viewerIndex) {
+			if (fov->mViewers[viewerIndex].mIsActive) {
+				fov->mViewers[viewerIndex].mNeedsUpdate = true;
+			}
+		}
+	}
+}
+
+// The callback runs every time a tile of a chunk changes, so it should only note the change down.
+// Subscribers stay for the life of the tile map. Returns a handle for RefreshTileSubscription.
+internal uint32
+SubscribeToTileChanges(tile_map* tileMap, tile_chunk_changed* callback, void* subscriberData) {
+	Assert(callback);
+
+	uint32 subscriberIndex = 0;
+	while ((subscriberIndex < TILE_MAX_SUBSCRIBERS) && tileMap->mSubscribers[subscriberIndex].mCallback) {
+		++subscriberIndex;
+	}
+	Assert(subscriberIndex < TILE_MAX_SUBSCRIBERS);
+
+	tileMap->mSubscribers[subscriberIndex].mCallback = callback;
+	tileMap->mSubscribers[subscriberIndex].mData = subscriberData;
+	return subscriberIndex;
+}
+
+// A reload moves the game code and with it every callback, subscribers that outlive it hand
+// theirs in again each frame. The handle and the data stay as they were.
+inline void
+RefreshTileSubscription(tile_map* tileMap, uint32 subscriberIndex, tile_chunk_changed* callback) {
+	Assert(subscriberIndex < TILE_MAX_SUBSCRIBERS);
+	Assert(tileMap->mSubscribers[subscriberIndex].mCallback);
+	tileMap->mSubscribers[subscriberIndex].mCallback = callback;
+}
+
+// Bumps the chunk's edit version, and its path version when paths across it may have changed,
+// then tells every subscriber
+internal void
+NotifyTileChunkChanged(tile_map* tileMap, tile_chunk* tileChunk, tile_change* change) {
+	++tileChunk->mEditVersion;
+	if (DoesTileChangeMovePaths(change)) {
+		++tileChunk->mPathVersion;
+	}
+
+	change->mChunkIndex = (uint32)(tileChunk - tileMap->mTileChunks);
+	for (uint32 subscriberIndex = 0; subscriberIndex < TILE_MAX_SUBSCRIBERS; ++subscriberIndex) {
+		tile_subscriber* subscriber = tileMap->mSubscribers + subscriberIndex;
+		if (subscriber->mCallback) {
+			subscriber->mCallback(tileMap, subscriber->mData, change);
+		}
+	}
+}
+
+// For the whole chunk paging in or out, TILE_CHANGE_LOAD or TILE_CHANGE_EVICT
+inline void
+NotifyTileChunkChanged(tile_map* tileMap, tile_chunk* tileChunk, uint32 changeType) {
+	tile_change change = {};
+	change.mType = changeType;
+	NotifyTileChunkChanged(tileMap, tileChunk, &change);
+}
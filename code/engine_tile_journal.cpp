@@ -0,0 +1,96 @@
+/*
+ * Author: Jheremy Strom
+ */
+
+internal void
+InitializeTileJournal(tile_map* tileMap, tile_journal* journal, memory_areana* arena, uint32 editCapacity, uint32 batchCapacity) {
+	Assert((editCapacity > 0) && (batchCapacity > 0));
+
+	journal->mEdits = PushArray(arena, editCapacity, tile_edit);
+	journal->mEditCapacity = editCapacity;
+	journal->mNextEdit = 0;
+
+	journal->mBatches = PushArray(arena, batchCapacity, tile_edit_batch);
+	journal->mBatchCapacity = batchCapacity;
+	journal->mOldestBatch = 0;
+	journal->mUndoBatch = 0;
+	journal->mNewestBatch = 0;
+
+	journal->mBatchDepth = 0;
+	journal->mHasOpenBatch = false;
+	journal->mIsBatchLost = false;
+	journal->mIsReplaying = false;
+
+	journal->mUndoCount = 0;
+	journal->mRedoCount = 0;
+	journal->mLostBatchCount = 0;
+
+	tileMap->mJournal = journal;
+}
+
+// Caches that keep the version they were built from can compare it against this
+inline uint32
+GetTileChunkEditVersion(tile_map* tileMap, uint32 tileChunkX, uint32 tileChunkY, uint32 tileChunkZ) {
+	uint32 result = 0;
+	if ((tileChunkX < tileMap->mTileChunkCountX) &&
+		(tileChunkY < tileMap->mTileChunkCountY) &&
+		(tileChunkZ < tileMap->mTileChunkCountZ)) {
+		result = tileMap->mTileChunks[GetTileChunkIndex(tileMap, tileChunkX, tileChunkY, tileChunkZ)].mEditVersion;
+	}
+	return result;
+}
+
+inline bool32
+CanUndoTileEdits(tile_map* tileMap) {
+	tile_journal* journal = tileMap->mJournal;
+	bool32 result = (journal && (journal->mUndoBatch > journal->mOldestBatch));
+	return result;
+}
+
+inline bool32
+CanRedoTileEdits(tile_map* tileMap) {
+	tile_journal* journal = tileMap->mJournal;
+	bool32 result = (journal && (journal->mUndoBatch < journal->mNewestBatch));
+	return result;
+}
+
+// Writes the batch's old values newest first, or its new values oldest first, through SetTileValue
+// so every cache hears about the change as if it were a fresh edit
+internal void
+ReplayTileEditBatch(tile_map* tileMap, tile_edit_batch* batch, bool32 isUndo) {
+	tile_journal* journal = tileMap->mJournal;
+	journal->mIsReplaying = true;
+	for (uint32 stepIndex = 0; stepIndex < batch->mEditCount; ++stepIndex) {
+		uint32 editIndex = isUndo ? (batch->mEditCount - 1 - stepIndex) : stepIndex;
+		tile_edit* edit = journal->mEdits + ((batch->mFirstEdit + editIndex) % journal->mEditCapacity);
+		SetTileValue(tileMap, edit->mAbsTileX, edit->mAbsTileY, edit->mAbsTileZ, isUndo ? edit->mOldValue : edit->mNewValue);
+	}
+	journal->mIsReplaying = false;
+}
+
+// Returns false when there is nothing left to undo
+internal bool32
+UndoTileEdits(tile_map* tileMap) {
+	bool32 result = CanUndoTileEdits(tileMap);
+	if (result) {
+		tile_journal* journal = tileMap->mJournal;
+		Assert(journal->mBatchDepth == 0);
+		--journal->mUndoBatch;
+		ReplayTileEditBatch(tileMap, journal->mBatches + (journal->mUndoBatch % journal->mBatchCapacity), true);
+		++journal->mUndoCount;
+	}
+	return result;
+}
+
+internal bool32
+RedoTileEdits(tile_map* tileMap) {
+	bool32 result = CanRedoTileEdits(tileMap);
+	if (result) {
+		tile_journal* journal = tileMap->mJournal;
+		Assert(journal->mBatchDepth == 0);
+		ReplayTileEditBatch(tileMap, journal->mBatches + (journal->mUndoBatch % journal->mBatchCapacity), false);
+		++journal->mUndoBatch;
+		++journal->mRedoCount;
+	}
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,58 @@
+#if !defined(ENGINE_TILE_JOURNAL_H)
+
+/*
+ * Author: Jheremy Strom
+ */
+
+/*
+ * The tile journal records the old and new value of every tile written while it is attached,
+ * grouped into batches that undo and redo as one step. Edits live in a ring, so the oldest
+ * batches are forgotten once it fills. Undo and redo write through SetTileValue, so the tile
+ * map's subscribers hear about them like about any other edit.
+ */
+
+struct tile_edit {
+	uint32 mChunkIndex;
+	tile_coord mAbsTileX;
+	tile_coord mAbsTileY;
+	uint32 mAbsTileZ;
+	uint32 mOldValue;
+	uint32 mNewValue;
+};
+
+struct tile_edit_batch {
+	// Position of the first edit, counting every edit ever recorded
+	uint64 mFirstEdit;
+	uint32 mEditCount;
+};
+
+struct tile_journal {
+	tile_edit* mEdits;
+	uint32 mEditCapacity;
+	uint64 mNextEdit;
+
+	// Batches from mOldestBatch up to mUndoBatch can be undone, from there up to mNewestBatch redone
+	tile_edit_batch* mBatches;
+	uint32 mBatchCapacity;
+	uint64 mOldestBatch;
+	uint64 mUndoBatch;
+	uint64 mNewestBatch;
+
+	// Batches nest, only the outermost one becomes an undo step. Its slot is only taken by
+	// its first edit, so a batch that changes nothing leaves the redo history alone.
+	uint32 mBatchDepth;
+	bool32 mHasOpenBatch;
+
+	// Set when the open batch alone outgrew the ring, it is dropped when it closes
+	bool32 mIsBatchLost;
+
+	// Undo and redo write through SetTileValue without recording
+	bool32 mIsReplaying;
+
+	uint32 mUndoCount;
+	uint32 mRedoCount;
+	uint32 mLostBatchCount;
+};
+
+#define ENGINE_TILE_JOURNAL_H
+#endif
\ No newline at end of file
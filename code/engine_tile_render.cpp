@@ -0,0 +1,346 @@
+/*
+ * Author: Jheremy Strom
+ */
+
+inline void
+UnlinkTileRenderEntry(tile_render_entry* entry) {
+	entry->mPrevUsed->mNextUsed = entry->mNextUsed;
+	entry->mNextUsed->mPrevUsed = entry->mPrevUsed;
+}
+
+inline void
+LinkTileRenderEntryAtFront(tile_render_cache* cache, tile_render_entry* entry) {
+	tile_render_entry* sentinel = &cache->mUsedSentinel;
+	entry->mNextUsed = sentinel->mNextUsed;
+	entry->mPrevUsed = sentinel;
+	entry->mNextUsed->mPrevUsed = entry;
+	sentinel->mNextUsed = entry;
+}
+
+// Every entry holds a whole chunk's bitmap, so entryCount bounds the memory at entryCount*(chunkDim*tileSideInPixels)^2 pixels
+internal void
+InitializeTileRenderCache(tile_map* tileMap, tile_render_cache* cache, memory_areana* arena,
+						  int32 tileSideInPixels, uint32 entryCount, real32 ambientLight) {
+	Assert((tileSideInPixels > 0) && (entryCount > 0));
+
+	cache->mTileSideInPixels = tileSideInPixels;
+	cache->mTileInsetInPixels = RoundReal32ToInt32(0.05f*(real32)tileSideInPixels);
+	cache->mAmbientLight = ambientLight;
+
+	uint32 chunkCount = GetTileChunkCount(tileMap);
+	cache->mEntryForChunk = PushArray(arena, chunkCount, uint32);
+	for (uint32 chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+		cache->mEntryForChunk[chunkIndex] = TILE_RENDER_NO_ENTRY;
+	}
+
+	cache->mUsedSentinel.mNextUsed = &cache->mUsedSentinel;
+	cache->mUsedSentinel.mPrevUsed = &cache->mUsedSentinel;
+
+	uint32 tileCount = GetTileChunkTileCount(tileMap);
+	uint32 visibleWordCount = TILE_FOV_MAX_VIEWERS*((tileCount + 31) / 32);
+	int32 bitmapSide = (int32)tileMap->mChunkDim*tileSideInPixels;
+	cache->mEntries = PushArray(arena, entryCount, tile_render_entry);
+	cache->mEntryCount = entryCount;
+	for (uint32 entryIndex = 0; entryIndex < entryCount; ++entryIndex) {
+		tile_render_entry* entry = cache->mEntries + entryIndex;
+		entry->mChunkIndex = TILE_RENDER_NO_ENTRY;
+		entry->mLightLevels = PushArray(arena, tileCount, uint8);
+		entry->mVisibleBits = PushArray(arena, visibleWordCount, uint32);
+		entry->mCellColors = PushArray(arena, tileCount, uint32);
+		entry->mBitmap.mWidth = bitmapSide;
+		entry->mBitmap.mHeight = bitmapSide;
+		entry->mBitmap.mPixels = PushArray(arena, (memory_index)bitmapSide*bitmapSide, uint32);
+		LinkTileRenderEntryAtFront(cache, entry);
+
+		// Touching the bitmaps now keeps the page faults out of the first frames that render into them
+		for (memory_index pixelIndex = 0; pixelIndex < (memory_index)bitmapSide*bitmapSide; ++pixelIndex) {
+			entry->mBitmap.mPixels[pixelIndex] = 0;
+		}
+	}
+
+	cache->mBlitWork = PushArray(arena, entryCount, tile_render_blit_work);
+	cache->mBlitWorkCount = 0;
+
+	cache->mHitCount = 0;
+	cache->mMissCount = 0;
+	cache->mLastFrameCheckedChunkCount = 0;
+	cache->mLastFrameCellCount = 0;
+}
+
+// Fills the tile's cell, with the gap around the tile left transparent
+internal void
+DrawTileRenderCell(tile_render_cache* cache, loaded_bitmap* bitmap, uint32 tileX, uint32 tileY, uint32 color) {
+	int32 side = cache->mTileSideInPixels;
+	int32 inset = cache->mTileInsetInPixels;
+
+	// Rows run bottom up like every loaded_bitmap, which matches tile Y
+	uint32* row = bitmap->mPixels + (int32)tileY*side*bitmap->mWidth + (int32)tileX*side;
+	for (int32 y = 0; y < side; ++y) {
+		bool32 isInsideY = ((y >= inset) && (y < (side - inset)));
+		uint32 insideColor = isInsideY ? color : 0;
+		__m128i insideColor4 = _mm_set1_epi32((int32)insideColor);
+		int32 x = 0;
+		for (; x < inset; ++x) {
+			row[x] = 0;
+		}
+		for (; (x + 4) <= (side - inset); x += 4) {
+			_mm_storeu_si128((__m128i*)(row + x), insideColor4);
+		}
+		for (; x < (side - inset); ++x) {
+			row[x] = insideColor;
+		}
+		for (; x < side; ++x) {
+			row[x] = 0;
+		}
+		row += bitmap->mWidth;
+	}
+}
+
+// What the tile's cell shows right now, quantized the way DrawRectangle quantizes
+internal uint32
+GetTileRenderColor(tile_map* tileMap, tile_render_cache* cache, tile_chunk* tileChunk, uint8* lightLevels,
+				   uint32* fovBits, bool32 isFogged, uint32 tileX, uint32 tileY) {
+	uint32 result = 0;
+	tile_type* tileType = GetTileType(tileMap, GetTileValue(tileMap, tileChunk, tileX, tileY));
+	if (tileType->mFlags & TILE_TYPE_DRAWN) {
+		uint32 bitIndex = tileY*tileMap->mChunkDim + tileX;
+		bool32 isVisible = !isFogged;
+		if (isFogged && fovBits) {
+			uint32 wordsPerLayer = tileMap->mFov->mWordsPerLayer;
+			for (uint32 viewerIndex = 0; viewerIndex < TILE_FOV_MAX_VIEWERS; ++viewerIndex) {
+				uint32* visible = fovBits + (1 + viewerIndex)*wordsPerLayer;
+				isVisible |= ((visible[bitIndex / 32] >> (bitIndex % 32)) & 1);
+			}
+		}
+
+		if (isVisible) {
+			uint32 level = lightLevels ? lightLevels[bitIndex] : 0;
+			real32 brightness = GetTileLightBrightness(level, cache->mAmbientLight);
+			uint32 color = tileType->mColor;
+			result = (0xFF000000 |
+					(RoundReal32ToUInt32(brightness*(real32)((color >> 16) & 0xFF)) << 16) |
+					(RoundReal32ToUInt32(brightness*(real32)((color >> 8) & 0xFF)) << 8) |
+					(RoundReal32ToUInt32(brightness*(real32)(color & 0xFF)) << 0));
+		}
+	}
+	return result;
+}
+
+// Copies what the chunk's tiles are lit with and seen by into the entry, returning whether that changed.
+// Chunks without light levels or sight bits read as all zero.
+internal bool32
+SnapshotTileRenderInputs(tile_map* tileMap, tile_render_entry* entry, uint8* lightLevels, uint32* fovBits, bool32 isFogged) {
+	uint32 tileCount = GetTileChunkTileCount(tileMap);
+	uint32 difference = (entry->mWasFogged != isFogged);
+	for (uint32 tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
+		uint8 level = lightLevels ? lightLevels[tileIndex] : 0;
+		difference |= (entry->mLightLevels[tileIndex] ^ level);
+		entry->mLightLevels[tileIndex] = level;
+	}
+
+	// Sight only matters while someone is looking, otherwise every tile shows
+	if (isFogged) {
+		uint32 wordsPerLayer = tileMap->mFov->mWordsPerLayer;
+		uint32 visibleWordCount = TILE_FOV_MAX_VIEWERS*wordsPerLayer;
+		for (uint32 wordIndex = 0; wordIndex < visibleWordCount; ++wordIndex) {
+			uint32 word = fovBits ? fovBits[wordsPerLayer + wordIndex] : 0;
+			difference |= (entry->mVisibleBits[wordIndex] ^ word);
+			entry->mVisibleBits[wordIndex] = word;
+		}
+	}
+	entry->mWasFogged = isFogged;
+
+	bool32 result = (difference != 0);
+	return result;
+}
+
+// The chunk's cache entry with every tile up to date, null off the map
+internal tile_render_entry*
+UpdateTileChunkRender(tile_map* tileMap, tile_render_cache* cache, uint32 chunkX, uint32 chunkY, uint32 chunkZ) {
+	TIMED_FUNCTION();
+	tile_render_entry* result = 0;
+	tile_chunk* tileChunk = GetTileChunk(tileMap, chunkX, chunkY, chunkZ);
+	if (tileChunk) {
+		uint32 chunkIndex = GetTileChunkIndex(tileMap, chunkX, chunkY, chunkZ);
+		uint32 tileCount = GetTileChunkTileCount(tileMap);
+
+		tile_render_entry* entry;
+		bool32 isNew = false;
+		if (cache->mEntryForChunk[chunkIndex] != TILE_RENDER_NO_ENTRY) {
+			entry = cache->mEntries + cache->mEntryForChunk[chunkIndex];
+			++cache->mHitCount;
+		}
+		else {
+			entry = cache->mUsedSentinel.mPrevUsed;
+			if (entry->mChunkIndex != TILE_RENDER_NO_ENTRY) {
+				cache->mEntryForChunk[entry->mChunkIndex] = TILE_RENDER_NO_ENTRY;
+			}
+			entry->mChunkIndex = chunkIndex;
+			cache->mEntryForChunk[chunkIndex] = (uint32)(entry - cache->mEntries);
+			for (uint32 tileIndex = 0; tileIndex < tileCount; ++tileIndex) {
+				entry->mCellColors[tileIndex] = TILE_RENDER_STALE_CELL;
+			}
+			isNew = true;
+			++cache->mMissCount;
+		}
+		UnlinkTileRenderEntry(entry);
+		LinkTileRenderEntryAtFront(cache, entry);
+
+		// Light and sight change without touching the chunk's tiles, so they are compared as well
+		uint8* lightLevels = tileMap->mLights ? tileMap->mLights->mChunkLevels[chunkIndex] : 0;
+		uint32* fovBits = tileMap->mFov ? tileMap->mFov->mChunkBits[chunkIndex] : 0;
+		bool32 isFogged = (tileMap->mFov && (tileMap->mFov->mActiveViewerCount > 0));
+		bool32 hasInputChanged = SnapshotTileRenderInputs(tileMap, entry, lightLevels, fovBits, isFogged);
+		if (isNew || hasInputChanged || (entry->mEditVersion != tileChunk->mEditVersion)) {
+			entry->mEditVersion = tileChunk->mEditVersion;
+			for (uint32 tileY = 0; tileY < tileMap->mChunkDim; ++tileY) {
+				for (uint32 tileX = 0; tileX < tileMap->mChunkDim; ++tileX) {
+					uint32 color = GetTileRenderColor(tileMap, cache, tileChunk, lightLevels, fovBits, isFogged, tileX, tileY);
+					uint32* cellColor = entry->mCellColors + tileY*tileMap->mChunkDim + tileX;
+					if (*cellColor != color) {
+						DrawTileRenderCell(cache, &entry->mBitmap, tileX, tileY, color);
+						*cellColor = color;
+						++cache->mLastFrameCellCount;
+					}
+				}
+			}
+			++cache->mLastFrameCheckedChunkCount;
+		}
+
+		result = entry;
+	}
+	return result;
+}
+
+// Copies the drawn tiles of the entry's bitmap with the bitmap's top left corner at minX, minY.
+// Drawn tiles are opaque inside their inset, so every tile is a plain copy without blending.
+internal void
+BlitTileChunkCells(game_offscreen_buffer* buffer, tile_map* tileMap, tile_render_cache* cache, tile_render_entry* entry,
+				   int32 minX, int32 minY, int32 firstTileY, int32 onePastLastTileY) {
+	int32 side = cache->mTileSideInPixels;
+	int32 inset = cache->mTileInsetInPixels;
+	int32 chunkDim = (int32)tileMap->mChunkDim;
+	loaded_bitmap* bitmap = &entry->mBitmap;
+
+	for (int32 tileY = firstTileY; tileY < onePastLastTileY; ++tileY) {
+		int32 cellMinY = minY + (chunkDim - 1 - tileY)*side + inset;
+		int32 cellMaxY = cellMinY + side - 2*inset;
+		int32 clippedMinY = Maximum(cellMinY, 0);
+		int32 clippedMaxY = Minimum(cellMaxY, buffer->mHeight);
+		if (clippedMinY >= clippedMaxY) {
+			continue;
+		}
+
+		for (int32 tileX = 0; tileX < chunkDim; ++tileX) {
+			if (!entry->mCellColors[tileY*chunkDim + tileX]) {
+				continue;
+			}
+
+			int32 cellMinX = minX + tileX*side + inset;
+			int32 cellMaxX = cellMinX + side - 2*inset;
+			int32 clippedMinX = Maximum(cellMinX, 0);
+			int32 clippedMaxX = Minimum(cellMaxX, buffer->mWidth);
+			if (clippedMinX < clippedMaxX) {
+				// Screen rows run top down while the bitmap's run bottom up
+				uint32* sourceRow = (bitmap->mPixels + (bitmap->mHeight - 1 - (clippedMinY - minY))*bitmap->mWidth +
+									(clippedMinX - minX));
+				uint8* destRow = (uint8*)buffer->mMemory + clippedMinX*buffer->mBytesPerPixel + clippedMinY*buffer->mPitch;
+				int32 width = clippedMaxX - clippedMinX;
+				for (int32 y = clippedMinY; y < clippedMaxY; ++y) {
+					uint32* dest = (uint32*)destRow;
+					int32 x = 0;
+					for (; (x + 4) <= width; x += 4) {
+						_mm_storeu_si128((__m128i*)(dest + x), _mm_loadu_si128((__m128i*)(sourceRow + x)));
+					}
+					for (; x < width; ++x) {
+						dest[x] = sourceRow[x];
+					}
+					sourceRow -= bitmap->mWidth;
+					destRow += buffer->mPitch;
+				}
+			}
+		}
+	}
+}
+
+// Each index is one tile row of one queued chunk. Rows of empty floor cost next to nothing while
+// rows of walls copy every cell, so the rows are spread over the workers rather than whole chunks.
+internal
+PARALLEL_FOR_CALLBACK(DoTileRenderBlitRows) {
+	TIMED_FUNCTION();
+	tile_render_cache* cache = (tile_render_cache*)pData;
+	uint32 chunkDim = cache->mBlitWork[0].mTileMap->mChunkDim;
+	for (uint32 rowIndex = pBegin; rowIndex < pEnd;) {
+		tile_render_blit_work* work = cache->mBlitWork + rowIndex / chunkDim;
+		uint32 firstTileY = rowIndex % chunkDim;
+		uint32 onePastLastTileY = Minimum(chunkDim, firstTileY + (pEnd - rowIndex));
+		BlitTileChunkCells(work->mBuffer, work->mTileMap, work->mCache, work->mEntry, work->mMinX, work->mMinY,
+			(int32)firstTileY, (int32)onePastLastTileY);
+		rowIndex += onePastLastTileY - firstTileY;
+	}
+}
+
+// Runs the queued copies, split across the platform's workers when there are any
+internal void
+FlushTileRenderBlits(game_memory* memory, tile_render_cache* cache) {
+	TIMED_FUNCTION();
+	if (cache->mBlitWorkCount) {
+		uint32 rowCount = cache->mBlitWorkCount*cache->mBlitWork[0].mTileMap->mChunkDim;
+		ParallelFor(memory, 0, rowCount, 2, DoTileRenderBlitRows, cache);
+		cache->mBlitWorkCount = 0;
+	}
+}
+
+// Draws the tiles on the camera's floor that cover the buffer, centered on the camera like the entities
+internal void
+DrawTileLayer(game_memory* memory, game_offscreen_buffer* buffer, tile_map* tileMap, tile_render_cache* cache,
+			  tile_map_location cameraP, real32 metersToPixels) {
+	TIMED_FUNCTION();
+	cache->mLastFrameCheckedChunkCount = 0;
+	cache->mLastFrameCellCount = 0;
+
+	int32 side = cache->mTileSideInPixels;
+	real32 cameraX = 0.5f*(real32)buffer->mWidth - metersToPixels*cameraP.mOffset.x;
+	real32 cameraY = 0.5f*(real32)buffer->mHeight + metersToPixels*cameraP.mOffset.y;
+
+	// Tiles relative to the camera tile that reach the buffer, rows count up the screen
+	tile_delta minRelX = -(tile_delta)(cameraX / (real32)side) - 1;
+	tile_delta maxRelX = (tile_delta)(((real32)buffer->mWidth - cameraX) / (real32)side) + 1;
+	tile_delta minRelY = -(tile_delta)(((real32)buffer->mHeight - cameraY) / (real32)side) - 1;
+	tile_delta maxRelY = (tile_delta)(cameraY / (real32)side) + 1;
+
+	tile_coord chunkMask = tileMap->mChunkMask;
+	tile_delta chunkDim = (tile_delta)tileMap->mChunkDim;
+	tile_delta firstRelX = (tile_delta)(((cameraP.mAbsTileX + minRelX) & ~chunkMask) - cameraP.mAbsTileX);
+	tile_delta firstRelY = (tile_delta)(((cameraP.mAbsTileY + minRelY) & ~chunkMask) - cameraP.mAbsTileY);
+	for (tile_delta relY = firstRelY; relY <= maxRelY; relY += chunkDim) {
+		for (tile_delta relX = firstRelX; relX <= maxRelX; relX += chunkDim) {
+			tile_chunk_location chunkLoc = GetChunkLocationFor(tileMap, cameraP.mAbsTileX + relX, cameraP.mAbsTileY + relY,
+				cameraP.mAbsTileZ);
+			if ((chunkLoc.mTileChunkX < tileMap->mTileChunkCountX) &&
+				(chunkLoc.mTileChunkY < tileMap->mTileChunkCountY) &&
+				(chunkLoc.mTileChunkZ < tileMap->mTileChunkCountZ)) {
+				// Every entry is queued, so the update below would recycle one that still has to be copied
+				if (cache->mBlitWorkCount == cache->mEntryCount) {
+					FlushTileRenderBlits(memory, cache);
+				}
+				tile_render_entry* entry = UpdateTileChunkRender(tileMap, cache, (uint32)chunkLoc.mTileChunkX,
+					(uint32)chunkLoc.mTileChunkY, chunkLoc.mTileChunkZ);
+				if (entry) {
+					real32 minX = cameraX + ((real32)relX - 0.5f)*(real32)side;
+					real32 minY = cameraY - ((real32)(relY + chunkDim) - 0.5f)*(real32)side;
+
+					tile_render_blit_work* work = cache->mBlitWork + cache->mBlitWorkCount++;
+					work->mBuffer = buffer;
+					work->mTileMap = tileMap;
+					work->mCache = cache;
+					work->mEntry = entry;
+					work->mMinX = RoundReal32ToInt32(minX);
+					work->mMinY = RoundReal32ToInt32(minY);
+				}
+			}
+		}
+	}
+
+	FlushTileRenderBlits(memory, cache);
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#if !defined(ENGINE_TILE_RENDER_H)
+
+/*
+ * Author: Jheremy Strom
+ */
+
+/*
+ * The tile layer is drawn from prerendered chunk bitmaps. A cached chunk is left alone while its
+ * edit version and the light and sight it was drawn with stay the same. Otherwise only the tiles
+ * whose color changed are redrawn. Each frame copies the drawn tiles of the cached bitmaps to the
+ * screen, so the floor and the gaps between tiles never cost anything.
+ */
+
+#define TILE_RENDER_NO_ENTRY UInt32Max
+
+// Cell color of a tile that has to be drawn before the cell can be trusted, real colors are opaque or zero
+#define TILE_RENDER_STALE_CELL 1
+
+struct tile_render_entry {
+	uint32 mChunkIndex;  // TILE_RENDER_NO_ENTRY while the entry is unused
+
+	// What the bitmap was drawn from
+	uint32 mEditVersion;
+	uint8* mLightLevels;
+	uint32* mVisibleBits;
+	bool32 mWasFogged;
+
+	// 0xAARRGGBB each tile's cell was last drawn with, 0 when it shows nothing
+	uint32* mCellColors;
+	loaded_bitmap mBitmap;
+
+	tile_render_entry* mNextUsed;
+	tile_render_entry* mPrevUsed;
+};
+
+struct tile_render_cache;
+
+// A chunk's copy to the screen, chunks and their rows cover separate parts of the screen so they copy in parallel
+struct tile_render_blit_work {
+	game_offscreen_buffer* mBuffer;
+	tile_map* mTileMap;
+	tile_render_cache* mCache;
+	tile_render_entry* mEntry;
+	int32 mMinX;
+	int32 mMinY;
+};
+
+struct tile_render_cache {
+	int32 mTileSideInPixels;
+	int32 mTileInsetInPixels;
+	real32 mAmbientLight;
+
+	uint32* mEntryForChunk;
+	tile_render_entry* mEntries;
+	uint32 mEntryCount;
+
+	// Most recently used first, the last entry is the one evicted
+	tile_render_entry mUsedSentinel;
+
+	// One per entry, a frame that needs more entries than the cache has waits for the copies before reusing them
+	tile_render_blit_work* mBlitWork;
+	uint32 mBlitWorkCount;
+
+	uint32 mHitCount;
+	uint32 mMissCount;
+	uint32 mLastFrameCheckedChunkCount;
+	uint32 mLastFrameCellCount;
+};
+
+#define ENGINE_TILE_RENDER_H
+#endif
\ No newline at end of file
@@ -0,0 +1,182 @@
+/*
+ * Author: Jheremy Strom
+ */
+
+// Setting a type that tiles already use does not invalidate the cached paths, regions, lights or rendered chunks
+internal void
+SetTileType(tile_map* tileMap, uint32 tileValue, uint32 flags, uint32 color, uint32 bitmapID) {
+	Assert(tileValue < TILE_TYPE_COUNT);
+	Assert(!((flags & TILE_TYPE_DOOR_UP) && (flags & TILE_TYPE_DOOR_DOWN)));
+	Assert(bitmapID <= 0xFFFF);
+
+	tile_type* type = tileMap->mTypes + tileValue;
+	type->mFlags = (uint8)flags;
+	type->mBitmapID = (uint16)bitmapID;
+	type->mColor = color & 0xFFFFFF;
+
+	type->mPathClass = TILE_PATH_CLASS_BLOCKED;
+	if (flags & TILE_TYPE_PASSABLE) {
+		type->mPathClass = TILE_PATH_CLASS_OPEN;
+		if (flags & TILE_TYPE_DOOR_UP) {
+			type->mPathClass = TILE_PATH_CLASS_DOOR_UP;
+		}
+		else if (flags & TILE_TYPE_DOOR_DOWN) {
+			type->mPathClass = TILE_PATH_CLASS_DOOR_DOWN;
+		}
+	}
+}
+
+// The types the game was built around, every other value blocks nothing and is never drawn
+internal void
+InitializeTileTypes(tile_map* tileMap) {
+	for (uint32 tileValue = 0; tileValue < TILE_TYPE_COUNT; ++tileValue) {
+		SetTileType(tileMap, tileValue, 0, 0, 0);
+	}
+
+	// Unloaded
+	SetTileType(tileMap, 0, TILE_TYPE_OPAQUE, 0x000000, 0);
+	// Floor
+	SetTileType(tileMap, 1, TILE_TYPE_PASSABLE, 0x808080, 0);
+	// Wall
+	SetTileType(tileMap, 2, TILE_TYPE_OPAQUE | TILE_TYPE_DRAWN, 0xFFFFFF, 0);
+	// Doors to the floor above and below
+	SetTileType(tileMap, 3, TILE_TYPE_PASSABLE | TILE_TYPE_DOOR_UP | TILE_TYPE_DRAWN, 0x404040, 0);
+	SetTileType(tileMap, 4, TILE_TYPE_PASSABLE | TILE_TYPE_DOOR_DOWN | TILE_TYPE_DRAWN, 0x404040, 0);
+}
+
+inline bool32
+IsTileTypeSpace(char c) {
+	bool32 result = ((c == ' ') || (c == '\t') || (c == '\r'));
+	return result;
+}
+
+inline bool32
+IsTileTypeWordEnd(char* at, char* end) {
+	bool32 result = ((at == end) || IsTileTypeSpace(*at) || (*at == '\n') || (*at == '#'));
+	return result;
+}
+
+inline char*
+SkipTileTypeSpaces(char* at, char* end) {
+	while ((at < end) && IsTileTypeSpace(*at)) {
+		++at;
+	}
+	return at;
+}
+
+// Reads a decimal number, or a hexadecimal one when it starts with 0x
+internal bool32
+ParseTileTypeNumber(char** at, char* end, uint32* value) {
+	char* scan = SkipTileTypeSpaces(*at, end);
+	uint32 base = 10;
+	if (((end - scan) > 2) && (scan[0] == '0') && ((scan[1] == 'x') || (scan[1] == 'X'))) {
+		base = 16;
+		scan += 2;
+	}
+
+	uint64 result = 0;
+	uint32 digitCount = 0;
+	while (!IsTileTypeWordEnd(scan, end)) {
+		char c = *scan;
+		uint32 digit = 16;
+		if ((c >= '0') && (c <= '9')) {
+			digit = c - '0';
+		}
+		else if ((c >= 'a') && (c <= 'f')) {
+			digit = c - 'a' + 10;
+		}
+		else if ((c >= 'A') && (c <= 'F')) {
+			digit = c - 'A' + 10;
+		}
+
+		if ((digit >= base) || (result > UInt32Max)) {
+			return false;
+		}
+		result = result*base + digit;
+		++digitCount;
+		++scan;
+	}
+
+	*at = scan;
+	*value = (uint32)result;
+	bool32 isValid = ((digitCount > 0) && (result <= UInt32Max));
+	return isValid;
+}
+
+inline bool32
+IsTileTypeWord(char* at, char* end, const char* word) {
+	while ((at < end) && *word && (*at == *word)) {
+		++at;
+		++word;
+	}
+	bool32 result = (!*word && IsTileTypeWordEnd(at, end));
+	return result;
+}
+
+/*
+ * Reads tile types from text, one per line:
+ *     <value> <0xRRGGBB color> <bitmap id> [passable] [opaque] [door_up] [door_down] [drawn]
+ * Everything after a # is a comment. Lines that do not parse are skipped.
+ * Returns how many types were set.
+ */
+internal uint32
+LoadTileTypes(tile_map* tileMap, char* text, uint32 textSize) {
+	uint32 result = 0;
+	char* at = text;
+	char* end = text + textSize;
+	while (at < end) {
+		char* lineEnd = at;
+		while ((lineEnd < end) && (*lineEnd != '\n')) {
+			++lineEnd;
+		}
+
+		uint32 tileValue = 0;
+		uint32 color = 0;
+		uint32 bitmapID = 0;
+		at = SkipTileTypeSpaces(at, lineEnd);
+		if ((at < lineEnd) && (*at != '#')) {
+			bool32 isValid = (ParseTileTypeNumber(&at, lineEnd, &tileValue) &&
+							ParseTileTypeNumber(&at, lineEnd, &color) &&
+							ParseTileTypeNumber(&at, lineEnd, &bitmapID) &&
+							(tileValue < TILE_TYPE_COUNT) && (color <= 0xFFFFFF) && (bitmapID <= 0xFFFF));
+
+			uint32 flags = 0;
+			at = SkipTileTypeSpaces(at, lineEnd);
+			while (isValid && (at < lineEnd) && (*at != '#')) {
+				char* word = at;
+				while (!IsTileTypeWordEnd(at, lineEnd)) {
+					++at;
+				}
+
+				if (IsTileTypeWord(word, lineEnd, "passable")) {
+					flags |= TILE_TYPE_PASSABLE;
+				}
+				else if (IsTileTypeWord(word, lineEnd, "opaque")) {
+					flags |= TILE_TYPE_OPAQUE;
+				}
+				else if (IsTileTypeWord(word, lineEnd, "door_up")) {
+					flags |= TILE_TYPE_DOOR_UP;
+				}
+				else if (IsTileTypeWord(word, lineEnd, "door_down")) {
+					flags |= TILE_TYPE_DOOR_DOWN;
+				}
+				else if (IsTileTypeWord(word, lineEnd, "drawn")) {
+					flags |= TILE_TYPE_DRAWN;
+				}
+				else {
+					isValid = false;
+				}
+				at = SkipTileTypeSpaces(at, lineEnd);
+			}
+
+			if (isValid && !((flags & TILE_TYPE_DOOR_UP) && (flags & TILE_TYPE_DOOR_DOWN))) {
+				SetTileType(tileMap, tileValue, flags, color, bitmapID);
+				++result;
+			}
+		}
+
+		at = (lineEnd < end) ? (lineEnd + 1) : end;
+	}
+
+	return result;
+}
\ No newline at end of file
@@ -0,0 +1,199 @@
+/*
+ * Author: Jheremy Strom
+ */
+
+inline uint64
+GetWorldFileSize(tile_map* tileMap) {
+	uint64 chunkCount = GetTileChunkCount(tileMap);
+	uint64 recordSize = GetTileChunkTileCount(tileMap)*sizeof(uint32);
+
+	// Every chunk can own a record, so the file never has to grow while mapped
+	uint64 result = sizeof(world_file_header) + chunkCount*sizeof(uint32) + chunkCount*recordSize;
+	return result;
+}
+
+inline uint32*
+GetWorldFileRecord(tile_chunk_stream* stream, uint32 recordIndex) {
+	Assert(recordIndex < stream->mHeader->mRecordCount);
+	uint32* result = (uint32*)(stream->mRecords + (uint64)recordIndex*stream->mHeader->mRecordSize);
+	return result;
+}
+
+inline void
+UnlinkResidentChunk(tile_chunk* tileChunk) {
+	tileChunk->mPrevResident->mNextResident = tileChunk->mNextResident;
+	tileChunk->mNextResident->mPrevResident = tileChunk->mPrevResident;
+	tileChunk->mNextResident = 0;
+	tileChunk->mPrevResident = 0;
+}
+
+inline void
+LinkResidentChunkAtFront(tile_chunk_stream* stream, tile_chunk* tileChunk) {
+	tile_chunk* sentinel = &stream->mResidentSentinel;
+	tileChunk->mNextResident = sentinel->mNextResident;
+	tileChunk->mPrevResident = sentinel;
+	tileChunk->mNextResident->mPrevResident = tileChunk;
+	sentinel->mNextResident = tileChunk;
+}
+
+inline void
+TouchTileChunk(tile_chunk_stream* stream, tile_chunk* tileChunk) {
+	Assert(IsTileChunkLoaded(tileChunk));
+	if (stream->mResidentSentinel.mNextResident != tileChunk) {
+		UnlinkResidentChunk(tileChunk);
+		LinkResidentChunkAtFront(stream, tileChunk);
+	}
+}
+
+// Returns true when the file already holds a world with the same dimensions
+internal bool32
+InitializeTileChunkStream(tile_map* tileMap, tile_chunk_stream* stream, platform_mapped_file file, uint32 residentBudget) {
+
+	Assert(file.mMemory);
+	Assert(file.mSize >= GetWorldFileSize(tileMap));
+	Assert(residentBudget > 0);
+
+	uint32 chunkCount = GetTileChunkCount(tileMap);
+	uint32 tileCount = GetTileChunkTileCount(tileMap);
+
+	stream->mFile = file;
+	stream->mHeader = (world_file_header*)file.mMemory;
+
+	world_file_header* header = stream->mHeader;
+	bool32 isExistingWorld = (!file.mWasCreated &&
+							(header->mMagicValue == WORLD_FILE_MAGIC_VALUE) &&
+							(header->mVersion == WORLD_FILE_VERSION) &&
+							(header->mChunkShift == tileMap->mChunkShift) &&
+							(header->mTileChunkCountX == tileMap->mTileChunkCountX) &&
+							(header->mTileChunkCountY == tileMap->mTileChunkCountY) &&
+							(header->mTileChunkCountZ == tileMap->mTileChunkCountZ) &&
+							(header->mIsMortonOrdered == tileMap->mIsMortonOrdered));
+
+	if (!isExistingWorld) {
+		header->mMagicValue = WORLD_FILE_MAGIC_VALUE;
+		header->mVersion = WORLD_FILE_VERSION;
+		header->mChunkShift = tileMap->mChunkShift;
+		header->mTileChunkCountX = tileMap->mTileChunkCountX;
+		header->mTileChunkCountY = tileMap->mTileChunkCountY;
+		header->mTileChunkCountZ = tileMap->mTileChunkCountZ;
+		header->mRecordSize = tileCount*sizeof(uint32);
+		header->mRecordCapacity = chunkCount;
+		header->mRecordCount = 0;
+		header->mIsMortonOrdered = tileMap->mIsMortonOrdered;
+		header->mDirectoryOffset = sizeof(world_file_header);
+		header->mRecordsOffset = header->mDirectoryOffset + (uint64)chunkCount*sizeof(uint32);
+	}
+
+	stream->mDirectory = (uint32*)((uint8*)file.mMemory + header->mDirectoryOffset);
+	stream->mRecords = (uint8*)file.mMemory + header->mRecordsOffset;
+
+	if (!isExistingWorld) {
+		for (uint32 chunkIndex = 0; chunkIndex < chunkCount; ++chunkIndex) {
+			stream->mDirectory[chunkIndex] = WORLD_FILE_NO_RECORD;
+		}
+	}
+
+	stream->mResidentBudget = residentBudget;
+	stream->mResidentCount = 0;
+
+	stream->mResidentSentinel.mNextResident = &stream->mResidentSentinel;
+	stream->mResidentSentinel.mPrevResident = &stream->mResidentSentinel;
+
+	stream->mPageInCount = 0;
+	stream->mEvictionCount = 0;
+	stream->mWriteBackCount = 0;
+
+	tileMap->mStream = stream;
+
+	return isExistingWorld;
+}
+
+internal void
+WriteBackTileChunk(tile_map* tileMap, tile_chunk* tileChunk) {
+	tile_chunk_stream* stream = tileMap->mStream;
+	Assert(IsTileChunkLoaded(tileChunk));
+
+	if (tileChunk->mCompressed) {
+		DecompressTileChunk(tileMap, tileChunk);
+	}
+
+	uint32 chunkIndex = (uint32)(tileChunk - tileMap->mTileChunks);
+	uint32 recordIndex = stream->mDirectory[chunkIndex];
+	if (recordIndex == WORLD_FILE_NO_RECORD) {
+		Assert(stream->mHeader->mRecordCount < stream->mHeader->mRecordCapacity);
+		recordIndex = stream->mHeader->mRecordCount++;
+		stream->mDirectory[chunkIndex] = recordIndex;
+	}
+
+	DecodeTileChunk(tileMap, tileChunk, GetWorldFileRecord(stream, recordIndex));
+	tileChunk->mIsDirty = false;
+	++stream->mWriteBackCount;
+}
+
+internal void
+EvictTileChunk(tile_map* tileMap, tile_chunk* tileChunk) {
+	tile_chunk_stream* stream = tileMap->mStream;
+	Assert(IsTileChunkLoaded(tileChunk));
+
+	if (tileChunk->mIsDirty) {
+		WriteBackTileChunk(tileMap, tileChunk);
+	}
+
+	// The region and light maps keep what they have, paths and light are the same once it pages back in
+	UnlinkResidentChunk(tileChunk);
+	FreeTileChunkStorage(tileMap, tileChunk);
+	InvalidateTileFov(tileMap);
+	NotifyTileChunkChanged(tileMap, tileChunk, TILE_CHANGE_EVICT);
+
+	--stream->mResidentCount;
+	++stream->mEvictionCount;
+}
+
+// Packs the chunk's record into resident storage, evicting the least recently used chunk if the budget is full
+internal void
+PageInTileChunk(tile_map* tileMap, tile_chunk* tileChunk) {
+	tile_chunk_stream* stream = tileMap->mStream;
+	Assert(!IsTileChunkLoaded(tileChunk));
+
+	if (stream->mResidentCount == stream->mResidentBudget) {
+		tile_chunk* leastRecentlyUsed = stream->mResidentSentinel.mPrevResident;
+		Assert(leastRecentlyUsed != &stream->mResidentSentinel);
+		EvictTileChunk(tileMap, leastRecentlyUsed);
+	}
+
+	uint32 chunkIndex = (uint32)(tileChunk - tileMap->mTileChunks);
+	uint32 recordIndex = stream->mDirectory[chunkIndex];
+	// A record too varied to pack can only be a damaged one, it reads like a chunk that was never written
+	if ((recordIndex == WORLD_FILE_NO_RECORD) ||
+		!EncodeTileChunk(tileMap, tileChunk, GetWorldFileRecord(stream, recordIndex))) {
+		MakeTileChunkUniform(tileChunk, 1);
+	}
+
+	tileChunk->mIsDirty = false;
+	tileChunk->mLastUsedFrame = tileMap->mFrameIndex;
+	InvalidateTileFov(tileMap);
+	NotifyTileChunkChanged(tileMap, tileChunk, TILE_CHANGE_LOAD);
+	LinkResidentChunkAtFront(stream, tileChunk);
+
+	++stream->mResidentCount;
+	++stream->mPageInCount;
+}
+
+// Writes every dirty resident chunk back and asks the platform to flush the file
+internal void
+FlushTileChunkStream(thread_context* thread, game_memory* memory, tile_map* tileMap) {
+	tile_chunk_stream* stream = tileMap->mStream;
+	if (stream) {
+		for (tile_chunk* tileChunk = stream->mResidentSentinel.mNextResident;
+			tileChunk != &stream->mResidentSentinel;
+			tileChunk = tileChunk->mNextResident) {
+			if (tileChunk->mIsDirty) {
+				WriteBackTileChunk(tileMap, tileChunk);
+			}
+		}
+
+		if (memory && memory->PlatformFlushMappedFile) {
+			memory->PlatformFlushMappedFile(thread, &stream->mFile, 0, stream->mFile.mSize);
+		}
+	}
+}
\ No newline at end of file
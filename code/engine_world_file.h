@@ -0,0 +1,57 @@
+#if !defined(ENGINE_WORLD_FILE_H)
+
+/*
+ * Author: Jheremy Strom
+ */
+
+#define WORLD_FILE_MAGIC_VALUE (((uint32)'E' << 0) | ((uint32)'W' << 8) | ((uint32)'L' << 16) | ((uint32)'D' << 24))
+#define WORLD_FILE_VERSION 2
+#define WORLD_FILE_NO_RECORD UInt32Max
+
+/*
+ * World file layout:
+ *   world_file_header
+ *   uint32 directory[chunkCount]  record index of every chunk, WORLD_FILE_NO_RECORD if never written
+ *   records[recordCapacity]       fixed size, mChunkDim*mChunkDim unpacked row major tiles each
+ *
+ * Records are handed out in the order chunks are first written back, so chunks that
+ * were built together end up near each other in the file.
+ */
+struct world_file_header {
+	uint32 mMagicValue;
+	uint32 mVersion;
+
+	uint32 mChunkShift;
+	uint32 mTileChunkCountX;
+	uint32 mTileChunkCountY;
+	uint32 mTileChunkCountZ;
+
+	uint32 mRecordSize;
+	uint32 mRecordCapacity;
+	uint32 mRecordCount;
+	bool32 mIsMortonOrdered;  // The directory follows the chunk array order
+
+	uint64 mDirectoryOffset;
+	uint64 mRecordsOffset;
+};
+
+struct tile_chunk_stream {
+	platform_mapped_file mFile;
+	world_file_header* mHeader;
+	uint32* mDirectory;
+	uint8* mRecords;
+
+	// Maximum number of chunks that hold tiles in memory at once
+	uint32 mResidentBudget;
+	uint32 mResidentCount;
+
+	// Resident chunks, most recently used first
+	tile_chunk mResidentSentinel;
+
+	uint32 mPageInCount;
+	uint32 mEvictionCount;
+	uint32 mWriteBackCount;
+};
+
+#define ENGINE_WORLD_FILE_H
+#endif
\ No newline at end of file
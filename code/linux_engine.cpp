@@ -0,0 +1,1998 @@
+/*
+ * Author: Jheremy Strom
+ */
+
+#include "engine.h"
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
+#include <sched.h>
+#include <linux/futex.h>
+#include <linux/io_uring.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+#include <x86intrin.h>
+// C runtime library
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "linux_engine.h"
+
+#define LINUX_DEFAULT_FRAME_COUNT 600
+#define LINUX_DEFAULT_BUFFER_WIDTH 960
+#define LINUX_DEFAULT_BUFFER_HEIGHT 540
+#define LINUX_DEFAULT_UPDATE_HZ 30
+#define LINUX_SAMPLES_PER_SECOND 48000
+// Runs without a frame count keep the timings of this many of the latest frames
+#define LINUX_ENDLESS_TIMING_COUNT 65536
+#define LINUX_FILE_READ_THREAD_COUNT 4
+
+global_variable volatile sig_atomic_t gRunning;
+
+/* START Utility Functions */
+
+// Concatenate two C-strings
+internal void
+CatStrings(size_t sourceACount, const char* sourceA,
+			size_t sourceBCount, const char* sourceB,
+			size_t destCount, char* dest) {
+
+	// Dest bounds checking
+	for (size_t index = 0; (index < sourceACount) && (destCount > 1); ++index, --destCount) {
+		*dest++ = *sourceA++;
+	}
+	for (size_t index = 0; (index < sourceBCount) && (destCount > 1); ++index, --destCount) {
+		*dest++ = *sourceB++;
+	}
+	*dest++ = 0;
+}
+
+// Return the length of a C-string
+internal int
+StringLength(const char* pString) {
+	int count = 0;
+	while (*pString++) {
+		++count;
+	}
+	return count;
+}
+
+inline char*
+FindOnePastLastSlash(char* path) {
+	char* result = path;
+	for (char* scan = path; *scan; ++scan) {
+		if (*scan == '/') {
+			result = scan + 1;
+		}
+	}
+	return result;
+}
+
+// Get the name of the executable
+internal void
+LinuxGetEXEFilename(linux_state* state) {
+	ssize_t sizeOfFilename = readlink("/proc/self/exe", state->EXEFilename, sizeof(state->EXEFilename) - 1);
+	if (sizeOfFilename < 0) {
+		sizeOfFilename = 0;
+	}
+	state->EXEFilename[sizeOfFilename] = 0;
+	state->onePastLastEXEFilenameSlash = FindOnePastLastSlash(state->EXEFilename);
+}
+
+internal void
+LinuxBuildEXEPathFilename(linux_state* state, const char* filename, int destSize, char* dest) {
+	CatStrings(state->onePastLastEXEFilenameSlash - state->EXEFilename, state->EXEFilename,
+		StringLength(filename), filename,
+		destSize, dest);
+}
+
+// A file in the same directory as path
+internal void
+LinuxBuildSiblingFilename(char* path, const char* filename, int destSize, char* dest) {
+	CatStrings(FindOnePastLastSlash(path) - path, path,
+		StringLength(filename), filename,
+		destSize, dest);
+}
+
+// The numbered copy of the game code next to the source, the name stays short so it never truncates
+internal void
+LinuxBuildTempGameCodeFilename(char* sourceSOName, uint32 copyIndex, int destSize, char* dest) {
+	char filename[32];
+	snprintf(filename, sizeof(filename), "engine_temp_%u.so", copyIndex);
+	LinuxBuildSiblingFilename(sourceSOName, filename, destSize, dest);
+}
+
+inline uint64
+LinuxGetWallClock(void) {
+	timespec clock;
+	clock_gettime(CLOCK_MONOTONIC, &clock);
+	uint64 result = (uint64)clock.tv_sec*1000000000ULL + (uint64)clock.tv_nsec;
+	return result;
+}
+
+/* END Utility Functions*/
+
+/* START File I/O */
+
+// Free memory in a certain thread
+DEBUG_PLATFORM_FREE_FILE_MEMORY(DEBUGPlatformFreeFileMemory) {
+	if (pBitmapMemory) {
+		free(pBitmapMemory);
+	}
+}
+
+// Read everything into memory
+DEBUG_PLATFORM_READ_ENTIRE_FILE(DEBUGPlatformReadEntireFile) {
+	debug_read_file_result result;
+	memset(&result, 0, sizeof(debug_read_file_result));
+
+	int fileHandle = open(pFilename, O_RDONLY);
+	if (fileHandle >= 0) {
+		struct stat fileStatus;
+		if (fstat(fileHandle, &fileStatus) == 0) {
+			uint32 fileSize32 = SafeTruncateUInt64((uint64)fileStatus.st_size);
+			result.mContents = malloc(fileSize32 ? fileSize32 : 1);
+			if (result.mContents) {
+				// read() can stop short of the count, keep going until the whole file is in
+				uint32 bytesRead = 0;
+				while (bytesRead < fileSize32) {
+					ssize_t readCount = read(fileHandle, (uint8*)result.mContents + bytesRead, fileSize32 - bytesRead);
+					if (readCount <= 0) {
+						break;
+					}
+					bytesRead += (uint32)readCount;
+				}
+
+				if (bytesRead == fileSize32) {
+					// File read successfully
+					result.mContentsSize = fileSize32;
+				}
+				else {
+					DEBUGPlatformFreeFileMemory(thread, result.mContents);
+					result.mContents = 0;
+				}
+			}
+			else {
+				// TODO: Could not allocate enough memory for the size of the file
+			}
+		}
+		else {
+			// TODO: Could not get the size of the file
+		}
+
+		close(fileHandle);
+	}
+	else {
+		// Could not open the file
+	}
+
+	return result;
+}
+
+// Write all memory to file
+DEBUG_PLATFORM_WRITE_ENTIRE_FILE(DEBUGPlatformWriteEntireFile) {
+	bool32 result = false;
+
+	int fileHandle = open(pFilename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fileHandle >= 0) {
+		uint32 bytesWritten = 0;
+		while (bytesWritten < pMemorySize) {
+			ssize_t writeCount = write(fileHandle, (uint8*)pMemory + bytesWritten, pMemorySize - bytesWritten);
+			if (writeCount <= 0) {
+				// TODO: Logging
+				break;
+			}
+			bytesWritten += (uint32)writeCount;
+		}
+		result = (bytesWritten == pMemorySize);
+
+		close(fileHandle);
+	}
+	else {
+		// Could not write to the file
+	}
+
+	return result;
+}
+
+// Map a file read/write, growing it to the minimum size if needed
+PLATFORM_MAP_FILE(PlatformMapFile) {
+	platform_mapped_file result;
+	memset(&result, 0, sizeof(platform_mapped_file));
+
+	int fileHandle = open(pFilename, O_RDWR | O_CREAT, 0644);
+	if (fileHandle >= 0) {
+		struct stat fileStatus;
+		if (fstat(fileHandle, &fileStatus) == 0) {
+			uint64 mapSize = (uint64)fileStatus.st_size;
+			bool32 isSizeValid = true;
+			if (mapSize < pMinimumSize) {
+				mapSize = pMinimumSize;
+				result.mWasCreated = true;
+				// Growing the file fills it with zeros
+				isSizeValid = (ftruncate(fileHandle, (off_t)mapSize) == 0);
+			}
+
+			if (isSizeValid && mapSize) {
+				void* memory = mmap(0, (size_t)mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileHandle, 0);
+				if (memory != MAP_FAILED) {
+					result.mMemory = memory;
+					result.mSize = mapSize;
+					result.mPlatformFileHandle = (void*)(intptr_t)fileHandle;
+					// The mapping outlives nothing but the file, there is no separate map handle on Linux
+					result.mPlatformMapHandle = 0;
+				}
+				else {
+					// TODO: Logging
+				}
+			}
+		}
+
+		if (!result.mMemory) {
+			close(fileHandle);
+			result.mWasCreated = false;
+		}
+	}
+	else {
+		// TODO: Logging, could not open the file
+	}
+
+	return result;
+}
+
+PLATFORM_FLUSH_MAPPED_FILE(PlatformFlushMappedFile) {
+	bool32 result = false;
+
+	if (pMappedFile->mMemory) {
+		Assert((pOffset + pSize) <= pMappedFile->mSize);
+		// msync wants a page aligned start
+		uint64 pageSize = (uint64)sysconf(_SC_PAGESIZE);
+		uint64 alignedOffset = pOffset & ~(pageSize - 1);
+		result = (msync((uint8*)pMappedFile->mMemory + alignedOffset,
+			(size_t)(pSize + (pOffset - alignedOffset)), MS_SYNC) == 0);
+	}
+
+	return result;
+}
+
+PLATFORM_UNMAP_FILE(PlatformUnmapFile) {
+	if (pMappedFile->mMemory) {
+		munmap(pMappedFile->mMemory, (size_t)pMappedFile->mSize);
+		close((int)(intptr_t)pMappedFile->mPlatformFileHandle);
+	}
+	memset(pMappedFile, 0, sizeof(platform_mapped_file));
+}
+
+// Map part of a file read only, the descriptor is not needed once the pages are mapped
+PLATFORM_MAP_FILE_VIEW(PlatformMapFileView) {
+	platform_file_view result;
+	memset(&result, 0, sizeof(platform_file_view));
+
+	int fileHandle = open(pFilename, O_RDONLY);
+	if (fileHandle >= 0) {
+		struct stat fileStatus;
+		if ((fstat(fileHandle, &fileStatus) == 0) && (pOffset < (uint64)fileStatus.st_size)) {
+			uint64 fileSize = (uint64)fileStatus.st_size;
+			uint64 viewSize = pSize ? pSize : (fileSize - pOffset);
+			if (viewSize <= (fileSize - pOffset)) {
+				// mmap wants a page aligned offset
+				uint64 pageSize = (uint64)sysconf(_SC_PAGESIZE);
+				uint64 alignedOffset = pOffset & ~(pageSize - 1);
+				uint64 mapSize = viewSize + (pOffset - alignedOffset);
+				void* memory = mmap(0, (size_t)mapSize, PROT_READ, MAP_PRIVATE, fileHandle, (off_t)alignedOffset);
+				if (memory != MAP_FAILED) {
+					if (pAccessHints & PLATFORM_VIEW_ACCESS_SEQUENTIAL) {
+						madvise(memory, (size_t)mapSize, MADV_SEQUENTIAL);
+					}
+					if (pAccessHints & PLATFORM_VIEW_ACCESS_WILL_NEED) {
+						madvise(memory, (size_t)mapSize, MADV_WILLNEED);
+					}
+
+					result.mMemory = (uint8*)memory + (pOffset - alignedOffset);
+					result.mSize = viewSize;
+					result.mPlatformBase = memory;
+					result.mPlatformSize = mapSize;
+				}
+				else {
+					// TODO: Logging
+				}
+			}
+		}
+
+		close(fileHandle);
+	}
+	else {
+		// TODO: Logging, could not open the file
+	}
+
+	return result;
+}
+
+PLATFORM_PREFETCH_FILE_VIEW(PlatformPrefetchFileView) {
+	if (pView->mMemory && pSize) {
+		Assert((pOffset + pSize) <= pView->mSize);
+		uint64 pageSize = (uint64)sysconf(_SC_PAGESIZE);
+		uint8* start = (uint8*)pView->mMemory + pOffset;
+		uint8* alignedStart = (uint8*)((uintptr_t)start & ~(uintptr_t)(pageSize - 1));
+		madvise(alignedStart, (size_t)(pSize + (start - alignedStart)), MADV_WILLNEED);
+	}
+}
+
+PLATFORM_UNMAP_FILE_VIEW(PlatformUnmapFileView) {
+	if (pView->mMemory) {
+		munmap(pView->mPlatformBase, (size_t)pView->mPlatformSize);
+	}
+	memset(pView, 0, sizeof(platform_file_view));
+}
+
+/* END File I/O */
+
+/* START Work Queues */
+
+global_variable platform_work_queue gHighPriorityQueue;
+global_variable platform_work_queue gLowPriorityQueue;
+
+PLATFORM_ADD_ENTRY(LinuxAddEntry) {
+	uint32 mask = LINUX_WORK_QUEUE_ENTRY_COUNT - 1;
+	platform_work_queue_entry* entry = 0;
+	uint32 entryToWrite = pQueue->nextEntryToWrite;
+	for (;;) {
+		entry = pQueue->entries + (entryToWrite & mask);
+		uint32 sequence = entry->sequence;
+		CompletePreviousReadsBeforeFutureReads;
+		int32 difference = (int32)(sequence - entryToWrite);
+		if (difference == 0) {
+			// The entry is free on this lap, claim it
+			uint32 original = AtomicCompareExchangeUInt32(&pQueue->nextEntryToWrite, entryToWrite + 1, entryToWrite);
+			if (original == entryToWrite) {
+				break;
+			}
+			entryToWrite = original;
+		}
+		else if (difference < 0) {
+			// The reader has not freed the entry from the last lap, the queue is full
+			entry = 0;
+			break;
+		}
+		else {
+			entryToWrite = pQueue->nextEntryToWrite;
+		}
+	}
+
+	if (entry) {
+		entry->callback = pCallback;
+		entry->data = pData;
+		// Counted before it is published so CompleteAllWork can never see the entry finish before it is owed
+		AtomicAddUInt32(&pQueue->completionGoal, 1);
+		CompletePreviousWritesBeforeFutureWrites;
+		entry->sequence = entryToWrite + 1;
+		sem_post(&pQueue->semaphore);
+	}
+	else {
+		pCallback(pQueue, pData);
+	}
+}
+
+// Returns false when there was nothing to take
+internal bool32
+LinuxDoNextWorkQueueEntry(platform_work_queue* queue) {
+	uint32 mask = LINUX_WORK_QUEUE_ENTRY_COUNT - 1;
+	uint32 entryToRead = queue->nextEntryToRead;
+	for (;;) {
+		platform_work_queue_entry* entry = queue->entries + (entryToRead & mask);
+		uint32 sequence = entry->sequence;
+		CompletePreviousReadsBeforeFutureReads;
+		int32 difference = (int32)(sequence - (entryToRead + 1));
+		if (difference == 0) {
+			uint32 original = AtomicCompareExchangeUInt32(&queue->nextEntryToRead, entryToRead + 1, entryToRead);
+			if (original == entryToRead) {
+				platform_work_queue_callback* callback = entry->callback;
+				void* data = entry->data;
+				CompletePreviousReadsBeforeFutureReads;
+				// Hand the entry back to the writers for the next lap
+				entry->sequence = entryToRead + LINUX_WORK_QUEUE_ENTRY_COUNT;
+
+				callback(queue, data);
+				CompletePreviousWritesBeforeFutureWrites;
+				AtomicAddUInt32(&queue->completionCount, 1);
+				return true;
+			}
+			entryToRead = original;
+		}
+		else if (difference < 0) {
+			// Nothing has been written here on this lap
+			return false;
+		}
+		else {
+			entryToRead = queue->nextEntryToRead;
+		}
+	}
+}
+
+PLATFORM_COMPLETE_ALL_WORK(LinuxCompleteAllWork) {
+	while (pQueue->completionCount != pQueue->completionGoal) {
+		if (!LinuxDoNextWorkQueueEntry(pQueue)) {
+			// The last entries are running on other threads
+			_mm_pause();
+		}
+	}
+}
+
+internal void*
+LinuxWorkerThreadProc(void* parameter) {
+	platform_work_queue* queue = (platform_work_queue*)parameter;
+	for (;;) {
+		if (!LinuxDoNextWorkQueueEntry(queue)) {
+			sem_wait(&queue->semaphore);
+		}
+	}
+	return 0;
+}
+
+internal void*
+LinuxLowPriorityThreadProc(void* parameter) {
+	// Niceness is per thread on Linux, so loads and generation give way to the frame
+	setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), 10);
+	void* result = LinuxWorkerThreadProc(parameter);
+	return result;
+}
+
+internal void
+LinuxMakeQueue(platform_work_queue* queue, uint32 threadCount, bool32 isLowPriority) {
+	queue->completionGoal = 0;
+	queue->completionCount = 0;
+	queue->nextEntryToWrite = 0;
+	queue->nextEntryToRead = 0;
+	for (uint32 entryIndex = 0; entryIndex < LINUX_WORK_QUEUE_ENTRY_COUNT; ++entryIndex) {
+		queue->entries[entryIndex].sequence = entryIndex;
+	}
+	sem_init(&queue->semaphore, 0, 0);
+
+	for (uint32 threadIndex = 0; threadIndex < threadCount; ++threadIndex) {
+		pthread_t thread;
+		if (pthread_create(&thread, 0, isLowPriority ? LinuxLowPriorityThreadProc : LinuxWorkerThreadProc, queue) == 0) {
+			pthread_detach(thread);
+		}
+	}
+}
+
+/* END Work Queues */
+
+/* START Work Stealing */
+
+global_variable platform_scheduler gScheduler;
+
+// One past the calling thread's deque index, zero until the thread first needs one
+global_variable __thread uint32 gThreadDequeIndexPlusOne;
+global_variable __thread uint32 gThreadRandomState;
+
+internal void
+LinuxFutexWait(uint32 volatile* address, uint32 expected) {
+	syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, 0, 0, 0);
+}
+
+internal void
+LinuxFutexWake(uint32 volatile* address, int wakeCount) {
+	syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, wakeCount, 0, 0, 0);
+}
+
+// Null when every deque is taken, the caller then runs its range alone
+internal linux_steal_deque*
+LinuxGetThreadDeque(platform_scheduler* scheduler) {
+	if (!gThreadDequeIndexPlusOne) {
+		uint32 dequeIndex = AtomicAddUInt32(&scheduler->dequeCount, 1);
+		if (dequeIndex >= LINUX_MAX_STEAL_DEQUE_COUNT) {
+			return 0;
+		}
+		gThreadDequeIndexPlusOne = dequeIndex + 1;
+		gThreadRandomState = 2463534242u + 977*dequeIndex;
+	}
+	linux_steal_deque* result = scheduler->deques + (gThreadDequeIndexPlusOne - 1);
+	return result;
+}
+
+// Returns false when the deque is full
+internal bool32
+LinuxPushRange(platform_scheduler* scheduler, linux_steal_deque* deque, linux_steal_range range) {
+	uint64 bottom = deque->bottom;
+	uint64 top = deque->top;
+	if ((bottom - top) >= LINUX_STEAL_DEQUE_ENTRY_COUNT) {
+		return false;
+	}
+
+	deque->entries[bottom % LINUX_STEAL_DEQUE_ENTRY_COUNT] = range;
+	CompletePreviousWritesBeforeFutureWrites;
+	deque->bottom = bottom + 1;
+
+	// A worker going to sleep counts itself before its last look at the deques, so one of the two sees the other
+	CompletePreviousWritesBeforeFutureReads;
+	if (scheduler->sleeperCount) {
+		AtomicAddUInt32(&scheduler->wakeSequence, 1);
+		LinuxFutexWake(&scheduler->wakeSequence, 1);
+	}
+	return true;
+}
+
+internal bool32
+LinuxPopRange(linux_steal_deque* deque, linux_steal_range* range) {
+	bool32 result = false;
+	uint64 bottom = deque->bottom;
+	if (bottom == deque->top) {
+		return false;
+	}
+
+	bottom -= 1;
+	deque->bottom = bottom;
+	// Thieves must see the smaller bottom before the top is read
+	CompletePreviousWritesBeforeFutureReads;
+	uint64 top = deque->top;
+	if ((int64)(bottom - top) >= 0) {
+		*range = deque->entries[bottom % LINUX_STEAL_DEQUE_ENTRY_COUNT];
+		result = true;
+		if (bottom == top) {
+			// The last piece, a thief may be taking it at the same time
+			result = (AtomicCompareExchangeUInt64(&deque->top, top + 1, top) == top);
+			deque->bottom = top + 1;
+		}
+	}
+	else {
+		deque->bottom = top;
+	}
+	return result;
+}
+
+internal bool32
+LinuxStealRange(linux_steal_deque* deque, linux_steal_range* range) {
+	bool32 result = false;
+	uint64 top = deque->top;
+	CompletePreviousReadsBeforeFutureReads;
+	uint64 bottom = deque->bottom;
+	if ((int64)(bottom - top) > 0) {
+		*range = deque->entries[top % LINUX_STEAL_DEQUE_ENTRY_COUNT];
+		CompletePreviousReadsBeforeFutureReads;
+		// A failed exchange means the owner or another thief got it first, the copy is thrown away
+		result = (AtomicCompareExchangeUInt64(&deque->top, top + 1, top) == top);
+	}
+	return result;
+}
+
+// Splits off the upper halves for thieves until the piece is down to the grain, then runs what is left
+internal void
+LinuxRunRange(platform_scheduler* scheduler, linux_steal_deque* deque, linux_steal_range range) {
+	linux_parallel_for_job* job = range.job;
+	while ((range.end - range.begin) > job->grain) {
+		uint32 middle = range.begin + (range.end - range.begin) / 2;
+		linux_steal_range upper = { job, middle, range.end };
+		AtomicAddUInt32(&job->pendingCount, 1);
+		if (!LinuxPushRange(scheduler, deque, upper)) {
+			AtomicAddUInt32(&job->pendingCount, (uint32)-1);
+			break;
+		}
+		range.end = middle;
+	}
+
+	job->callback(job->data, range.begin, range.end);
+	// The job may be gone from the caller's stack as soon as the count reaches zero
+	CompletePreviousWritesBeforeFutureWrites;
+	AtomicAddUInt32(&job->pendingCount, (uint32)-1);
+}
+
+// Own pieces first, newest first, then the oldest piece of a random other deque
+internal bool32
+LinuxRunNextRange(platform_scheduler* scheduler, linux_steal_deque* deque) {
+	linux_steal_range range;
+	bool32 result = LinuxPopRange(deque, &range);
+	if (!result) {
+		uint32 dequeCount = scheduler->dequeCount;
+		if (dequeCount > LINUX_MAX_STEAL_DEQUE_COUNT) {
+			dequeCount = LINUX_MAX_STEAL_DEQUE_COUNT;
+		}
+
+		uint32 random = gThreadRandomState;
+		random ^= random << 13;
+		random ^= random >> 17;
+		random ^= random << 5;
+		gThreadRandomState = random;
+
+		for (uint32 attempt = 0; !result && (attempt < dequeCount); ++attempt) {
+			linux_steal_deque* victim = scheduler->deques + ((random + attempt) % dequeCount);
+			if (victim != deque) {
+				result = LinuxStealRange(victim, &range);
+			}
+		}
+	}
+
+	if (result) {
+		LinuxRunRange(scheduler, deque, range);
+	}
+	return result;
+}
+
+internal bool32
+LinuxHasStealableRange(platform_scheduler* scheduler) {
+	bool32 result = false;
+	uint32 dequeCount = scheduler->dequeCount;
+	if (dequeCount > LINUX_MAX_STEAL_DEQUE_COUNT) {
+		dequeCount = LINUX_MAX_STEAL_DEQUE_COUNT;
+	}
+	for (uint32 dequeIndex = 0; !result && (dequeIndex < dequeCount); ++dequeIndex) {
+		linux_steal_deque* deque = scheduler->deques + dequeIndex;
+		result = ((int64)(deque->bottom - deque->top) > 0);
+	}
+	return result;
+}
+
+PLATFORM_PARALLEL_FOR(LinuxParallelFor) {
+	if (pBegin >= pEnd) {
+		return;
+	}
+
+	linux_steal_deque* deque = LinuxGetThreadDeque(pScheduler);
+	if (!deque) {
+		pCallback(pData, pBegin, pEnd);
+		return;
+	}
+
+	linux_parallel_for_job job;
+	job.callback = pCallback;
+	job.data = pData;
+	job.grain = pGrain ? pGrain : 1;
+	job.pendingCount = 1;
+
+	linux_steal_range range = { &job, pBegin, pEnd };
+	LinuxRunRange(pScheduler, deque, range);
+
+	// Help out, with this job's pieces or anyone else's, until the last of ours is done
+	while (job.pendingCount) {
+		if (!LinuxRunNextRange(pScheduler, deque)) {
+			_mm_pause();
+		}
+	}
+}
+
+internal void*
+LinuxSchedulerThreadProc(void* parameter) {
+	platform_scheduler* scheduler = (platform_scheduler*)parameter;
+	linux_steal_deque* deque = LinuxGetThreadDeque(scheduler);
+	if (deque) {
+		for (;;) {
+			// Spin a little before sleeping, pieces tend to come in bursts
+			bool32 didWork = false;
+			for (uint32 spinIndex = 0; !didWork && (spinIndex < 64); ++spinIndex) {
+				didWork = LinuxRunNextRange(scheduler, deque);
+				if (!didWork) {
+					_mm_pause();
+				}
+			}
+
+			if (!didWork) {
+				uint32 wakeSequence = scheduler->wakeSequence;
+				AtomicAddUInt32(&scheduler->sleeperCount, 1);
+				if (!LinuxHasStealableRange(scheduler)) {
+					LinuxFutexWait(&scheduler->wakeSequence, wakeSequence);
+				}
+				AtomicAddUInt32(&scheduler->sleeperCount, (uint32)-1);
+			}
+		}
+	}
+	return 0;
+}
+
+internal void
+LinuxMakeScheduler(platform_scheduler* scheduler, uint32 threadCount) {
+	scheduler->dequeCount = 0;
+	scheduler->wakeSequence = 0;
+	scheduler->sleeperCount = 0;
+	for (uint32 threadIndex = 0; threadIndex < threadCount; ++threadIndex) {
+		pthread_t thread;
+		if (pthread_create(&thread, 0, LinuxSchedulerThreadProc, scheduler) == 0) {
+			pthread_detach(thread);
+		}
+	}
+}
+
+/* END Work Stealing */
+
+/* START Async File Reads */
+
+global_variable linux_file_reader gFileReader;
+global_variable platform_work_queue gFileReadQueue;
+
+PLATFORM_OPEN_FILE(PlatformOpenFile) {
+	platform_file_handle result;
+	memset(&result, 0, sizeof(platform_file_handle));
+
+	int fileHandle = open(pFilename, O_RDONLY);
+	if (fileHandle >= 0) {
+		struct stat fileStatus;
+		if (fstat(fileHandle, &fileStatus) == 0) {
+			result.mSize = (uint64)fileStatus.st_size;
+			result.mIsValid = true;
+			result.mPlatformHandle = (void*)(intptr_t)fileHandle;
+		}
+		else {
+			close(fileHandle);
+		}
+	}
+	else {
+		// TODO: Logging, could not open the file
+	}
+
+	return result;
+}
+
+PLATFORM_CLOSE_FILE(PlatformCloseFile) {
+	if (pFile->mIsValid) {
+		close((int)(intptr_t)pFile->mPlatformHandle);
+	}
+	memset(pFile, 0, sizeof(platform_file_handle));
+}
+
+// Returns false when the file ended or failed before all of it came in
+internal bool32
+LinuxReadFileBlocking(int fileHandle, uint64 offset, uint64 size, uint8* dest) {
+	while (size) {
+		ssize_t readCount = pread(fileHandle, dest, (size_t)Minimum(size, (uint64)LINUX_MAX_READ_PIECE_SIZE), (off_t)offset);
+		if (readCount > 0) {
+			offset += (uint64)readCount;
+			dest += readCount;
+			size -= (uint64)readCount;
+		}
+		else if ((readCount == 0) || (errno != EINTR)) {
+			break;
+		}
+	}
+
+	bool32 result = (size == 0);
+	return result;
+}
+
+// The fence is the last thing touched, the game can reuse it as soon as the count drops
+internal void
+LinuxSettleReadFence(platform_read_fence* fence, bool32 failed) {
+	if (failed) {
+		AtomicAddUInt32(&fence->mFailedCount, 1);
+	}
+	CompletePreviousWritesBeforeFutureWrites;
+	if (AtomicAddUInt32(&fence->mPendingCount, (uint32)-1) == 1) {
+		LinuxFutexWake(&fence->mPendingCount, INT_MAX);
+	}
+}
+
+// Null when every read is in flight
+internal linux_file_read*
+LinuxAllocateFileRead(linux_file_reader* reader) {
+	linux_file_read* result = 0;
+	pthread_mutex_lock(&reader->mutex);
+	if (reader->firstFree != UInt32Max) {
+		result = reader->reads + reader->firstFree;
+		reader->firstFree = result->nextFree;
+	}
+	pthread_mutex_unlock(&reader->mutex);
+	return result;
+}
+
+internal void
+LinuxFinishFileRead(linux_file_reader* reader, linux_file_read* read) {
+	platform_read_fence* fence = read->fence;
+	bool32 failed = read->failed;
+
+	pthread_mutex_lock(&reader->mutex);
+	read->nextFree = reader->firstFree;
+	reader->firstFree = (uint32)(read - reader->reads);
+	pthread_mutex_unlock(&reader->mutex);
+
+	LinuxSettleReadFence(fence, failed);
+}
+
+internal
+PLATFORM_WORK_QUEUE_CALLBACK(LinuxDoFileRead) {
+	linux_file_read* read = (linux_file_read*)pData;
+	read->failed = !LinuxReadFileBlocking(read->fileHandle, read->offset, read->size, read->dest);
+	LinuxFinishFileRead(&gFileReader, read);
+}
+
+internal int
+LinuxIoUringSetup(uint32 entryCount, struct io_uring_params* params) {
+	int result = (int)syscall(__NR_io_uring_setup, entryCount, params);
+	return result;
+}
+
+internal int
+LinuxIoUringEnter(int ringFile, uint32 submitCount, uint32 minCompleteCount, uint32 flags) {
+	int result = (int)syscall(__NR_io_uring_enter, ringFile, submitCount, minCompleteCount, flags, 0, 0);
+	return result;
+}
+
+// Caller holds the reader's mutex. The kernel copies the piece straight into the read's dest.
+internal void
+LinuxSubmitReadPiece(linux_file_reader* reader, linux_file_read* read) {
+	linux_io_ring* ring = &reader->ring;
+	read->pieceVector.iov_base = read->dest;
+	read->pieceVector.iov_len = (size_t)Minimum(read->size, (uint64)LINUX_MAX_READ_PIECE_SIZE);
+
+	uint32 tail = *ring->submitTail;
+	uint32 index = tail & ring->submitMask;
+	struct io_uring_sqe* entry = ring->submitEntries + index;
+	memset(entry, 0, sizeof(struct io_uring_sqe));
+	entry->opcode = IORING_OP_READV;
+	entry->fd = read->fileHandle;
+	entry->off = read->offset;
+	entry->addr = (uint64)(uintptr_t)&read->pieceVector;
+	entry->len = 1;
+	entry->user_data = (uint64)(read - reader->reads);
+	ring->submitArray[index] = index;
+
+	// The kernel reads the ring indices without locks, they need real release and acquire ordering
+	__atomic_store_n(ring->submitTail, tail + 1, __ATOMIC_RELEASE);
+
+	// Without kernel polling the entry is taken during the call, so the ring never fills up
+	while ((LinuxIoUringEnter(ring->ringFile, 1, 0, 0) < 0) && ((errno == EINTR) || (errno == EAGAIN))) {
+	}
+}
+
+internal void*
+LinuxFileReadCompletionThreadProc(void* parameter) {
+	linux_file_reader* reader = (linux_file_reader*)parameter;
+	linux_io_ring* ring = &reader->ring;
+	for (;;) {
+		LinuxIoUringEnter(ring->ringFile, 0, 1, IORING_ENTER_GETEVENTS);
+
+		uint32 head = *ring->completeHead;
+		uint32 tail = __atomic_load_n(ring->completeTail, __ATOMIC_ACQUIRE);
+		while (head != tail) {
+			struct io_uring_cqe* entry = ring->completeEntries + (head & ring->completeMask);
+			linux_file_read* read = reader->reads + entry->user_data;
+			int32 readCount = entry->res;
+			++head;
+			__atomic_store_n(ring->completeHead, head, __ATOMIC_RELEASE);
+
+			if (readCount > 0) {
+				read->offset += (uint64)readCount;
+				read->dest += readCount;
+				read->size -= (uint64)readCount;
+			}
+			else if ((readCount != -EINTR) && (readCount != -EAGAIN)) {
+				// Zero is the end of the file coming before the end of the read
+				read->failed = true;
+			}
+
+			if (read->size && !read->failed) {
+				pthread_mutex_lock(&reader->mutex);
+				LinuxSubmitReadPiece(reader, read);
+				pthread_mutex_unlock(&reader->mutex);
+			}
+			else {
+				LinuxFinishFileRead(reader, read);
+			}
+		}
+	}
+	return 0;
+}
+
+// False when the kernel has no io_uring or the process is not allowed to use it
+internal bool32
+LinuxMakeIoRing(linux_io_ring* ring, uint32 entryCount) {
+	bool32 result = false;
+
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	ring->ringFile = LinuxIoUringSetup(entryCount, &params);
+	if (ring->ringFile >= 0) {
+		size_t submitRingSize = params.sq_off.array + params.sq_entries*sizeof(uint32);
+		size_t completeRingSize = params.cq_off.cqes + params.cq_entries*sizeof(struct io_uring_cqe);
+		size_t submitEntriesSize = params.sq_entries*sizeof(struct io_uring_sqe);
+		bool32 isSingleMap = (params.features & IORING_FEAT_SINGLE_MMAP);
+		if (isSingleMap) {
+			submitRingSize = Maximum(submitRingSize, completeRingSize);
+		}
+
+		uint8* submitRing = (uint8*)mmap(0, submitRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			ring->ringFile, IORING_OFF_SQ_RING);
+		uint8* completeRing = submitRing;
+		if (!isSingleMap && (submitRing != MAP_FAILED)) {
+			completeRing = (uint8*)mmap(0, completeRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+				ring->ringFile, IORING_OFF_CQ_RING);
+		}
+		void* submitEntries = mmap(0, submitEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			ring->ringFile, IORING_OFF_SQES);
+
+		if ((submitRing != MAP_FAILED) && (completeRing != MAP_FAILED) && (submitEntries != MAP_FAILED)) {
+			ring->submitHead = (uint32 volatile*)(submitRing + params.sq_off.head);
+			ring->submitTail = (uint32 volatile*)(submitRing + params.sq_off.tail);
+			ring->submitMask = *(uint32*)(submitRing + params.sq_off.ring_mask);
+			ring->submitArray = (uint32*)(submitRing + params.sq_off.array);
+			ring->submitEntries = (struct io_uring_sqe*)submitEntries;
+
+			ring->completeHead = (uint32 volatile*)(completeRing + params.cq_off.head);
+			ring->completeTail = (uint32 volatile*)(completeRing + params.cq_off.tail);
+			ring->completeMask = *(uint32*)(completeRing + params.cq_off.ring_mask);
+			ring->completeEntries = (struct io_uring_cqe*)(completeRing + params.cq_off.cqes);
+			result = true;
+		}
+		else {
+			// Closing the ring takes whatever did get mapped with it
+			close(ring->ringFile);
+			ring->ringFile = -1;
+		}
+	}
+
+	return result;
+}
+
+internal void
+LinuxMakeFileReader(linux_file_reader* reader, platform_work_queue* readQueue, bool32 allowRing) {
+	pthread_mutex_init(&reader->mutex, 0);
+	for (uint32 readIndex = 0; readIndex < LINUX_FILE_READ_COUNT; ++readIndex) {
+		reader->reads[readIndex].nextFree = readIndex + 1;
+	}
+	reader->reads[LINUX_FILE_READ_COUNT - 1].nextFree = UInt32Max;
+	reader->firstFree = 0;
+	reader->readQueue = readQueue;
+
+	reader->hasRing = (allowRing && LinuxMakeIoRing(&reader->ring, LINUX_FILE_READ_COUNT));
+	if (reader->hasRing) {
+		pthread_t thread;
+		if (pthread_create(&thread, 0, LinuxFileReadCompletionThreadProc, reader) == 0) {
+			pthread_detach(thread);
+		}
+		else {
+			close(reader->ring.ringFile);
+			reader->hasRing = false;
+		}
+	}
+
+	if (!reader->hasRing) {
+		// The threads spend their time blocked in pread, a few keep several reads in flight
+		LinuxMakeQueue(readQueue, LINUX_FILE_READ_THREAD_COUNT, false);
+	}
+}
+
+PLATFORM_READ_DATA_FROM_FILE(LinuxReadDataFromFile) {
+	Assert(pFile->mIsValid);
+	linux_file_reader* reader = &gFileReader;
+	AtomicAddUInt32(&pFence->mPendingCount, 1);
+
+	linux_file_read* read = pSize ? LinuxAllocateFileRead(reader) : 0;
+	if (read) {
+		read->fileHandle = (int)(intptr_t)pFile->mPlatformHandle;
+		read->offset = pOffset;
+		read->size = pSize;
+		read->dest = (uint8*)pDest;
+		read->fence = pFence;
+		read->failed = false;
+
+		if (reader->hasRing) {
+			pthread_mutex_lock(&reader->mutex);
+			LinuxSubmitReadPiece(reader, read);
+			pthread_mutex_unlock(&reader->mutex);
+		}
+		else {
+			LinuxAddEntry(reader->readQueue, LinuxDoFileRead, read);
+		}
+	}
+	else {
+		// Nothing to read, or so many reads are in flight that this one is done on the calling thread
+		bool32 failed = !LinuxReadFileBlocking((int)(intptr_t)pFile->mPlatformHandle, pOffset, pSize, (uint8*)pDest);
+		LinuxSettleReadFence(pFence, failed);
+	}
+}
+
+PLATFORM_WAIT_FOR_READS(LinuxWaitForReads) {
+	for (;;) {
+		uint32 pendingCount = pFence->mPendingCount;
+		if (!pendingCount) {
+			break;
+		}
+		LinuxFutexWait(&pFence->mPendingCount, pendingCount);
+	}
+	CompletePreviousReadsBeforeFutureReads;
+
+	bool32 result = (pFence->mFailedCount == 0);
+	return result;
+}
+
+/* END Async File Reads */
+
+/* START Profiling */
+
+// The trace wants microseconds and the stamps are in cycles
+internal real64
+LinuxMeasureCyclesPerMicrosecond(void) {
+	uint64 startCounter = LinuxGetWallClock();
+	uint64 startCycleCount = __rdtsc();
+	timespec wait;
+	wait.tv_sec = 0;
+	wait.tv_nsec = 20000000;
+	nanosleep(&wait, 0);
+	uint64 endCycleCount = __rdtsc();
+	uint64 endCounter = LinuxGetWallClock();
+
+	real64 result = ((real64)(endCycleCount - startCycleCount)*1000.0) / (real64)(endCounter - startCounter);
+	return result;
+}
+
+// Returns 0 when the rings or the trace file can not be had
+internal linux_profiler*
+LinuxMakeProfiler(char* traceFilename) {
+	linux_profiler* result = (linux_profiler*)calloc(1, sizeof(linux_profiler));
+	if (!result) {
+		fprintf(stderr, "Could not allocate the profiler\n");
+		return 0;
+	}
+
+	// Anonymous pages come back zeroed, which is every ring unclaimed
+	void* table = mmap(0, sizeof(debug_table), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (table == MAP_FAILED) {
+		fprintf(stderr, "Could not allocate the debug event rings\n");
+		free(result);
+		return 0;
+	}
+	result->table = (debug_table*)table;
+
+	if (traceFilename) {
+		result->traceFile = fopen(traceFilename, "w");
+		if (!result->traceFile) {
+			fprintf(stderr, "Could not write %s\n", traceFilename);
+			munmap(table, sizeof(debug_table));
+			free(result);
+			return 0;
+		}
+		fprintf(result->traceFile, "{\"traceEvents\":[");
+		result->cyclesPerMicrosecond = LinuxMeasureCyclesPerMicrosecond();
+	}
+	result->firstClock = __rdtsc();
+	return result;
+}
+
+// Names are matched by their text, a reloaded game hands in the same names at new addresses
+internal uint32
+LinuxGetProfileBlockIndex(linux_profiler* profiler, const char* name) {
+	uint32 nameHash = 2166136261u;
+	for (const char* scan = name; *scan; ++scan) {
+		nameHash = (nameHash ^ (uint8)*scan)*16777619u;
+	}
+
+	// Past the last block when the table is full, those names go untimed
+	uint32 result = LINUX_PROFILE_MAX_BLOCK_COUNT;
+	for (uint32 slotIndex = nameHash; ; ++slotIndex) {
+		uint32* slot = profiler->blockIndexPlusOne + (slotIndex & (LINUX_PROFILE_BLOCK_SLOT_COUNT - 1));
+		if (*slot == 0) {
+			if (profiler->blockCount < LINUX_PROFILE_MAX_BLOCK_COUNT) {
+				char* nameCopy = strdup(name);
+				if (nameCopy) {
+					result = profiler->blockCount++;
+					linux_profile_block* block = profiler->blocks + result;
+					block->name = nameCopy;
+					block->nameHash = nameHash;
+					*slot = result + 1;
+				}
+			}
+			break;
+		}
+
+		linux_profile_block* block = profiler->blocks + (*slot - 1);
+		if ((block->nameHash == nameHash) && (strcmp(block->name, name) == 0)) {
+			result = *slot - 1;
+			break;
+		}
+	}
+	return result;
+}
+
+// Complete events carry their own begin and length, so a block only goes out once both stamps are in
+internal void
+LinuxWriteTraceEvent(linux_profiler* profiler, uint32 threadIndex, linux_profile_block* block,
+					 uint64 beginClock, uint64 endClock) {
+	real64 toMicroseconds = 1.0 / profiler->cyclesPerMicrosecond;
+	fprintf(profiler->traceFile, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+		profiler->traceEventCount ? "," : "", block->name, threadIndex,
+		(real64)(beginClock - profiler->firstClock)*toMicroseconds,
+		(real64)(endClock - beginClock)*toMicroseconds);
+	++profiler->traceEventCount;
+}
+
+// Has to run before the game code is unloaded, the stamps still point at its names
+internal void
+LinuxCollateDebugEvents(linux_profiler* profiler) {
+	for (uint32 ringIndex = 0; ringIndex < DEBUG_MAX_THREAD_COUNT; ++ringIndex) {
+		debug_event_ring* ring = profiler->table->mRings + ringIndex;
+		if (ring->mThreadID) {
+			linux_profile_thread* thread = profiler->threads + ringIndex;
+
+			uint32 droppedCount = ring->mDroppedCount;
+			uint32 writeIndex = ring->mWriteIndex;
+			CompletePreviousReadsBeforeFutureReads;
+
+			uint32 readIndex = ring->mReadIndex;
+			for (; readIndex != writeIndex; ++readIndex) {
+				debug_event* event = ring->mEvents + (readIndex & (DEBUG_RING_EVENT_COUNT - 1));
+				uint32 blockIndex = LinuxGetProfileBlockIndex(profiler, event->mName);
+				if (blockIndex == LINUX_PROFILE_MAX_BLOCK_COUNT) {
+					continue;
+				}
+
+				if (event->mType == DEBUG_EVENT_BEGIN_BLOCK) {
+					// Too deep to track, its end will not match and is skipped too
+					if (thread->openCount < LINUX_PROFILE_MAX_DEPTH) {
+						linux_profile_open_block* openBlock = thread->openBlocks + thread->openCount++;
+						openBlock->blockIndex = blockIndex;
+						openBlock->beginClock = event->mClock;
+						openBlock->childCycles = 0;
+					}
+				}
+				else if (thread->openCount &&
+						 (thread->openBlocks[thread->openCount - 1].blockIndex == blockIndex)) {
+					linux_profile_open_block* openBlock = thread->openBlocks + --thread->openCount;
+					uint64 cycles = event->mClock - openBlock->beginClock;
+
+					linux_profile_block* block = profiler->blocks + blockIndex;
+					++block->frameCallCount;
+					block->frameInclusiveCycles += cycles;
+					block->frameSelfCycles += cycles - openBlock->childCycles;
+					if (thread->openCount) {
+						thread->openBlocks[thread->openCount - 1].childCycles += cycles;
+					}
+
+					if (profiler->traceFile) {
+						LinuxWriteTraceEvent(profiler, ringIndex, block, openBlock->beginClock, event->mClock);
+					}
+				}
+			}
+
+			// The events have to be read before the thread can write over them
+			CompletePreviousReadsBeforeFutureReads;
+			ring->mReadIndex = readIndex;
+
+			// A full ring dropped stamps after the ones just read, the blocks still open may never see their ends
+			if (droppedCount != thread->droppedCount) {
+				profiler->droppedCount += droppedCount - thread->droppedCount;
+				thread->droppedCount = droppedCount;
+				thread->openCount = 0;
+			}
+		}
+	}
+}
+
+// Only the timed frames go into the totals, warm up frames are still traced
+internal void
+LinuxEndProfileFrame(linux_profiler* profiler, bool32 isTimed) {
+	LinuxCollateDebugEvents(profiler);
+	for (uint32 blockIndex = 0; blockIndex < profiler->blockCount; ++blockIndex) {
+		linux_profile_block* block = profiler->blocks + blockIndex;
+		if (isTimed) {
+			block->callCount += block->frameCallCount;
+			block->inclusiveCycles += block->frameInclusiveCycles;
+			block->selfCycles += block->frameSelfCycles;
+			if (block->frameInclusiveCycles > block->maxFrameInclusiveCycles) {
+				block->maxFrameInclusiveCycles = block->frameInclusiveCycles;
+			}
+		}
+		block->frameCallCount = 0;
+		block->frameInclusiveCycles = 0;
+		block->frameSelfCycles = 0;
+	}
+	if (isTimed) {
+		++profiler->timedFrameCount;
+	}
+}
+
+internal void
+LinuxEndTrace(linux_profiler* profiler) {
+	if (profiler->traceFile) {
+		fprintf(profiler->traceFile, "\n]}\n");
+		fclose(profiler->traceFile);
+		profiler->traceFile = 0;
+	}
+}
+
+internal int
+CompareProfileBlockCycles(const void* a, const void* b) {
+	uint64 aCycles = ((linux_profile_block*)a)->inclusiveCycles;
+	uint64 bCycles = ((linux_profile_block*)b)->inclusiveCycles;
+	int result = (aCycles > bCycles) ? -1 : ((aCycles < bCycles) ? 1 : 0);
+	return result;
+}
+
+// Sorts the blocks in place, nothing can be collated after it
+internal void
+LinuxReportProfile(linux_profiler* profiler) {
+	if (profiler->timedFrameCount == 0) {
+		return;
+	}
+
+	qsort(profiler->blocks, profiler->blockCount, sizeof(linux_profile_block), CompareProfileBlockCycles);
+
+	real64 perFrame = 1.0 / (real64)profiler->timedFrameCount;
+	printf("%-32s %11s %11s %11s %11s\n", "block", "calls/frame", "Kcycles", "self", "max");
+	for (uint32 blockIndex = 0; blockIndex < profiler->blockCount; ++blockIndex) {
+		linux_profile_block* block = profiler->blocks + blockIndex;
+		printf("%-32s %11.2f %11.1f %11.1f %11.1f\n", block->name,
+			(real64)block->callCount*perFrame,
+			((real64)block->inclusiveCycles*perFrame) / 1000.0,
+			((real64)block->selfCycles*perFrame) / 1000.0,
+			(real64)block->maxFrameInclusiveCycles / 1000.0);
+	}
+	if (profiler->droppedCount) {
+		printf("%llu stamps were dropped, the rings filled up within a frame\n",
+			(unsigned long long)profiler->droppedCount);
+	}
+}
+
+/* END Profiling */
+
+/* START Dynamically linking the platform independent code */
+
+// Copy a file byte for byte, the destination is replaced rather than written over
+internal bool32
+LinuxCopyFile(char* sourceName, char* destName) {
+	bool32 result = false;
+
+	int sourceFile = open(sourceName, O_RDONLY);
+	if (sourceFile >= 0) {
+		// A new inode every time, so the loader never mistakes the copy for a library it already has open
+		unlink(destName);
+		int destFile = open(destName, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+		if (destFile >= 0) {
+			uint8 buffer[Kilobytes(64)];
+			result = true;
+			for (;;) {
+				ssize_t readCount = read(sourceFile, buffer, sizeof(buffer));
+				if (readCount == 0) {
+					break;
+				}
+				if ((readCount < 0) || (write(destFile, buffer, readCount) != readCount)) {
+					result = false;
+					break;
+				}
+			}
+			close(destFile);
+		}
+		close(sourceFile);
+	}
+
+	return result;
+}
+
+// Load in the shared object containing the game code
+internal linux_game_code
+LinuxLoadGameCode(char* sourceSOName, char* tempSOName, char* lockFilename) {
+	linux_game_code result;
+	memset(&result, 0, sizeof(result));
+
+	// The build writes the lock file while the linker is still writing the shared object
+	if (access(lockFilename, F_OK) != 0) {
+		// Load a copy so the build can replace the original while it is loaded
+		if (LinuxCopyFile(sourceSOName, tempSOName)) {
+			result.gameCodeSO = dlopen(tempSOName, RTLD_NOW | RTLD_LOCAL);
+			// The mapping keeps the file alive, nothing is left behind in the build directory
+			unlink(tempSOName);
+		}
+
+		// Setup function pointers
+		if (result.gameCodeSO) {
+			result.updateAndRender =
+				(game_update_and_render*)dlsym(result.gameCodeSO, "GameUpdateAndRender");
+			result.getSoundSamples =
+				(game_get_sound_samples*)dlsym(result.gameCodeSO, "GameGetSoundSamples");
+
+			result.isValid = (result.updateAndRender && result.getSoundSamples);
+		}
+		else {
+			fprintf(stderr, "Could not load %s: %s\n", sourceSOName, dlerror());
+		}
+	}
+
+	if (!result.isValid) {
+		if (result.gameCodeSO) {
+			dlclose(result.gameCodeSO);
+			result.gameCodeSO = 0;
+		}
+		result.updateAndRender = 0;
+		result.getSoundSamples = 0;
+	}
+
+	return result;
+}
+
+// Unload the game code (reset function pointers)
+internal void
+LinuxUnloadGameCode(linux_game_code* gameCode) {
+	if (gameCode->gameCodeSO) {
+		dlclose(gameCode->gameCodeSO);
+		gameCode->gameCodeSO = 0;
+	}
+	gameCode->isValid = false;
+	gameCode->updateAndRender = 0;
+	gameCode->getSoundSamples = 0;
+}
+
+// Watch the directory, the build replaces the shared object so a watch on the file itself would go stale
+internal bool32
+LinuxBeginWatchingGameCode(linux_game_code_watch* watch, char* sourceSOName, char* lockFilename) {
+	memset(watch, 0, sizeof(linux_game_code_watch));
+	watch->notifyFile = -1;
+
+	char directory[LINUX_STATE_FILE_NAME_COUNT];
+	LinuxBuildSiblingFilename(sourceSOName, ".", sizeof(directory), directory);
+
+	watch->sourceSOFilename = FindOnePastLastSlash(sourceSOName);
+	watch->lockFilename = FindOnePastLastSlash(lockFilename);
+
+	watch->notifyFile = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	bool32 result = ((watch->notifyFile >= 0) &&
+		(inotify_add_watch(watch->notifyFile, directory, IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE) >= 0));
+	if (!result) {
+		fprintf(stderr, "Could not watch %s, the game code will not reload\n", directory);
+	}
+
+	return result;
+}
+
+// Drains the pending events without blocking, returns true when the game code should be reloaded
+internal bool32
+LinuxGameCodeChanged(linux_game_code_watch* watch) {
+	if (watch->notifyFile >= 0) {
+		// Events are variable length, the buffer has to be aligned for inotify_event
+		alignas(inotify_event) char buffer[Kilobytes(4)];
+		for (;;) {
+			ssize_t readCount = read(watch->notifyFile, buffer, sizeof(buffer));
+			if (readCount <= 0) {
+				break;
+			}
+
+			for (char* at = buffer; at < (buffer + readCount);) {
+				inotify_event* event = (inotify_event*)at;
+				if (event->len &&
+					((strcmp(event->name, watch->sourceSOFilename) == 0) ||
+					(strcmp(event->name, watch->lockFilename) == 0))) {
+					watch->needsReload = true;
+				}
+				at += sizeof(inotify_event) + event->len;
+			}
+		}
+	}
+
+	bool32 result = watch->needsReload;
+	return result;
+}
+
+// Swaps in the new game code between frames. The old code stays loaded until the new build loads,
+// a half written build just gets tried again next frame.
+internal void
+LinuxReloadGameCode(linux_game_code_watch* watch, linux_game_code* game, linux_profiler* profiler,
+					char* sourceSOName, char* lockFilename) {
+	// The loader matches libraries by name, the old copy is still open under the last one
+	char tempSOName[LINUX_STATE_FILE_NAME_COUNT];
+	LinuxBuildTempGameCodeFilename(sourceSOName, watch->reloadCount + 1, sizeof(tempSOName), tempSOName);
+
+	linux_game_code newGame = LinuxLoadGameCode(sourceSOName, tempSOName, lockFilename);
+	if (newGame.isValid) {
+		// Queued callbacks point into the old code
+		LinuxCompleteAllWork(&gHighPriorityQueue);
+		LinuxCompleteAllWork(&gLowPriorityQueue);
+		if (profiler) {
+			LinuxCollateDebugEvents(profiler);
+		}
+		LinuxUnloadGameCode(game);
+		*game = newGame;
+		watch->needsReload = false;
+		++watch->reloadCount;
+		fprintf(stderr, "Reloaded %s\n", sourceSOName);
+	}
+}
+
+/* END Dynamically linking the platform independent code */
+
+/* START Scripted Input */
+
+// Names for the buttons of game_controller_input::mButtons, in order
+global_variable const char* gButtonNames[] = {
+	"move_up", "move_down", "move_left", "move_right",
+	"action_up", "action_down", "action_left", "action_right",
+	"left_shoulder", "right_shoulder",
+	"start", "back",
+};
+
+inline bool32
+IsScriptSpace(char c) {
+	bool32 result = ((c == ' ') || (c == '\t') || (c == '\r'));
+	return result;
+}
+
+/*
+ * Reads an input script, one step per line:
+ *     <frame count> [button] [button] ...
+ * The buttons of the keyboard controller named on the line are held down for that many frames,
+ * every other button is up. Everything after a # is a comment. Returns false on a line that does not parse.
+ */
+internal bool32
+LinuxLoadInputScript(linux_input_script* script, char* text, uint32 textSize) {
+	memset(script, 0, sizeof(linux_input_script));
+
+	uint32 lineNumber = 0;
+	char* at = text;
+	char* end = text + textSize;
+	while (at < end) {
+		char* lineEnd = at;
+		while ((lineEnd < end) && (*lineEnd != '\n')) {
+			++lineEnd;
+		}
+		++lineNumber;
+
+		while ((at < lineEnd) && IsScriptSpace(*at)) {
+			++at;
+		}
+		if ((at < lineEnd) && (*at != '#')) {
+			uint32 frameCount = 0;
+			while ((at < lineEnd) && (*at >= '0') && (*at <= '9')) {
+				frameCount = frameCount*10 + (*at++ - '0');
+			}
+
+			uint32 buttonsDown = 0;
+			bool32 isValid = (frameCount > 0) && ((at == lineEnd) || IsScriptSpace(*at) || (*at == '#'));
+			while (isValid) {
+				while ((at < lineEnd) && IsScriptSpace(*at)) {
+					++at;
+				}
+				if ((at == lineEnd) || (*at == '#')) {
+					break;
+				}
+
+				char* word = at;
+				while ((at < lineEnd) && !IsScriptSpace(*at) && (*at != '#')) {
+					++at;
+				}
+
+				isValid = false;
+				for (uint32 buttonIndex = 0; buttonIndex < ArrayCount(gButtonNames); ++buttonIndex) {
+					const char* name = gButtonNames[buttonIndex];
+					if ((StringLength(name) == (at - word)) && (memcmp(name, word, at - word) == 0)) {
+						buttonsDown |= (1 << buttonIndex);
+						isValid = true;
+					}
+				}
+			}
+
+			if (!isValid || (script->stepCount == LINUX_MAX_SCRIPT_STEP_COUNT)) {
+				fprintf(stderr, "Input script line %u does not parse\n", lineNumber);
+				return false;
+			}
+
+			linux_script_step* step = script->steps + script->stepCount++;
+			step->frameCount = frameCount;
+			step->buttonsDown = buttonsDown;
+		}
+
+		at = (lineEnd < end) ? (lineEnd + 1) : end;
+	}
+
+	script->stepIndex = 0;
+	script->framesLeftInStep = script->stepCount ? script->steps[0].frameCount : 0;
+	return true;
+}
+
+internal void
+LinuxProcessButton(game_button_state* pNewState, bool32 isDown) {
+	if (pNewState->EndedDown != isDown) {
+		pNewState->EndedDown = isDown;
+		++pNewState->mHalfTransitionCount;
+	}
+}
+
+// Presses the buttons of the current step on the keyboard controller, everything is up once the script runs out
+internal void
+LinuxPlayInputScript(linux_input_script* script, game_controller_input* keyboardController) {
+	uint32 buttonsDown = 0;
+	if (script->stepIndex < script->stepCount) {
+		buttonsDown = script->steps[script->stepIndex].buttonsDown;
+		if (--script->framesLeftInStep == 0) {
+			++script->stepIndex;
+			if (script->stepIndex < script->stepCount) {
+				script->framesLeftInStep = script->steps[script->stepIndex].frameCount;
+			}
+		}
+	}
+
+	for (uint32 buttonIndex = 0; buttonIndex < ArrayCount(gButtonNames); ++buttonIndex) {
+		LinuxProcessButton(&keyboardController->mButtons[buttonIndex], (buttonsDown >> buttonIndex) & 1);
+	}
+}
+
+/* END Scripted Input */
+
+/* START Debug Loop Support */
+
+// Recorded input is the raw game_input of every frame, the same stream the Windows host records
+
+internal void
+LinuxBeginRecordingInput(linux_state* state, char* filename) {
+	state->recordingFile = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (state->recordingFile < 0) {
+		fprintf(stderr, "Could not record input to %s\n", filename);
+	}
+}
+
+internal void
+LinuxEndRecordingInput(linux_state* state) {
+	if (state->recordingFile >= 0) {
+		close(state->recordingFile);
+	}
+	state->recordingFile = -1;
+}
+
+internal void
+LinuxBeginInputPlayback(linux_state* state, char* filename) {
+	state->playbackFile = open(filename, O_RDONLY);
+	if (state->playbackFile < 0) {
+		fprintf(stderr, "Could not play back input from %s\n", filename);
+	}
+}
+
+internal void
+LinuxEndInputPlayback(linux_state* state) {
+	if (state->playbackFile >= 0) {
+		close(state->playbackFile);
+	}
+	state->playbackFile = -1;
+}
+
+internal void
+LinuxRecordInput(linux_state* state, game_input* newInput) {
+	if (write(state->recordingFile, newInput, sizeof(*newInput)) != sizeof(*newInput)) {
+		// TODO: Logging
+	}
+}
+
+internal void
+LinuxPlaybackInput(linux_state* state, game_input* newInput) {
+	// Restart at the end of loop
+	ssize_t bytesRead = read(state->playbackFile, newInput, sizeof(*newInput));
+	if (bytesRead != sizeof(*newInput)) {
+		lseek(state->playbackFile, 0, SEEK_SET);
+		bytesRead = read(state->playbackFile, newInput, sizeof(*newInput));
+	}
+}
+
+/* END Debug Loop Support */
+
+/* START Frame Timing */
+
+internal int
+CompareFrameNanoseconds(const void* a, const void* b) {
+	uint64 aTime = ((linux_frame_timing*)a)->nanoseconds;
+	uint64 bTime = ((linux_frame_timing*)b)->nanoseconds;
+	int result = (aTime < bTime) ? -1 : ((aTime > bTime) ? 1 : 0);
+	return result;
+}
+
+// Sorts the timings in place
+internal void
+LinuxReportFrameTimings(linux_frame_timing* timings, uint32 frameCount) {
+	if (frameCount == 0) {
+		printf("No frames were timed\n");
+		return;
+	}
+
+	uint64 totalNanoseconds = 0;
+	uint64 totalCycles = 0;
+	for (uint32 frameIndex = 0; frameIndex < frameCount; ++frameIndex) {
+		totalNanoseconds += timings[frameIndex].nanoseconds;
+		totalCycles += timings[frameIndex].cycles;
+	}
+
+	qsort(timings, frameCount, sizeof(linux_frame_timing), CompareFrameNanoseconds);
+
+	real64 toMilliseconds = 1.0 / 1000000.0;
+	printf("frames %u, total %.2fms\n", frameCount, (real64)totalNanoseconds*toMilliseconds);
+	printf("ms/frame min %.3f, median %.3f, p99 %.3f, max %.3f, avg %.3f\n",
+		(real64)timings[0].nanoseconds*toMilliseconds,
+		(real64)timings[frameCount / 2].nanoseconds*toMilliseconds,
+		(real64)timings[((uint64)frameCount*99) / 100].nanoseconds*toMilliseconds,
+		(real64)timings[frameCount - 1].nanoseconds*toMilliseconds,
+		((real64)totalNanoseconds / (real64)frameCount)*toMilliseconds);
+	printf("Mcycles/frame avg %.3f\n", ((real64)totalCycles / (real64)frameCount) / 1000000.0);
+}
+
+// FNV-1a of the visible pixels, two runs that draw the same frame print the same hash
+internal uint32
+HashOffscreenBuffer(linux_offscreen_buffer* buffer) {
+	uint32 result = 2166136261u;
+	uint8* row = (uint8*)buffer->mMemory;
+	for (int y = 0; y < buffer->mHeight; ++y) {
+		for (int byteIndex = 0; byteIndex < buffer->mWidth*buffer->mBytesPerPixel; ++byteIndex) {
+			result = (result ^ row[byteIndex])*16777619u;
+		}
+		row += buffer->mPitch;
+	}
+	return result;
+}
+
+/* END Frame Timing */
+
+internal void
+LinuxHandleInterrupt(int signal) {
+	gRunning = false;
+}
+
+internal void
+PrintUsage(char* programName) {
+	fprintf(stderr,
+		"Usage: %s [options]\n"
+		"  -game <file.so>     Game code to run (engine.so next to the executable)\n"
+		"  -frames <count>     Frames to run, 0 runs until interrupted (%d)\n"
+		"  -warmup <count>     Frames run before timing starts (0)\n"
+		"  -size <w> <h>       Offscreen buffer size (%d %d)\n"
+		"  -hz <rate>          Game update rate, sets the frame delta time (%d)\n"
+		"  -realtime           Wait out the rest of each frame instead of running flat out\n"
+		"  -script <file>      Input script, one '<frames> [button]...' step per line\n"
+		"  -playback <file>    Recorded game_input stream, looped\n"
+		"  -record <file>      Record the game_input of every frame\n"
+		"  -csv <file>         Write the time of every timed frame\n"
+		"  -profile            Report the cycles of every TIMED_BLOCK per timed frame\n"
+		"  -trace <file.json>  Write every TIMED_BLOCK as a Chrome trace event\n"
+		"  -nouring            Read files on a pread thread pool even when io_uring is there\n",
+		programName, LINUX_DEFAULT_FRAME_COUNT, LINUX_DEFAULT_BUFFER_WIDTH, LINUX_DEFAULT_BUFFER_HEIGHT,
+		LINUX_DEFAULT_UPDATE_HZ);
+}
+
+int
+main(int argumentCount, char** arguments) {
+	linux_state state;
+	memset(&state, 0, sizeof(state));
+	state.recordingFile = -1;
+	state.playbackFile = -1;
+	LinuxGetEXEFilename(&state);
+
+	char sourceGameCodeSOFullPath[LINUX_STATE_FILE_NAME_COUNT];
+	LinuxBuildEXEPathFilename(&state, "engine.so", sizeof(sourceGameCodeSOFullPath), sourceGameCodeSOFullPath);
+
+	uint32 frameCount = LINUX_DEFAULT_FRAME_COUNT;
+	uint32 warmupFrameCount = 0;
+	int bufferWidth = LINUX_DEFAULT_BUFFER_WIDTH;
+	int bufferHeight = LINUX_DEFAULT_BUFFER_HEIGHT;
+	int gameUpdateHz = LINUX_DEFAULT_UPDATE_HZ;
+	char* scriptFilename = 0;
+	char* playbackFilename = 0;
+	char* recordFilename = 0;
+	char* csvFilename = 0;
+	char* traceFilename = 0;
+	bool32 isProfiling = false;
+	bool32 isRealtime = false;
+	bool32 allowIoRing = true;
+
+	for (int argumentIndex = 1; argumentIndex < argumentCount; ++argumentIndex) {
+		char* argument = arguments[argumentIndex];
+		int valuesLeft = argumentCount - argumentIndex - 1;
+		if ((strcmp(argument, "-game") == 0) && (valuesLeft >= 1)) {
+			CatStrings(0, 0, StringLength(arguments[argumentIndex + 1]), arguments[argumentIndex + 1],
+				sizeof(sourceGameCodeSOFullPath), sourceGameCodeSOFullPath);
+			++argumentIndex;
+		}
+		else if ((strcmp(argument, "-frames") == 0) && (valuesLeft >= 1)) {
+			frameCount = (uint32)atoi(arguments[++argumentIndex]);
+		}
+		else if ((strcmp(argument, "-warmup") == 0) && (valuesLeft >= 1)) {
+			warmupFrameCount = (uint32)atoi(arguments[++argumentIndex]);
+		}
+		else if ((strcmp(argument, "-size") == 0) && (valuesLeft >= 2)) {
+			bufferWidth = atoi(arguments[++argumentIndex]);
+			bufferHeight = atoi(arguments[++argumentIndex]);
+		}
+		else if ((strcmp(argument, "-hz") == 0) && (valuesLeft >= 1)) {
+			gameUpdateHz = atoi(arguments[++argumentIndex]);
+		}
+		else if (strcmp(argument, "-realtime") == 0) {
+			isRealtime = true;
+		}
+		else if (strcmp(argument, "-profile") == 0) {
+			isProfiling = true;
+		}
+		else if (strcmp(argument, "-nouring") == 0) {
+			allowIoRing = false;
+		}
+		else if ((strcmp(argument, "-script") == 0) && (valuesLeft >= 1)) {
+			scriptFilename = arguments[++argumentIndex];
+		}
+		else if ((strcmp(argument, "-playback") == 0) && (valuesLeft >= 1)) {
+			playbackFilename = arguments[++argumentIndex];
+		}
+		else if ((strcmp(argument, "-record") == 0) && (valuesLeft >= 1)) {
+			recordFilename = arguments[++argumentIndex];
+		}
+		else if ((strcmp(argument, "-csv") == 0) && (valuesLeft >= 1)) {
+			csvFilename = arguments[++argumentIndex];
+		}
+		else if ((strcmp(argument, "-trace") == 0) && (valuesLeft >= 1)) {
+			traceFilename = arguments[++argumentIndex];
+		}
+		else {
+			PrintUsage(arguments[0]);
+			return 1;
+		}
+	}
+
+	if ((bufferWidth <= 0) || (bufferHeight <= 0) || (gameUpdateHz <= 0)) {
+		PrintUsage(arguments[0]);
+		return 1;
+	}
+	real32 targetSecondsPerFrame = 1.0f / (real32)gameUpdateHz;
+
+	thread_context thread;
+	memset(&thread, 0, sizeof(thread));
+
+	linux_input_script* script = 0;
+	if (scriptFilename) {
+		debug_read_file_result scriptFile = DEBUGPlatformReadEntireFile(&thread, scriptFilename);
+		script = (linux_input_script*)malloc(sizeof(linux_input_script));
+		bool32 isScriptValid = (scriptFile.mContents && script &&
+			LinuxLoadInputScript(script, (char*)scriptFile.mContents, scriptFile.mContentsSize));
+		DEBUGPlatformFreeFileMemory(&thread, scriptFile.mContents);
+		if (!isScriptValid) {
+			fprintf(stderr, "Could not load the input script %s\n", scriptFilename);
+			return 1;
+		}
+	}
+
+#if ENGINE_INTERNAL
+	// Same base address as the Windows host so pointers in recorded state line up
+	void* baseAddress = (void*)Terabytes(2);
+#else
+	void* baseAddress = 0;
+#endif
+	// Game Memory
+	game_memory gameMemory;
+	memset(&gameMemory, 0, sizeof(gameMemory));
+	gameMemory.mPermanentStorageSize = Megabytes(64);
+	gameMemory.mTransientStorageSize = Gigabytes(1);
+	gameMemory.DEBUGPlatformReadEntireFile = DEBUGPlatformReadEntireFile;
+	gameMemory.DEBUGPlatformWriteEntireFile = DEBUGPlatformWriteEntireFile;
+	gameMemory.DEBUGPlatformFreeFileMemory = DEBUGPlatformFreeFileMemory;
+	gameMemory.PlatformMapFile = PlatformMapFile;
+	gameMemory.PlatformFlushMappedFile = PlatformFlushMappedFile;
+	gameMemory.PlatformUnmapFile = PlatformUnmapFile;
+	gameMemory.PlatformMapFileView = PlatformMapFileView;
+	gameMemory.PlatformPrefetchFileView = PlatformPrefetchFileView;
+	gameMemory.PlatformUnmapFileView = PlatformUnmapFileView;
+
+	LinuxMakeFileReader(&gFileReader, &gFileReadQueue, allowIoRing);
+	gameMemory.PlatformOpenFile = PlatformOpenFile;
+	gameMemory.PlatformCloseFile = PlatformCloseFile;
+	gameMemory.PlatformReadDataFromFile = LinuxReadDataFromFile;
+	gameMemory.PlatformWaitForReads = LinuxWaitForReads;
+
+	// The main thread works the high priority queue too while it waits on it
+	long coreCount = sysconf(_SC_NPROCESSORS_ONLN);
+	uint32 highPriorityThreadCount = (coreCount > 1) ? (uint32)(coreCount - 1) : 1;
+	LinuxMakeQueue(&gHighPriorityQueue, highPriorityThreadCount, false);
+	LinuxMakeQueue(&gLowPriorityQueue, 2, true);
+	gameMemory.mHighPriorityQueue = &gHighPriorityQueue;
+	gameMemory.mLowPriorityQueue = &gLowPriorityQueue;
+	gameMemory.PlatformAddEntry = LinuxAddEntry;
+	gameMemory.PlatformCompleteAllWork = LinuxCompleteAllWork;
+
+	LinuxMakeScheduler(&gScheduler, highPriorityThreadCount);
+	gameMemory.mScheduler = &gScheduler;
+	gameMemory.PlatformParallelFor = LinuxParallelFor;
+
+	// Without a table every TIMED_BLOCK is a load and a branch
+	linux_profiler* profiler = 0;
+	if (isProfiling || traceFilename) {
+		profiler = LinuxMakeProfiler(traceFilename);
+		if (!profiler) {
+			return 1;
+		}
+		gameMemory.mDebugTable = profiler->table;
+		gDebugTable = profiler->table;
+	}
+
+	state.totalSize = gameMemory.mPermanentStorageSize + gameMemory.mTransientStorageSize;
+	// Anonymous pages come back zeroed and are only backed once the game touches them
+	state.gameMemoryBlock = mmap(baseAddress, (size_t)state.totalSize, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (state.gameMemoryBlock == MAP_FAILED) {
+		fprintf(stderr, "Could not allocate %llu bytes of game memory\n", (unsigned long long)state.totalSize);
+		return 1;
+	}
+	gameMemory.mPermanentStorage = state.gameMemoryBlock;
+	gameMemory.mTransientStorage = ((uint8*)gameMemory.mPermanentStorage +
+		gameMemory.mPermanentStorageSize);
+
+	// Screen
+	linux_offscreen_buffer backBuffer;
+	backBuffer.mWidth = bufferWidth;
+	backBuffer.mHeight = bufferHeight;
+	backBuffer.mBytesPerPixel = 4;
+	backBuffer.mPitch = bufferWidth*backBuffer.mBytesPerPixel;
+	backBuffer.mMemory = mmap(0, (size_t)backBuffer.mPitch*bufferHeight, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	// Sound is made every frame like the Windows host does, then thrown away
+	int soundSampleCount = LINUX_SAMPLES_PER_SECOND / gameUpdateHz;
+	int16* samples = (int16*)malloc((size_t)soundSampleCount*2*sizeof(int16));
+
+	uint32 timingCapacity = frameCount ? frameCount : LINUX_ENDLESS_TIMING_COUNT;
+	linux_frame_timing* timings = (linux_frame_timing*)malloc(timingCapacity*sizeof(linux_frame_timing));
+
+	if ((backBuffer.mMemory == MAP_FAILED) || !samples || !timings) {
+		fprintf(stderr, "Could not allocate the frame buffers\n");
+		return 1;
+	}
+
+	// The build directory is the one the game code is in
+	char tempGameCodeSOFullPath[LINUX_STATE_FILE_NAME_COUNT];
+	LinuxBuildTempGameCodeFilename(sourceGameCodeSOFullPath, 0, sizeof(tempGameCodeSOFullPath), tempGameCodeSOFullPath);
+	char gameCodeLockFullPath[LINUX_STATE_FILE_NAME_COUNT];
+	LinuxBuildSiblingFilename(sourceGameCodeSOFullPath, "lock.tmp", sizeof(gameCodeLockFullPath), gameCodeLockFullPath);
+
+	// Watch before loading so a build that lands in between is not missed
+	linux_game_code_watch gameCodeWatch;
+	LinuxBeginWatchingGameCode(&gameCodeWatch, sourceGameCodeSOFullPath, gameCodeLockFullPath);
+
+	// Load in the platform independent code
+	linux_game_code game = LinuxLoadGameCode(sourceGameCodeSOFullPath, tempGameCodeSOFullPath, gameCodeLockFullPath);
+	if (!game.isValid) {
+		return 1;
+	}
+
+	if (recordFilename) {
+		LinuxBeginRecordingInput(&state, recordFilename);
+	}
+	if (playbackFilename) {
+		LinuxBeginInputPlayback(&state, playbackFilename);
+		if (state.playbackFile < 0) {
+			return 1;
+		}
+	}
+
+	game_input input[2];
+	memset(input, 0, sizeof(input));
+	game_input* newInput = &input[0];
+	game_input* oldInput = &input[1];
+
+	// Ctrl-C ends the run and still prints the report
+	gRunning = true;
+	signal(SIGINT, LinuxHandleInterrupt);
+
+	uint64 timedFrameCount = 0;
+	uint64 totalFrameCount = (uint64)warmupFrameCount + frameCount;
+	uint64 targetNanosecondsPerFrame = 1000000000ULL / (uint64)gameUpdateHz;
+	uint64 frameStartCounter = LinuxGetWallClock();
+	for (uint64 frameIndex = 0; gRunning && (!frameCount || (frameIndex < totalFrameCount)); ++frameIndex) {
+		// New game code only ever comes in between frames, game_memory is untouched by the swap
+		if (LinuxGameCodeChanged(&gameCodeWatch)) {
+			LinuxReloadGameCode(&gameCodeWatch, &game, profiler, sourceGameCodeSOFullPath, gameCodeLockFullPath);
+		}
+
+		newInput->deltaTime = targetSecondsPerFrame;
+
+		// The keyboard controller keeps its buttons down until the script lets go of them
+		game_controller_input* oldKeyboardController = GetController(oldInput, 0);
+		game_controller_input* newKeyboardController = GetController(newInput, 0);
+		memset(newKeyboardController, 0, sizeof(game_controller_input));
+		newKeyboardController->IsConnected = true;
+		for (uint32 buttonIndex = 0; buttonIndex < ArrayCount(newKeyboardController->mButtons); ++buttonIndex) {
+			newKeyboardController->mButtons[buttonIndex].EndedDown =
+				oldKeyboardController->mButtons[buttonIndex].EndedDown;
+		}
+		if (script) {
+			LinuxPlayInputScript(script, newKeyboardController);
+		}
+
+		// linux_state looping
+		if (state.recordingFile >= 0) {
+			LinuxRecordInput(&state, newInput);
+		}
+		if (state.playbackFile >= 0) {
+			LinuxPlaybackInput(&state, newInput);
+		}
+
+		game_offscreen_buffer screenBuffer;
+		screenBuffer.mMemory = backBuffer.mMemory;
+		screenBuffer.mWidth = backBuffer.mWidth;
+		screenBuffer.mHeight = backBuffer.mHeight;
+		screenBuffer.mPitch = backBuffer.mPitch;
+		screenBuffer.mBytesPerPixel = backBuffer.mBytesPerPixel;
+
+		game_sound_output_buffer soundBuffer;
+		soundBuffer.mSamplesPerSecond = LINUX_SAMPLES_PER_SECOND;
+		soundBuffer.mSampleCount = soundSampleCount;
+		soundBuffer.mSamples = samples;
+
+		uint64 startCounter = LinuxGetWallClock();
+		uint64 startCycleCount = __rdtsc();
+
+		// Pass everything off to the game
+		{
+			TIMED_BLOCK("Frame");
+			if (game.updateAndRender) {
+				game.updateAndRender(&thread, &gameMemory, newInput, &screenBuffer);
+			}
+			if (game.getSoundSamples) {
+				game.getSoundSamples(&thread, &gameMemory, &soundBuffer);
+			}
+		}
+
+		uint64 endCycleCount = __rdtsc();
+		uint64 endCounter = LinuxGetWallClock();
+
+		if (frameIndex >= warmupFrameCount) {
+			linux_frame_timing* timing = timings + (timedFrameCount++ % timingCapacity);
+			timing->nanoseconds = endCounter - startCounter;
+			timing->cycles = endCycleCount - startCycleCount;
+		}
+		if (profiler) {
+			LinuxEndProfileFrame(profiler, frameIndex >= warmupFrameCount);
+		}
+
+		game_input* temp = newInput;
+		newInput = oldInput;
+		oldInput = temp;
+
+		if (isRealtime) {
+			frameStartCounter += targetNanosecondsPerFrame;
+			timespec frameEnd;
+			frameEnd.tv_sec = (time_t)(frameStartCounter / 1000000000ULL);
+			frameEnd.tv_nsec = (long)(frameStartCounter % 1000000000ULL);
+			clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &frameEnd, 0);
+
+			// A missed frame (a breakpoint, a slow reload) does not make the next ones rush to catch up
+			uint64 now = LinuxGetWallClock();
+			if (now > (frameStartCounter + targetNanosecondsPerFrame)) {
+				frameStartCounter = now;
+			}
+		}
+	}
+
+	LinuxEndRecordingInput(&state);
+	LinuxEndInputPlayback(&state);
+
+	// Endless runs only kept the latest frames
+	uint32 timingCount = (uint32)((timedFrameCount < timingCapacity) ? timedFrameCount : timingCapacity);
+	if (csvFilename) {
+		FILE* csvFile = fopen(csvFilename, "w");
+		if (csvFile) {
+			fprintf(csvFile, "frame,nanoseconds,cycles\n");
+			for (uint64 frameIndex = timedFrameCount - timingCount; frameIndex < timedFrameCount; ++frameIndex) {
+				linux_frame_timing* timing = timings + (frameIndex % timingCapacity);
+				fprintf(csvFile, "%llu,%llu,%llu\n", (unsigned long long)frameIndex,
+					(unsigned long long)timing->nanoseconds,
+					(unsigned long long)timing->cycles);
+			}
+			fclose(csvFile);
+		}
+		else {
+			fprintf(stderr, "Could not write %s\n", csvFilename);
+		}
+	}
+
+	printf("final frame hash %08x\n", HashOffscreenBuffer(&backBuffer));
+	if (gameCodeWatch.reloadCount) {
+		printf("game code reloaded %u times\n", gameCodeWatch.reloadCount);
+	}
+	LinuxReportFrameTimings(timings, timingCount);
+
+	LinuxCompleteAllWork(&gHighPriorityQueue);
+	LinuxCompleteAllWork(&gLowPriorityQueue);
+	if (profiler) {
+		LinuxCollateDebugEvents(profiler);
+		LinuxEndTrace(profiler);
+		if (isProfiling) {
+			LinuxReportProfile(profiler);
+		}
+	}
+	LinuxUnloadGameCode(&game);
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,243 @@
+#if !defined(LINUX_ENGINE_H)
+
+/*
+ * Author: Jheremy Strom
+ */
+
+/*
+ * Headless host for running the engine on Linux. Nothing is shown or played, the frames are drawn
+ * into memory as fast as the game can make them and the time each one took is reported.
+ */
+
+struct linux_offscreen_buffer {
+	//  Pixels are always 32-bit wide, Memory order BB GG RR XX
+	void* mMemory;
+	int mWidth;
+	int mHeight;
+	int mPitch;
+	int mBytesPerPixel;
+};
+
+struct linux_game_code {
+	void* gameCodeSO;
+
+	// Both callbacks can be NULL, check before calling
+	game_update_and_render* updateAndRender;
+	game_get_sound_samples* getSoundSamples;
+
+	bool32 isValid;
+};
+
+// Rebuilds are noticed through inotify on the build directory instead of checking the file every frame
+struct linux_game_code_watch {
+	int notifyFile;
+	char* sourceSOFilename;  // Name inside the watched directory
+	char* lockFilename;
+
+	// Set by a change to either file, stays set until a reload works
+	bool32 needsReload;
+	uint32 reloadCount;
+};
+
+/*
+ * Bounded lock-free queue any thread can add to and take from. Every entry carries a sequence number
+ * that says whether it is free for the writer or filled for a reader at the current lap around the ring.
+ */
+struct platform_work_queue_entry {
+	uint32 volatile sequence;
+	platform_work_queue_callback* callback;
+	void* data;
+};
+
+// Must be a power of two
+#define LINUX_WORK_QUEUE_ENTRY_COUNT 256
+struct platform_work_queue {
+	uint32 volatile completionGoal;
+	uint32 volatile completionCount;
+
+	// Writers and readers race on different cache lines
+	alignas(64) uint32 volatile nextEntryToWrite;
+	alignas(64) uint32 volatile nextEntryToRead;
+
+	// Posted once per entry, sleeping workers wait on it
+	sem_t semaphore;
+
+	platform_work_queue_entry entries[LINUX_WORK_QUEUE_ENTRY_COUNT];
+};
+
+// A ParallelFor call, it lives on the caller's stack until every piece has finished
+struct linux_parallel_for_job {
+	parallel_for_callback* callback;
+	void* data;
+	uint32 grain;
+	uint32 volatile pendingCount;
+};
+
+struct linux_steal_range {
+	linux_parallel_for_job* job;
+	uint32 begin;
+	uint32 end;
+};
+
+/*
+ * Chase-Lev deque. The owner pushes and pops at the bottom without contention, thieves take the oldest
+ * (largest) pieces from the top with a compare exchange. Only the last piece is ever raced for.
+ */
+#define LINUX_STEAL_DEQUE_ENTRY_COUNT 256
+struct linux_steal_deque {
+	alignas(64) uint64 volatile top;
+	alignas(64) uint64 volatile bottom;
+	linux_steal_range entries[LINUX_STEAL_DEQUE_ENTRY_COUNT];
+};
+
+// Workers, the main thread and any queue thread that calls ParallelFor each take a deque
+#define LINUX_MAX_STEAL_DEQUE_COUNT 64
+struct platform_scheduler {
+	uint32 volatile dequeCount;
+
+	// Idle workers sleep on the futex at wakeSequence, pushes bump it when anyone sleeps
+	alignas(64) uint32 volatile wakeSequence;
+	uint32 volatile sleeperCount;
+
+	linux_steal_deque deques[LINUX_MAX_STEAL_DEQUE_COUNT];
+};
+
+// A read in flight. Big reads go out a piece at a time and a short read carries on from where it stopped.
+struct linux_file_read {
+	int fileHandle;
+	uint64 offset;
+	uint64 size;
+	uint8* dest;
+	platform_read_fence* fence;
+	bool32 failed;
+
+	struct iovec pieceVector;
+	uint32 nextFree;
+};
+
+#define LINUX_FILE_READ_COUNT 256
+#define LINUX_MAX_READ_PIECE_SIZE Megabytes(64)
+
+// The rings io_uring shares with the kernel, mapped at setup
+struct linux_io_ring {
+	int ringFile;
+
+	uint32 volatile* submitHead;
+	uint32 volatile* submitTail;
+	uint32 submitMask;
+	uint32* submitArray;
+	struct io_uring_sqe* submitEntries;
+
+	uint32 volatile* completeHead;
+	uint32 volatile* completeTail;
+	uint32 completeMask;
+	struct io_uring_cqe* completeEntries;
+};
+
+/*
+ * Reads go to io_uring when the kernel has it, a thread reaps the completions and settles the fences.
+ * Otherwise the read queue's threads each pread one read at a time.
+ */
+struct linux_file_reader {
+	bool32 hasRing;
+	linux_io_ring ring;
+	platform_work_queue* readQueue;
+
+	// Guards the free list and the submission ring
+	pthread_mutex_t mutex;
+	uint32 firstFree;
+	linux_file_read reads[LINUX_FILE_READ_COUNT];
+};
+
+// One line of an input script, the buttons are held down for the whole step
+struct linux_script_step {
+	uint32 frameCount;
+	uint32 buttonsDown;  // Bit per button of game_controller_input::mButtons
+};
+
+#define LINUX_MAX_SCRIPT_STEP_COUNT 4096
+struct linux_input_script {
+	linux_script_step steps[LINUX_MAX_SCRIPT_STEP_COUNT];
+	uint32 stepCount;
+
+	uint32 stepIndex;
+	uint32 framesLeftInStep;
+};
+
+// How long each frame took, kept for every frame so the report can sort them
+struct linux_frame_timing {
+	uint64 nanoseconds;
+	uint64 cycles;
+};
+
+/*
+ * The profiler drains the TIMED_BLOCK rings between frames. Blocks are matched up per thread, added
+ * into per name totals and, with a trace file open, written out as Chrome trace events.
+ */
+#define LINUX_PROFILE_MAX_BLOCK_COUNT 256
+// Must be a power of two, and more than the block count so the lookup always finds an empty slot
+#define LINUX_PROFILE_BLOCK_SLOT_COUNT 512
+#define LINUX_PROFILE_MAX_DEPTH 64
+
+// Everything timed under one name
+struct linux_profile_block {
+	char* name;  // Our own copy, the game's strings go away on a reload
+	uint32 nameHash;
+
+	// This frame's, cleared once they are added to the totals
+	uint32 frameCallCount;
+	uint64 frameInclusiveCycles;
+	uint64 frameSelfCycles;
+
+	// Over the timed frames
+	uint64 callCount;
+	uint64 inclusiveCycles;
+	uint64 selfCycles;
+	uint64 maxFrameInclusiveCycles;
+};
+
+struct linux_profile_open_block {
+	uint32 blockIndex;
+	uint64 beginClock;
+	uint64 childCycles;
+};
+
+// The blocks a ring's thread is inside of, innermost last
+struct linux_profile_thread {
+	linux_profile_open_block openBlocks[LINUX_PROFILE_MAX_DEPTH];
+	uint32 openCount;
+	uint32 droppedCount;  // The ring's count when it was last drained
+	bool32 isNamed;
+};
+
+struct linux_profiler {
+	debug_table* table;
+
+	uint32 blockIndexPlusOne[LINUX_PROFILE_BLOCK_SLOT_COUNT];
+	linux_profile_block blocks[LINUX_PROFILE_MAX_BLOCK_COUNT];
+	uint32 blockCount;
+	uint64 timedFrameCount;
+	uint64 droppedCount;
+
+	linux_profile_thread threads[DEBUG_MAX_THREAD_COUNT];
+
+	FILE* traceFile;
+	uint64 traceEventCount;
+	uint64 firstClock;
+	real64 cyclesPerMicrosecond;
+};
+
+#define LINUX_STATE_FILE_NAME_COUNT 4096
+struct linux_state {
+	uint64 totalSize;
+	void* gameMemoryBlock;
+
+	int recordingFile;
+	int playbackFile;
+
+	char EXEFilename[LINUX_STATE_FILE_NAME_COUNT];
+	char* onePastLastEXEFilenameSlash;
+};
+
+#define LINUX_ENGINE_H
+#endif
\ No newline at end of file
@@ -9,6 +9,7 @@
 #include <xinput.h>
 #include <dsound.h>
 // C runtime library
+#include <limits.h>
 #include <stdio.h>
 
 #include "win32_engine.h"
@@ -31,8 +32,8 @@ global_variable WINDOWPLACEMENT gWindowPosition = { sizeof(gWindowPosition) };
 
 // Concatenate two C-strings
 internal void
-CatStrings(size_t sourceACount, char* sourceA,
-			size_t sourceBCount, char* sourceB,
+CatStrings(size_t sourceACount, const char* sourceA,
+			size_t sourceBCount, const char* sourceB,
 			size_t destCount, char* dest) {
 
 	// Dest bounds checking
@@ -47,7 +48,7 @@ CatStrings(size_t sourceACount, char* sourceA,
 
 // Return the length of a C-string
 internal int
-StringLength(char* pString) {
+StringLength(const char* pString) {
 	int count = 0;
 	while (*pString++) {
 		++count;
@@ -68,7 +69,7 @@ Win32GetEXEFilename(win32_state* state) {
 }
 
 internal void
-Win32BuildEXEPathFilename(win32_state* state, char* filename, int destSize, char* dest) {
+Win32BuildEXEPathFilename(win32_state* state, const char* filename, int destSize, char* dest) {
 	CatStrings(state->onePastLastEXEFilenameSlash - state->EXEFilename, state->EXEFilename,
 		StringLength(filename), filename,
 		destSize, dest);
@@ -152,8 +153,664 @@ DEBUG_PLATFORM_WRITE_ENTIRE_FILE(DEBUGPlatformWriteEntireFile) {
 	return result;
 }
 
+// Map a file read/write, growing it to the minimum size if needed
+PLATFORM_MAP_FILE(PlatformMapFile) {
+	platform_mapped_file result;
+	ZeroMemory(&result, sizeof(platform_mapped_file));
+
+	HANDLE fileHandle = CreateFileA(pFilename, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, 0, OPEN_ALWAYS, 0, 0);
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER fileSize;
+		if (GetFileSizeEx(fileHandle, &fileSize)) {
+			uint64 mapSize = (uint64)fileSize.QuadPart;
+			if (mapSize < pMinimumSize) {
+				mapSize = pMinimumSize;
+				result.mWasCreated = true;
+			}
+
+			LARGE_INTEGER maxSize;
+			maxSize.QuadPart = mapSize;
+			// Mapping past the end of the file extends it with zeros
+			HANDLE mapHandle = CreateFileMapping(fileHandle, 0, PAGE_READWRITE,
+				maxSize.HighPart, maxSize.LowPart, 0);
+			if (mapHandle) {
+				result.mMemory = MapViewOfFile(mapHandle, FILE_MAP_ALL_ACCESS, 0, 0, (SIZE_T)mapSize);
+				if (result.mMemory) {
+					result.mSize = mapSize;
+					result.mPlatformFileHandle = fileHandle;
+					result.mPlatformMapHandle = mapHandle;
+				}
+				else {
+					// TODO: Logging
+					CloseHandle(mapHandle);
+				}
+			}
+			else {
+				// TODO: Logging
+			}
+		}
+
+		if (!result.mMemory) {
+			CloseHandle(fileHandle);
+			result.mWasCreated = false;
+		}
+	}
+	else {
+		// TODO: Logging, could not open the file
+	}
+
+	return result;
+}
+
+PLATFORM_FLUSH_MAPPED_FILE(PlatformFlushMappedFile) {
+	bool32 result = false;
+
+	if (pMappedFile->mMemory) {
+		Assert((pOffset + pSize) <= pMappedFile->mSize);
+		result = (FlushViewOfFile((uint8*)pMappedFile->mMemory + pOffset, (SIZE_T)pSize) != 0);
+	}
+
+	return result;
+}
+
+PLATFORM_UNMAP_FILE(PlatformUnmapFile) {
+	if (pMappedFile->mMemory) {
+		UnmapViewOfFile(pMappedFile->mMemory);
+		CloseHandle((HANDLE)pMappedFile->mPlatformMapHandle);
+		CloseHandle((HANDLE)pMappedFile->mPlatformFileHandle);
+	}
+	ZeroMemory(pMappedFile, sizeof(platform_mapped_file));
+}
+
+PLATFORM_PREFETCH_FILE_VIEW(PlatformPrefetchFileView) {
+	if (pView->mMemory && pSize) {
+		Assert((pOffset + pSize) <= pView->mSize);
+		WIN32_MEMORY_RANGE_ENTRY range;
+		range.VirtualAddress = (uint8*)pView->mMemory + pOffset;
+		range.NumberOfBytes = (SIZE_T)pSize;
+		PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+	}
+}
+
+// Map part of a file read only, the view keeps the file and the mapping open on its own
+PLATFORM_MAP_FILE_VIEW(PlatformMapFileView) {
+	platform_file_view result;
+	ZeroMemory(&result, sizeof(platform_file_view));
+
+	DWORD fileFlags = (pAccessHints & PLATFORM_VIEW_ACCESS_SEQUENTIAL) ? FILE_FLAG_SEQUENTIAL_SCAN : 0;
+	HANDLE fileHandle = CreateFileA(pFilename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, fileFlags, 0);
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER fileSize;
+		if (GetFileSizeEx(fileHandle, &fileSize) && (pOffset < (uint64)fileSize.QuadPart)) {
+			uint64 viewSize = pSize ? pSize : ((uint64)fileSize.QuadPart - pOffset);
+			HANDLE mapHandle = 0;
+			if (viewSize <= ((uint64)fileSize.QuadPart - pOffset)) {
+				mapHandle = CreateFileMapping(fileHandle, 0, PAGE_READONLY, 0, 0, 0);
+			}
+
+			if (mapHandle) {
+				// Views start on the allocation granularity, not just the page size
+				SYSTEM_INFO systemInfo;
+				GetSystemInfo(&systemInfo);
+				uint64 granularity = (uint64)systemInfo.dwAllocationGranularity;
+				uint64 alignedOffset = pOffset & ~(granularity - 1);
+				uint64 mapSize = viewSize + (pOffset - alignedOffset);
+				void* memory = MapViewOfFile(mapHandle, FILE_MAP_READ, (DWORD)(alignedOffset >> 32),
+					(DWORD)(alignedOffset & 0xFFFFFFFF), (SIZE_T)mapSize);
+				if (memory) {
+					result.mMemory = (uint8*)memory + (pOffset - alignedOffset);
+					result.mSize = viewSize;
+					result.mPlatformBase = memory;
+					result.mPlatformSize = mapSize;
+					if (pAccessHints & PLATFORM_VIEW_ACCESS_WILL_NEED) {
+						PlatformPrefetchFileView(&result, 0, viewSize);
+					}
+				}
+				else {
+					// TODO: Logging
+				}
+				CloseHandle(mapHandle);
+			}
+		}
+
+		CloseHandle(fileHandle);
+	}
+	else {
+		// TODO: Logging, could not open the file
+	}
+
+	return result;
+}
+
+PLATFORM_UNMAP_FILE_VIEW(PlatformUnmapFileView) {
+	if (pView->mMemory) {
+		UnmapViewOfFile(pView->mPlatformBase);
+	}
+	ZeroMemory(pView, sizeof(platform_file_view));
+}
+
 /* END File I/O */
 
+/* START Work Queues */
+
+global_variable platform_work_queue gHighPriorityQueue;
+global_variable platform_work_queue gLowPriorityQueue;
+
+PLATFORM_ADD_ENTRY(Win32AddEntry) {
+	uint32 mask = WIN32_WORK_QUEUE_ENTRY_COUNT - 1;
+	platform_work_queue_entry* entry = 0;
+	uint32 entryToWrite = pQueue->nextEntryToWrite;
+	for (;;) {
+		entry = pQueue->entries + (entryToWrite & mask);
+		uint32 sequence = entry->sequence;
+		CompletePreviousReadsBeforeFutureReads;
+		int32 difference = (int32)(sequence - entryToWrite);
+		if (difference == 0) {
+			// The entry is free on this lap, claim it
+			uint32 original = AtomicCompareExchangeUInt32(&pQueue->nextEntryToWrite, entryToWrite + 1, entryToWrite);
+			if (original == entryToWrite) {
+				break;
+			}
+			entryToWrite = original;
+		}
+		else if (difference < 0) {
+			// The reader has not freed the entry from the last lap, the queue is full
+			entry = 0;
+			break;
+		}
+		else {
+			entryToWrite = pQueue->nextEntryToWrite;
+		}
+	}
+
+	if (entry) {
+		entry->callback = pCallback;
+		entry->data = pData;
+		// Counted before it is published so CompleteAllWork can never see the entry finish before it is owed
+		AtomicAddUInt32(&pQueue->completionGoal, 1);
+		CompletePreviousWritesBeforeFutureWrites;
+		entry->sequence = entryToWrite + 1;
+		ReleaseSemaphore(pQueue->semaphoreHandle, 1, 0);
+	}
+	else {
+		pCallback(pQueue, pData);
+	}
+}
+
+// Returns false when there was nothing to take
+internal bool32
+Win32DoNextWorkQueueEntry(platform_work_queue* queue) {
+	uint32 mask = WIN32_WORK_QUEUE_ENTRY_COUNT - 1;
+	uint32 entryToRead = queue->nextEntryToRead;
+	for (;;) {
+		platform_work_queue_entry* entry = queue->entries + (entryToRead & mask);
+		uint32 sequence = entry->sequence;
+		CompletePreviousReadsBeforeFutureReads;
+		int32 difference = (int32)(sequence - (entryToRead + 1));
+		if (difference == 0) {
+			uint32 original = AtomicCompareExchangeUInt32(&queue->nextEntryToRead, entryToRead + 1, entryToRead);
+			if (original == entryToRead) {
+				platform_work_queue_callback* callback = entry->callback;
+				void* data = entry->data;
+				CompletePreviousReadsBeforeFutureReads;
+				// Hand the entry back to the writers for the next lap
+				entry->sequence = entryToRead + WIN32_WORK_QUEUE_ENTRY_COUNT;
+
+				callback(queue, data);
+				CompletePreviousWritesBeforeFutureWrites;
+				AtomicAddUInt32(&queue->completionCount, 1);
+				return true;
+			}
+			entryToRead = original;
+		}
+		else if (difference < 0) {
+			// Nothing has been written here on this lap
+			return false;
+		}
+		else {
+			entryToRead = queue->nextEntryToRead;
+		}
+	}
+}
+
+PLATFORM_COMPLETE_ALL_WORK(Win32CompleteAllWork) {
+	while (pQueue->completionCount != pQueue->completionGoal) {
+		if (!Win32DoNextWorkQueueEntry(pQueue)) {
+			// The last entries are running on other threads
+			_mm_pause();
+		}
+	}
+}
+
+DWORD WINAPI
+Win32WorkerThreadProc(LPVOID parameter) {
+	platform_work_queue* queue = (platform_work_queue*)parameter;
+	for (;;) {
+		if (!Win32DoNextWorkQueueEntry(queue)) {
+			WaitForSingleObjectEx(queue->semaphoreHandle, INFINITE, FALSE);
+		}
+	}
+	return 0;
+}
+
+internal void
+Win32MakeQueue(platform_work_queue* queue, uint32 threadCount, bool32 isLowPriority) {
+	queue->completionGoal = 0;
+	queue->completionCount = 0;
+	queue->nextEntryToWrite = 0;
+	queue->nextEntryToRead = 0;
+	for (uint32 entryIndex = 0; entryIndex < WIN32_WORK_QUEUE_ENTRY_COUNT; ++entryIndex) {
+		queue->entries[entryIndex].sequence = entryIndex;
+	}
+	queue->semaphoreHandle = CreateSemaphoreEx(0, 0, WIN32_WORK_QUEUE_ENTRY_COUNT, 0, 0, SEMAPHORE_ALL_ACCESS);
+
+	for (uint32 threadIndex = 0; threadIndex < threadCount; ++threadIndex) {
+		DWORD threadID;
+		HANDLE threadHandle = CreateThread(0, 0, Win32WorkerThreadProc, queue, 0, &threadID);
+		if (threadHandle) {
+			if (isLowPriority) {
+				// Loads and generation give way to the frame
+				SetThreadPriority(threadHandle, THREAD_PRIORITY_BELOW_NORMAL);
+			}
+			CloseHandle(threadHandle);
+		}
+	}
+}
+
+/* END Work Queues */
+
+/* START Work Stealing */
+
+global_variable platform_scheduler gScheduler;
+
+// One past the calling thread's deque index, zero until the thread first needs one
+global_variable __declspec(thread) uint32 gThreadDequeIndexPlusOne;
+global_variable __declspec(thread) uint32 gThreadRandomState;
+
+// WaitOnAddress is the Windows futex
+internal void
+Win32FutexWait(uint32 volatile* address, uint32 expected) {
+	WaitOnAddress(address, &expected, sizeof(expected), INFINITE);
+}
+
+internal void
+Win32FutexWake(uint32 volatile* address, int wakeCount) {
+	if (wakeCount == 1) {
+		WakeByAddressSingle((PVOID)address);
+	}
+	else {
+		WakeByAddressAll((PVOID)address);
+	}
+}
+
+// Null when every deque is taken, the caller then runs its range alone
+internal win32_steal_deque*
+Win32GetThreadDeque(platform_scheduler* scheduler) {
+	if (!gThreadDequeIndexPlusOne) {
+		uint32 dequeIndex = AtomicAddUInt32(&scheduler->dequeCount, 1);
+		if (dequeIndex >= WIN32_MAX_STEAL_DEQUE_COUNT) {
+			return 0;
+		}
+		gThreadDequeIndexPlusOne = dequeIndex + 1;
+		gThreadRandomState = 2463534242u + 977*dequeIndex;
+	}
+	win32_steal_deque* result = scheduler->deques + (gThreadDequeIndexPlusOne - 1);
+	return result;
+}
+
+// Returns false when the deque is full
+internal bool32
+Win32PushRange(platform_scheduler* scheduler, win32_steal_deque* deque, win32_steal_range range) {
+	uint64 bottom = deque->bottom;
+	uint64 top = deque->top;
+	if ((bottom - top) >= WIN32_STEAL_DEQUE_ENTRY_COUNT) {
+		return false;
+	}
+
+	deque->entries[bottom % WIN32_STEAL_DEQUE_ENTRY_COUNT] = range;
+	CompletePreviousWritesBeforeFutureWrites;
+	deque->bottom = bottom + 1;
+
+	// A worker going to sleep counts itself before its last look at the deques, so one of the two sees the other
+	CompletePreviousWritesBeforeFutureReads;
+	if (scheduler->sleeperCount) {
+		AtomicAddUInt32(&scheduler->wakeSequence, 1);
+		Win32FutexWake(&scheduler->wakeSequence, 1);
+	}
+	return true;
+}
+
+internal bool32
+Win32PopRange(win32_steal_deque* deque, win32_steal_range* range) {
+	bool32 result = false;
+	uint64 bottom = deque->bottom;
+	if (bottom == deque->top) {
+		return false;
+	}
+
+	bottom -= 1;
+	deque->bottom = bottom;
+	// Thieves must see the smaller bottom before the top is read
+	CompletePreviousWritesBeforeFutureReads;
+	uint64 top = deque->top;
+	if ((int64)(bottom - top) >= 0) {
+		*range = deque->entries[bottom % WIN32_STEAL_DEQUE_ENTRY_COUNT];
+		result = true;
+		if (bottom == top) {
+			// The last piece, a thief may be taking it at the same time
+			result = (AtomicCompareExchangeUInt64(&deque->top, top + 1, top) == top);
+			deque->bottom = top + 1;
+		}
+	}
+	else {
+		deque->bottom = top;
+	}
+	return result;
+}
+
+internal bool32
+Win32StealRange(win32_steal_deque* deque, win32_steal_range* range) {
+	bool32 result = false;
+	uint64 top = deque->top;
+	CompletePreviousReadsBeforeFutureReads;
+	uint64 bottom = deque->bottom;
+	if ((int64)(bottom - top) > 0) {
+		*range = deque->entries[top % WIN32_STEAL_DEQUE_ENTRY_COUNT];
+		CompletePreviousReadsBeforeFutureReads;
+		// A failed exchange means the owner or another thief got it first, the copy is thrown away
+		result = (AtomicCompareExchangeUInt64(&deque->top, top + 1, top) == top);
+	}
+	return result;
+}
+
+// Splits off the upper halves for thieves until the piece is down to the grain, then runs what is left
+internal void
+Win32RunRange(platform_scheduler* scheduler, win32_steal_deque* deque, win32_steal_range range) {
+	win32_parallel_for_job* job = range.job;
+	while ((range.end - range.begin) > job->grain) {
+		uint32 middle = range.begin + (range.end - range.begin) / 2;
+		win32_steal_range upper = { job, middle, range.end };
+		AtomicAddUInt32(&job->pendingCount, 1);
+		if (!Win32PushRange(scheduler, deque, upper)) {
+			AtomicAddUInt32(&job->pendingCount, (uint32)-1);
+			break;
+		}
+		range.end = middle;
+	}
+
+	job->callback(job->data, range.begin, range.end);
+	// The job may be gone from the caller's stack as soon as the count reaches zero
+	CompletePreviousWritesBeforeFutureWrites;
+	AtomicAddUInt32(&job->pendingCount, (uint32)-1);
+}
+
+// Own pieces first, newest first, then the oldest piece of a random other deque
+internal bool32
+Win32RunNextRange(platform_scheduler* scheduler, win32_steal_deque* deque) {
+	win32_steal_range range;
+	bool32 result = Win32PopRange(deque, &range);
+	if (!result) {
+		uint32 dequeCount = scheduler->dequeCount;
+		if (dequeCount > WIN32_MAX_STEAL_DEQUE_COUNT) {
+			dequeCount = WIN32_MAX_STEAL_DEQUE_COUNT;
+		}
+
+		uint32 random = gThreadRandomState;
+		random ^= random << 13;
+		random ^= random >> 17;
+		random ^= random << 5;
+		gThreadRandomState = random;
+
+		for (uint32 attempt = 0; !result && (attempt < dequeCount); ++attempt) {
+			win32_steal_deque* victim = scheduler->deques + ((random + attempt) % dequeCount);
+			if (victim != deque) {
+				result = Win32StealRange(victim, &range);
+			}
+		}
+	}
+
+	if (result) {
+		Win32RunRange(scheduler, deque, range);
+	}
+	return result;
+}
+
+internal bool32
+Win32HasStealableRange(platform_scheduler* scheduler) {
+	bool32 result = false;
+	uint32 dequeCount = scheduler->dequeCount;
+	if (dequeCount > WIN32_MAX_STEAL_DEQUE_COUNT) {
+		dequeCount = WIN32_MAX_STEAL_DEQUE_COUNT;
+	}
+	for (uint32 dequeIndex = 0; !result && (dequeIndex < dequeCount); ++dequeIndex) {
+		win32_steal_deque* deque = scheduler->deques + dequeIndex;
+		result = ((int64)(deque->bottom - deque->top) > 0);
+	}
+	return result;
+}
+
+PLATFORM_PARALLEL_FOR(Win32ParallelFor) {
+	if (pBegin >= pEnd) {
+		return;
+	}
+
+	win32_steal_deque* deque = Win32GetThreadDeque(pScheduler);
+	if (!deque) {
+		pCallback(pData, pBegin, pEnd);
+		return;
+	}
+
+	win32_parallel_for_job job;
+	job.callback = pCallback;
+	job.data = pData;
+	job.grain = pGrain ? pGrain : 1;
+	job.pendingCount = 1;
+
+	win32_steal_range range = { &job, pBegin, pEnd };
+	Win32RunRange(pScheduler, deque, range);
+
+	// Help out, with this job's pieces or anyone else's, until the last of ours is done
+	while (job.pendingCount) {
+		if (!Win32RunNextRange(pScheduler, deque)) {
+			_mm_pause();
+		}
+	}
+}
+
+DWORD WINAPI
+Win32SchedulerThreadProc(LPVOID parameter) {
+	platform_scheduler* scheduler = (platform_scheduler*)parameter;
+	win32_steal_deque* deque = Win32GetThreadDeque(scheduler);
+	if (deque) {
+		for (;;) {
+			// Spin a little before sleeping, pieces tend to come in bursts
+			bool32 didWork = false;
+			for (uint32 spinIndex = 0; !didWork && (spinIndex < 64); ++spinIndex) {
+				didWork = Win32RunNextRange(scheduler, deque);
+				if (!didWork) {
+					_mm_pause();
+				}
+			}
+
+			if (!didWork) {
+				uint32 wakeSequence = scheduler->wakeSequence;
+				AtomicAddUInt32(&scheduler->sleeperCount, 1);
+				if (!Win32HasStealableRange(scheduler)) {
+					Win32FutexWait(&scheduler->wakeSequence, wakeSequence);
+				}
+				AtomicAddUInt32(&scheduler->sleeperCount, (uint32)-1);
+			}
+		}
+	}
+	return 0;
+}
+
+internal void
+Win32MakeScheduler(platform_scheduler* scheduler, uint32 threadCount) {
+	scheduler->dequeCount = 0;
+	scheduler->wakeSequence = 0;
+	scheduler->sleeperCount = 0;
+	for (uint32 threadIndex = 0; threadIndex < threadCount; ++threadIndex) {
+		DWORD threadID;
+		HANDLE threadHandle = CreateThread(0, 0, Win32SchedulerThreadProc, scheduler, 0, &threadID);
+		if (threadHandle) {
+			CloseHandle(threadHandle);
+		}
+	}
+}
+
+/* END Work Stealing */
+
+/* START Async File Reads */
+
+global_variable win32_file_reader gFileReader;
+global_variable platform_work_queue gFileReadQueue;
+
+PLATFORM_OPEN_FILE(PlatformOpenFile) {
+	platform_file_handle result;
+	ZeroMemory(&result, sizeof(platform_file_handle));
+
+	HANDLE fileHandle = CreateFileA(pFilename, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, 0, 0);
+	if (fileHandle != INVALID_HANDLE_VALUE) {
+		LARGE_INTEGER fileSize;
+		if (GetFileSizeEx(fileHandle, &fileSize)) {
+			result.mSize = (uint64)fileSize.QuadPart;
+			result.mIsValid = true;
+			result.mPlatformHandle = fileHandle;
+		}
+		else {
+			CloseHandle(fileHandle);
+		}
+	}
+	else {
+		// TODO: Logging, could not open the file
+	}
+
+	return result;
+}
+
+PLATFORM_CLOSE_FILE(PlatformCloseFile) {
+	if (pFile->mIsValid) {
+		CloseHandle((HANDLE)pFile->mPlatformHandle);
+	}
+	ZeroMemory(pFile, sizeof(platform_file_handle));
+}
+
+// Returns false when the file ended or failed before all of it came in
+internal bool32
+Win32ReadFileBlocking(HANDLE fileHandle, uint64 offset, uint64 size, uint8* dest) {
+	while (size) {
+		// The offset in the OVERLAPPED makes the read positional, threads never fight over a file pointer
+		OVERLAPPED overlapped;
+		ZeroMemory(&overlapped, sizeof(overlapped));
+		overlapped.Offset = (DWORD)(offset & 0xFFFFFFFF);
+		overlapped.OffsetHigh = (DWORD)(offset >> 32);
+
+		DWORD bytesRead = 0;
+		DWORD bytesToRead = (DWORD)Minimum(size, (uint64)WIN32_MAX_READ_PIECE_SIZE);
+		if (!ReadFile(fileHandle, dest, bytesToRead, &bytesRead, &overlapped) || (bytesRead == 0)) {
+			break;
+		}
+		offset += bytesRead;
+		dest += bytesRead;
+		size -= bytesRead;
+	}
+
+	bool32 result = (size == 0);
+	return result;
+}
+
+// The fence is the last thing touched, the game can reuse it as soon as the count drops
+internal void
+Win32SettleReadFence(platform_read_fence* fence, bool32 failed) {
+	if (failed) {
+		AtomicAddUInt32(&fence->mFailedCount, 1);
+	}
+	CompletePreviousWritesBeforeFutureWrites;
+	if (AtomicAddUInt32(&fence->mPendingCount, (uint32)-1) == 1) {
+		Win32FutexWake(&fence->mPendingCount, INT_MAX);
+	}
+}
+
+// Null when every read is in flight
+internal win32_file_read*
+Win32AllocateFileRead(win32_file_reader* reader) {
+	win32_file_read* result = 0;
+	AcquireSRWLockExclusive(&reader->lock);
+	if (reader->firstFree != UInt32Max) {
+		result = reader->reads + reader->firstFree;
+		reader->firstFree = result->nextFree;
+	}
+	ReleaseSRWLockExclusive(&reader->lock);
+	return result;
+}
+
+internal
+PLATFORM_WORK_QUEUE_CALLBACK(Win32DoFileRead) {
+	win32_file_read* read = (win32_file_read*)pData;
+	win32_file_reader* reader = &gFileReader;
+	bool32 failed = !Win32ReadFileBlocking(read->fileHandle, read->offset, read->size, read->dest);
+	platform_read_fence* fence = read->fence;
+
+	AcquireSRWLockExclusive(&reader->lock);
+	read->nextFree = reader->firstFree;
+	reader->firstFree = (uint32)(read - reader->reads);
+	ReleaseSRWLockExclusive(&reader->lock);
+
+	Win32SettleReadFence(fence, failed);
+}
+
+internal void
+Win32MakeFileReader(win32_file_reader* reader, platform_work_queue* readQueue) {
+	InitializeSRWLock(&reader->lock);
+	for (uint32 readIndex = 0; readIndex < WIN32_FILE_READ_COUNT; ++readIndex) {
+		reader->reads[readIndex].nextFree = readIndex + 1;
+	}
+	reader->reads[WIN32_FILE_READ_COUNT - 1].nextFree = UInt32Max;
+	reader->firstFree = 0;
+	reader->readQueue = readQueue;
+
+	// The threads spend their time blocked in ReadFile, a few keep several reads in flight
+	Win32MakeQueue(readQueue, WIN32_FILE_READ_THREAD_COUNT, false);
+}
+
+PLATFORM_READ_DATA_FROM_FILE(Win32ReadDataFromFile) {
+	Assert(pFile->mIsValid);
+	win32_file_reader* reader = &gFileReader;
+	AtomicAddUInt32(&pFence->mPendingCount, 1);
+
+	win32_file_read* read = pSize ? Win32AllocateFileRead(reader) : 0;
+	if (read) {
+		read->fileHandle = (HANDLE)pFile->mPlatformHandle;
+		read->offset = pOffset;
+		read->size = pSize;
+		read->dest = (uint8*)pDest;
+		read->fence = pFence;
+		Win32AddEntry(reader->readQueue, Win32DoFileRead, read);
+	}
+	else {
+		// Nothing to read, or so many reads are in flight that this one is done on the calling thread
+		bool32 failed = !Win32ReadFileBlocking((HANDLE)pFile->mPlatformHandle, pOffset, pSize, (uint8*)pDest);
+		Win32SettleReadFence(pFence, failed);
+	}
+}
+
+PLATFORM_WAIT_FOR_READS(Win32WaitForReads) {
+	for (;;) {
+		uint32 pendingCount = pFence->mPendingCount;
+		if (!pendingCount) {
+			break;
+		}
+		Win32FutexWait(&pFence->mPendingCount, pendingCount);
+	}
+	CompletePreviousReadsBeforeFutureReads;
+
+	bool32 result = (pFence->mFailedCount == 0);
+	return result;
+}
+
+/* END Async File Reads */
+
 /* START Dynamically linking the platform independent code */
 
 // Get the last time the file was written to
@@ -986,6 +1643,34 @@ int CALLBACK WinMain(
 			gameMemory.DEBUGPlatformReadEntireFile = DEBUGPlatformReadEntireFile;
 			gameMemory.DEBUGPlatformWriteEntireFile = DEBUGPlatformWriteEntireFile;
 			gameMemory.DEBUGPlatformFreeFileMemory = DEBUGPlatformFreeFileMemory;
+			gameMemory.PlatformMapFile = PlatformMapFile;
+			gameMemory.PlatformFlushMappedFile = PlatformFlushMappedFile;
+			gameMemory.PlatformUnmapFile = PlatformUnmapFile;
+			gameMemory.PlatformMapFileView = PlatformMapFileView;
+			gameMemory.PlatformPrefetchFileView = PlatformPrefetchFileView;
+			gameMemory.PlatformUnmapFileView = PlatformUnmapFileView;
+
+			Win32MakeFileReader(&gFileReader, &gFileReadQueue);
+			gameMemory.PlatformOpenFile = PlatformOpenFile;
+			gameMemory.PlatformCloseFile = PlatformCloseFile;
+			gameMemory.PlatformReadDataFromFile = Win32ReadDataFromFile;
+			gameMemory.PlatformWaitForReads = Win32WaitForReads;
+
+			// The main thread works the high priority queue too while it waits on it
+			SYSTEM_INFO systemInfo;
+			GetSystemInfo(&systemInfo);
+			uint32 highPriorityThreadCount = (systemInfo.dwNumberOfProcessors > 1) ?
+				(uint32)(systemInfo.dwNumberOfProcessors - 1) : 1;
+			Win32MakeQueue(&gHighPriorityQueue, highPriorityThreadCount, false);
+			Win32MakeQueue(&gLowPriorityQueue, 2, true);
+			gameMemory.mHighPriorityQueue = &gHighPriorityQueue;
+			gameMemory.mLowPriorityQueue = &gLowPriorityQueue;
+			gameMemory.PlatformAddEntry = Win32AddEntry;
+			gameMemory.PlatformCompleteAllWork = Win32CompleteAllWork;
+
+			Win32MakeScheduler(&gScheduler, highPriorityThreadCount);
+			gameMemory.mScheduler = &gScheduler;
+			gameMemory.PlatformParallelFor = Win32ParallelFor;
 
 			state.totalSize = gameMemory.mPermanentStorageSize + gameMemory.mTransientStorageSize;
 			// TODO: Use MEM_LARGE_PAGES and call adjust token privileges when not on Windows XP
@@ -1051,6 +1736,9 @@ int CALLBACK WinMain(
 					newInput->deltaTime = targetSecondsPerFrame;
 					FILETIME newDLLWriteTime = Win32GetLastWriteTime(sourceGameCodeDLLFullPath);
 					if (CompareFileTime(&newDLLWriteTime, &game.DLLLastWriteTime) != 0) {
+						// Queued callbacks point into the old code
+						Win32CompleteAllWork(&gHighPriorityQueue);
+						Win32CompleteAllWork(&gLowPriorityQueue);
 						Win32UnloadGameCode(&game);
 						game = Win32LoadGameCode(sourceGameCodeDLLFullPath, tempGameCodeDLLFullPath, gameCodeLockFullPath);
 						loadCounter = 0;
@@ -49,6 +49,94 @@ struct win32_game_code {
 	bool32 isValid;
 };
 
+/*
+ * Bounded lock-free queue any thread can add to and take from. Every entry carries a sequence number
+ * that says whether it is free for the writer or filled for a reader at the current lap around the ring.
+ */
+struct platform_work_queue_entry {
+	uint32 volatile sequence;
+	platform_work_queue_callback* callback;
+	void* data;
+};
+
+// Must be a power of two
+#define WIN32_WORK_QUEUE_ENTRY_COUNT 256
+struct platform_work_queue {
+	uint32 volatile completionGoal;
+	uint32 volatile completionCount;
+
+	// Writers and readers race on different cache lines
+	__declspec(align(64)) uint32 volatile nextEntryToWrite;
+	__declspec(align(64)) uint32 volatile nextEntryToRead;
+
+	// Released once per entry, sleeping workers wait on it
+	HANDLE semaphoreHandle;
+
+	platform_work_queue_entry entries[WIN32_WORK_QUEUE_ENTRY_COUNT];
+};
+
+// A ParallelFor call, it lives on the caller's stack until every piece has finished
+struct win32_parallel_for_job {
+	parallel_for_callback* callback;
+	void* data;
+	uint32 grain;
+	uint32 volatile pendingCount;
+};
+
+struct win32_steal_range {
+	win32_parallel_for_job* job;
+	uint32 begin;
+	uint32 end;
+};
+
+/*
+ * Chase-Lev deque. The owner pushes and pops at the bottom without contention, thieves take the oldest
+ * (largest) pieces from the top with a compare exchange. Only the last piece is ever raced for.
+ */
+#define WIN32_STEAL_DEQUE_ENTRY_COUNT 256
+struct win32_steal_deque {
+	__declspec(align(64)) uint64 volatile top;
+	__declspec(align(64)) uint64 volatile bottom;
+	win32_steal_range entries[WIN32_STEAL_DEQUE_ENTRY_COUNT];
+};
+
+// Workers, the main thread and any queue thread that calls ParallelFor each take a deque
+#define WIN32_MAX_STEAL_DEQUE_COUNT 64
+struct platform_scheduler {
+	uint32 volatile dequeCount;
+
+	// Idle workers sleep on the futex at wakeSequence, pushes bump it when anyone sleeps
+	__declspec(align(64)) uint32 volatile wakeSequence;
+	uint32 volatile sleeperCount;
+
+	win32_steal_deque deques[WIN32_MAX_STEAL_DEQUE_COUNT];
+};
+
+// A read in flight, the read queue's threads each ReadFile one read at a time
+struct win32_file_read {
+	HANDLE fileHandle;
+	uint64 offset;
+	uint64 size;
+	uint8* dest;
+	platform_read_fence* fence;
+
+	uint32 nextFree;
+};
+
+#define WIN32_FILE_READ_COUNT 256
+#define WIN32_FILE_READ_THREAD_COUNT 4
+// ReadFile takes a DWORD count, big reads go out a piece at a time
+#define WIN32_MAX_READ_PIECE_SIZE Megabytes(64)
+
+struct win32_file_reader {
+	platform_work_queue* readQueue;
+
+	// Guards the free list
+	SRWLOCK lock;
+	uint32 firstFree;
+	win32_file_read reads[WIN32_FILE_READ_COUNT];
+};
+
 #define WIN32_STATE_FILE_NAME_COUNT MAX_PATH
 struct win32_replay_buffer {
 	HANDLE filehandle;